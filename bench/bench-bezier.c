@@ -0,0 +1,255 @@
+/*
+ * Times the batched curve kernels of pw-curve-batch.c for every SIMD level
+ * the CPU has, on as many curves as a big graph has links. Prints one JSON
+ * object per level:
+ *
+ *   {"simd":"avx2","curves":50000,"eval_us":{"median":…,"max":…},
+ *    "bounds_us":{…},"cull_us":{…},"select_us":{…}}
+ *
+ * and one for the scalar rubberband code the canvas used before, as
+ * "simd":"pw-misc".
+ *
+ * With --check it times nothing and instead checks the kernels against the
+ * scalar code of pw-misc.c on the same curves, printing the error counts of
+ * each level, and fails on a mismatch. That is how the test suite runs it.
+ */
+#include "pw-curve-batch.h"
+#include "pw-misc.h"
+
+#define N_CURVES 50000
+#define N_RUNS 51
+#define N_REFERENCE_RUNS 3
+#define CANVAS_W 20000
+#define CANVAS_H 12000
+#define LINK_SPAN 1500
+#define EVAL_TOLERANCE 0.05 // px, floats against doubles
+#define BOUNDS_TOLERANCE 0.1
+#define N_RECTS 32
+
+static const char *const simd_names[] = { "none", "sse", "avx2" };
+
+// like the canvas makes them, from an output port to an input port nearby
+static void
+link_curve (GRand *rand, graphene_point_t *pts)
+{
+  gint x1 = g_rand_int_range (rand, 0, CANVAS_W), y1 = g_rand_int_range (rand, 0, CANVAS_H);
+  gint x2 = x1 + g_rand_int_range (rand, -LINK_SPAN, LINK_SPAN);
+  gint y2 = y1 + g_rand_int_range (rand, -LINK_SPAN, LINK_SPAN);
+  gint ydiff = ABS (y1 - y2), xdiff = ABS (x1 - x2);
+
+  pts[0] = GRAPHENE_POINT_INIT (x1, y1);
+  pts[1] = GRAPHENE_POINT_INIT (x1 + xdiff / 2 + ydiff / 4, y1);
+  pts[2] = GRAPHENE_POINT_INIT (x2 - 10 - xdiff / 2 - ydiff / 4, y2);
+  pts[3] = GRAPHENE_POINT_INIT (x2, y2);
+}
+
+// anything, loops and cusps included
+static void
+random_curve (GRand *rand, graphene_point_t *pts)
+{
+  for (int j = 0; j < 4; j++)
+    pts[j] = GRAPHENE_POINT_INIT (g_rand_int_range (rand, 0, CANVAS_W / 10),
+                                  g_rand_int_range (rand, 0, CANVAS_H / 10));
+}
+
+static void
+random_rect (GRand *rand, graphene_rect_t *rect)
+{
+  graphene_rect_init (rect, g_rand_int_range (rand, 0, CANVAS_W), g_rand_int_range (rand, 0, CANVAS_H),
+                      g_rand_int_range (rand, 10, CANVAS_W / 4), g_rand_int_range (rand, 10, CANVAS_H / 4));
+}
+
+// what the canvas did for a link before the batches
+static gboolean
+reference_select (const graphene_rect_t *rect, const graphene_point_t *pts)
+{
+  graphene_point_t l1 = { rect->origin.x, rect->origin.y };
+  graphene_point_t l2 = { rect->origin.x + rect->size.width, rect->origin.y };
+  graphene_point_t l3 = { rect->origin.x + rect->size.width, rect->origin.y + rect->size.height };
+  graphene_point_t l4 = { rect->origin.x, rect->origin.y + rect->size.height };
+
+  return cbezier_line_intersects (l1, l2, pts[0], pts[1], pts[2], pts[3])
+         || cbezier_line_intersects (l2, l3, pts[0], pts[1], pts[2], pts[3])
+         || cbezier_line_intersects (l4, l3, pts[0], pts[1], pts[2], pts[3])
+         || cbezier_line_intersects (l1, l4, pts[0], pts[1], pts[2], pts[3])
+         || rect_contains_rect (*rect, get_cbezier_bounding_box (pts[0], pts[1], pts[2], pts[3]));
+}
+
+static guint
+check_accuracy (PwCurveBatch *batch, const graphene_point_t *curves, GRand *rand)
+{
+  static const gfloat ts[] = { 0, 0.25, 0.5, 0.8, 1 };
+  g_autofree gfloat *x = g_new (gfloat, batch->n);
+  g_autofree gfloat *y = g_new (gfloat, batch->n);
+  g_autofree guint8 *flags = g_new (guint8, batch->n);
+  guint eval_errors = 0, bounds_errors = 0, line_errors = 0, select_errors = 0;
+  guint n_selected = 0;
+
+  for (guint k = 0; k < G_N_ELEMENTS (ts); k++)
+    {
+      pw_curve_batch_eval (batch, ts[k], x, y);
+      for (guint i = 0; i < batch->n; i++)
+        {
+          const graphene_point_t *p = &curves[i * 4];
+          graphene_point_t ref = curve_get_point (p[0], p[1], p[2], p[3], ts[k]);
+          eval_errors += fabs (x[i] - ref.x) > EVAL_TOLERANCE || fabs (y[i] - ref.y) > EVAL_TOLERANCE;
+        }
+    }
+
+  pw_curve_batch_update_bounds (batch);
+  for (guint i = 0; i < batch->n; i++)
+    {
+      const graphene_point_t *p = &curves[i * 4];
+      graphene_rect_t ref = get_cbezier_bounding_box (p[0], p[1], p[2], p[3]);
+      bounds_errors += fabs (batch->x0[i] - ref.origin.x) > BOUNDS_TOLERANCE
+                       || fabs (batch->y0[i] - ref.origin.y) > BOUNDS_TOLERANCE
+                       || fabs (batch->x1[i] - (ref.origin.x + ref.size.width)) > BOUNDS_TOLERANCE
+                       || fabs (batch->y1[i] - (ref.origin.y + ref.size.height)) > BOUNDS_TOLERANCE;
+    }
+
+  for (guint r = 0; r < N_RECTS; r++)
+    {
+      graphene_rect_t rect;
+      random_rect (rand, &rect);
+
+      graphene_point_t l1 = rect.origin;
+      graphene_point_t l2 = { rect.origin.x + rect.size.width, rect.origin.y };
+      pw_curve_batch_intersect_line (batch, l1, l2, flags);
+      for (guint i = 0; i < batch->n; i++)
+        {
+          const graphene_point_t *p = &curves[i * 4];
+          line_errors += flags[i] != cbezier_line_intersects (l1, l2, p[0], p[1], p[2], p[3]);
+        }
+
+      n_selected += pw_curve_batch_select (batch, &rect, flags);
+      for (guint i = 0; i < batch->n; i++)
+        select_errors += flags[i] != reference_select (&rect, &curves[i * 4]);
+    }
+
+  g_print ("{\"simd\":\"%s\",\"eval_errors\":%u,\"bounds_errors\":%u,\"line_errors\":%u,"
+           "\"select_errors\":%u,\"selected\":%u}\n",
+           simd_names[pw_bezier_get_simd ()], eval_errors, bounds_errors, line_errors,
+           select_errors, n_selected);
+
+  // a curve touching the rubberband within float rounding may go either way
+  return eval_errors + bounds_errors + line_errors + (select_errors > N_RECTS * batch->n / 10000);
+}
+
+static int
+compare_time (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+  return (x > y) - (x < y);
+}
+
+static void
+print_times (const char *name, GArray *times)
+{
+  g_array_sort (times, compare_time);
+  g_print ("\"%s\":{\"median\":%" G_GINT64_FORMAT ",\"max\":%" G_GINT64_FORMAT "}",
+           name, g_array_index (times, gint64, times->len / 2),
+           g_array_index (times, gint64, times->len - 1));
+}
+
+static void
+time_kernels (PwCurveBatch *batch)
+{
+  g_autoptr (GArray) eval = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_autoptr (GArray) bounds = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_autoptr (GArray) cull = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_autoptr (GArray) select = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_autofree gfloat *x = g_new (gfloat, batch->n);
+  g_autofree gfloat *y = g_new (gfloat, batch->n);
+  g_autofree guint *visible = g_new (guint, batch->n);
+  g_autofree guint8 *selected = g_new (guint8, batch->n);
+  graphene_rect_t viewport = GRAPHENE_RECT_INIT (CANVAS_W / 2, CANVAS_H / 2, 1920, 1080);
+  graphene_rect_t rubberband = GRAPHENE_RECT_INIT (CANVAS_W / 3, CANVAS_H / 3, 2000, 1500);
+
+  for (guint r = 0; r < N_RUNS; r++)
+    {
+      gint64 t0 = g_get_monotonic_time ();
+      pw_curve_batch_eval (batch, 0.5, x, y);
+      gint64 t1 = g_get_monotonic_time ();
+      pw_curve_batch_update_bounds (batch);
+      gint64 t2 = g_get_monotonic_time ();
+      pw_curve_batch_cull (batch, &viewport, 2, visible);
+      gint64 t3 = g_get_monotonic_time ();
+      pw_curve_batch_select (batch, &rubberband, selected);
+      gint64 t4 = g_get_monotonic_time ();
+
+      g_array_append_vals (eval, (gint64[]){ t1 - t0 }, 1);
+      g_array_append_vals (bounds, (gint64[]){ t2 - t1 }, 1);
+      g_array_append_vals (cull, (gint64[]){ t3 - t2 }, 1);
+      g_array_append_vals (select, (gint64[]){ t4 - t3 }, 1);
+    }
+
+  g_print ("{\"simd\":\"%s\",\"curves\":%u,", simd_names[pw_bezier_get_simd ()], batch->n);
+  print_times ("eval_us", eval);
+  g_print (",");
+  print_times ("bounds_us", bounds);
+  g_print (",");
+  print_times ("cull_us", cull);
+  g_print (",");
+  print_times ("select_us", select);
+  g_print ("}\n");
+}
+
+static void
+time_reference (const graphene_point_t *curves, guint n)
+{
+  g_autoptr (GArray) select = g_array_new (FALSE, FALSE, sizeof (gint64));
+  graphene_rect_t rubberband = GRAPHENE_RECT_INIT (CANVAS_W / 3, CANVAS_H / 3, 2000, 1500);
+  guint n_selected = 0;
+
+  for (guint r = 0; r < N_REFERENCE_RUNS; r++)
+    {
+      gint64 t0 = g_get_monotonic_time ();
+      for (guint i = 0; i < n; i++)
+        n_selected += reference_select (&rubberband, &curves[i * 4]);
+      g_array_append_vals (select, (gint64[]){ g_get_monotonic_time () - t0 }, 1);
+    }
+
+  g_print ("{\"simd\":\"pw-misc\",\"curves\":%u,", n);
+  print_times ("select_us", select);
+  g_print ("}\n");
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GRand) rand = g_rand_new_with_seed (1);
+  g_autoptr (PwCurveBatch) batch = pw_curve_batch_new ();
+  g_autofree graphene_point_t *curves = g_new (graphene_point_t, N_CURVES * 4);
+  gboolean check = argc > 1 && g_str_equal (argv[1], "--check");
+  guint failures = 0;
+
+  // one in eight curves is odd, the rest are links
+  pw_curve_batch_set_size (batch, N_CURVES);
+  for (guint i = 0; i < N_CURVES; i++)
+    {
+      if (i % 8 == 7)
+        random_curve (rand, &curves[i * 4]);
+      else
+        link_curve (rand, &curves[i * 4]);
+      pw_curve_batch_set (batch, i, &curves[i * 4]);
+    }
+
+  if (check)
+    {
+      for (PwSimd level = PW_SIMD_NONE; level <= pw_bezier_get_supported_simd (); level++)
+        {
+          pw_bezier_set_simd (level);
+          failures += check_accuracy (batch, curves, rand);
+        }
+      return failures ? 1 : 0;
+    }
+
+  for (PwSimd level = PW_SIMD_NONE; level <= pw_bezier_get_supported_simd (); level++)
+    {
+      pw_bezier_set_simd (level);
+      time_kernels (batch);
+    }
+  time_reference (curves, N_CURVES);
+
+  return 0;
+}
@@ -0,0 +1,440 @@
+#include "bench-client.h"
+#include "pw-enums.h"
+#include <errno.h>
+#include <gio/gio.h>
+#include <pipewire/pipewire.h>
+#include <stdlib.h>
+
+#define MAX_ROUNDTRIPS 100 // for ports to show up after their node
+
+typedef struct
+{
+  struct pw_proxy *proxy;
+  struct pw_filter *filter; // instead of a proxy
+  struct spa_hook listener;
+  guint32 id;
+  guint n_ports; // a node is synced once it has these
+  gboolean gone; // failed or removed by someone else, never synced
+} BenchObject;
+
+typedef struct
+{
+  guint32 node;
+  gint direction;
+} BenchPort;
+
+struct _BenchClient
+{
+  struct pw_thread_loop *loop;
+  struct pw_context *context;
+  struct pw_core *core;
+  struct pw_registry *registry;
+  struct spa_hook core_listener;
+  struct spa_hook registry_listener;
+  int seq, done_seq;
+
+  // only touched with the loop locked
+  GPtrArray *objects; // BenchObject, handle - 1 is the index
+  GArray *free_slots; // indices of destroyed objects, handed out again
+  GHashTable *ports; // port id -> BenchPort
+  GHashTable *node_ports; // node id -> GArray of port ids
+};
+
+static void
+proxy_bound (void *data, uint32_t global_id)
+{
+  BenchObject *obj = data;
+  obj->id = global_id;
+}
+
+static void
+proxy_removed (void *data)
+{
+  BenchObject *obj = data;
+  obj->gone = TRUE;
+}
+
+static void
+proxy_error (void *data, int seq, int res, const char *message)
+{
+  BenchObject *obj = data;
+  obj->gone = TRUE;
+}
+
+static const struct pw_proxy_events proxy_events = {
+  PW_VERSION_PROXY_EVENTS,
+  .bound = proxy_bound,
+  .removed = proxy_removed,
+  .error = proxy_error,
+};
+
+static void
+filter_state_changed (void *data, enum pw_filter_state old, enum pw_filter_state state,
+                      const char *error)
+{
+  BenchObject *obj = data;
+
+  if (state == PW_FILTER_STATE_ERROR || state == PW_FILTER_STATE_UNCONNECTED)
+    obj->gone = TRUE;
+  else if (state >= PW_FILTER_STATE_PAUSED)
+    obj->id = pw_filter_get_node_id (obj->filter);
+}
+
+static const struct pw_filter_events filter_events = {
+  PW_VERSION_FILTER_EVENTS,
+  .state_changed = filter_state_changed,
+};
+
+static void
+free_object (gpointer data)
+{
+  BenchObject *obj = data;
+
+  if (!obj)
+    return;
+  spa_hook_remove (&obj->listener);
+  if (obj->filter)
+    pw_filter_destroy (obj->filter);
+  else
+    pw_proxy_destroy (obj->proxy);
+  g_free (obj);
+}
+
+static void
+registry_global (void *data, uint32_t id, uint32_t permissions, const char *type,
+                 uint32_t version, const struct spa_dict *props)
+{
+  BenchClient *self = data;
+  const char *node, *dir;
+  BenchPort *port;
+  GArray *ids;
+
+  if (!spa_streq (type, PW_TYPE_INTERFACE_Port) || !props)
+    return;
+  node = spa_dict_lookup (props, PW_KEY_NODE_ID);
+  dir = spa_dict_lookup (props, PW_KEY_PORT_DIRECTION);
+  if (!node || !dir)
+    return;
+
+  port = g_new (BenchPort, 1);
+  port->node = atoi (node);
+  port->direction = spa_streq (dir, "out") ? PW_PAD_DIRECTION_OUT : PW_PAD_DIRECTION_IN;
+  g_hash_table_insert (self->ports, GUINT_TO_POINTER (id), port);
+
+  ids = g_hash_table_lookup (self->node_ports, GUINT_TO_POINTER (port->node));
+  if (!ids)
+    {
+      ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+      g_hash_table_insert (self->node_ports, GUINT_TO_POINTER (port->node), ids);
+    }
+  g_array_append_val (ids, id);
+}
+
+static void
+registry_global_remove (void *data, uint32_t id)
+{
+  BenchClient *self = data;
+  BenchPort *port = g_hash_table_lookup (self->ports, GUINT_TO_POINTER (id));
+  GArray *ids;
+
+  // a node takes its ports along
+  g_hash_table_remove (self->node_ports, GUINT_TO_POINTER (id));
+  if (!port)
+    return;
+
+  ids = g_hash_table_lookup (self->node_ports, GUINT_TO_POINTER (port->node));
+  for (guint i = 0; ids && i < ids->len; i++)
+    if (g_array_index (ids, guint32, i) == id)
+      {
+        g_array_remove_index (ids, i);
+        break;
+      }
+  g_hash_table_remove (self->ports, GUINT_TO_POINTER (id));
+}
+
+static const struct pw_registry_events registry_events = {
+  PW_VERSION_REGISTRY_EVENTS,
+  .global = registry_global,
+  .global_remove = registry_global_remove,
+};
+
+static void
+core_done (void *data, uint32_t id, int seq)
+{
+  BenchClient *self = data;
+
+  if (id != PW_ID_CORE)
+    return;
+  self->done_seq = seq;
+  pw_thread_loop_signal (self->loop, FALSE);
+}
+
+static const struct pw_core_events core_events = {
+  PW_VERSION_CORE_EVENTS,
+  .done = core_done,
+};
+
+/**
+ * bench_client_new:
+ *
+ * Connects to the daemon, pw_init() must have been called.
+ *
+ * Returns: the client or %NULL if there is no daemon
+ */
+BenchClient *
+bench_client_new (GError **error)
+{
+  BenchClient *self = g_new0 (BenchClient, 1);
+
+  self->loop = pw_thread_loop_new ("bench-client", NULL);
+  self->context = pw_context_new (pw_thread_loop_get_loop (self->loop), NULL, 0);
+  self->core = pw_context_connect (self->context, NULL, 0);
+  self->objects = g_ptr_array_new_with_free_func (free_object);
+  self->free_slots = g_array_new (FALSE, FALSE, sizeof (guint));
+  self->ports = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  self->node_ports = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+
+  if (!self->core)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+                   "Can't connect to PipeWire: %s", g_strerror (errno));
+      bench_client_free (self);
+      return NULL;
+    }
+
+  pw_core_add_listener (self->core, &self->core_listener, &core_events, self);
+  self->registry = pw_core_get_registry (self->core, PW_VERSION_REGISTRY, 0);
+  pw_registry_add_listener (self->registry, &self->registry_listener, &registry_events, self);
+  pw_thread_loop_start (self->loop);
+  bench_client_sync (self);
+
+  return self;
+}
+
+void
+bench_client_free (BenchClient *self)
+{
+  pw_thread_loop_stop (self->loop);
+  g_ptr_array_unref (self->objects);
+  g_array_unref (self->free_slots);
+  if (self->registry)
+    {
+      spa_hook_remove (&self->registry_listener);
+      pw_proxy_destroy ((struct pw_proxy *) self->registry);
+    }
+  if (self->core)
+    {
+      spa_hook_remove (&self->core_listener);
+      pw_core_disconnect (self->core);
+    }
+  pw_context_destroy (self->context);
+  pw_thread_loop_destroy (self->loop);
+  g_hash_table_unref (self->ports);
+  g_hash_table_unref (self->node_ports);
+  g_free (self);
+}
+
+// with the loop locked
+static guint
+client_take_slot (BenchClient *self, BenchObject *obj)
+{
+  guint slot;
+
+  if (self->free_slots->len == 0)
+    {
+      g_ptr_array_add (self->objects, obj);
+      return self->objects->len;
+    }
+
+  slot = g_array_index (self->free_slots, guint, self->free_slots->len - 1);
+  g_array_set_size (self->free_slots, self->free_slots->len - 1);
+  g_ptr_array_index (self->objects, slot) = obj;
+  return slot + 1;
+}
+
+static guint
+client_add_object (BenchClient *self, const char *factory, const char *type,
+                   guint32 version, struct pw_properties *props, guint n_ports)
+{
+  BenchObject *obj = g_new0 (BenchObject, 1);
+  guint handle;
+
+  obj->id = SPA_ID_INVALID;
+  obj->n_ports = n_ports;
+
+  pw_thread_loop_lock (self->loop);
+  obj->proxy = pw_core_create_object (self->core, factory, type, version, &props->dict, 0);
+  pw_proxy_add_listener (obj->proxy, &obj->listener, &proxy_events, obj);
+  handle = client_take_slot (self, obj);
+  pw_thread_loop_unlock (self->loop);
+
+  pw_properties_free (props);
+  return handle;
+}
+
+guint
+bench_client_add_node (BenchClient *self, const char *name, guint channels)
+{
+  static const char *const positions[] = { "FL", "FR", "FC", "LFE", "RL", "RR", "SL", "SR" };
+  g_autoptr (GString) position = g_string_new (NULL);
+
+  for (guint i = 0; i < channels; i++)
+    {
+      if (i)
+        g_string_append_c (position, ',');
+      if (i < G_N_ELEMENTS (positions))
+        g_string_append (position, positions[i]);
+      else
+        g_string_append_printf (position, "AUX%u", i);
+    }
+
+  struct pw_properties *props = pw_properties_new (
+      PW_KEY_FACTORY_NAME, "support.null-audio-sink",
+      PW_KEY_NODE_NAME, name,
+      PW_KEY_MEDIA_CLASS, "Audio/Sink",
+      PW_KEY_OBJECT_LINGER, "false",
+      NULL);
+  pw_properties_setf (props, PW_KEY_AUDIO_CHANNELS, "%u", channels);
+  pw_properties_set (props, "audio.position", position->str);
+
+  return client_add_object (self, "adapter", PW_TYPE_INTERFACE_Node, PW_VERSION_NODE,
+                            props, 2 * channels);
+}
+
+guint
+bench_client_add_filter (BenchClient *self, const char *name, guint n_inputs, guint n_outputs)
+{
+  BenchObject *obj = g_new0 (BenchObject, 1);
+  guint handle;
+
+  obj->id = SPA_ID_INVALID;
+  obj->n_ports = n_inputs + n_outputs;
+
+  pw_thread_loop_lock (self->loop);
+  obj->filter = pw_filter_new (self->core, name,
+                               pw_properties_new (PW_KEY_MEDIA_TYPE, "Audio",
+                                                  PW_KEY_MEDIA_CATEGORY, "Filter",
+                                                  PW_KEY_MEDIA_ROLE, "DSP",
+                                                  NULL));
+  pw_filter_add_listener (obj->filter, &obj->listener, &filter_events, obj);
+  for (guint i = 0; i < n_inputs + n_outputs; i++)
+    {
+      gboolean in = i < n_inputs;
+      struct pw_properties *props = pw_properties_new (
+          PW_KEY_FORMAT_DSP, "32 bit float mono audio", NULL);
+      pw_properties_setf (props, PW_KEY_PORT_NAME, "%s_%u", in ? "input" : "output",
+                          in ? i : i - n_inputs);
+      pw_filter_add_port (obj->filter, in ? PW_DIRECTION_INPUT : PW_DIRECTION_OUTPUT,
+                          PW_FILTER_PORT_FLAG_MAP_BUFFERS, 0, props, NULL, 0);
+    }
+  pw_filter_connect (obj->filter, PW_FILTER_FLAG_NONE, NULL, 0);
+  handle = client_take_slot (self, obj);
+  pw_thread_loop_unlock (self->loop);
+
+  return handle;
+}
+
+guint
+bench_client_add_link (BenchClient *self, guint32 out_port, guint32 in_port)
+{
+  struct pw_properties *props = pw_properties_new (PW_KEY_OBJECT_LINGER, "false", NULL);
+
+  pw_thread_loop_lock (self->loop);
+  BenchPort *out = g_hash_table_lookup (self->ports, GUINT_TO_POINTER (out_port));
+  BenchPort *in = g_hash_table_lookup (self->ports, GUINT_TO_POINTER (in_port));
+  if (out && in)
+    {
+      pw_properties_setf (props, PW_KEY_LINK_OUTPUT_NODE, "%u", out->node);
+      pw_properties_setf (props, PW_KEY_LINK_INPUT_NODE, "%u", in->node);
+    }
+  pw_thread_loop_unlock (self->loop);
+  pw_properties_setf (props, PW_KEY_LINK_OUTPUT_PORT, "%u", out_port);
+  pw_properties_setf (props, PW_KEY_LINK_INPUT_PORT, "%u", in_port);
+
+  return client_add_object (self, "link-factory", PW_TYPE_INTERFACE_Link, PW_VERSION_LINK,
+                            props, 0);
+}
+
+void
+bench_client_destroy (BenchClient *self, guint handle)
+{
+  g_return_if_fail (handle > 0 && handle <= self->objects->len);
+
+  // the object goes with its proxy as it doesn't linger
+  pw_thread_loop_lock (self->loop);
+  free_object (g_ptr_array_index (self->objects, handle - 1));
+  g_ptr_array_index (self->objects, handle - 1) = NULL;
+  handle--;
+  g_array_append_val (self->free_slots, handle);
+  pw_thread_loop_unlock (self->loop);
+}
+
+static void
+client_roundtrip (BenchClient *self)
+{
+  self->seq = pw_core_sync (self->core, PW_ID_CORE, self->seq);
+  while (self->done_seq < self->seq)
+    pw_thread_loop_wait (self->loop);
+}
+
+static gboolean
+client_is_synced (BenchClient *self)
+{
+  for (guint i = 0; i < self->objects->len; i++)
+    {
+      BenchObject *obj = g_ptr_array_index (self->objects, i);
+      GArray *ids;
+
+      if (!obj || obj->gone)
+        continue;
+      if (obj->id == SPA_ID_INVALID)
+        return FALSE;
+      ids = g_hash_table_lookup (self->node_ports, GUINT_TO_POINTER (obj->id));
+      if (obj->n_ports && (!ids || ids->len < obj->n_ports))
+        return FALSE;
+    }
+  return TRUE;
+}
+
+void
+bench_client_sync (BenchClient *self)
+{
+  pw_thread_loop_lock (self->loop);
+  client_roundtrip (self);
+  for (guint i = 0; i < MAX_ROUNDTRIPS && !client_is_synced (self); i++)
+    client_roundtrip (self);
+  pw_thread_loop_unlock (self->loop);
+}
+
+guint32
+bench_client_get_id (BenchClient *self, guint handle)
+{
+  g_return_val_if_fail (handle > 0 && handle <= self->objects->len, SPA_ID_INVALID);
+  guint32 id;
+
+  pw_thread_loop_lock (self->loop);
+  BenchObject *obj = g_ptr_array_index (self->objects, handle - 1);
+  id = obj ? obj->id : SPA_ID_INVALID;
+  pw_thread_loop_unlock (self->loop);
+
+  return id;
+}
+
+GArray *
+bench_client_get_ports (BenchClient *self, guint32 node, gint direction)
+{
+  GArray *res = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  pw_thread_loop_lock (self->loop);
+  GArray *ids = g_hash_table_lookup (self->node_ports, GUINT_TO_POINTER (node));
+  for (guint i = 0; ids && i < ids->len; i++)
+    {
+      guint32 id = g_array_index (ids, guint32, i);
+      BenchPort *port = g_hash_table_lookup (self->ports, GUINT_TO_POINTER (id));
+      if (port->direction == direction)
+        g_array_append_val (res, id);
+    }
+  pw_thread_loop_unlock (self->loop);
+
+  return res;
+}
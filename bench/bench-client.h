@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A PipeWire client of its own, apart from the one patchwork runs, that
+ * creates and destroys objects on the daemon PIPEWIRE_REMOTE points to.
+ * Nothing it creates outlives it. Handles of destroyed objects are handed
+ * out again.
+ */
+typedef struct _BenchClient BenchClient;
+
+BenchClient *bench_client_new (GError **error);
+
+void bench_client_free (BenchClient *self);
+
+// a null sink with @channels playback and as many monitor ports
+guint bench_client_add_node (BenchClient *self, const char *name, guint channels);
+
+// a pw_filter, so the node lives in this process like an application's
+guint bench_client_add_filter (BenchClient *self, const char *name, guint n_inputs,
+                               guint n_outputs);
+
+guint bench_client_add_link (BenchClient *self, guint32 out_port, guint32 in_port);
+
+void bench_client_destroy (BenchClient *self, guint handle);
+
+// waits until the daemon handled everything asked for so far
+void bench_client_sync (BenchClient *self);
+
+// the global id of a handle once synced, SPA_ID_INVALID before
+guint32 bench_client_get_id (BenchClient *self, guint handle);
+
+// port ids of a node in the order they came, @direction is a PwPadDirection
+GArray *bench_client_get_ports (BenchClient *self, guint32 node, gint direction);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (BenchClient, bench_client_free)
+
+G_END_DECLS
@@ -0,0 +1,365 @@
+/*
+ * Runs patchwork against a daemon of its own, with null sinks and nothing
+ * else, while a second client adds and removes objects. Takes the path of
+ * the pipewire binary and prints one JSON object per graph size:
+ *
+ *   {"nodes":…,"links":…,"hold_off_ms":…,"create_us":…,"visible_us":…,
+ *    "link_rtt_us":{"median":…,"max":…},"remove_us":{…},"bulk_remove_us":…}
+ *
+ * create_us is how long the daemon took to create the objects, visible_us
+ * until all of them were in patchwork's graph, both from the first request.
+ * link_rtt_us is from asking patchwork for a link until it shows the link,
+ * remove_us from removing a single node until patchwork lets go of it.
+ */
+#include "bench-client.h"
+#include "pw-canvas.h"
+#include "pw-view-controller.h"
+#include <glib/gstdio.h>
+#include <pipewire/pipewire.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#define CORE_NAME "patchwork-bench"
+#define CHANNELS 2
+#define N_SAMPLES 20 // link round trips and single removals per size
+#define TIMEOUT (60 * G_USEC_PER_SEC)
+
+static const struct
+{
+  guint nodes, links;
+} sizes[] = { { 50, 50 }, { 200, 400 }, { 1000, 2000 } };
+
+// no session manager, no devices, just enough to create null sinks and link them
+static const char config[] =
+  "context.properties = {\n"
+  "  core.daemon = true\n"
+  "  core.name = " CORE_NAME "\n"
+  "  support.dbus = false\n"
+  "}\n"
+  "context.spa-libs = {\n"
+  "  audio.convert.* = audioconvert/libspa-audioconvert\n"
+  "  support.* = support/libspa-support\n"
+  "}\n"
+  "context.modules = [\n"
+  "  { name = libpipewire-module-protocol-native }\n"
+  "  { name = libpipewire-module-client-node }\n"
+  "  { name = libpipewire-module-adapter }\n"
+  "  { name = libpipewire-module-link-factory }\n"
+  "]\n"
+  "context.objects = [\n"
+  "  { factory = spa-node-factory\n"
+  "    args = { factory.name = support.node.driver node.name = Dummy-Driver priority.driver = 1 } }\n"
+  "]\n";
+
+typedef struct
+{
+  GArray *nodes, *links; // global ids
+  guint32 out, in;
+} Expect;
+
+typedef gboolean (*Condition) (PwGraph *graph, Expect *expect);
+
+static gboolean
+all_shown (PwGraph *graph, Expect *expect)
+{
+  for (guint i = 0; i < expect->nodes->len; i++)
+    if (!pw_graph_lookup_node (graph, g_array_index (expect->nodes, guint32, i)))
+      return FALSE;
+  for (guint i = 0; i < expect->links->len; i++)
+    if (!pw_graph_lookup_link (graph, g_array_index (expect->links, guint32, i)))
+      return FALSE;
+  return TRUE;
+}
+
+static gboolean
+all_gone (PwGraph *graph, Expect *expect)
+{
+  for (guint i = 0; i < expect->nodes->len; i++)
+    if (pw_graph_lookup_node (graph, g_array_index (expect->nodes, guint32, i)))
+      return FALSE;
+  return TRUE;
+}
+
+static gboolean
+link_shown (PwGraph *graph, Expect *expect)
+{
+  guint n_links;
+  PwGraphLink *links = pw_graph_get_links (graph, &n_links);
+
+  for (guint i = 0; i < n_links; i++)
+    if (links[i].out == expect->out && links[i].in == expect->in)
+      return TRUE;
+  return FALSE;
+}
+
+// patchwork only hears of changes from the main loop, so that is what runs
+static gint64
+wait_until (PwGraph *graph, Condition cond, Expect *expect, gint64 start)
+{
+  while (!cond (graph, expect))
+    {
+      if (g_get_monotonic_time () - start > TIMEOUT)
+        g_error ("Patchwork didn't catch up within %d s", (int) (TIMEOUT / G_USEC_PER_SEC));
+      g_main_context_iteration (NULL, TRUE);
+    }
+  return g_get_monotonic_time () - start;
+}
+
+static void
+settle (guint ms)
+{
+  gint64 end = g_get_monotonic_time () + ms * 1000;
+
+  while (g_get_monotonic_time () < end)
+    {
+      g_main_context_iteration (NULL, FALSE);
+      g_usleep (1000);
+    }
+}
+
+static int
+compare_time (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+  return (x > y) - (x < y);
+}
+
+static void
+print_times (const char *name, GArray *times)
+{
+  g_array_sort (times, compare_time);
+  g_print ("\"%s\":{\"median\":%" G_GINT64_FORMAT ",\"max\":%" G_GINT64_FORMAT "}",
+           name, g_array_index (times, gint64, times->len / 2),
+           g_array_index (times, gint64, times->len - 1));
+}
+
+static guint32
+port_of (BenchClient *client, guint32 node, gint direction, guint channel)
+{
+  g_autoptr (GArray) ports = bench_client_get_ports (client, node, direction);
+
+  g_assert_cmpuint (ports->len, >, channel);
+  return g_array_index (ports, guint32, channel);
+}
+
+static void
+run (BenchClient *client, GObject *controller, guint n_nodes, guint n_links)
+{
+  PwGraph *graph = pw_view_controller_get_graph (controller);
+  g_autoptr (GArray) node_handles = g_array_new (FALSE, FALSE, sizeof (guint));
+  g_autoptr (GArray) link_handles = g_array_new (FALSE, FALSE, sizeof (guint));
+  g_autoptr (GArray) link_rtt = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_autoptr (GArray) remove = g_array_new (FALSE, FALSE, sizeof (gint64));
+  Expect expect = {
+    .nodes = g_array_new (FALSE, FALSE, sizeof (guint32)),
+    .links = g_array_new (FALSE, FALSE, sizeof (guint32)),
+  };
+  gint64 start, create, visible, bulk_remove;
+  guint hold_off;
+
+  g_object_get (controller, "hold-off", &hold_off, NULL);
+
+  start = g_get_monotonic_time ();
+  for (guint i = 0; i < n_nodes; i++)
+    {
+      g_autofree char *name = g_strdup_printf ("bench.%u.%u", n_nodes, i);
+      guint handle = bench_client_add_node (client, name, CHANNELS);
+      g_array_append_val (node_handles, handle);
+    }
+  bench_client_sync (client);
+  for (guint i = 0; i < n_nodes; i++)
+    {
+      guint32 id = bench_client_get_id (client, g_array_index (node_handles, guint, i));
+      g_array_append_val (expect.nodes, id);
+    }
+
+  // every link has its own (source, offset) so none of them repeat
+  for (guint k = 0; k < n_links; k++)
+    {
+      guint src = k % n_nodes, dst = (src + 1 + k / n_nodes) % n_nodes;
+      guint channel = k % CHANNELS;
+      guint handle = bench_client_add_link (
+          client,
+          port_of (client, g_array_index (expect.nodes, guint32, src), PW_PAD_DIRECTION_OUT, channel),
+          port_of (client, g_array_index (expect.nodes, guint32, dst), PW_PAD_DIRECTION_IN, channel));
+      g_array_append_val (link_handles, handle);
+    }
+  bench_client_sync (client);
+  create = g_get_monotonic_time () - start;
+  for (guint k = 0; k < n_links; k++)
+    {
+      guint32 id = bench_client_get_id (client, g_array_index (link_handles, guint, k));
+      if (id != SPA_ID_INVALID)
+        g_array_append_val (expect.links, id);
+    }
+  visible = wait_until (graph, all_shown, &expect, start);
+
+  // to the node before, no link above goes that far back
+  for (guint i = 0; i < N_SAMPLES; i++)
+    {
+      expect.out = port_of (client, g_array_index (expect.nodes, guint32, i), PW_PAD_DIRECTION_OUT, 0);
+      expect.in = port_of (client, g_array_index (expect.nodes, guint32, (i + n_nodes - 1) % n_nodes),
+                           PW_PAD_DIRECTION_IN, 0);
+      start = g_get_monotonic_time ();
+      pw_view_controller_link_pads (controller, expect.out, expect.in);
+      gint64 t = wait_until (graph, link_shown, &expect, start);
+      g_array_append_val (link_rtt, t);
+    }
+
+  for (guint i = 0; i < N_SAMPLES; i++)
+    {
+      guint32 id = g_array_index (expect.nodes, guint32, 0);
+      start = g_get_monotonic_time ();
+      bench_client_destroy (client, g_array_index (node_handles, guint, i));
+      g_array_set_size (expect.nodes, 0);
+      g_array_append_val (expect.nodes, id);
+      gint64 t = wait_until (graph, all_gone, &expect, start);
+      g_array_append_val (remove, t);
+
+      // back to all nodes that are left
+      g_array_set_size (expect.nodes, 0);
+      for (guint j = i + 1; j < n_nodes; j++)
+        {
+          guint32 left = bench_client_get_id (client, g_array_index (node_handles, guint, j));
+          g_array_append_val (expect.nodes, left);
+        }
+    }
+
+  start = g_get_monotonic_time ();
+  for (guint k = 0; k < n_links; k++)
+    bench_client_destroy (client, g_array_index (link_handles, guint, k));
+  for (guint i = N_SAMPLES; i < n_nodes; i++)
+    bench_client_destroy (client, g_array_index (node_handles, guint, i));
+  bulk_remove = wait_until (graph, all_gone, &expect, start);
+
+  g_print ("{\"nodes\":%u,\"links\":%u,\"hold_off_ms\":%u,\"create_us\":%" G_GINT64_FORMAT
+           ",\"visible_us\":%" G_GINT64_FORMAT ",",
+           n_nodes, n_links, hold_off, create, visible);
+  print_times ("link_rtt_us", link_rtt);
+  g_print (",");
+  print_times ("remove_us", remove);
+  g_print (",\"bulk_remove_us\":%" G_GINT64_FORMAT "}\n", bulk_remove);
+
+  g_array_unref (expect.nodes);
+  g_array_unref (expect.links);
+}
+
+static void
+remove_tree (const char *path)
+{
+  g_autoptr (GDir) dir = g_dir_open (path, 0, NULL);
+  const char *name;
+
+  while (dir && (name = g_dir_read_name (dir)))
+    {
+      g_autofree char *child = g_build_filename (path, name, NULL);
+      if (g_file_test (child, G_FILE_TEST_IS_DIR) && !g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+        remove_tree (child);
+      else
+        g_unlink (child);
+    }
+  g_rmdir (path);
+}
+
+static GPid
+start_daemon (const char *pipewire, const char *dir, GError **error)
+{
+  g_autofree char *conf = g_build_filename (dir, "pipewire.conf", NULL);
+  g_autofree char *socket = g_build_filename (dir, CORE_NAME, NULL);
+  const char *argv[] = { pipewire, "-c", conf, NULL };
+  GPid pid;
+
+  if (!g_file_set_contents (conf, config, -1, error)
+      || !g_spawn_async (NULL, (char **) argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                         NULL, NULL, &pid, error))
+    return 0;
+
+  for (guint i = 0; i < 100 && !g_file_test (socket, G_FILE_TEST_EXISTS); i++)
+    g_usleep (50000);
+  if (!g_file_test (socket, G_FILE_TEST_EXISTS))
+    {
+      g_set_error (error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED, "%s didn't come up", pipewire);
+      kill (pid, SIGTERM);
+      waitpid (pid, NULL, 0);
+      return 0;
+    }
+
+  return pid;
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree char *dir = NULL;
+  GPid daemon;
+
+  // 77 tells meson the benchmark was skipped
+  if (argc < 2 || !g_file_test (argv[1], G_FILE_TEST_IS_EXECUTABLE))
+    return 77;
+
+  // a socket, a graph cache and a layout store nobody else sees
+  dir = g_dir_make_tmp ("patchwork-bench-XXXXXX", &error);
+  if (!dir)
+    g_error ("%s", error->message);
+  g_setenv ("PIPEWIRE_RUNTIME_DIR", dir, TRUE);
+  g_setenv ("PIPEWIRE_REMOTE", CORE_NAME, TRUE);
+  g_unsetenv ("PATCHWORK_DUMMY");
+  g_unsetenv ("PATCHWORK_REPLAY");
+  g_unsetenv ("PATCHWORK_RECORD");
+  const char *const homes[] = { "XDG_CACHE_HOME", "XDG_DATA_HOME", "XDG_STATE_HOME" };
+  for (guint i = 0; i < G_N_ELEMENTS (homes); i++)
+    {
+      g_autofree char *home = g_build_filename (dir, homes[i], NULL);
+      g_setenv (homes[i], home, TRUE);
+    }
+
+  if (!gtk_init_check ())
+    {
+      remove_tree (dir);
+      return 77;
+    }
+  adw_init ();
+  pw_init (&argc, &argv);
+
+  daemon = start_daemon (argv[1], dir, &error);
+  if (!daemon)
+    {
+      g_printerr ("%s\n", error->message);
+      remove_tree (dir);
+      return 77;
+    }
+
+  {
+    g_autoptr (BenchClient) client = bench_client_new (&error);
+    if (!client)
+      g_error ("%s", error->message);
+
+    GtkWidget *window = gtk_window_new ();
+    GtkWidget *scroll = gtk_scrolled_window_new ();
+    PwCanvas *canvas = pw_canvas_new ();
+    g_autoptr (GObject) controller = NULL;
+
+    gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (scroll), GTK_WIDGET (canvas));
+    gtk_window_set_child (GTK_WINDOW (window), scroll);
+    gtk_window_present (GTK_WINDOW (window));
+
+    // the benchmark is about the pipeline, not how long nodes are held back
+    g_object_get (canvas, "controller", &controller, NULL);
+    g_object_set (controller, "hold-off", 0, NULL);
+    settle (1000);
+
+    for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+      run (client, controller, sizes[i].nodes, sizes[i].links);
+
+    gtk_window_destroy (GTK_WINDOW (window));
+  }
+
+  kill (daemon, SIGTERM);
+  waitpid (daemon, NULL, 0);
+  g_spawn_close_pid (daemon);
+  remove_tree (dir);
+  pw_deinit ();
+
+  return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Looks a node up by id the way the canvas did before the graph kept its
+ * own index: by walking every widget. Once through the property system,
+ * once through the accessor, so the cost of the GValue round trip shows.
+ * Prints one JSON object per way:
+ *
+ *   {"lookup":"property","nodes":10000,"scans":200,
+ *    "scan_us":{"median":…,"max":…},"node_ns":…}
+ *
+ * node_ns is the median scan spread over the nodes it walked.
+ */
+#include "pw-node.h"
+
+#define N_NODES 10000
+#define N_ROUNDS 200
+
+static gint
+scan_property (GPtrArray *nodes, guint32 id)
+{
+  for (guint i = 0; i < nodes->len; i++)
+    {
+      guint32 node_id;
+      g_object_get (g_ptr_array_index (nodes, i), "id", &node_id, NULL);
+      if (node_id == id)
+        return i;
+    }
+  return -1;
+}
+
+static gint
+scan_direct (GPtrArray *nodes, guint32 id)
+{
+  for (guint i = 0; i < nodes->len; i++)
+    if (pw_node_get_id (g_ptr_array_index (nodes, i)) == id)
+      return i;
+  return -1;
+}
+
+static int
+compare_time (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+  return (x > y) - (x < y);
+}
+
+static void
+run (const char *name, gint (*scan) (GPtrArray *, guint32), GPtrArray *nodes)
+{
+  g_autoptr (GArray) times = g_array_new (FALSE, FALSE, sizeof (gint64));
+  // the last node, so every lookup walks all of them
+  guint32 id = N_NODES - 1;
+
+  for (guint r = 0; r < N_ROUNDS; r++)
+    {
+      gint64 start = g_get_monotonic_time ();
+      g_assert_cmpint (scan (nodes, id), ==, N_NODES - 1);
+      g_array_append_vals (times, (gint64[]){ g_get_monotonic_time () - start }, 1);
+    }
+
+  g_array_sort (times, compare_time);
+  gint64 median = g_array_index (times, gint64, times->len / 2);
+  g_print ("{\"lookup\":\"%s\",\"nodes\":%u,\"scans\":%u,"
+           "\"scan_us\":{\"median\":%" G_GINT64_FORMAT ",\"max\":%" G_GINT64_FORMAT "},"
+           "\"node_ns\":%.1f}\n",
+           name, N_NODES, N_ROUNDS, median, g_array_index (times, gint64, times->len - 1),
+           median * 1000.0 / N_NODES);
+}
+
+int
+main (int argc, char *argv[])
+{
+  // 77 tells meson the benchmark was skipped
+  if (!gtk_init_check ())
+    return 77;
+
+  g_autoptr (GPtrArray) nodes = g_ptr_array_new_with_free_func (g_object_unref);
+  for (guint i = 0; i < N_NODES; i++)
+    g_ptr_array_add (nodes, g_object_ref_sink (pw_node_new (i)));
+
+  run ("property", scan_property, nodes);
+  run ("accessor", scan_direct, nodes);
+
+  return 0;
+}
@@ -0,0 +1,358 @@
+/*
+ * Plays scripted interaction on a generated graph, one step per frame,
+ * through the same code the gestures run (see pw-canvas-private.h), and
+ * times the frames with the frame clock. Prints one JSON object per
+ * scenario and graph size:
+ *
+ *   {"scenario":"pan","nodes":…,"frames":…,"refresh_us":…,"dropped":…,
+ *    "interval_us":{"p50":…,"p99":…},"layout_us":{…},"paint_us":{…}}
+ *
+ * interval_us is the time between frames, a frame is dropped when that is
+ * over one and a half refresh intervals. layout_us and paint_us are the
+ * phases the canvas takes part in, paint includes rendering.
+ */
+#include "pw-canvas.h"
+#include "pw-canvas-private.h"
+#include "pw-view-controller.h"
+#include <math.h>
+
+#define WIDTH 1600
+#define HEIGHT 1000
+#define N_FRAMES 240 // per scenario
+#define DEFAULT_REFRESH 16667 // us, if the frame clock doesn't know
+
+static const guint sizes[] = { 500, 2000 };
+
+typedef struct _Bench Bench;
+
+typedef struct
+{
+  const char *name;
+  gboolean (*begin) (Bench *bench);
+  void (*step) (Bench *bench, gdouble t);
+  void (*end) (Bench *bench);
+} Scenario;
+
+struct _Bench
+{
+  GMainLoop *loop;
+  PwCanvas *canvas;
+  GtkAdjustment *hadj, *vadj;
+  PwGraph *graph;
+  guint n_nodes;
+  gdouble width, height;
+  gdouble grab_x, grab_y;
+
+  const Scenario *scenario;
+  guint frame;
+  gint64 prev_frame_time, refresh;
+  gint64 t_update, t_layout;
+  GArray *intervals, *layout, *paint; // gint64 us
+};
+
+// 0 → 1 → 0
+static gdouble
+there_and_back (gdouble t)
+{
+  return 1 - fabs (1 - 2 * t);
+}
+
+static gboolean
+pan_begin (Bench *b)
+{
+  pw_canvas_set_zoom (b->canvas, 1);
+  return TRUE;
+}
+
+// a figure eight over all there is to scroll to
+static void
+pan_step (Bench *b, gdouble t)
+{
+  gdouble h = (gtk_adjustment_get_upper (b->hadj) - gtk_adjustment_get_page_size (b->hadj)
+               - gtk_adjustment_get_lower (b->hadj));
+  gdouble v = (gtk_adjustment_get_upper (b->vadj) - gtk_adjustment_get_page_size (b->vadj)
+               - gtk_adjustment_get_lower (b->vadj));
+
+  gtk_adjustment_set_value (b->hadj, gtk_adjustment_get_lower (b->hadj) + h * (0.5 - 0.5 * cos (2 * G_PI * t)));
+  gtk_adjustment_set_value (b->vadj, gtk_adjustment_get_lower (b->vadj) + v * (0.5 + 0.5 * sin (4 * G_PI * t)));
+}
+
+static gboolean
+pinch_begin (Bench *b)
+{
+  pw_canvas_set_zoom (b->canvas, 0.25);
+  pw_canvas_pinch_begin (b->canvas);
+  return TRUE;
+}
+
+// 25% to 500% and back, the pinch scale adds to the zoom
+static void
+pinch_step (Bench *b, gdouble t)
+{
+  pw_canvas_pinch (b->canvas, 1 + 4.75 * there_and_back (t), b->width / 2, b->height / 2);
+}
+
+// the node with the most links, in the middle of the view
+static gboolean
+drag_begin (Bench *b)
+{
+  g_autoptr (GHashTable) counts = g_hash_table_new (NULL, NULL);
+  guint n_links, best = 0;
+  PwGraphLink *links = pw_graph_get_links (b->graph, &n_links);
+  PwGraphNode *node = NULL;
+
+  for (guint i = 0; i < n_links; i++)
+    {
+      guint32 ports[2] = { links[i].out, links[i].in };
+      for (guint p = 0; p < 2; p++)
+        {
+          PwGraphPort *port = pw_graph_lookup_port (b->graph, ports[p]);
+          if (!port)
+            continue;
+          gpointer key = GUINT_TO_POINTER (port->parent_id);
+          guint count = GPOINTER_TO_UINT (g_hash_table_lookup (counts, key)) + 1;
+          g_hash_table_insert (counts, key, GUINT_TO_POINTER (count));
+          if (count > best)
+            {
+              best = count;
+              node = pw_graph_lookup_node (b->graph, port->parent_id);
+            }
+        }
+    }
+  if (!node)
+    return FALSE;
+
+  // held by the title, the adjustments are in canvas units
+  pw_canvas_set_zoom (b->canvas, 1);
+  gtk_adjustment_set_value (b->hadj, node->x + 20 - b->width / 2);
+  gtk_adjustment_set_value (b->vadj, node->y + 10 - b->height / 2);
+  b->grab_x = b->width / 2;
+  b->grab_y = b->height / 2;
+  return TRUE;
+}
+
+static void
+drag_step (Bench *b, gdouble t)
+{
+  // the node has a widget once the canvas is allocated at the new position
+  if (b->frame == 0)
+    {
+      if (!pw_canvas_grab_node (b->canvas, b->grab_x, b->grab_y))
+        g_warning ("No node to grab at %.0f, %.0f", b->grab_x, b->grab_y);
+      return;
+    }
+
+  pw_canvas_move_grabbed (b->canvas, b->grab_x + 300 * sin (4 * G_PI * t),
+                          b->grab_y + 200 * (1 - cos (4 * G_PI * t)));
+}
+
+static void
+drag_end (Bench *b)
+{
+  pw_canvas_drop_grabbed (b->canvas, b->grab_x, b->grab_y);
+}
+
+static gboolean
+rubberband_begin (Bench *b)
+{
+  pw_canvas_set_zoom (b->canvas, 0.5);
+  pw_canvas_rubberband_begin (b->canvas, b->width * 0.1, b->height * 0.1);
+  return TRUE;
+}
+
+static void
+rubberband_step (Bench *b, gdouble t)
+{
+  gdouble f = there_and_back (t);
+  pw_canvas_rubberband_update (b->canvas, b->width * 0.8 * f, b->height * 0.8 * f);
+}
+
+static void
+rubberband_end (Bench *b)
+{
+  pw_canvas_rubberband_end (b->canvas);
+}
+
+static const Scenario scenarios[] = {
+  { "pan", pan_begin, pan_step, NULL },
+  { "pinch-zoom", pinch_begin, pinch_step, NULL },
+  { "drag", drag_begin, drag_step, drag_end },
+  { "rubberband", rubberband_begin, rubberband_step, rubberband_end },
+};
+
+static int
+compare_time (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+  return (x > y) - (x < y);
+}
+
+static void
+print_times (const char *name, GArray *times)
+{
+  g_array_sort (times, compare_time);
+  g_print (",\"%s\":{\"p50\":%" G_GINT64_FORMAT ",\"p99\":%" G_GINT64_FORMAT "}", name,
+           g_array_index (times, gint64, times->len / 2),
+           g_array_index (times, gint64, MIN (times->len - 1, times->len * 99 / 100)));
+}
+
+static void
+report (Bench *b)
+{
+  guint dropped = 0;
+
+  for (guint i = 0; i < b->intervals->len; i++)
+    if (g_array_index (b->intervals, gint64, i) * 2 > b->refresh * 3)
+      dropped++;
+
+  g_print ("{\"scenario\":\"%s\",\"nodes\":%u,\"frames\":%u,\"refresh_us\":%" G_GINT64_FORMAT
+           ",\"dropped\":%u",
+           b->scenario->name, b->n_nodes, b->intervals->len, b->refresh, dropped);
+  print_times ("interval_us", b->intervals);
+  print_times ("layout_us", b->layout);
+  print_times ("paint_us", b->paint);
+  g_print ("}\n");
+
+  g_array_set_size (b->intervals, 0);
+  g_array_set_size (b->layout, 0);
+  g_array_set_size (b->paint, 0);
+}
+
+// our handlers run after the ones of GTK, so every phase ends where the next one starts
+static void
+clock_update (GdkFrameClock *clock, Bench *b)
+{
+  b->t_update = g_get_monotonic_time ();
+}
+
+static void
+clock_layout (GdkFrameClock *clock, Bench *b)
+{
+  b->t_layout = g_get_monotonic_time ();
+}
+
+static void
+clock_paint (GdkFrameClock *clock, Bench *b)
+{
+  gint64 now = g_get_monotonic_time ();
+  gint64 frame_time = gdk_frame_clock_get_frame_time (clock);
+  gint64 layout = b->t_layout - b->t_update, paint = now - b->t_layout;
+
+  // the first frame of a scenario only sets it up
+  if (!b->scenario || b->frame < 2)
+    {
+      b->prev_frame_time = frame_time;
+      return;
+    }
+
+  gint64 interval = frame_time - b->prev_frame_time;
+  b->prev_frame_time = frame_time;
+  g_array_append_val (b->intervals, interval);
+  g_array_append_val (b->layout, layout);
+  g_array_append_val (b->paint, paint);
+}
+
+static gboolean
+bench_tick (GtkWidget *widget, GdkFrameClock *clock, gpointer data)
+{
+  Bench *b = data;
+
+  if (!b->scenario)
+    {
+      b->refresh = 0;
+      gdk_frame_clock_get_refresh_info (clock, gdk_frame_clock_get_frame_time (clock), &b->refresh, NULL);
+      if (b->refresh <= 0)
+        b->refresh = DEFAULT_REFRESH;
+      b->scenario = scenarios;
+      b->frame = 0;
+      if (!b->scenario->begin (b))
+        b->frame = N_FRAMES;
+    }
+
+  if (b->frame < N_FRAMES)
+    {
+      b->scenario->step (b, (gdouble) b->frame / (N_FRAMES - 1));
+      b->frame++;
+      return G_SOURCE_CONTINUE;
+    }
+
+  if (b->scenario->end)
+    b->scenario->end (b);
+  if (b->intervals->len)
+    report (b);
+
+  b->scenario++;
+  if (b->scenario == scenarios + G_N_ELEMENTS (scenarios))
+    {
+      g_main_loop_quit (b->loop);
+      return G_SOURCE_REMOVE;
+    }
+  b->frame = 0;
+  if (!b->scenario->begin (b))
+    b->frame = N_FRAMES;
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+run (guint n_nodes)
+{
+  g_autofree char *spec = g_strdup_printf ("n-nodes=%u,seed=1,churn=0", n_nodes);
+  g_setenv ("PATCHWORK_DUMMY", spec, TRUE);
+
+  Bench b = { 0 };
+  GtkWidget *window = gtk_window_new ();
+  GtkWidget *scroll = gtk_scrolled_window_new ();
+  g_autoptr (GObject) controller = NULL;
+
+  b.loop = g_main_loop_new (NULL, FALSE);
+  b.canvas = pw_canvas_new ();
+  b.n_nodes = n_nodes;
+  b.intervals = g_array_new (FALSE, FALSE, sizeof (gint64));
+  b.layout = g_array_new (FALSE, FALSE, sizeof (gint64));
+  b.paint = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  gtk_window_set_default_size (GTK_WINDOW (window), WIDTH, HEIGHT);
+  gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (scroll), GTK_WIDGET (b.canvas));
+  gtk_window_set_child (GTK_WINDOW (window), scroll);
+  gtk_window_present (GTK_WINDOW (window));
+  while (!gtk_widget_get_mapped (GTK_WIDGET (b.canvas)) || gtk_widget_get_width (GTK_WIDGET (b.canvas)) == 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_object_get (b.canvas, "controller", &controller, NULL);
+  b.graph = pw_view_controller_get_graph (controller);
+  b.hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (b.canvas));
+  b.vadj = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (b.canvas));
+  b.width = gtk_widget_get_width (GTK_WIDGET (b.canvas));
+  b.height = gtk_widget_get_height (GTK_WIDGET (b.canvas));
+
+  GdkFrameClock *clock = gtk_widget_get_frame_clock (GTK_WIDGET (b.canvas));
+  gulong ids[] = {
+    g_signal_connect (clock, "update", G_CALLBACK (clock_update), &b),
+    g_signal_connect (clock, "layout", G_CALLBACK (clock_layout), &b),
+    g_signal_connect (clock, "paint", G_CALLBACK (clock_paint), &b),
+  };
+  gtk_widget_add_tick_callback (GTK_WIDGET (b.canvas), bench_tick, &b, NULL);
+  g_main_loop_run (b.loop);
+
+  for (guint i = 0; i < G_N_ELEMENTS (ids); i++)
+    g_signal_handler_disconnect (clock, ids[i]);
+  gtk_window_destroy (GTK_WINDOW (window));
+  g_array_unref (b.intervals);
+  g_array_unref (b.layout);
+  g_array_unref (b.paint);
+  g_main_loop_unref (b.loop);
+}
+
+int
+main (int argc, char *argv[])
+{
+  // 77 tells meson the benchmark was skipped
+  if (!gtk_init_check ())
+    return 77;
+  adw_init ();
+
+  for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    run (sizes[i]);
+
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Draws a generated graph the way a frame does, once per link rendering
+ * strategy and graph size, and renders the result offscreen with the cairo
+ * renderer so no GPU is involved. Prints one JSON object per case:
+ *
+ *   {"strategy":"shared","nodes":500,"links":…,"frames":…,
+ *    "snapshot_us":{"median":…,"max":…},"render_us":{…},
+ *    "render_nodes":…,"cairo_nodes":…}
+ *
+ * render_nodes counts what a frame allocates for the canvas, every render
+ * node in its tree, cairo_nodes the share of those that carry a surface.
+ *
+ * GTK has no backend without a display, so the canvas still needs one to be
+ * built and laid out, even though nothing is shown and no GPU is used. Without
+ * one the benchmark is skipped; headless machines can give it a virtual one,
+ * as in `xvfb-run meson test --benchmark` or under `weston --backend=headless`.
+ */
+#include "pw-canvas.h"
+#include "pw-types.h"
+#include "pw-view-controller.h"
+
+#define WIDTH 1600
+#define HEIGHT 1000
+#define N_WARMUP 3
+#define N_FRAMES 30
+
+static const guint sizes[] = { 50, 500, 2000 };
+
+typedef struct
+{
+  guint nodes;
+  guint cairo;
+} NodeCount;
+
+static void
+count_nodes (GskRenderNode *node, NodeCount *count)
+{
+  count->nodes++;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CAIRO_NODE:
+      count->cairo++;
+      break;
+    case GSK_CONTAINER_NODE:
+      for (guint i = 0; i < gsk_container_node_get_n_children (node); i++)
+        count_nodes (gsk_container_node_get_child (node, i), count);
+      break;
+    case GSK_TRANSFORM_NODE:
+      count_nodes (gsk_transform_node_get_child (node), count);
+      break;
+    case GSK_CLIP_NODE:
+      count_nodes (gsk_clip_node_get_child (node), count);
+      break;
+    case GSK_ROUNDED_CLIP_NODE:
+      count_nodes (gsk_rounded_clip_node_get_child (node), count);
+      break;
+    case GSK_OPACITY_NODE:
+      count_nodes (gsk_opacity_node_get_child (node), count);
+      break;
+    case GSK_REPEAT_NODE:
+      count_nodes (gsk_repeat_node_get_child (node), count);
+      break;
+    case GSK_SHADOW_NODE:
+      count_nodes (gsk_shadow_node_get_child (node), count);
+      break;
+    case GSK_DEBUG_NODE:
+      count_nodes (gsk_debug_node_get_child (node), count);
+      break;
+    default:
+      break;
+    }
+}
+
+static int
+compare_time (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+  return (x > y) - (x < y);
+}
+
+static void
+print_times (const char *name, GArray *times)
+{
+  g_array_sort (times, compare_time);
+  g_print ("\"%s\":{\"median\":%" G_GINT64_FORMAT ",\"max\":%" G_GINT64_FORMAT "}",
+           name, g_array_index (times, gint64, times->len / 2),
+           g_array_index (times, gint64, times->len - 1));
+}
+
+static void
+wait_for (GtkWidget *widget)
+{
+  while (!gtk_widget_get_mapped (widget) || gtk_widget_get_width (widget) == 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  // let the graph and the layout settle, bounded as the frame clock may
+  // keep asking for more
+  for (guint i = 0; i < 1000 && g_main_context_pending (NULL); i++)
+    g_main_context_iteration (NULL, FALSE);
+}
+
+static void
+run (GskRenderer *renderer, guint n_nodes, GEnumClass *strategies)
+{
+  g_autofree char *spec = g_strdup_printf ("n-nodes=%u,seed=1,churn=0", n_nodes);
+  g_setenv ("PATCHWORK_DUMMY", spec, TRUE);
+
+  GtkWidget *window = gtk_window_new ();
+  GtkWidget *scroll = gtk_scrolled_window_new ();
+  PwCanvas *canvas = pw_canvas_new ();
+
+  gtk_window_set_default_size (GTK_WINDOW (window), WIDTH, HEIGHT);
+  gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (scroll), GTK_WIDGET (canvas));
+  gtk_window_set_child (GTK_WINDOW (window), scroll);
+  pw_canvas_set_zoom (canvas, 0.5);
+  gtk_window_present (GTK_WINDOW (window));
+  wait_for (GTK_WIDGET (canvas));
+
+  g_autoptr (GObject) controller = NULL;
+  guint n_links;
+  g_object_get (canvas, "controller", &controller, NULL);
+  pw_graph_get_links (pw_view_controller_get_graph (controller), &n_links);
+
+  g_autoptr (GdkPaintable) paintable = gtk_widget_paintable_new (GTK_WIDGET (canvas));
+  graphene_rect_t viewport = GRAPHENE_RECT_INIT (0, 0,
+                                                 gtk_widget_get_width (GTK_WIDGET (canvas)),
+                                                 gtk_widget_get_height (GTK_WIDGET (canvas)));
+
+  for (guint s = 0; s < strategies->n_values; s++)
+    {
+      g_autoptr (GArray) snapshot_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+      g_autoptr (GArray) render_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+      NodeCount count = { 0 };
+
+      g_object_set (canvas, "link-rendering", strategies->values[s].value, NULL);
+
+      for (guint f = 0; f < N_WARMUP + N_FRAMES; f++)
+        {
+          // throw away the node the widget keeps from the last frame
+          gtk_widget_queue_draw (GTK_WIDGET (canvas));
+
+          gint64 t0 = g_get_monotonic_time ();
+          GtkSnapshot *snapshot = gtk_snapshot_new ();
+          gdk_paintable_snapshot (paintable, snapshot, viewport.size.width, viewport.size.height);
+          g_autoptr (GskRenderNode) node = gtk_snapshot_free_to_node (snapshot);
+          gint64 t1 = g_get_monotonic_time ();
+          g_autoptr (GdkTexture) texture = gsk_renderer_render_texture (renderer, node, &viewport);
+          gint64 t2 = g_get_monotonic_time ();
+
+          if (f < N_WARMUP)
+            continue;
+
+          gint64 dt = t1 - t0;
+          g_array_append_val (snapshot_times, dt);
+          dt = t2 - t1;
+          g_array_append_val (render_times, dt);
+          if (f == N_WARMUP)
+            count_nodes (node, &count);
+        }
+
+      g_print ("{\"strategy\":\"%s\",\"nodes\":%u,\"links\":%u,\"frames\":%u,",
+               strategies->values[s].value_nick, n_nodes, n_links, N_FRAMES);
+      print_times ("snapshot_us", snapshot_times);
+      g_print (",");
+      print_times ("render_us", render_times);
+      g_print (",\"render_nodes\":%u,\"cairo_nodes\":%u}\n", count.nodes, count.cairo);
+    }
+
+  gtk_window_destroy (GTK_WINDOW (window));
+}
+
+int
+main (int argc, char *argv[])
+{
+  // 77 tells meson the benchmark was skipped, there is no display
+  if (!gtk_init_check ())
+    return 77;
+  adw_init ();
+
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GskRenderer) renderer = gsk_cairo_renderer_new ();
+  if (!gsk_renderer_realize (renderer, NULL, &error))
+    g_error ("Can't realize the cairo renderer: %s", error->message);
+
+  g_autoptr (GEnumClass) strategies = g_type_class_ref (PW_TYPE_LINK_RENDERING);
+  for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    run (renderer, sizes[i], strategies);
+
+  gsk_renderer_unrealize (renderer);
+  return 0;
+}
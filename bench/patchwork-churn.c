@@ -0,0 +1,301 @@
+/*
+ * Keeps a PipeWire daemon busy with nodes and links coming and going, the
+ * way a desktop does with hotplugged devices and short lived streams, so
+ * patchwork can be watched under registry load for as long as needed.
+ *
+ *   patchwork-churn --shape=trickle --rate=20 --lifetime=5
+ *   patchwork-churn --shape=herd --burst=64 --interval=10
+ *   patchwork-churn --shape=mixed --short-fraction=0.9 --short-lifetime=0.2
+ *
+ * Prints a JSON line with the counters every --report seconds.
+ */
+#include "bench-client.h"
+#include "pw-enums.h"
+#include <glib-unix.h>
+#include <signal.h>
+#include <pipewire/pipewire.h>
+
+#define TICK 10 // ms
+
+typedef enum
+{
+  SHAPE_TRICKLE, // one node at a time, at --rate
+  SHAPE_HERD, // --burst nodes every --interval, all gone together
+  SHAPE_MIXED, // a trickle of mostly short lived nodes among long lived ones
+} Shape;
+
+typedef struct
+{
+  guint handle;
+  guint32 id;
+  gint64 death;
+  GArray *links; // handles of the links this node started
+} Spawn;
+
+typedef struct
+{
+  BenchClient *client;
+  GMainLoop *loop;
+  GRand *rand;
+  GQueue *live; // Spawn, oldest first
+  gint64 start, last_tick, next_burst, next_report;
+  gdouble debt; // nodes owed to the rate
+  guint64 serial, created, destroyed, links;
+} Churn;
+
+static Shape shape = SHAPE_TRICKLE;
+static gboolean use_filters = FALSE;
+static gdouble rate = 10; // nodes per second
+static guint burst = 32;
+static gdouble interval = 10; // s between bursts
+static gdouble lifetime = 5; // s
+static gdouble short_lifetime = 0.2; // s
+static gdouble short_fraction = 0.8;
+static guint n_links = 2; // per new node
+static guint n_ports = 2; // per direction
+static guint max_nodes = 2000;
+static gdouble duration = 0; // s, 0 runs until interrupted
+static gdouble report = 10; // s
+static guint seed = 0;
+
+static gboolean
+parse_shape (const char *option, const char *value, gpointer data, GError **error)
+{
+  static const char *const names[] = { "trickle", "herd", "mixed" };
+
+  for (guint i = 0; i < G_N_ELEMENTS (names); i++)
+    if (g_str_equal (value, names[i]))
+      {
+        shape = i;
+        return TRUE;
+      }
+
+  g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+               "Expected trickle, herd or mixed instead of “%s”", value);
+  return FALSE;
+}
+
+static const GOptionEntry entries[] = {
+  { "shape", 0, 0, G_OPTION_ARG_CALLBACK, parse_shape, "How nodes come and go", "trickle|herd|mixed" },
+  { "filters", 0, 0, G_OPTION_ARG_NONE, &use_filters, "Create pw_filter nodes instead of null sinks", NULL },
+  { "rate", 0, 0, G_OPTION_ARG_DOUBLE, &rate, "Nodes per second of a trickle", "N" },
+  { "burst", 0, 0, G_OPTION_ARG_INT, &burst, "Nodes per burst of a herd", "N" },
+  { "interval", 0, 0, G_OPTION_ARG_DOUBLE, &interval, "Seconds between bursts", "S" },
+  { "lifetime", 0, 0, G_OPTION_ARG_DOUBLE, &lifetime, "Seconds a node lives", "S" },
+  { "short-lifetime", 0, 0, G_OPTION_ARG_DOUBLE, &short_lifetime, "Seconds a short lived node lives when mixed", "S" },
+  { "short-fraction", 0, 0, G_OPTION_ARG_DOUBLE, &short_fraction, "Share of short lived nodes when mixed", "0..1" },
+  { "links", 0, 0, G_OPTION_ARG_INT, &n_links, "Links from every new node to others", "N" },
+  { "ports", 0, 0, G_OPTION_ARG_INT, &n_ports, "Ports per direction of a node", "N" },
+  { "max-nodes", 0, 0, G_OPTION_ARG_INT, &max_nodes, "The oldest nodes go when there are more", "N" },
+  { "duration", 0, 0, G_OPTION_ARG_DOUBLE, &duration, "Seconds to run, until interrupted if 0", "S" },
+  { "report", 0, 0, G_OPTION_ARG_DOUBLE, &report, "Seconds between reports", "S" },
+  { "seed", 0, 0, G_OPTION_ARG_INT, &seed, "Seed of the generator, random if 0", "N" },
+  { NULL },
+};
+
+static void
+kill_spawn (Churn *self, Spawn *spawn)
+{
+  // links first, they would only linger as dead proxies
+  for (guint i = 0; i < spawn->links->len; i++)
+    bench_client_destroy (self->client, g_array_index (spawn->links, guint, i));
+  bench_client_destroy (self->client, spawn->handle);
+  g_array_unref (spawn->links);
+  g_free (spawn);
+  self->destroyed++;
+}
+
+static gdouble
+spawn_lifetime (Churn *self)
+{
+  switch (shape)
+    {
+    case SHAPE_HERD:
+      return lifetime;
+    case SHAPE_MIXED:
+      return g_rand_double (self->rand) < short_fraction ? short_lifetime : lifetime;
+    case SHAPE_TRICKLE:
+    default:
+      return lifetime;
+    }
+}
+
+static void
+spawn_nodes (Churn *self, guint count, gint64 now)
+{
+  g_autoptr (GPtrArray) born = g_ptr_array_new ();
+
+  for (guint i = 0; i < count; i++)
+    {
+      g_autofree char *name = g_strdup_printf ("churn.%" G_GUINT64_FORMAT, self->serial++);
+      Spawn *spawn = g_new0 (Spawn, 1);
+
+      spawn->handle = use_filters ? bench_client_add_filter (self->client, name, n_ports, n_ports)
+                                  : bench_client_add_node (self->client, name, n_ports);
+      spawn->death = now + spawn_lifetime (self) * G_USEC_PER_SEC;
+      spawn->links = g_array_new (FALSE, FALSE, sizeof (guint));
+      g_ptr_array_add (born, spawn);
+      g_queue_push_tail (self->live, spawn);
+      self->created++;
+    }
+
+  // the ports have to be known before anything links to them
+  bench_client_sync (self->client);
+  for (guint i = 0; i < born->len; i++)
+    {
+      Spawn *spawn = g_ptr_array_index (born, i);
+      spawn->id = bench_client_get_id (self->client, spawn->handle);
+    }
+
+  for (guint i = 0; i < born->len; i++)
+    {
+      Spawn *spawn = g_ptr_array_index (born, i);
+      g_autoptr (GArray) outs = bench_client_get_ports (self->client, spawn->id, PW_PAD_DIRECTION_OUT);
+
+      for (guint l = 0; l < n_links && outs->len && self->live->length > 1; l++)
+        {
+          Spawn *peer = g_queue_peek_nth (self->live, g_rand_int_range (self->rand, 0, self->live->length));
+          if (peer == spawn)
+            continue;
+
+          g_autoptr (GArray) ins = bench_client_get_ports (self->client, peer->id, PW_PAD_DIRECTION_IN);
+          if (!ins->len)
+            continue;
+
+          guint handle = bench_client_add_link (
+              self->client,
+              g_array_index (outs, guint32, g_rand_int_range (self->rand, 0, outs->len)),
+              g_array_index (ins, guint32, g_rand_int_range (self->rand, 0, ins->len)));
+          g_array_append_val (spawn->links, handle);
+          self->links++;
+        }
+    }
+}
+
+static void
+print_report (Churn *self, gint64 now)
+{
+  g_print ("{\"t\":%.1f,\"live\":%u,\"created\":%" G_GUINT64_FORMAT ",\"destroyed\":%" G_GUINT64_FORMAT
+           ",\"links\":%" G_GUINT64_FORMAT "}\n",
+           (now - self->start) / (gdouble) G_USEC_PER_SEC, self->live->length,
+           self->created, self->destroyed, self->links);
+}
+
+static gboolean
+churn_tick (gpointer data)
+{
+  Churn *self = data;
+  gint64 now = g_get_monotonic_time ();
+  guint count = 0;
+
+  // the queue isn't sorted by death when lifetimes differ
+  for (GList *l = self->live->head; l;)
+    {
+      GList *next = l->next;
+      Spawn *spawn = l->data;
+      if (spawn->death <= now)
+        {
+          g_queue_delete_link (self->live, l);
+          kill_spawn (self, spawn);
+        }
+      l = next;
+    }
+
+  if (shape == SHAPE_HERD)
+    {
+      if (now >= self->next_burst)
+        {
+          count = burst;
+          self->next_burst = now + interval * G_USEC_PER_SEC;
+        }
+    }
+  else
+    {
+      self->debt += rate * (now - self->last_tick) / G_USEC_PER_SEC;
+      count = self->debt;
+      self->debt -= count;
+    }
+  self->last_tick = now;
+
+  if (count)
+    spawn_nodes (self, count, now);
+
+  while (self->live->length > max_nodes)
+    kill_spawn (self, g_queue_pop_head (self->live));
+
+  if (now >= self->next_report)
+    {
+      print_report (self, now);
+      self->next_report = now + report * G_USEC_PER_SEC;
+    }
+
+  if (duration > 0 && now - self->start >= duration * G_USEC_PER_SEC)
+    {
+      g_main_loop_quit (self->loop);
+      return G_SOURCE_REMOVE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+churn_interrupt (gpointer data)
+{
+  Churn *self = data;
+
+  g_main_loop_quit (self->loop);
+  return G_SOURCE_CONTINUE;
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_autoptr (GOptionContext) context = g_option_context_new (NULL);
+  g_autoptr (GError) error = NULL;
+  Churn self = { 0 };
+
+  g_option_context_set_summary (context,
+                                "Creates and destroys nodes and links on the PipeWire daemon\n"
+                                "PIPEWIRE_REMOTE points to.");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+  if (rate <= 0 || interval <= 0 || report <= 0 || short_fraction < 0 || short_fraction > 1)
+    {
+      g_printerr ("--rate, --interval and --report have to be positive, --short-fraction within 0..1\n");
+      return 1;
+    }
+
+  pw_init (&argc, &argv);
+  self.client = bench_client_new (&error);
+  if (!self.client)
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  self.loop = g_main_loop_new (NULL, FALSE);
+  self.rand = seed ? g_rand_new_with_seed (seed) : g_rand_new ();
+  self.live = g_queue_new ();
+  self.start = self.last_tick = self.next_burst = self.next_report = g_get_monotonic_time ();
+
+  g_timeout_add (TICK, churn_tick, &self);
+  g_unix_signal_add (SIGINT, churn_interrupt, &self);
+  g_unix_signal_add (SIGTERM, churn_interrupt, &self);
+  g_main_loop_run (self.loop);
+
+  print_report (&self, g_get_monotonic_time ());
+  while (!g_queue_is_empty (self.live))
+    kill_spawn (&self, g_queue_pop_head (self.live));
+
+  g_queue_free (self.live);
+  g_rand_free (self.rand);
+  g_main_loop_unref (self.loop);
+  bench_client_free (self.client);
+  pw_deinit ();
+
+  return 0;
+}
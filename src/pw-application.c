@@ -104,4 +104,10 @@ pw_application_init (PwApplication *self)
   gtk_application_set_accels_for_action (
       GTK_APPLICATION (self), "app.quit",
       (const char *[]){ "<primary>q", NULL });
+  gtk_application_set_accels_for_action (
+      GTK_APPLICATION (self), "win.arrange",
+      (const char *[]){ "<primary>l", NULL });
+  gtk_application_set_accels_for_action (
+      GTK_APPLICATION (self), "win.show-stats",
+      (const char *[]){ "F12", NULL });
 }
@@ -0,0 +1,112 @@
+#include "pw-bezier.h"
+#include <math.h>
+
+#define FLATTEN_DEPTH 10 // 1024 segments at most
+
+// the halves of a curve at t = 0.5, after de Casteljau
+static void
+split (const graphene_point_t *p, graphene_point_t *l, graphene_point_t *r)
+{
+  graphene_point_t p01, p12, p23, p012, p123, mid;
+
+  graphene_point_interpolate (&p[0], &p[1], 0.5, &p01);
+  graphene_point_interpolate (&p[1], &p[2], 0.5, &p12);
+  graphene_point_interpolate (&p[2], &p[3], 0.5, &p23);
+  graphene_point_interpolate (&p01, &p12, 0.5, &p012);
+  graphene_point_interpolate (&p12, &p23, 0.5, &p123);
+  graphene_point_interpolate (&p012, &p123, 0.5, &mid);
+
+  l[0] = p[0], l[1] = p01, l[2] = p012, l[3] = mid;
+  r[0] = mid, r[1] = p123, r[2] = p23, r[3] = p[3];
+}
+
+// @tolerance16 is 16 times the tolerance squared, after Roger Willcocks' flatness bound
+static void
+flatten (const graphene_point_t *p, gfloat tolerance16, guint depth, GArray *points)
+{
+  gfloat ux = 3 * p[1].x - 2 * p[0].x - p[3].x, uy = 3 * p[1].y - 2 * p[0].y - p[3].y;
+  gfloat vx = 3 * p[2].x - p[0].x - 2 * p[3].x, vy = 3 * p[2].y - p[0].y - 2 * p[3].y;
+  graphene_point_t l[4], r[4];
+
+  if (depth == 0 || MAX (ux * ux, vx * vx) + MAX (uy * uy, vy * vy) <= tolerance16)
+    {
+      g_array_append_val (points, p[3]);
+      return;
+    }
+
+  split (p, l, r);
+  flatten (l, tolerance16, depth - 1, points);
+  flatten (r, tolerance16, depth - 1, points);
+}
+
+void
+pw_bezier_flatten (const graphene_point_t *cpts, gfloat tolerance, GArray *points)
+{
+  g_array_append_val (points, cpts[0]);
+  flatten (cpts, 16 * tolerance * tolerance, FLATTEN_DEPTH, points);
+}
+
+gfloat
+pw_polyline_distance (const graphene_point_t *points, guint n, gfloat x, gfloat y)
+{
+  gfloat best = G_MAXFLOAT; // squared
+
+  if (n == 1)
+    return hypotf (points[0].x - x, points[0].y - y);
+
+  for (guint i = 1; i < n; i++)
+    {
+      const graphene_point_t *a = &points[i - 1], *b = &points[i];
+      gfloat dx = b->x - a->x, dy = b->y - a->y;
+      gfloat len2 = dx * dx + dy * dy;
+      gfloat t = len2 > 0 ? ((x - a->x) * dx + (y - a->y) * dy) / len2 : 0;
+
+      t = CLAMP (t, 0, 1);
+      gfloat ex = a->x + t * dx - x, ey = a->y + t * dy - y;
+      best = MIN (best, ex * ex + ey * ey);
+    }
+  return sqrtf (best);
+}
+
+// Liang-Barsky, clips the segment to the rectangle and sees if anything is left
+static gboolean
+segment_intersects_rect (const graphene_point_t *a, const graphene_point_t *b, gfloat x0,
+                         gfloat y0, gfloat x1, gfloat y1)
+{
+  gfloat dx = b->x - a->x, dy = b->y - a->y;
+  const gfloat p[4] = { -dx, dx, -dy, dy };
+  const gfloat q[4] = { a->x - x0, x1 - a->x, a->y - y0, y1 - a->y };
+  gfloat t0 = 0, t1 = 1;
+
+  for (int k = 0; k < 4; k++)
+    {
+      if (p[k] == 0)
+        {
+          if (q[k] < 0)
+            return FALSE;
+          continue;
+        }
+
+      gfloat t = q[k] / p[k];
+      if (p[k] < 0)
+        t0 = MAX (t0, t);
+      else
+        t1 = MIN (t1, t);
+    }
+  return t0 <= t1;
+}
+
+gboolean
+pw_polyline_intersects_rect (const graphene_point_t *points, guint n, const graphene_rect_t *rect)
+{
+  gfloat x0 = rect->origin.x, y0 = rect->origin.y;
+  gfloat x1 = x0 + rect->size.width, y1 = y0 + rect->size.height;
+
+  if (n == 1)
+    return graphene_rect_contains_point (rect, &points[0]);
+
+  for (guint i = 1; i < n; i++)
+    if (segment_intersects_rect (&points[i - 1], &points[i], x0, y0, x1, y1))
+      return TRUE;
+  return FALSE;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glib.h>
+#include <graphene.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Single curves as polylines, what the link shapes of the canvas are hit
+ * tested and culled with.
+ */
+
+// appends graphene_point_t to @points, from the start of @cpts to its end, so
+// that no part of the curve is farther than @tolerance from them
+void pw_bezier_flatten (const graphene_point_t *cpts, gfloat tolerance, GArray *points);
+
+gfloat pw_polyline_distance (const graphene_point_t *points, guint n, gfloat x, gfloat y);
+
+// whether any part of the polyline is inside of @rect
+gboolean pw_polyline_intersects_rect (const graphene_point_t *points, guint n,
+                                      const graphene_rect_t *rect);
+
+G_END_DECLS
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "pw-canvas.h"
+#include "pw-stats.h"
+
+G_BEGIN_DECLS
+
+/*
+ * The steps the gestures of the canvas take, without the events, for
+ * scripting interaction in the benchmarks. Coordinates are the canvas
+ * widget's, like the ones the gestures report.
+ */
+
+void pw_canvas_pinch_begin (PwCanvas *self);
+
+void pw_canvas_pinch (PwCanvas *self, gdouble scale, gdouble x, gdouble y);
+
+void pw_canvas_rubberband_begin (PwCanvas *self, gdouble x, gdouble y);
+
+void pw_canvas_rubberband_update (PwCanvas *self, gdouble x_offset, gdouble y_offset);
+
+void pw_canvas_rubberband_end (PwCanvas *self);
+
+gboolean pw_canvas_grab_node (PwCanvas *self, gdouble x, gdouble y);
+
+void pw_canvas_move_grabbed (PwCanvas *self, gdouble x, gdouble y);
+
+void pw_canvas_drop_grabbed (PwCanvas *self, gdouble x, gdouble y);
+
+// what the show-stats overlay draws, updated with every frame
+const PwStats *pw_canvas_get_stats (PwCanvas *self);
+
+G_END_DECLS
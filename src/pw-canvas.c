@@ -1,19 +1,43 @@
 #include "pw-canvas.h"
+#include "pw-canvas-private.h"
 #include "pw-dummy.h"
 #include "pw-pipewire.h"
 #include "pw-node.h"
 #include "pw-view-controller.h"
 #include "pw-misc.h"
+#include "pw-link-shapes.h"
+#include "pw-stats.h"
+#include "pw-layout.h"
+#include "pw-force-layout.h"
+#include "pw-grid.h"
+#include "pw-layout-store.h"
+#include "pw-types.h"
+#include <string.h>
 
 #define MAX_ZOOM 5.0
 #define MIN_ZOOM 0.25
 #define CANV_EXTRA 100 // units of allocation outside edge
+#define MATERIALIZE_MARGIN 200 // nodes this close to the viewport keep their widgets
+#define ARRANGE_DURATION 400000 // usec
+#define OCCUPANCY_CELL 256
+#define PLACE_MARGIN 20
+#define PLACE_GAP 20 // kept free around placed nodes
+#define PLACE_LINK_GAP 80 // between a placed node and the ones it links to
+#define PLACE_COLUMN 500 // distance of the source, duplex and sink columns
+#define PLACE_TRIES 64 // how far upwards to look for a free spot
+#define NODE_GUESS_WIDTH 180 // size of a node no node of its shape was measured for
+#define NODE_GUESS_HEADER 44
+#define NODE_GUESS_ROW 26
+#define LINK_TOLERANCE 0.2 // how far the flattened links stray from the curves
+#define LINK_PICK_RADIUS 6 // screen pixels around a link that still hit it
 
 struct _PwRubberband
 {
   GtkWidget parent_instance;
 
   GtkAllocation al;
+  gdouble start_x, start_y;
+  graphene_rect_t area; // in canvas units, the links in it are selected
 };
 
 #define PW_TYPE_RUBBERBAND (pw_rubberband_get_type())
@@ -48,8 +72,59 @@ typedef struct
   gdouble zoom_gest_prev_scale;
 
   GObject *controller;
+  GHashTable *widgets; // node id -> PwNode, only for materialized nodes
+  GHashTable *records; // node id -> PwNodeRecord
+  GHashTable *node_sizes; // node shape -> size last measured, see canvas_estimate_node_size
+  guint generation;
+  PwGrid *occupancy; // node id -> record rect
+  PwLayoutStore *store;
+
+  GCancellable *arrange_cancel;
+  GArray *arrange_moves; // NodeMove
+  gint64 arrange_start;
+  guint arrange_tick;
+
+  PwForceLayout *relax;
+  GHashTable *relax_index; // node id -> index + 1 in the force layout
+  GArray *relax_positions; // PwLayoutNode
+  guint relax_serial;
+  guint relax_tick;
+  GHashTable *pinned; // ids of nodes the user has placed
+
+  PwLinkRendering link_rendering;
+  PwLinkShapes *shapes; // of the links whose ports are known
+  guint32 hovered; // link under the pointer, 0 if none
+
+  PwStats stats;
+  gboolean show_stats;
 } PwCanvasPrivate;
 
+// who a new node is linked to, see canvas_place_new_nodes
+typedef struct
+{
+  GArray *upstream, *downstream; // guint32 node ids
+} Neighbours;
+
+// one node's way from its current to its arranged position
+typedef struct
+{
+  guint32 id;
+  gfloat x0, y0, x1, y1;
+} NodeMove;
+
+/*
+ * What the canvas remembers about a node, so nodes outside of the viewport
+ * need no widget and still take part in bounds and link computations.
+ */
+typedef struct
+{
+  guint32 id;
+  graphene_rect_t rect; // canvas units
+  GHashTable *anchors; // pad id -> graphene_point_t, relative to the node
+  guint generation;
+  gboolean allocated;
+} PwNodeRecord;
+
 G_DEFINE_TYPE_WITH_CODE (PwCanvas, pw_canvas, GTK_TYPE_WIDGET,
                          G_IMPLEMENT_INTERFACE(GTK_TYPE_SCROLLABLE, NULL)
                          G_ADD_PRIVATE (PwCanvas))
@@ -63,6 +138,9 @@ enum
   PROP_VSCROLL_POLICY,
   PROP_ZOOM,
   PROP_CONTROLLER,
+  PROP_RELAXING,
+  PROP_LINK_RENDERING,
+  PROP_SHOW_STATS,
   N_PROPS
 };
 
@@ -173,10 +251,35 @@ canvas_drgesture_drag_end(PwCanvas       *self,
                           GtkGestureDrag *gest);
 
 static void
-pipewire_changed_cb(GObject *object, gpointer user_data);
+canvas_motion(PwCanvas                 *self,
+              gdouble                   x,
+              gdouble                   y,
+              GtkEventControllerMotion *motion);
+
+static void
+canvas_motion_leave(PwCanvas                 *self,
+                    GtkEventControllerMotion *motion);
+
+static void
+controller_change_notify_cb(GObject *object, PwChangeSet *changes, gpointer user_data);
+
+static gboolean
+canvas_compute_port_anchor(PwCanvas* self, guint32 id, graphene_point_t* pt);
+
+static gboolean
+get_curve_control_points(PwCanvas* self, PwGraphLink* link, graphene_point_t* points);
+
+static void
+canvas_pin_node(PwCanvas *self, PwGraphNode *node);
+
+static void
+canvas_remember_node(PwCanvas *self, PwGraphNode *node);
+
+static void
+canvas_release_node(PwCanvas *self, PwNode *nod);
 
 static void
-get_curve_control_points(PwCanvas* self, PwLinkData* link, graphene_point_t* points);
+canvas_place_new_nodes(PwCanvas *self, PwChangeSet *changes);
 ///////////////////////////////////////////////////////////
 
 PwCanvas *
@@ -190,10 +293,43 @@ pw_canvas_dispose(GObject *object)
 {
   GtkWidget *self = GTK_WIDGET (object);
   PwCanvasPrivate *priv = pw_canvas_get_instance_private (PW_CANVAS (object));
+  PwPoolStats node_stats, pad_stats;
 
   gtk_widget_dispose_template(self, PW_TYPE_CANVAS);
 
+  g_cancellable_cancel (priv->arrange_cancel);
+  g_clear_object (&priv->arrange_cancel);
+  if (priv->arrange_tick)
+    gtk_widget_remove_tick_callback (self, priv->arrange_tick);
+  priv->arrange_tick = 0;
+  g_clear_pointer (&priv->arrange_moves, g_array_unref);
+  pw_canvas_set_relaxing (PW_CANVAS (object), FALSE);
+  g_clear_pointer (&priv->pinned, g_hash_table_unref);
+
+  if (priv->widgets){
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init (&iter, priv->widgets);
+    while (g_hash_table_iter_next (&iter, NULL, &value)){
+      g_hash_table_iter_steal (&iter);
+      canvas_release_node (PW_CANVAS (object), value);
+    }
+
+    // the canvas is what takes widgets from the pools, whatever the controller
+    pw_node_pool_get_stats (&node_stats);
+    pw_pad_pool_get_stats (&pad_stats);
+    g_debug ("node pool: %u hits, %u misses, %u dropped; pad pool: %u hits, %u misses, %u dropped",
+             node_stats.hits, node_stats.misses, node_stats.dropped,
+             pad_stats.hits, pad_stats.misses, pad_stats.dropped);
+  }
+  g_clear_pointer (&priv->widgets, g_hash_table_unref);
+
   g_clear_object (&priv->controller);
+  g_clear_pointer (&priv->records, g_hash_table_unref);
+  g_clear_pointer (&priv->node_sizes, g_hash_table_unref);
+  g_clear_pointer (&priv->occupancy, pw_grid_free);
+  g_clear_pointer (&priv->store, pw_layout_store_free);
+  g_clear_pointer (&priv->shapes, pw_link_shapes_free);
 
   G_OBJECT_CLASS (pw_canvas_parent_class)->dispose (object);
 }
@@ -297,6 +433,15 @@ pw_canvas_get_property(GObject    *object,
   case PROP_CONTROLLER:
     g_value_set_object (value, self->controller);
     break;
+  case PROP_RELAXING:
+    g_value_set_boolean (value, self->relax != NULL);
+    break;
+  case PROP_LINK_RENDERING:
+    g_value_set_enum (value, self->link_rendering);
+    break;
+  case PROP_SHOW_STATS:
+    g_value_set_boolean (value, self->show_stats);
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -370,6 +515,23 @@ pw_canvas_set_property(GObject      *object,
   case PROP_CONTROLLER:
     set_controller (self, g_value_get_object (value));
     break;
+  case PROP_RELAXING:
+    pw_canvas_set_relaxing (self, g_value_get_boolean (value));
+    break;
+  case PROP_LINK_RENDERING:
+    if (priv->link_rendering != g_value_get_enum (value)){
+      priv->link_rendering = g_value_get_enum (value);
+      gtk_widget_queue_draw (GTK_WIDGET (self));
+      g_object_notify_by_pspec (object, pspec);
+    }
+    break;
+  case PROP_SHOW_STATS:
+    if (priv->show_stats != g_value_get_boolean (value)){
+      priv->show_stats = g_value_get_boolean (value);
+      gtk_widget_queue_draw (GTK_WIDGET (self));
+      g_object_notify_by_pspec (object, pspec);
+    }
+    break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -392,27 +554,267 @@ pw_canvas_measure(GtkWidget *widget, GtkOrientation orientation, int for_size,
   *natural_baseline = -1;
 }
 
+static void
+free_node_record(gpointer data)
+{
+  PwNodeRecord *rec = data;
+
+  g_clear_pointer(&rec->anchors, g_hash_table_unref);
+  g_free(rec);
+}
+
+static PwGraph *
+canvas_get_graph(PwCanvas *self)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  return pw_view_controller_get_graph(priv->controller);
+}
+
+static PwNodeRecord *
+canvas_get_node_record(PwCanvas *self, guint32 id)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwNodeRecord *rec = g_hash_table_lookup(priv->records, GUINT_TO_POINTER(id));
+
+  if(!rec){
+    rec = g_new0(PwNodeRecord, 1);
+    rec->id = id;
+    rec->anchors = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    g_hash_table_insert(priv->records, GUINT_TO_POINTER(id), rec);
+  }
+
+  return rec;
+}
+
+// NULL if the node has no widget right now
+static PwNode *
+canvas_lookup_widget(PwCanvas *self, guint32 id)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  return g_hash_table_lookup(priv->widgets, GUINT_TO_POINTER(id));
+}
+
+static void
+record_capture_anchors(PwNodeRecord *rec, PwNode *nod)
+{
+  g_hash_table_remove_all(rec->anchors);
+  if(!rec->allocated)
+    return;
+
+  for(int dir = PW_PAD_DIRECTION_OUT; dir <= PW_PAD_DIRECTION_IN; dir++){
+    const GArray *ids = pw_node_get_ports(nod, dir);
+    for(guint i = 0; i < ids->len; i++){
+      guint32 id = g_array_index(ids, guint32, i);
+      graphene_rect_t r;
+      if(!pw_node_compute_port_bounds(nod, id, GTK_WIDGET(nod), &r))
+        continue;
+
+      graphene_point_t *pt = g_new(graphene_point_t, 1);
+      pt->x = r.origin.x + (dir == PW_PAD_DIRECTION_OUT ? r.size.width : 0);
+      pt->y = r.origin.y + r.size.height/2;
+      g_hash_table_insert(rec->anchors, GUINT_TO_POINTER(id), pt);
+    }
+  }
+}
+
+static void
+node_link_added_cb(PwNode *nod, guint out, guint in, gpointer user_data)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (PW_CANVAS (user_data));
+  pw_view_controller_link_pads(priv->controller, out, in);
+}
+
+// the node only makes pads for the ports it shows
+static void
+canvas_fill_ports(PwCanvas *self, PwGraphNode *node, PwNode *nod)
+{
+  PwGraph *graph = canvas_get_graph(self);
+
+  for(int dir = PW_PAD_DIRECTION_OUT; dir <= PW_PAD_DIRECTION_IN; dir++){
+    GArray *ids = pw_graph_node_get_ports(node, dir);
+    for(guint i = 0; i < ids->len; i++){
+      PwGraphPort *port = pw_graph_lookup_port(graph, g_array_index(ids, guint32, i));
+      if(port)
+        pw_node_append_port(nod, port->id, port->name, dir);
+    }
+  }
+}
+
+// whether the ports of @nod are still the ones of @node, in order
+static gboolean
+canvas_ports_match(PwGraphNode *node, PwNode *nod)
+{
+  for(int dir = PW_PAD_DIRECTION_OUT; dir <= PW_PAD_DIRECTION_IN; dir++){
+    GArray *ids = pw_graph_node_get_ports(node, dir);
+    const GArray *shown = pw_node_get_ports(nod, dir);
+
+    if(ids->len != shown->len
+       || memcmp(ids->data, shown->data, ids->len * sizeof(guint32)) != 0)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+// a pooled widget showing @node, not parented yet
+static PwNode *
+canvas_build_node(PwCanvas *self, PwGraphNode *node)
+{
+  PwNode *nod = pw_node_acquire(node->id);
+
+  pw_node_set_title(nod, node->title);
+  pw_node_set_media_type(nod, node->type);
+  canvas_fill_ports(self, node, nod);
+  g_signal_connect(nod, "link-added", G_CALLBACK(node_link_added_cb), self);
+  return nod;
+}
+
+// hands the widget and its pads back to the pools
+static void
+canvas_release_node(PwCanvas *self, PwNode *nod)
+{
+  pw_node_release(nod);
+}
+
+// nodes of one shape measure about the same, whatever their titles say
+static guint
+canvas_node_shape(PwGraphNode *node)
+{
+  guint rows = pw_node_get_shown_rows(MAX(node->inputs->len, node->outputs->len));
+
+  return rows << 2 | (node->outputs->len > 0) << 1 | (node->inputs->len > 0);
+}
+
+static void
+canvas_remember_node_size(PwCanvas *self, PwGraphNode *node, int w, int h)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+
+  g_hash_table_insert(priv->node_sizes, GUINT_TO_POINTER(canvas_node_shape(node)),
+                      GUINT_TO_POINTER((guint) w << 16 | (guint) h));
+}
+
+/*
+ * The size of a node that has no widget: what the last node of the same
+ * shape measured, else a guess from its port count. Building a widget to
+ * measure it would cost more than the guess is off, the record gets the
+ * real size once the node is materialized.
+ */
+static void
+canvas_estimate_node_size(PwCanvas *self, PwGraphNode *node, int *w, int *h)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  guint size = GPOINTER_TO_UINT(g_hash_table_lookup(priv->node_sizes,
+                                                    GUINT_TO_POINTER(canvas_node_shape(node))));
+
+  if(size){
+    *w = size >> 16;
+    *h = size & 0xffff;
+    return;
+  }
+
+  *w = NODE_GUESS_WIDTH;
+  *h = NODE_GUESS_HEADER
+       + NODE_GUESS_ROW * pw_node_get_shown_rows(MAX(node->inputs->len, node->outputs->len));
+}
+
+/*
+ * Creates widgets for the nodes that are near the viewport and releases the
+ * ones of the rest, so styling, measuring, allocation and snapshotting only
+ * cost as much as what is on screen. Widget contents are kept current by
+ * controller_change_notify_cb, this only refreshes the node records and
+ * drops the ones of nodes that no longer exist.
+ */
+static void
+canvas_sync_materialized(PwCanvas *self)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  GtkWidget *widget = GTK_WIDGET(self);
+  PwGraph *graph = canvas_get_graph(self);
+  GHashTableIter iter;
+  gpointer value;
+
+  gdouble hval = gtk_adjustment_get_value(priv->adj[GTK_ORIENTATION_HORIZONTAL]);
+  gdouble vval = gtk_adjustment_get_value(priv->adj[GTK_ORIENTATION_VERTICAL]);
+  graphene_rect_t viewport = GRAPHENE_RECT_INIT(hval - MATERIALIZE_MARGIN,
+                                                vval - MATERIALIZE_MARGIN,
+                                                gtk_widget_get_width(widget)/priv->scale + 2*MATERIALIZE_MARGIN,
+                                                gtk_widget_get_height(widget)/priv->scale + 2*MATERIALIZE_MARGIN);
+
+  // in stacking order, so new widgets are parented roughly where they are picked
+  priv->generation++;
+  PwGraphStackIter stack;
+  PwGraphNode *node;
+  pw_graph_stack_iter_init(&stack, graph);
+  while((node = pw_graph_stack_iter_next(&stack))){
+    PwNode *nod = canvas_lookup_widget(self, node->id);
+    PwNodeRecord *rec = canvas_get_node_record(self, node->id);
+    int w, h;
+
+    rec->generation = priv->generation;
+    rec->rect.origin.x = node->x;
+    rec->rect.origin.y = node->y;
+
+    if(nod){
+      gtk_widget_measure(GTK_WIDGET(nod), GTK_ORIENTATION_HORIZONTAL, -1, NULL, &w, NULL, NULL);
+      gtk_widget_measure(GTK_WIDGET(nod), GTK_ORIENTATION_VERTICAL, -1, NULL, &h, NULL, NULL);
+      rec->rect.size.width = w;
+      rec->rect.size.height = h;
+      canvas_remember_node_size(self, node, w, h);
+    }else if(rec->rect.size.width <= 0 || rec->rect.size.height <= 0){
+      // never measured, an empty rect would intersect nothing and never materialize
+      canvas_estimate_node_size(self, node, &w, &h);
+      rec->rect.size.width = w;
+      rec->rect.size.height = h;
+    }
+
+    gboolean wanted = graphene_rect_intersection(&rec->rect, &viewport, NULL)
+                      || (nod && GTK_WIDGET(nod) == priv->dr_obj)
+                      || (nod && priv->dr_obj && gtk_widget_is_ancestor(priv->dr_obj, GTK_WIDGET(nod)));
+
+    if(wanted && !nod){
+      nod = canvas_build_node(self, node);
+      gtk_widget_set_parent(GTK_WIDGET(nod), widget);
+      g_hash_table_insert(priv->widgets, GUINT_TO_POINTER(node->id), nod);
+      gtk_widget_measure(GTK_WIDGET(nod), GTK_ORIENTATION_HORIZONTAL, -1, NULL, &w, NULL, NULL);
+      gtk_widget_measure(GTK_WIDGET(nod), GTK_ORIENTATION_VERTICAL, -1, NULL, &h, NULL, NULL);
+      rec->rect.size.width = w;
+      rec->rect.size.height = h;
+      rec->allocated = FALSE;
+      canvas_remember_node_size(self, node, w, h);
+    }else if(!wanted && nod){
+      record_capture_anchors(rec, nod);
+      g_hash_table_remove(priv->widgets, GUINT_TO_POINTER(node->id));
+      canvas_release_node(self, nod);
+    }
+
+    pw_grid_set(priv->occupancy, rec->id, &rec->rect);
+  }
+
+  g_hash_table_iter_init(&iter, priv->records);
+  while(g_hash_table_iter_next(&iter, NULL, &value)){
+    PwNodeRecord *rec = value;
+    if(rec->generation != priv->generation){
+      pw_grid_remove(priv->occupancy, rec->id);
+      g_hash_table_iter_remove(&iter);
+    }
+  }
+}
+
 static void
 allocate_node(GtkWidget *self, GtkWidget *child)
 {
   PwCanvasPrivate *priv = pw_canvas_get_instance_private (PW_CANVAS (self));
-  int x, y, w, h;
-  PwNode *nod = PW_NODE (child);
-  pw_node_get_pos (nod, &x, &y);
+  PwNodeRecord *rec = canvas_get_node_record(PW_CANVAS(self), pw_node_get_id(PW_NODE(child)));
   int voffset = gtk_adjustment_get_value(priv->adj[GTK_ORIENTATION_VERTICAL]);
   int hoffset = gtk_adjustment_get_value(priv->adj[GTK_ORIENTATION_HORIZONTAL]);
 
-  gtk_widget_measure (child, GTK_ORIENTATION_HORIZONTAL, -1, NULL, &w, NULL,
-                      NULL);
-  gtk_widget_measure (child, GTK_ORIENTATION_VERTICAL, -1, NULL, &h, NULL,
-                      NULL);
-
   GskTransform *tr = gsk_transform_new ();
   tr = gsk_transform_scale (tr, priv->scale, priv->scale);
-  graphene_point_t pt = { .x = x-hoffset, .y = y-voffset };
+  graphene_point_t pt = { .x = rec->rect.origin.x-hoffset, .y = rec->rect.origin.y-voffset };
   tr = gsk_transform_translate (tr, &pt);
 
-  gtk_widget_allocate (child, w, h, -1, tr);
+  gtk_widget_allocate (child, rec->rect.size.width, rec->rect.size.height, -1, tr);
+  rec->allocated = TRUE;
 }
 
 /*
@@ -422,25 +824,18 @@ static graphene_rect_t
 canvas_get_node_bounds(PwCanvas* self)
 {
   PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
-  GtkWidget *widget = GTK_WIDGET(self);
   gfloat xmin=G_MAXFLOAT,ymin=G_MAXFLOAT,xmax=G_MINFLOAT,ymax=G_MINFLOAT;
+  GHashTableIter iter;
+  gpointer value;
+
+  g_hash_table_iter_init(&iter, priv->records);
+  while(g_hash_table_iter_next(&iter, NULL, &value)){
+    PwNodeRecord *rec = value;
 
-  GList *l = pw_view_controller_get_node_list(priv->controller);
-  while(l){
-    GtkWidget *child = GTK_WIDGET(l->data);
-    PwNode* nod = PW_NODE(child);
-    int X, Y;
-    pw_node_get_pos(PW_NODE(child),&X, &Y);
-    int width, height;
-    gtk_widget_measure(child, GTK_ORIENTATION_HORIZONTAL, -1, NULL, &width, NULL, NULL);
-    gtk_widget_measure(child, GTK_ORIENTATION_VERTICAL, -1, NULL, &height, NULL, NULL);
-
-    xmin = MIN(xmin, X);
-    ymin = MIN(ymin,Y);
-    xmax = MAX(xmax, X+width);
-    ymax = MAX(ymax, Y+height);
-
-    l = l->next;
+    xmin = MIN(xmin, rec->rect.origin.x);
+    ymin = MIN(ymin, rec->rect.origin.y);
+    xmax = MAX(xmax, rec->rect.origin.x + rec->rect.size.width);
+    ymax = MAX(ymax, rec->rect.origin.y + rec->rect.size.height);
   }
   graphene_rect_t res = GRAPHENE_RECT_INIT(xmin, ymin, xmax, ymax);
 
@@ -487,67 +882,100 @@ canvas_configure_adj(PwCanvas        *self,
   gtk_adjustment_configure(adj, value, lower, upper, step_inc, page_inc, page_size);
 }
 
-static bool
-check_link_rubberband_selection(PwCanvas* self, PwRubberband* rb, PwLinkData* link)
+// widget coordinates to canvas units
+static graphene_point_t
+canvas_widget_to_canvas(PwCanvas* self, gdouble x, gdouble y)
 {
   PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
-  GList *links = pw_view_controller_get_link_list (priv->controller);
-  graphene_rect_t rb_al;
-  if(!gtk_widget_compute_bounds (GTK_WIDGET (rb), GTK_WIDGET (self), &rb_al)){
-    return false;
-  }
+  gdouble hval = gtk_adjustment_get_value(priv->adj[GTK_ORIENTATION_HORIZONTAL]);
+  gdouble vval = gtk_adjustment_get_value(priv->adj[GTK_ORIENTATION_VERTICAL]);
 
-  /* 
-   *  l1---l2
-   *  |    |
-   *  l4---l3
-   */
-  graphene_point_t l1 = { rb_al.origin.x, rb_al.origin.y };
-  graphene_point_t l2 = { rb_al.origin.x + rb_al.size.width, rb_al.origin.y };
-  graphene_point_t l3 = { rb_al.origin.x + rb_al.size.width, rb_al.origin.y + rb_al.size.height };
-  graphene_point_t l4 = { rb_al.origin.x, rb_al.origin.y + rb_al.size.height };
-
-  graphene_point_t cpts[4];
-  get_curve_control_points(self, link, cpts);
-  
-  bool is_intersecting =
-    cbezier_line_intersects(l1, l2, cpts[0], cpts[1], cpts[2], cpts[3])||
-    cbezier_line_intersects(l2, l3, cpts[0], cpts[1], cpts[2], cpts[3])||
-    cbezier_line_intersects(l4, l3, cpts[0], cpts[1], cpts[2], cpts[3])||
-    cbezier_line_intersects(l1, l4, cpts[0], cpts[1], cpts[2], cpts[3]);
-  
-  return is_intersecting;
+  return GRAPHENE_POINT_INIT(x/priv->scale + hval, y/priv->scale + vval);
 }
 
-static bool
-check_curve_bounding_box_rubberband(PwCanvas* self, PwRubberband* rb, PwLinkData* link)
+static PwLinkShape*
+canvas_update_link_shape(PwCanvas* self, PwGraphLink* link)
 {
-  graphene_point_t pts[4];
-  get_curve_control_points(self, link, pts);
-  graphene_rect_t curve_box = get_cbezier_bounding_box(pts[0], pts[1], pts[2], pts[3]);
+  PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
+  PwRubberband *rb = g_object_get_data(G_OBJECT(self), "rubberband");
+  graphene_point_t from, to;
+  PwLinkShape *shape;
 
-  graphene_rect_t al;
-  if(!gtk_widget_compute_bounds (GTK_WIDGET (rb), GTK_WIDGET (self), &al)){
-    return false;
-  }
+  if(!canvas_compute_port_anchor(self, link->out, &from)
+     || !canvas_compute_port_anchor(self, link->in, &to))
+    return NULL;
 
-  return rect_contains_rect(al, curve_box);
+  shape = pw_link_shapes_update(priv->shapes, link->id, from, to);
+  if(rb && shape->moved)
+    link->selected = pw_link_shape_intersects_rect(shape, &rb->area);
+  return shape;
 }
 
+// rebuilds the shapes of the links whose ends moved since the last time
 static void
-check_link_selection(PwCanvas* self, PwRubberband* rb)
+canvas_update_link_shapes(PwCanvas* self)
+{
+  PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
+  guint n_links;
+  PwGraphLink *links = pw_graph_get_links(canvas_get_graph(self), &n_links);
+
+  pw_link_shapes_begin(priv->shapes);
+  for(guint i = 0; i < n_links; i++)
+    canvas_update_link_shape(self, &links[i]);
+  pw_link_shapes_end(priv->shapes);
+
+  if(priv->hovered && !pw_link_shapes_lookup(priv->shapes, priv->hovered))
+    priv->hovered = 0;
+}
+
+static graphene_rect_t
+canvas_rubberband_area(PwCanvas* self, PwRubberband* rb)
 {
   PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
-  GList *links = pw_view_controller_get_link_list (priv->controller);
+  graphene_point_t start = canvas_widget_to_canvas(self, rb->al.x, rb->al.y);
+
+  return GRAPHENE_RECT_INIT(start.x, start.y, rb->al.width/priv->scale, rb->al.height/priv->scale);
+}
 
-  while(links){
-    PwLinkData* link = links->data;
+// selects the links touching @regions by whether they are in @area
+static void
+canvas_select_links(PwCanvas* self, const graphene_rect_t* regions, guint n_regions,
+                    const graphene_rect_t* area)
+{
+  PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
+  PwGraph *graph = canvas_get_graph(self);
+  g_autoptr(GArray) ids = g_array_new(FALSE, FALSE, sizeof(guint32));
 
-    bool is_selected = check_link_rubberband_selection(self, rb, link) || check_curve_bounding_box_rubberband(self, rb, link);
+  for(guint i = 0; i < n_regions; i++)
+    pw_link_shapes_query(priv->shapes, &regions[i], ids);
 
-    link->selected = is_selected;
-    links = links->next;
+  for(guint i = 0; i < ids->len; i++){
+    guint32 id = g_array_index(ids, guint32, i);
+    PwGraphLink *link = pw_graph_lookup_link(graph, id);
+    if(link)
+      link->selected = pw_link_shape_intersects_rect(pw_link_shapes_lookup(priv->shapes, id), area);
   }
+  gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+/*
+ * Only the links touching the parts the rubberband gained or lost since the
+ * last time can change, so only those are looked up in the index and tested.
+ */
+static void
+check_link_selection(PwCanvas* self, PwRubberband* rb)
+{
+  graphene_rect_t area = canvas_rubberband_area(self, rb);
+  graphene_rect_t delta[8];
+  guint n;
+
+  if(graphene_rect_equal(&area, &rb->area))
+    return;
+
+  n = rect_subtract(&area, &rb->area, delta);
+  n += rect_subtract(&rb->area, &area, delta + n);
+  rb->area = area;
+  canvas_select_links(self, delta, n, &area);
 }
 
 static void
@@ -556,23 +984,34 @@ pw_canvas_size_allocate(GtkWidget *widget, int width, int height,
 {
   PwCanvas* self = PW_CANVAS(widget);
   PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
+  gint64 start = g_get_monotonic_time();
+
+  if(!priv->adj[GTK_ORIENTATION_HORIZONTAL] || !priv->adj[GTK_ORIENTATION_VERTICAL])
+    return;
+
+  canvas_sync_materialized(self);
 
   graphene_rect_t bounds = canvas_get_node_bounds(self);
   canvas_configure_adj(self, GTK_ORIENTATION_HORIZONTAL, bounds, width, CANV_EXTRA);
   canvas_configure_adj(self, GTK_ORIENTATION_VERTICAL, bounds, height, CANV_EXTRA);
 
-  GList *list = pw_view_controller_get_node_list(priv->controller);
-  while(list){
-    allocate_node (widget, GTK_WIDGET(list->data));
-    list = list->next;
+  guint n_nodes;
+  PwGraphNode *nodes = pw_graph_get_nodes(canvas_get_graph(self), &n_nodes);
+  for(guint i = 0; i < n_nodes; i++){
+    PwNode *nod = canvas_lookup_widget(self, nodes[i].id);
+    if(nod)
+      allocate_node (widget, GTK_WIDGET(nod));
   }
+  canvas_update_link_shapes(self);
 
   PwRubberband *rb = g_object_get_data(G_OBJECT(self), "rubberband");
   if(rb){
     gtk_widget_size_allocate(GTK_WIDGET(rb), &rb->al, -1);
-  } else return;
-  check_link_selection(self, rb);
+    // nothing to do unless the view scrolled or zoomed under the rubberband
+    check_link_selection(self, rb);
+  }
 
+  priv->stats.allocate_us = g_get_monotonic_time() - start;
 }
 
 static void
@@ -613,41 +1052,43 @@ snapshot_bg(GtkWidget *widget, GtkSnapshot *snapshot)
 static void
 snapshot_nodes(GtkWidget *widget, GtkSnapshot *snapshot)
 {
-  PwCanvasPrivate *priv = pw_canvas_get_instance_private (PW_CANVAS(widget));
-  PwViewControllerInterface *iface = PW_VIEW_CONTROLLER_GET_IFACE (priv->controller);
-
-  GList* nodes = iface->get_node_list(priv->controller);
-
-  while (nodes){
-    gtk_widget_snapshot_child (widget, GTK_WIDGET(nodes->data), snapshot);
-    nodes = nodes->next;
+  PwCanvas *self = PW_CANVAS(widget);
+  PwGraphStackIter iter;
+  PwGraphNode *node;
+
+  pw_graph_stack_iter_init(&iter, canvas_get_graph(self));
+  while((node = pw_graph_stack_iter_next(&iter))){
+    PwNode *nod = canvas_lookup_widget(self, node->id);
+    if (nod)
+      gtk_widget_snapshot_child (widget, GTK_WIDGET(nod), snapshot);
   }
 }
 
+// @cr is in canvas units, see canvas_cairo_to_canvas()
 static void
-draw_single_link(PwCanvas* canv, cairo_t* cr, PwLinkData* link)
+draw_single_link(cairo_t* cr, const PwLinkShape* shape, const GdkRGBA* color, gdouble width)
 {
-  PwCanvasPrivate* priv = pw_canvas_get_instance_private(canv);
-  AdwStyleManager *style = adw_style_manager_get_default ();
-  gboolean is_dark = adw_style_manager_get_dark (style);
-  GdkRGBA* accent_col = adw_style_manager_get_accent_color_rgba(style);
-
-  graphene_point_t cpts[4];
-  get_curve_control_points(canv, link, cpts);
+  const graphene_point_t *pts = (const graphene_point_t*) shape->points->data;
 
-  gint col = (is_dark?1:0);
-  if(link->selected){
-    cairo_set_source_rgba(cr, accent_col->red, accent_col->green, accent_col->blue, 1.0);
-  }else{
-    cairo_set_source_rgba(cr, col, col, col, 0.6);
-  }
-  cairo_set_line_width(cr, 2*priv->scale);
+  gdk_cairo_set_source_rgba(cr, color);
+  cairo_set_line_width(cr, width);
 
-  cairo_move_to(cr, cpts[0].x, cpts[0].y);
-  cairo_curve_to(cr, cpts[1].x, cpts[1].y, cpts[2].x, cpts[2].y, cpts[3].x, cpts[3].y);
+  cairo_move_to(cr, pts[0].x, pts[0].y);
+  for(guint i = 1; i < shape->points->len; i++)
+    cairo_line_to(cr, pts[i].x, pts[i].y);
   cairo_stroke(cr);
 }
 
+static void
+canvas_cairo_to_canvas(PwCanvas* self, cairo_t* cr)
+{
+  PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
+
+  cairo_scale(cr, priv->scale, priv->scale);
+  cairo_translate(cr, -gtk_adjustment_get_value(priv->adj[GTK_ORIENTATION_HORIZONTAL]),
+                  -gtk_adjustment_get_value(priv->adj[GTK_ORIENTATION_VERTICAL]));
+}
+
 static void
 draw_dragged_link(PwCanvas* canv, cairo_t* cr)
 {
@@ -687,29 +1128,86 @@ draw_dragged_link(PwCanvas* canv, cairo_t* cr)
   cairo_stroke(cr);
 }
 
+static gint
+compare_link_ids(gconstpointer a, gconstpointer b)
+{
+  guint32 ia = *(const guint32*)a, ib = *(const guint32*)b;
+  return ia < ib ? -1 : ia > ib;
+}
+
 static void
 snapshot_links(GtkWidget* widget, GtkSnapshot* snapshot)
 {
   PwCanvas* canv = PW_CANVAS(widget);
   PwCanvasPrivate* priv = pw_canvas_get_instance_private(canv);
-  GList* link = pw_view_controller_get_link_list(priv->controller);
+  AdwStyleManager *style = adw_style_manager_get_default ();
+  gfloat col = adw_style_manager_get_dark (style) ? 1 : 0;
+  GdkRGBA *accent = adw_style_manager_get_accent_color_rgba(style);
+  GdkRGBA colors[3] = { { col, col, col, 0.6 }, *accent, *accent };
+  gdouble width = 2; // canvas units
+  PwGraph *graph = canvas_get_graph(canv);
+  guint n_links;
   graphene_rect_t al;
   gboolean success = gtk_widget_compute_bounds(widget, widget, &al);
   graphene_rect_t canv_rect = GRAPHENE_RECT_INIT(0, 0, al.size.width, al.size.height);
-
-  // TODO: test out if single cairo node approach is actually faster than spearate nodes
-  cairo_t* cai =gtk_snapshot_append_cairo(snapshot, &canv_rect);
+  graphene_point_t origin = canvas_widget_to_canvas(canv, 0, 0);
+  graphene_rect_t viewport = GRAPHENE_RECT_INIT(origin.x, origin.y,
+                                                al.size.width/priv->scale, al.size.height/priv->scale);
+  g_autoptr(GArray) ids = g_array_new(FALSE, FALSE, sizeof(guint32));
+  graphene_rect_t near = viewport;
+  cairo_t* cai = NULL;
+
+  pw_graph_get_links(graph, &n_links);
+  priv->stats.links_drawn = priv->stats.links_culled = 0;
+  gdk_rgba_free(accent);
+  colors[1].alpha = 1.0;
+  colors[2].alpha = 0.6; // hovered
+
+  if(priv->link_rendering == PW_LINK_RENDERING_SHARED || (priv->dr_obj && PW_IS_PAD(priv->dr_obj)))
+    cai = gtk_snapshot_append_cairo(snapshot, &canv_rect);
 
   if(priv->dr_obj && PW_IS_PAD(priv->dr_obj)){
     draw_dragged_link(canv, cai);
   }
+  if(cai)
+    canvas_cairo_to_canvas(canv, cai);
+
+  // only the links the grid has near the viewport, in id order so that
+  // overlapping links stack the same way however the view is panned
+  graphene_rect_inset(&near, -width, -width);
+  pw_link_shapes_query(priv->shapes, &near, ids);
+  g_array_sort(ids, compare_link_ids);
+  priv->stats.links_culled = n_links - MIN(n_links, ids->len);
+
+  for(guint i = 0; i < ids->len; i++){
+    guint32 id = g_array_index(ids, guint32, i);
+    PwLinkShape *shape = pw_link_shapes_lookup(priv->shapes, id);
+    PwGraphLink *link = pw_graph_lookup_link(graph, id);
+    if(!shape || !link)
+      continue;
+
+    graphene_rect_t bounds = shape->bounds;
+    graphene_rect_inset(&bounds, -width, -width);
+    graphene_rect_intersection(&bounds, &viewport, &bounds);
+    priv->stats.links_drawn++;
+
+    const GdkRGBA *color = &colors[link->selected ? 1 : id == priv->hovered ? 2 : 0];
+    if(priv->link_rendering == PW_LINK_RENDERING_SHARED){
+      draw_single_link(cai, shape, color, width);
+      continue;
+    }
 
-  while(link){
-    PwLinkData* ldat = link->data;
-    draw_single_link(canv, cai, link->data);
-    link=link->next;
+    // a node per link, sized to the curve, so offscreen links cost nothing
+    graphene_rect_t node_rect = GRAPHENE_RECT_INIT((bounds.origin.x - origin.x)*priv->scale,
+                                                   (bounds.origin.y - origin.y)*priv->scale,
+                                                   bounds.size.width*priv->scale,
+                                                   bounds.size.height*priv->scale);
+    cairo_t* cr = gtk_snapshot_append_cairo(snapshot, &node_rect);
+    canvas_cairo_to_canvas(canv, cr);
+    draw_single_link(cr, shape, color, width);
+    cairo_destroy(cr);
   }
-  cairo_destroy(cai);
+  g_clear_pointer(&cai, cairo_destroy);
 }
 
 // ugly, hard to read and probably commits multiple warcrimes
@@ -725,7 +1223,8 @@ curve_collision_debug (PwCanvas* canv, GtkWidget* rb, GtkSnapshot *snapshot)
   cairo_t *cai = gtk_snapshot_append_cairo (snapshot, &canv_bounds);
   PwCanvasPrivate* priv = pw_canvas_get_instance_private(canv);
 
-  GList *links = pw_view_controller_get_link_list (priv->controller);
+  guint n_links;
+  PwGraphLink *links = pw_graph_get_links (canvas_get_graph (canv), &n_links);
   graphene_rect_t rb_al;
   if(!gtk_widget_compute_bounds (GTK_WIDGET (rb), GTK_WIDGET (canv), &rb_al)){
     return;
@@ -735,12 +1234,13 @@ curve_collision_debug (PwCanvas* canv, GtkWidget* rb, GtkSnapshot *snapshot)
   graphene_point_t l3 = { rb_al.origin.x + rb_al.size.width, rb_al.origin.y };
   graphene_point_t lbweh = l2;
 
-  while (links)
+  for (guint l = 0; l < n_links; l++)
   {
-    PwLinkData *link = links->data;
+    PwGraphLink *link = &links[l];
     
     graphene_point_t cpts[4];
-    get_curve_control_points(canv, link, cpts);
+    if (!get_curve_control_points(canv, link, cpts))
+      continue;
     bool redo_once = true;
     double roots[3];
 redo_align:
@@ -789,7 +1289,6 @@ redo_align:
     graphene_rect_t bounding_box = get_cbezier_bounding_box(cpts[0], cpts[1], cpts[2], cpts[3]);
     cairo_rectangle(cai, bounding_box.origin.x, bounding_box.origin.y, bounding_box.size.width, bounding_box.size.height);
     cairo_stroke(cai);
-    links = links->next;
   }
   cairo_destroy(cai);
 }
@@ -809,13 +1308,125 @@ snapshot_rubberband(GtkWidget* widget, GtkSnapshot* snapshot)
   // curve_collision_debug(canv, rb, snapshot);
 }
 
+static void
+canvas_stats_frame(PwCanvas* self)
+{
+  PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
+  GdkFrameClock *clock = gtk_widget_get_frame_clock(GTK_WIDGET(self));
+  gint64 now = clock ? gdk_frame_clock_get_frame_time(clock) : g_get_monotonic_time();
+  guint64 messages = 0;
+  GHashTableIter iter;
+  gpointer nod;
+
+  priv->stats.queue_depth = 0;
+  if(PW_IS_PIPEWIRE(priv->controller)){
+    messages = pw_pipewire_get_handled_messages(PW_PIPEWIRE(priv->controller));
+    priv->stats.queue_depth = pw_pipewire_get_queue_depth(PW_PIPEWIRE(priv->controller));
+  }
+  priv->stats.n_nodes = g_hash_table_size(priv->widgets);
+  // only the rows in a node's window have pads
+  priv->stats.n_pads = 0;
+  g_hash_table_iter_init(&iter, priv->widgets);
+  while(g_hash_table_iter_next(&iter, NULL, &nod))
+    priv->stats.n_pads += pw_node_get_pads(nod, PW_PAD_DIRECTION_OUT)->len
+                          + pw_node_get_pads(nod, PW_PAD_DIRECTION_IN)->len;
+  pw_stats_frame(&priv->stats, now, messages);
+}
+
+#define STATS_MARGIN 12
+#define STATS_PADDING 8
+#define STATS_BAR_WIDTH 28
+#define STATS_BAR_HEIGHT 40
+
+// the overlay of the show-stats property, in the top left corner
+static void
+snapshot_stats(GtkWidget* widget, GtkSnapshot* snapshot)
+{
+  PwCanvasPrivate* priv = pw_canvas_get_instance_private(PW_CANVAS(widget));
+  const PwStats *st = &priv->stats;
+  GdkRGBA bg = { 0, 0, 0, 0.7 }, fg = { 1, 1, 1, 1 }, bar = { 0.4, 0.8, 1, 1 };
+  gint64 snapshot_us = 0;
+  guint counts[PW_STATS_N_BUCKETS], most = 1;
+  int text_w, text_h, labels_h;
+
+  for(guint i = 0; i < PW_STATS_N_PHASES; i++)
+    snapshot_us += st->snapshot_us[i];
+  pw_stats_get_histogram(st, counts);
+  for(guint i = 0; i < PW_STATS_N_BUCKETS; i++)
+    most = MAX(most, counts[i]);
+
+  g_autoptr(GString) text = g_string_new(NULL);
+  g_string_append_printf(text, "%.1f fps\n", pw_stats_get_fps(st));
+  g_string_append_printf(text, "allocate %.2f ms\n", st->allocate_us/1000.0);
+  g_string_append_printf(text, "snapshot %.2f ms: bg %.2f, nodes %.2f, links %.2f, rubberband %.2f\n",
+                         snapshot_us/1000.0, st->snapshot_us[PW_STATS_BG]/1000.0,
+                         st->snapshot_us[PW_STATS_NODES]/1000.0, st->snapshot_us[PW_STATS_LINKS]/1000.0,
+                         st->snapshot_us[PW_STATS_RUBBERBAND]/1000.0);
+  g_string_append_printf(text, "registry %u messages/frame, %u queued\n", st->messages_per_frame, st->queue_depth);
+  g_string_append_printf(text, "widgets %u nodes, %u pads\n", st->n_nodes, st->n_pads);
+  g_string_append_printf(text, "links %u drawn, %u culled\n", st->links_drawn, st->links_culled);
+  g_string_append(text, "frame intervals (ms):");
+
+  g_autoptr(GString) labels = g_string_new(NULL);
+  for(guint i = 0; i < PW_STATS_N_BUCKETS; i++)
+    g_string_append_printf(labels, "%s%s", i ? "\t" : "", pw_stats_get_bucket_name(i));
+
+  g_autoptr(PangoLayout) layout = gtk_widget_create_pango_layout(widget, text->str);
+  g_autoptr(PangoLayout) label_layout = gtk_widget_create_pango_layout(widget, labels->str);
+  PangoTabArray *tabs = pango_tab_array_new(PW_STATS_N_BUCKETS, TRUE);
+  for(guint i = 0; i < PW_STATS_N_BUCKETS; i++)
+    pango_tab_array_set_tab(tabs, i, PANGO_TAB_LEFT, (i + 1)*STATS_BAR_WIDTH);
+  pango_layout_set_tabs(label_layout, tabs);
+  pango_tab_array_free(tabs);
+  pango_layout_get_pixel_size(layout, &text_w, &text_h);
+  pango_layout_get_pixel_size(label_layout, NULL, &labels_h);
+
+  graphene_point_t corner = GRAPHENE_POINT_INIT(STATS_MARGIN, STATS_MARGIN);
+  graphene_point_t inner = GRAPHENE_POINT_INIT(STATS_PADDING, STATS_PADDING);
+  graphene_point_t below = GRAPHENE_POINT_INIT(0, text_h + STATS_BAR_HEIGHT);
+  graphene_rect_t box = GRAPHENE_RECT_INIT(0, 0, MAX(text_w, PW_STATS_N_BUCKETS*STATS_BAR_WIDTH) + 2*STATS_PADDING,
+                                           text_h + STATS_BAR_HEIGHT + labels_h + 2*STATS_PADDING);
+
+  gtk_snapshot_save(snapshot);
+  gtk_snapshot_translate(snapshot, &corner);
+  gtk_snapshot_append_color(snapshot, &bg, &box);
+
+  gtk_snapshot_translate(snapshot, &inner);
+  gtk_snapshot_append_layout(snapshot, layout, &fg);
+  for(guint i = 0; i < PW_STATS_N_BUCKETS; i++){
+    gfloat bar_h = (gfloat) STATS_BAR_HEIGHT*counts[i]/most;
+    graphene_rect_t r = GRAPHENE_RECT_INIT(i*STATS_BAR_WIDTH, text_h + STATS_BAR_HEIGHT - bar_h,
+                                           STATS_BAR_WIDTH - 2, bar_h);
+    gtk_snapshot_append_color(snapshot, &bar, &r);
+  }
+  gtk_snapshot_translate(snapshot, &below);
+  gtk_snapshot_append_layout(snapshot, label_layout, &fg);
+  gtk_snapshot_restore(snapshot);
+}
+
 static void
 pw_canvas_snapshot(GtkWidget *widget, GtkSnapshot *snapshot)
 {
+  PwCanvasPrivate* priv = pw_canvas_get_instance_private(PW_CANVAS(widget));
+  gint64 t[PW_STATS_N_PHASES + 1];
+
+  // recording only, the GPU renders later
+  t[0] = g_get_monotonic_time();
   snapshot_bg (widget, snapshot);
+  t[PW_STATS_BG + 1] = g_get_monotonic_time();
   snapshot_nodes (widget, snapshot);
+  t[PW_STATS_NODES + 1] = g_get_monotonic_time();
   snapshot_links (widget, snapshot);
+  t[PW_STATS_LINKS + 1] = g_get_monotonic_time();
   snapshot_rubberband(widget, snapshot);
+  t[PW_STATS_RUBBERBAND + 1] = g_get_monotonic_time();
+
+  for(guint i = 0; i < PW_STATS_N_PHASES; i++)
+    priv->stats.snapshot_us[i] = t[i + 1] - t[i];
+  canvas_stats_frame(PW_CANVAS(widget));
+
+  if(priv->show_stats)
+    snapshot_stats(widget, snapshot);
 }
 
 static void
@@ -846,6 +1457,16 @@ pw_canvas_class_init(PwCanvasClass *klass)
   properties[PROP_CONTROLLER] = g_param_spec_object (
       "controller", "Controller", "Driver of the canvas", G_TYPE_OBJECT,
       G_PARAM_READWRITE);
+  properties[PROP_RELAXING] = g_param_spec_boolean (
+      "relaxing", "Relaxing", "Whether a force directed layout keeps moving the nodes",
+      FALSE, G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+  properties[PROP_LINK_RENDERING] = g_param_spec_enum (
+      "link-rendering", "Link rendering", "How links are turned into render nodes",
+      PW_TYPE_LINK_RENDERING, PW_LINK_RENDERING_SHARED,
+      G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+  properties[PROP_SHOW_STATS] = g_param_spec_boolean (
+      "show-stats", "Show stats", "Whether frame statistics are drawn over the canvas",
+      FALSE, G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
   g_object_class_install_properties (object_class, N_PROPS, properties);
 
   g_type_ensure(PW_TYPE_NODE); // for GtkDropTarget's format
@@ -863,10 +1484,65 @@ pw_canvas_class_init(PwCanvasClass *klass)
   gtk_widget_class_bind_template_callback(widget_class, canvas_drgesture_drag_begin);
   gtk_widget_class_bind_template_callback(widget_class, canvas_drgesture_drag_update);
   gtk_widget_class_bind_template_callback(widget_class, canvas_drgesture_drag_end);
+  gtk_widget_class_bind_template_callback(widget_class, canvas_motion);
+  gtk_widget_class_bind_template_callback(widget_class, canvas_motion_leave);
+
+  gtk_widget_class_install_action(widget_class, "canvas.delete-links", NULL, canvas_delete_links_action);
+  gtk_widget_class_add_binding_action(widget_class, GDK_KEY_Delete, 0, "canvas.delete-links", NULL);
 
   gtk_widget_class_set_css_name (widget_class, "canvas");
 }
 
+/*
+ * What the gestures and the node drag do, apart from the events, so the
+ * same steps can be scripted, see pw-canvas-private.h.
+ */
+static gboolean
+canvas_grab_node(PwCanvas *self, PwNode *nod, gdouble x, gdouble y)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwGraphNode *node = pw_graph_lookup_node(canvas_get_graph(self), pw_node_get_id(nod));
+
+  if(!node)
+    return FALSE;
+  priv->dr_x = (x / priv->scale) - node->x;
+  priv->dr_y = (y / priv->scale) - node->y;
+  priv->dr_obj = GTK_WIDGET(nod);
+  return TRUE;
+}
+
+static void
+canvas_move_grabbed(PwCanvas *self, gdouble x, gdouble y)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwGraphNode *node = pw_graph_lookup_node(canvas_get_graph(self), pw_node_get_id(PW_NODE(priv->dr_obj)));
+
+  if(node){
+    node->x = (x / priv->scale) - priv->dr_x;
+    node->y = (y / priv->scale) - priv->dr_y;
+    canvas_pin_node(self, node);
+    gtk_widget_queue_allocate(GTK_WIDGET(self));
+  }
+}
+
+static void
+canvas_drop_node(PwCanvas *self, PwNode *nod, gdouble x, gdouble y)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwGraphNode *node = pw_graph_lookup_node(canvas_get_graph(self), pw_node_get_id(nod));
+
+  if(node){
+    node->x = (x / priv->scale) - priv->dr_x;
+    node->y = (y / priv->scale) - priv->dr_y;
+    canvas_pin_node(self, node);
+    canvas_remember_node(self, node);
+  }
+  if(gtk_widget_get_parent(GTK_WIDGET(nod)) == GTK_WIDGET(self))
+    gtk_widget_insert_before(GTK_WIDGET(nod), GTK_WIDGET(self), NULL);
+  priv->dr_obj = NULL;
+  gtk_widget_queue_allocate(GTK_WIDGET(self));
+}
+
 static GdkContentProvider *
 canvas_dnd_prepare(GtkDragSource *self,
                    gdouble        x,
@@ -887,14 +1563,8 @@ canvas_dnd_prepare(GtkDragSource *self,
     return gdk_content_provider_new_typed (PW_TYPE_PAD, ancestor);
   }
 
-  if((ancestor = gtk_widget_get_ancestor(pick, PW_TYPE_NODE))){
-    int nx, ny;
-    pw_node_get_pos (PW_NODE (ancestor), &nx, &ny);
-    priv->dr_x = (x / priv->scale) - nx;
-    priv->dr_y = (y / priv->scale) - ny;
-    priv->dr_obj = ancestor;
+  if((ancestor = gtk_widget_get_ancestor(pick, PW_TYPE_NODE)) && canvas_grab_node(canv, PW_NODE(ancestor), x, y))
     return gdk_content_provider_new_typed (PW_TYPE_NODE, ancestor);
-  }
 
   return NULL;
 }
@@ -912,7 +1582,7 @@ canvas_dnd_begin(GtkDragSource *self,
 
   if(PW_IS_NODE (priv->dr_obj)){
     PwNode* nod = PW_NODE(priv->dr_obj);
-    pw_view_controller_node_to_front(priv->controller, pw_node_get_id(nod));
+    pw_graph_raise_node(canvas_get_graph(canv), pw_node_get_id(nod));
   }
 }
 
@@ -959,13 +1629,7 @@ canvas_dnd_drop(GtkDropTarget *self,
   PwCanvas *canv = PW_CANVAS (user_data);
   PwCanvasPrivate *priv = pw_canvas_get_instance_private (canv);
 
-  PwNode *nod = PW_NODE (g_value_get_object (value));
-
-  pw_node_set_xpos (nod, (x / priv->scale) - priv->dr_x);
-  pw_node_set_ypos (nod, (y / priv->scale) - priv->dr_y);
-  gtk_widget_insert_before(GTK_WIDGET(nod), GTK_WIDGET(canv), NULL);
-  priv->dr_obj = NULL;
-
+  canvas_drop_node(canv, PW_NODE (g_value_get_object (value)), x, y);
   return TRUE;
 }
 
@@ -980,9 +1644,7 @@ canvas_dnd_motion(GtkDropTarget *self,
 
 
   if(PW_IS_NODE(priv->dr_obj)){
-    PwNode *nod = PW_NODE (priv->dr_obj);
-    pw_node_set_xpos (nod, (x / priv->scale) - priv->dr_x);
-    pw_node_set_ypos (nod, (y / priv->scale) - priv->dr_y);
+    canvas_move_grabbed(canv, x, y);
   }else if(PW_IS_PAD(priv->dr_obj)){
     priv->dr_x = x;
     priv->dr_y = y;
@@ -990,13 +1652,31 @@ canvas_dnd_motion(GtkDropTarget *self,
   }
 }
 
+void
+pw_canvas_pinch_begin(PwCanvas *self)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private(self);
+  priv->zoom_gest_prev_scale = 1.0;
+}
+
+// @scale is relative to where the pinch began, @x, @y stays in place
+void
+pw_canvas_pinch(PwCanvas *self, gdouble scale, gdouble x, gdouble y)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private(self);
+  graphene_point_t pt = {x,y};
+
+  gdouble delta = priv->zoom_gest_prev_scale - scale;
+  canvas_set_zoom(self, CLAMP(pw_canvas_get_zoom(self) - delta, MIN_ZOOM, MAX_ZOOM), &pt);
+  priv->zoom_gest_prev_scale = scale;
+}
+
 static void
 canvas_zgesture_begin(PwCanvas         *self,
                       GdkEventSequence *sequence,
                       GtkGesture       *gest)
 {
-  PwCanvasPrivate *priv = pw_canvas_get_instance_private(self);
-  priv->zoom_gest_prev_scale = 1.0;
+  pw_canvas_pinch_begin(self);
 }
 
 static void
@@ -1004,14 +1684,9 @@ canvas_zgesture_scale_change(PwCanvas       *self,
                              gdouble         scale,
                              GtkGestureZoom *gest)
 {
-  PwCanvasPrivate *priv = pw_canvas_get_instance_private(self);
   gdouble X,Y;
   gtk_gesture_get_bounding_box_center(GTK_GESTURE(gest), &X, &Y);
-  graphene_point_t pt = {X,Y};
-
-  gdouble delta = priv->zoom_gest_prev_scale - scale;
-  canvas_set_zoom(self, pw_canvas_get_zoom(self) - delta, &pt);
-  priv->zoom_gest_prev_scale = scale;
+  pw_canvas_pinch(self, scale, X, Y);
 }
 
 static void
@@ -1038,35 +1713,105 @@ drgesture_update_allocation(GtkAllocation *al,
   }
 }
 
-static void
-canvas_drgesture_drag_begin(PwCanvas       *self,
-                            gdouble         start_x,
-                            gdouble         start_y,
-                            GtkGestureDrag *gest)
+void
+pw_canvas_rubberband_begin(PwCanvas *self, gdouble x, gdouble y)
 {
   PwRubberband *rb = pw_rubberband_new();
 
   gtk_widget_set_parent(GTK_WIDGET(rb), GTK_WIDGET(self));
 
-  drgesture_update_allocation(&rb->al, start_y, start_x, 0, 0);
+  rb->start_x = x;
+  rb->start_y = y;
+  drgesture_update_allocation(&rb->al, x, y, 0, 0);
+
+  // a new rubberband replaces the selection, the updates only touch its edges
+  guint n_links;
+  PwGraphLink *links = pw_graph_get_links(canvas_get_graph(self), &n_links);
+  for(guint i = 0; i < n_links; i++)
+    links[i].selected = FALSE;
+  rb->area = canvas_rubberband_area(self, rb);
+  canvas_select_links(self, &rb->area, 1, &rb->area);
 
   gtk_widget_queue_allocate(GTK_WIDGET(self));
   g_object_set_data(G_OBJECT(self), "rubberband", rb);
 }
 
+void
+pw_canvas_rubberband_update(PwCanvas *self, gdouble x_offset, gdouble y_offset)
+{
+  PwRubberband *rb = g_object_get_data(G_OBJECT(self), "rubberband");
+
+  drgesture_update_allocation(&rb->al, rb->start_x, rb->start_y, x_offset, y_offset);
+  check_link_selection(self, rb);
+
+  gtk_widget_queue_allocate(GTK_WIDGET(self));
+}
+
+void
+pw_canvas_rubberband_end(PwCanvas *self)
+{
+  GtkWidget *rb = g_object_get_data(G_OBJECT(self), "rubberband");
+
+  gtk_widget_unparent(rb);
+  g_object_set_data(G_OBJECT(self), "rubberband", NULL);
+}
+
+// the link under @x, @y in widget coordinates, 0 if there is none
+static guint32
+canvas_pick_link(PwCanvas *self, gdouble x, gdouble y)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  graphene_point_t pt = canvas_widget_to_canvas(self, x, y);
+  guint32 id = 0;
+
+  pw_link_shapes_pick(priv->shapes, pt.x, pt.y, LINK_PICK_RADIUS/priv->scale, &id);
+  return id;
+}
+
+// selects the link under @x, @y, alone unless @extend, FALSE if there is none
+static gboolean
+canvas_click_link(PwCanvas *self, gdouble x, gdouble y, gboolean extend)
+{
+  guint32 id = canvas_pick_link(self, x, y);
+  guint n_links;
+  PwGraphLink *links;
+
+  if(!id)
+    return FALSE;
+
+  links = pw_graph_get_links(canvas_get_graph(self), &n_links);
+  for(guint i = 0; i < n_links; i++){
+    if(links[i].id == id)
+      links[i].selected = extend ? !links[i].selected : TRUE;
+    else if(!extend)
+      links[i].selected = FALSE;
+  }
+  gtk_widget_queue_draw(GTK_WIDGET(self));
+  return TRUE;
+}
+
+static void
+canvas_drgesture_drag_begin(PwCanvas       *self,
+                            gdouble         start_x,
+                            gdouble         start_y,
+                            GtkGestureDrag *gest)
+{
+  GdkModifierType state = gtk_event_controller_get_current_event_state(GTK_EVENT_CONTROLLER(gest));
+
+  gtk_widget_grab_focus(GTK_WIDGET(self));
+  if(canvas_click_link(self, start_x, start_y, state & (GDK_SHIFT_MASK | GDK_CONTROL_MASK)))
+    return;
+  pw_canvas_rubberband_begin(self, start_x, start_y);
+}
+
 static void
 canvas_drgesture_drag_update(PwCanvas       *self,
                              gdouble         x_offset,
                              gdouble         y_offset,
                              GtkGestureDrag *gest)
 {
-  PwRubberband *rb = g_object_get_data(G_OBJECT(self), "rubberband");
-
-  double x,y;
-  gtk_gesture_drag_get_start_point(gest, &x, &y);
-  drgesture_update_allocation(&rb->al, x, y, x_offset, y_offset);
-
-  gtk_widget_queue_allocate(GTK_WIDGET(self));
+  if(g_object_get_data(G_OBJECT(self), "rubberband"))
+    pw_canvas_rubberband_update(self, x_offset, y_offset);
 }
 
 static void
@@ -1075,45 +1820,708 @@ canvas_drgesture_drag_end(PwCanvas       *self,
                           gdouble         y_offset,
                           GtkGestureDrag *gest)
 {
-  GtkWidget *rb = g_object_get_data(G_OBJECT(self), "rubberband");
+  if(g_object_get_data(G_OBJECT(self), "rubberband"))
+    pw_canvas_rubberband_end(self);
+}
 
-  gtk_widget_unparent(rb);
-  g_object_set_data(G_OBJECT(self), "rubberband", NULL);
+static void
+canvas_motion(PwCanvas                 *self,
+              gdouble                   x,
+              gdouble                   y,
+              GtkEventControllerMotion *motion)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  guint32 id = 0;
+
+  // the links over nodes can't be clicked, so they don't light up either
+  if(gtk_widget_pick(GTK_WIDGET(self), x, y, GTK_PICK_DEFAULT) == GTK_WIDGET(self))
+    id = canvas_pick_link(self, x, y);
+
+  if(id != priv->hovered){
+    priv->hovered = id;
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+  }
 }
 
 static void
-pipewire_changed_cb(GObject *object, gpointer user_data)
+canvas_motion_leave(PwCanvas                 *self,
+                    GtkEventControllerMotion *motion)
 {
-  PwCanvas* self = PW_CANVAS(user_data);
-  gtk_widget_queue_allocate(GTK_WIDGET(self));
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+
+  if(priv->hovered){
+    priv->hovered = 0;
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+  }
+}
+
+void
+pw_canvas_delete_selected_links(PwCanvas *self)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  g_autoptr(GArray) ids = g_array_new(FALSE, FALSE, sizeof(guint32));
+  guint n_links;
+  PwGraphLink *links = pw_graph_get_links(canvas_get_graph(self), &n_links);
+
+  // the controller may change the graph under us while unlinking
+  for(guint i = 0; i < n_links; i++)
+    if(links[i].selected)
+      g_array_append_val(ids, links[i].id);
+
+  for(guint i = 0; i < ids->len; i++)
+    pw_view_controller_unlink(priv->controller, g_array_index(ids, guint32, i));
+}
+
+static void
+canvas_delete_links_action(GtkWidget  *widget,
+                           const char *action_name,
+                           GVariant   *parameter)
+{
+  pw_canvas_delete_selected_links(PW_CANVAS(widget));
+}
+
+// @x, @y are in widget coordinates, like the start point of a drag, not canvas units
+gboolean
+pw_canvas_grab_node(PwCanvas *self, gdouble x, gdouble y)
+{
+  GtkWidget *pick = gtk_widget_pick(GTK_WIDGET(self), x, y, GTK_PICK_DEFAULT);
+  GtkWidget *ancestor = pick ? gtk_widget_get_ancestor(pick, PW_TYPE_NODE) : NULL;
+
+  if(!ancestor || !canvas_grab_node(self, PW_NODE(ancestor), x, y))
+    return FALSE;
+  pw_graph_raise_node(canvas_get_graph(self), pw_node_get_id(PW_NODE(ancestor)));
+  return TRUE;
+}
+
+void
+pw_canvas_move_grabbed(PwCanvas *self, gdouble x, gdouble y)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private(self);
+
+  if(PW_IS_NODE(priv->dr_obj))
+    canvas_move_grabbed(self, x, y);
+}
+
+void
+pw_canvas_drop_grabbed(PwCanvas *self, gdouble x, gdouble y)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private(self);
+
+  if(PW_IS_NODE(priv->dr_obj))
+    canvas_drop_node(self, PW_NODE(priv->dr_obj), x, y);
 }
 
+// brings the widget of @node up to date with its record
+static void
+canvas_refresh_node(PwCanvas *self, PwGraphNode *node)
+{
+  PwNode *nod = canvas_lookup_widget(self, node->id);
+
+  if(!nod)
+    return;
+
+  if(!canvas_ports_match(node, nod)){
+    pw_node_clear_ports(nod);
+    canvas_fill_ports(self, node, nod);
+  }
+  pw_node_set_title(nod, node->title);
+  pw_node_set_media_type(nod, node->type);
+}
+
+/*
+ * Carries what the canvas knows about a node over to its new id, for when
+ * the controller matched a node it showed up with a live one.
+ */
+static void
+canvas_rekey_node(PwCanvas *self, guint32 old_id, guint32 new_id)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  // it may have gone again in the same batch, then nothing is noted for new_id
+  gboolean alive = pw_graph_lookup_node(canvas_get_graph(self), new_id) != NULL;
+  gpointer rec, nod;
+
+  if(g_hash_table_remove(priv->pinned, GUINT_TO_POINTER(old_id)) && alive)
+    g_hash_table_add(priv->pinned, GUINT_TO_POINTER(new_id));
+
+  if(g_hash_table_steal_extended(priv->widgets, GUINT_TO_POINTER(old_id), NULL, &nod)){
+    if(alive){
+      pw_node_set_id(nod, new_id);
+      g_hash_table_insert(priv->widgets, GUINT_TO_POINTER(new_id), nod);
+    }else{
+      canvas_release_node(self, nod);
+    }
+  }
+
+  if(!g_hash_table_steal_extended(priv->records, GUINT_TO_POINTER(old_id), NULL, &rec))
+    return;
+  if(!alive){
+    pw_grid_remove(priv->occupancy, old_id);
+    free_node_record(rec);
+    return;
+  }
+
+  ((PwNodeRecord *) rec)->id = new_id;
+  g_hash_table_replace(priv->records, GUINT_TO_POINTER(new_id), rec);
+  pw_grid_remove(priv->occupancy, old_id);
+  pw_grid_set(priv->occupancy, new_id, &((PwNodeRecord *) rec)->rect);
+}
+
+/*
+ * Keeps the parked anchor of a port that got a new id. Its node is noted as
+ * changed, which rebinds the pad.
+ */
 static void
-get_curve_control_points(PwCanvas* self, PwLinkData* link, graphene_point_t* points)
+canvas_rekey_port(PwCanvas *self, guint32 old_id, guint32 new_id)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwGraphPort *port = pw_graph_lookup_port(canvas_get_graph(self), new_id);
+  PwNodeRecord *rec;
+  gpointer anchor;
+
+  if(port && (rec = g_hash_table_lookup(priv->records, GUINT_TO_POINTER(port->parent_id)))
+     && g_hash_table_steal_extended(rec->anchors, GUINT_TO_POINTER(old_id), NULL, &anchor))
+    g_hash_table_insert(rec->anchors, GUINT_TO_POINTER(new_id), anchor);
+}
+
+/*
+ * Only the widgets of the nodes a batch touched are updated. A batch of
+ * link changes alone doesn't move anything, so it only needs a redraw.
+ */
+static void
+controller_change_notify_cb(GObject *object, PwChangeSet *changes, gpointer user_data)
+{
+  PwCanvas* self = PW_CANVAS(user_data);
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwGraph *graph = canvas_get_graph(self);
+  g_autoptr(GHashTable) dirty = g_hash_table_new(NULL, NULL);
+  const guint32 *ids;
+  const PwRekey *rekeys;
+  guint n_ids, n_rekeys, n_layout = 0;
+
+  /*
+   * A removed id may be back as another object in the same batch, which then
+   * also shows up as added, so what the canvas keeps for it goes first. The
+   * nodes that only got a new id are carried over to it afterwards.
+   */
+  g_autoptr(GHashTable) carried = g_hash_table_new(NULL, NULL);
+  rekeys = pw_change_set_get_rekeys(changes, PW_OBJECT_NODE, &n_rekeys);
+  for(guint i = 0; i < n_rekeys; i++)
+    g_hash_table_add(carried, GUINT_TO_POINTER(rekeys[i].old_id));
+
+  ids = pw_change_set_get(changes, PW_OBJECT_NODE, PW_CHANGE_REMOVED, &n_ids);
+  n_layout += n_ids;
+  for(guint i = 0; i < n_ids; i++){
+    gpointer nod;
+    if(g_hash_table_contains(carried, GUINT_TO_POINTER(ids[i])))
+      continue;
+    if(g_hash_table_steal_extended(priv->widgets, GUINT_TO_POINTER(ids[i]), NULL, &nod))
+      canvas_release_node(self, nod);
+    pw_grid_remove(priv->occupancy, ids[i]);
+    g_hash_table_remove(priv->records, GUINT_TO_POINTER(ids[i]));
+    g_hash_table_remove(priv->pinned, GUINT_TO_POINTER(ids[i]));
+  }
+  for(guint i = 0; i < n_rekeys; i++)
+    canvas_rekey_node(self, rekeys[i].old_id, rekeys[i].new_id);
+
+  // a new port has no parked anchor, unless it is one that got a new id
+  ids = pw_change_set_get(changes, PW_OBJECT_PORT, PW_CHANGE_ADDED, &n_ids);
+  for(guint i = 0; i < n_ids; i++){
+    PwGraphPort *port = pw_graph_lookup_port(graph, ids[i]);
+    PwNodeRecord *rec = port ? g_hash_table_lookup(priv->records, GUINT_TO_POINTER(port->parent_id)) : NULL;
+    if(rec)
+      g_hash_table_remove(rec->anchors, GUINT_TO_POINTER(ids[i]));
+  }
+  rekeys = pw_change_set_get_rekeys(changes, PW_OBJECT_PORT, &n_rekeys);
+  for(guint i = 0; i < n_rekeys; i++)
+    canvas_rekey_port(self, rekeys[i].old_id, rekeys[i].new_id);
+
+  ids = pw_change_set_get(changes, PW_OBJECT_LINK, PW_CHANGE_REMOVED, &n_ids);
+  for(guint i = 0; i < n_ids; i++)
+    if(ids[i] == priv->hovered)
+      priv->hovered = 0;
+
+  canvas_place_new_nodes(self, changes);
+
+  // the parents of removed ports are noted as changed
+  pw_change_set_get(changes, PW_OBJECT_PORT, PW_CHANGE_REMOVED, &n_ids);
+  n_layout += n_ids;
+
+  static const PwChange kinds[] = { PW_CHANGE_ADDED, PW_CHANGE_CHANGED };
+  for(guint k = 0; k < G_N_ELEMENTS(kinds); k++){
+    ids = pw_change_set_get(changes, PW_OBJECT_PORT, kinds[k], &n_ids);
+    n_layout += n_ids;
+    for(guint i = 0; i < n_ids; i++){
+      PwGraphPort *port = pw_graph_lookup_port(graph, ids[i]);
+      if(port)
+        g_hash_table_add(dirty, GUINT_TO_POINTER(port->parent_id));
+    }
+
+    ids = pw_change_set_get(changes, PW_OBJECT_NODE, kinds[k], &n_ids);
+    n_layout += n_ids;
+    for(guint i = 0; i < n_ids; i++)
+      g_hash_table_add(dirty, GUINT_TO_POINTER(ids[i]));
+
+    // a link needs its shape, not a layout, the shapes of gone ones wait for one
+    ids = pw_change_set_get(changes, PW_OBJECT_LINK, kinds[k], &n_ids);
+    for(guint i = 0; i < n_ids; i++){
+      PwGraphLink *link = pw_graph_lookup_link(graph, ids[i]);
+      if(link)
+        canvas_update_link_shape(self, link);
+    }
+  }
+
+  GHashTableIter iter;
+  gpointer key;
+  g_hash_table_iter_init(&iter, dirty);
+  while(g_hash_table_iter_next(&iter, &key, NULL)){
+    PwGraphNode *node = pw_graph_lookup_node(graph, GPOINTER_TO_UINT(key));
+    if(node)
+      canvas_refresh_node(self, node);
+  }
+
+  if(n_layout > 0)
+    gtk_widget_queue_allocate(GTK_WIDGET(self));
+  else
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+// where links meet the port, in canvas units
+static gboolean
+canvas_compute_port_anchor(PwCanvas* self, guint32 id, graphene_point_t* pt)
 {
   PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
+  PwGraphPort *port = pw_graph_lookup_port(canvas_get_graph(self), id);
+  PwNodeRecord *rec;
+  PwNode *nod;
+  graphene_point_t *anchor;
+  graphene_rect_t r;
+
+  if(!port || !(rec = g_hash_table_lookup(priv->records, GUINT_TO_POINTER(port->parent_id))))
+    return FALSE;
+
+  gboolean is_out = port->direction == PW_PAD_DIRECTION_OUT;
+  nod = canvas_lookup_widget(self, port->parent_id);
+  if(nod && rec->allocated && pw_node_compute_port_bounds(nod, id, GTK_WIDGET(nod), &r)){
+    pt->x = r.origin.x + (is_out ? r.size.width : 0);
+    pt->y = r.origin.y + r.size.height/2;
+  }else if((anchor = g_hash_table_lookup(rec->anchors, GUINT_TO_POINTER(id)))){
+    *pt = *anchor;
+  }else{
+    // never laid out, fall back to the middle of the node's edge
+    pt->x = is_out ? rec->rect.size.width : 0;
+    pt->y = rec->rect.size.height/2;
+  }
 
-  PwPad *p1 = pw_view_controller_get_pad_by_id(G_OBJECT (priv->controller), link->out);
-  PwPad *p2 = pw_view_controller_get_pad_by_id(G_OBJECT (priv->controller), link->in);
-  graphene_rect_t rect1, rect2;
-  gboolean res = gtk_widget_compute_bounds(GTK_WIDGET (p1),GTK_WIDGET (self), &rect1);
-  res &= gtk_widget_compute_bounds (GTK_WIDGET (p2), GTK_WIDGET (self), &rect2);
-  if (!res)
-  {
-    g_warning ("Bounds checking failed");
+  pt->x += rec->rect.origin.x;
+  pt->y += rec->rect.origin.y;
+  return TRUE;
+}
+
+// FALSE if a port of the link isn't known (yet), in widget coordinates
+static gboolean
+get_curve_control_points(PwCanvas* self, PwGraphLink* link, graphene_point_t* points)
+{
+  PwCanvasPrivate* priv = pw_canvas_get_instance_private(self);
+  PwLinkShape *shape = pw_link_shapes_lookup(priv->shapes, link->id);
+  graphene_point_t origin = canvas_widget_to_canvas(self, 0, 0);
+
+  if(!shape)
+    return FALSE;
+
+  for(int i = 0; i < 4; i++)
+    points[i] = GRAPHENE_POINT_INIT((shape->cpts[i].x - origin.x)*priv->scale,
+                                    (shape->cpts[i].y - origin.y)*priv->scale);
+  return TRUE;
+}
+
+// a node being dragged is left to the user
+static gboolean
+canvas_node_is_dragged(PwCanvas *self, guint32 id)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwNode *nod = canvas_lookup_widget(self, id);
+
+  return nod && GTK_WIDGET(nod) == priv->dr_obj;
+}
+
+static gboolean
+canvas_arrange_tick(GtkWidget     *widget,
+                    GdkFrameClock *clock,
+                    gpointer       user_data)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (PW_CANVAS (widget));
+  gint64 now = gdk_frame_clock_get_frame_time(clock);
+  gdouble t = MIN(1.0, (gdouble)(now - priv->arrange_start) / ARRANGE_DURATION);
+  gdouble ease = 1 - (1 - t) * (1 - t) * (1 - t);
+
+  PwGraph *graph = canvas_get_graph(PW_CANVAS(widget));
+
+  for(guint i = 0; i < priv->arrange_moves->len; i++){
+    NodeMove *move = &g_array_index(priv->arrange_moves, NodeMove, i);
+    PwGraphNode *node = pw_graph_lookup_node(graph, move->id);
+    // removed meanwhile, or grabbed by the user
+    if(!node || canvas_node_is_dragged(PW_CANVAS(widget), move->id))
+      continue;
+    node->x = move->x0 + (move->x1 - move->x0) * ease;
+    node->y = move->y0 + (move->y1 - move->y0) * ease;
   }
-  int x1, x2, y1, y2, ydiff, xdiff;
-  x1 = rect1.origin.x + rect1.size.width;
-  y1 = rect1.origin.y + rect1.size.height / 2;
-  x2 = rect2.origin.x;
-  y2 = rect2.origin.y + rect2.size.height / 2;
-  ydiff = ABS (y1 - y2);
-  xdiff = ABS (x1 - x2);
+  gtk_widget_queue_allocate(widget);
+
+  if(t < 1.0)
+    return G_SOURCE_CONTINUE;
 
-  points[0] = GRAPHENE_POINT_INIT(x1, y1);
-  points[1] = GRAPHENE_POINT_INIT(x1 + xdiff / 2 + ydiff / 4, y1);
-  points[2] = GRAPHENE_POINT_INIT(x2 - 10 - xdiff / 2 - ydiff / 4, y2);
-  points[3] = GRAPHENE_POINT_INIT(x2, y2);
+  for(guint i = 0; i < priv->arrange_moves->len; i++){
+    NodeMove *move = &g_array_index(priv->arrange_moves, NodeMove, i);
+    PwGraphNode *node = pw_graph_lookup_node(graph, move->id);
+    if(node)
+      canvas_remember_node(PW_CANVAS(widget), node);
+  }
+  priv->arrange_tick = 0;
+  g_clear_pointer(&priv->arrange_moves, g_array_unref);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+canvas_arrange_done(GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  g_autoptr(PwCanvas) self = user_data;
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GArray) placed = pw_layout_layered_finish(result, &error);
+
+  if(!placed){
+    if(!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_warning("Arranging nodes failed: %s", error->message);
+    return;
+  }
+
+  PwGraph *graph = canvas_get_graph(self);
+
+  priv->arrange_moves = g_array_sized_new(FALSE, FALSE, sizeof(NodeMove), placed->len);
+  for(guint i = 0; i < placed->len; i++){
+    PwLayoutNode *ln = &g_array_index(placed, PwLayoutNode, i);
+    PwGraphNode *node = pw_graph_lookup_node(graph, ln->id);
+
+    if(!node)
+      continue;
+
+    NodeMove move = { ln->id, node->x, node->y, ln->x, ln->y };
+    g_array_append_val(priv->arrange_moves, move);
+  }
+
+  priv->arrange_start = g_get_monotonic_time();
+  GdkFrameClock *clock = gtk_widget_get_frame_clock(GTK_WIDGET(self));
+  if(clock)
+    priv->arrange_start = gdk_frame_clock_get_frame_time(clock);
+  priv->arrange_tick = gtk_widget_add_tick_callback(GTK_WIDGET(self), canvas_arrange_tick, NULL, NULL);
+}
+
+static void
+canvas_stop_arrange(PwCanvas *self)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+
+  g_cancellable_cancel(priv->arrange_cancel);
+  g_clear_object(&priv->arrange_cancel);
+  if(priv->arrange_tick)
+    gtk_widget_remove_tick_callback(GTK_WIDGET(self), priv->arrange_tick);
+  priv->arrange_tick = 0;
+  g_clear_pointer(&priv->arrange_moves, g_array_unref);
+}
+
+static PwLayoutHint
+node_layout_hint(PwGraphNode *node)
+{
+  guint n_in = node->inputs->len;
+  guint n_out = node->outputs->len;
+
+  if(n_out && !n_in)
+    return PW_LAYOUT_HINT_SOURCE;
+  if(n_in && !n_out)
+    return PW_LAYOUT_HINT_SINK;
+  return PW_LAYOUT_HINT_NONE;
+}
+
+
+/*
+ * Copies what the layouts need to know about the graph: node sizes as last
+ * measured, positions, pins and which nodes the links connect.
+ */
+static void
+canvas_snapshot_graph(PwCanvas  *self,
+                      GArray    *nodes,
+                      GArray    *edges)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwGraph *graph = canvas_get_graph(self);
+  g_autoptr(GHashTable) node_index = g_hash_table_new(NULL, NULL); // node id -> index + 1
+  guint n_nodes, n_links;
+
+  PwGraphNode *gnodes = pw_graph_get_nodes(graph, &n_nodes);
+  for(guint i = 0; i < n_nodes; i++){
+    PwGraphNode *node = &gnodes[i];
+    PwNodeRecord *rec = canvas_get_node_record(self, node->id);
+
+    // never measured yet, so the record holds no size
+    if(rec->rect.size.width <= 0 || rec->rect.size.height <= 0){
+      int w, h;
+      canvas_estimate_node_size(self, node, &w, &h);
+      rec->rect.size.width = w;
+      rec->rect.size.height = h;
+    }
+
+    PwLayoutNode ln = { .id = node->id,
+                        .x = node->x,
+                        .y = node->y,
+                        .width = rec->rect.size.width,
+                        .height = rec->rect.size.height,
+                        .hint = node_layout_hint(node) };
+    ln.pinned = g_hash_table_contains(priv->pinned, GUINT_TO_POINTER(ln.id));
+
+    g_array_append_val(nodes, ln);
+    g_hash_table_insert(node_index, GUINT_TO_POINTER(node->id), GUINT_TO_POINTER(nodes->len));
+  }
+
+  PwGraphLink *links = pw_graph_get_links(graph, &n_links);
+  for(guint i = 0; i < n_links; i++){
+    PwGraphPort *out = pw_graph_lookup_port(graph, links[i].out);
+    PwGraphPort *in = pw_graph_lookup_port(graph, links[i].in);
+    guint src = out ? GPOINTER_TO_UINT(g_hash_table_lookup(node_index, GUINT_TO_POINTER(out->parent_id))) : 0;
+    guint dst = in ? GPOINTER_TO_UINT(g_hash_table_lookup(node_index, GUINT_TO_POINTER(in->parent_id))) : 0;
+
+    if(src && dst){
+      PwLayoutEdge e = { src - 1, dst - 1 };
+      g_array_append_val(edges, e);
+    }
+  }
+}
+
+static gboolean
+canvas_relax_tick(GtkWidget     *widget,
+                  GdkFrameClock *clock,
+                  gpointer       user_data)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (PW_CANVAS (widget));
+  guint serial = pw_force_layout_fetch(priv->relax, priv->relax_serial, priv->relax_positions);
+
+  if(serial == priv->relax_serial)
+    return G_SOURCE_CONTINUE;
+
+  priv->relax_serial = serial;
+  PwGraph *graph = canvas_get_graph(PW_CANVAS(widget));
+  for(guint i = 0; i < priv->relax_positions->len; i++){
+    PwLayoutNode *ln = &g_array_index(priv->relax_positions, PwLayoutNode, i);
+    PwGraphNode *node = pw_graph_lookup_node(graph, ln->id);
+
+    if(!node || canvas_node_is_dragged(PW_CANVAS(widget), ln->id))
+      continue;
+    node->x = ln->x;
+    node->y = ln->y;
+  }
+  gtk_widget_queue_allocate(widget);
+
+  return G_SOURCE_CONTINUE;
+}
+
+// a node the user moved stays where it was put, also for later relaxing
+static void
+canvas_pin_node(PwCanvas *self, PwGraphNode *node)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+
+  g_hash_table_add(priv->pinned, GUINT_TO_POINTER(node->id));
+  if(!priv->relax)
+    return;
+
+  guint index = GPOINTER_TO_UINT(g_hash_table_lookup(priv->relax_index, GUINT_TO_POINTER(node->id)));
+  if(index)
+    pw_force_layout_pin(priv->relax, index - 1, node->x, node->y);
+}
+
+static void
+canvas_remember_node(PwCanvas *self, PwGraphNode *node)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+
+  pw_layout_store_remember(priv->store, node->key, node->x, node->y);
+}
+
+/*
+ * Looks for the free spot closest to @y in the column at @x, jumping past
+ * whatever is in the way. Downwards there is always a free spot eventually,
+ * upwards the search gives up after PLACE_TRIES obstacles or at the margin.
+ */
+static gfloat
+canvas_find_free_y(PwCanvas *self, guint32 id, gfloat x, gfloat y, gfloat w, gfloat h)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  graphene_rect_t probe, hit;
+  gfloat down = y, up = y;
+  gboolean up_free = FALSE;
+
+  probe = GRAPHENE_RECT_INIT(x - PLACE_GAP, down - PLACE_GAP, w + 2*PLACE_GAP, h + 2*PLACE_GAP);
+  while(pw_grid_find_overlap(priv->occupancy, &probe, id, &hit)){
+    down = hit.origin.y + hit.size.height + PLACE_GAP;
+    probe.origin.y = down - PLACE_GAP;
+  }
+  if(down == y)
+    return y;
+
+  for(guint i = 0; i < PLACE_TRIES && up >= PLACE_MARGIN; i++){
+    probe.origin.y = up - PLACE_GAP;
+    if(!pw_grid_find_overlap(priv->occupancy, &probe, id, &hit)){
+      up_free = TRUE;
+      break;
+    }
+    up = hit.origin.y - PLACE_GAP - h;
+  }
+
+  return (up_free && up >= PLACE_MARGIN && y - up < down - y) ? up : down;
+}
+
+/*
+ * Moves a new node to where the layout store remembers it, else next to the
+ * nodes it is linked to or into the column its ports suggest, and from
+ * there to the closest spot where it doesn't overlap any other node.
+ */
+static void
+canvas_place_node(PwCanvas      *self,
+                  PwGraphNode   *node,
+                  const guint32 *upstream,
+                  guint          n_upstream,
+                  const guint32 *downstream,
+                  guint          n_downstream)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwLayoutHint column = node_layout_hint(node);
+  gfloat right = -G_MAXFLOAT, left = G_MAXFLOAT, centers = 0;
+  guint found = 0;
+  gfloat x, y;
+  int w, h, sx, sy;
+
+  PwNodeRecord *rec = canvas_get_node_record(self, node->id);
+  canvas_estimate_node_size(self, node, &w, &h);
+
+  for(guint i = 0; i < n_upstream + n_downstream; i++){
+    gboolean up = i < n_upstream;
+    guint32 other_id = up ? upstream[i] : downstream[i - n_upstream];
+    PwNodeRecord *other = g_hash_table_lookup(priv->records, GUINT_TO_POINTER(other_id));
+
+    if(!other || other == rec)
+      continue;
+    if(up)
+      right = MAX(right, other->rect.origin.x + other->rect.size.width);
+    else
+      left = MIN(left, other->rect.origin.x);
+    centers += other->rect.origin.y + other->rect.size.height/2;
+    found++;
+  }
+
+  if(pw_layout_store_lookup(priv->store, node->key, &sx, &sy)){
+    // where the user had it last time
+    x = sx;
+    y = sy;
+  }else{
+    if(right > -G_MAXFLOAT)
+      x = right + PLACE_LINK_GAP;
+    else if(left < G_MAXFLOAT)
+      x = MAX(PLACE_MARGIN, left - PLACE_LINK_GAP - w);
+    else
+      x = PLACE_MARGIN + PLACE_COLUMN * (column == PW_LAYOUT_HINT_SOURCE ? 0 :
+                                         column == PW_LAYOUT_HINT_SINK ? 2 : 1);
+    y = found ? MAX(PLACE_MARGIN, centers/found - h/2.0) : PLACE_MARGIN;
+  }
+  y = canvas_find_free_y(self, rec->id, x, y, w, h);
+
+  node->x = x;
+  node->y = y;
+  rec->rect = GRAPHENE_RECT_INIT(x, y, w, h);
+  rec->generation = priv->generation;
+  pw_grid_set(priv->occupancy, rec->id, &rec->rect);
+}
+
+static void
+free_neighbours(gpointer data)
+{
+  Neighbours *nb = data;
+
+  g_array_unref(nb->upstream);
+  g_array_unref(nb->downstream);
+  g_free(nb);
+}
+
+/*
+ * Places the nodes added in a batch whose position the controller left
+ * open, in the order they arrived, so a node can already sit next to the
+ * ones placed before it. The links of the batch tell who is next to whom.
+ */
+static void
+canvas_place_new_nodes(PwCanvas *self, PwChangeSet *changes)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  PwGraph *graph = canvas_get_graph(self);
+  g_autoptr(GHashTable) unplaced = g_hash_table_new_full(NULL, NULL, NULL, free_neighbours);
+  const guint32 *ids, *links;
+  guint n_ids, n_links;
+  Neighbours *nb;
+
+  ids = pw_change_set_get(changes, PW_OBJECT_NODE, PW_CHANGE_ADDED, &n_ids);
+  for(guint i = 0; i < n_ids; i++){
+    PwGraphNode *node = pw_graph_lookup_node(graph, ids[i]);
+
+    // a node with a record was already known under another id
+    if(!node || node->placed || g_hash_table_contains(priv->records, GUINT_TO_POINTER(ids[i])))
+      continue;
+
+    nb = g_new(Neighbours, 1);
+    nb->upstream = g_array_new(FALSE, FALSE, sizeof(guint32));
+    nb->downstream = g_array_new(FALSE, FALSE, sizeof(guint32));
+    g_hash_table_insert(unplaced, GUINT_TO_POINTER(ids[i]), nb);
+  }
+  if(g_hash_table_size(unplaced) == 0)
+    return;
+
+  links = pw_change_set_get(changes, PW_OBJECT_LINK, PW_CHANGE_ADDED, &n_links);
+  for(guint i = 0; i < n_links; i++){
+    PwGraphLink *link = pw_graph_lookup_link(graph, links[i]);
+    PwGraphPort *out = link ? pw_graph_lookup_port(graph, link->out) : NULL;
+    PwGraphPort *in = link ? pw_graph_lookup_port(graph, link->in) : NULL;
+
+    if(!out || !in)
+      continue;
+    if((nb = g_hash_table_lookup(unplaced, GUINT_TO_POINTER(in->parent_id))))
+      g_array_append_val(nb->upstream, out->parent_id);
+    if((nb = g_hash_table_lookup(unplaced, GUINT_TO_POINTER(out->parent_id))))
+      g_array_append_val(nb->downstream, in->parent_id);
+  }
+
+  for(guint i = 0; i < n_ids; i++){
+    if(!(nb = g_hash_table_lookup(unplaced, GUINT_TO_POINTER(ids[i]))))
+      continue;
+    canvas_place_node(self, pw_graph_lookup_node(graph, ids[i]),
+                      (guint32 *) nb->upstream->data, nb->upstream->len,
+                      (guint32 *) nb->downstream->data, nb->downstream->len);
+  }
+}
+
+// PATCHWORK_DUMMY=<spec> shows a generated graph, see pw_dummy_configure()
+static GObject *
+canvas_create_controller(PwCanvas *self)
+{
+  const char *spec = g_getenv("PATCHWORK_DUMMY");
+  g_autoptr(GError) error = NULL;
+
+  if(spec){
+    PwDummy *dummy = pw_dummy_new();
+    if(pw_dummy_configure(dummy, spec, &error))
+      return G_OBJECT(dummy);
+    g_warning("Ignoring PATCHWORK_DUMMY: %s", error->message);
+    g_object_unref(dummy);
+  }
+
+  return G_OBJECT(pw_pipewire_new());
 }
 
 static void
@@ -1121,14 +2529,27 @@ pw_canvas_init(PwCanvas *self)
 {
   GtkWidget *widget = GTK_WIDGET (self);
   PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
-  PwPipewire *con = pw_pipewire_new (self);
-  priv->controller = G_OBJECT (con);
+  GObject *con = canvas_create_controller(self);
+  priv->controller = con;
+  priv->widgets = g_hash_table_new (NULL, NULL);
+  priv->records = g_hash_table_new_full (NULL, NULL, NULL, free_node_record);
+  priv->node_sizes = g_hash_table_new (NULL, NULL);
+  priv->generation = 0;
+  priv->occupancy = pw_grid_new (OCCUPANCY_CELL);
+  g_autofree char *store_path = pw_layout_store_get_default_path ();
+  priv->store = pw_layout_store_new (store_path);
+  priv->pinned = g_hash_table_new (NULL, NULL);
+  priv->shapes = pw_link_shapes_new (LINK_TOLERANCE);
 
   gtk_widget_init_template(widget);
+  gtk_widget_set_focusable(widget, TRUE);
   g_object_set(gtk_widget_get_settings(widget), "gtk-dnd-drag-threshold" , 1, NULL);
 
-  g_signal_connect(con, "changed", G_CALLBACK(pipewire_changed_cb), self);
-  pw_pipewire_run(con);
+  g_signal_connect(con, "change-notify", G_CALLBACK(controller_change_notify_cb), self);
+  if(PW_IS_DUMMY(con))
+    pw_dummy_run(PW_DUMMY(con));
+  else
+    pw_pipewire_run(PW_PIPEWIRE(con));
 }
 
 gdouble
@@ -1143,3 +2564,95 @@ pw_canvas_set_zoom(PwCanvas *self, gdouble zoom)
 {
   g_object_set(self, "zoom", MIN(MAX_ZOOM, MAX(MIN_ZOOM, zoom)) ,NULL);
 }
+
+/**
+ * pw_canvas_arrange:
+ *
+ * Lays all nodes out in columns following the signal flow. The layout is
+ * computed on a worker thread from a snapshot of the graph and the nodes
+ * are then moved there together in one animation.
+ */
+void
+pw_canvas_arrange(PwCanvas *self)
+{
+  g_return_if_fail(PW_IS_CANVAS(self));
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  g_autoptr(GArray) nodes = g_array_new(FALSE, FALSE, sizeof(PwLayoutNode));
+  g_autoptr(GArray) edges = g_array_new(FALSE, FALSE, sizeof(PwLayoutEdge));
+
+  canvas_stop_arrange(self);
+  pw_canvas_set_relaxing(self, FALSE);
+  canvas_snapshot_graph(self, nodes, edges);
+
+  priv->arrange_cancel = g_cancellable_new();
+  pw_layout_layered_async(nodes, edges, priv->arrange_cancel,
+                          canvas_arrange_done, g_object_ref(self));
+}
+
+const PwStats *
+pw_canvas_get_stats(PwCanvas *self)
+{
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+  return &priv->stats;
+}
+
+gboolean
+pw_canvas_get_relaxing(PwCanvas *self)
+{
+  g_return_val_if_fail(PW_IS_CANVAS(self), FALSE);
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+
+  return priv->relax != NULL;
+}
+
+/**
+ * pw_canvas_set_relaxing:
+ *
+ * Starts or stops a force directed layout that keeps pulling linked nodes
+ * together and pushing the others apart, starting from where the nodes
+ * are. Nodes the user drags are pinned in place.
+ */
+void
+pw_canvas_set_relaxing(PwCanvas *self, gboolean relaxing)
+{
+  g_return_if_fail(PW_IS_CANVAS(self));
+  PwCanvasPrivate *priv = pw_canvas_get_instance_private (self);
+
+  if(relaxing == (priv->relax != NULL))
+    return;
+
+  if(relaxing){
+    g_autoptr(GArray) nodes = g_array_new(FALSE, FALSE, sizeof(PwLayoutNode));
+    g_autoptr(GArray) edges = g_array_new(FALSE, FALSE, sizeof(PwLayoutEdge));
+
+    canvas_stop_arrange(self);
+    canvas_snapshot_graph(self, nodes, edges);
+
+    priv->relax_index = g_hash_table_new(NULL, NULL);
+    for(guint i = 0; i < nodes->len; i++)
+      g_hash_table_insert(priv->relax_index,
+                          GUINT_TO_POINTER(g_array_index(nodes, PwLayoutNode, i).id),
+                          GUINT_TO_POINTER(i + 1));
+
+    priv->relax_positions = g_array_new(FALSE, FALSE, sizeof(PwLayoutNode));
+    priv->relax_serial = 0;
+    priv->relax = pw_force_layout_new(nodes, edges);
+    priv->relax_tick = gtk_widget_add_tick_callback(GTK_WIDGET(self), canvas_relax_tick, NULL, NULL);
+  }else{
+    gtk_widget_remove_tick_callback(GTK_WIDGET(self), priv->relax_tick);
+    priv->relax_tick = 0;
+    GHashTableIter iter;
+    gpointer key;
+    g_hash_table_iter_init(&iter, priv->relax_index);
+    while(g_hash_table_iter_next(&iter, &key, NULL)){
+      PwGraphNode *node = pw_graph_lookup_node(canvas_get_graph(self), GPOINTER_TO_UINT(key));
+      if(node)
+        canvas_remember_node(self, node);
+    }
+    g_clear_pointer(&priv->relax, pw_force_layout_free);
+    g_clear_pointer(&priv->relax_index, g_hash_table_unref);
+    g_clear_pointer(&priv->relax_positions, g_array_unref);
+  }
+
+  g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RELAXING]);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <adwaita.h>
+#include "pw-node.h"
 
 G_BEGIN_DECLS
 
@@ -19,4 +20,12 @@ gdouble pw_canvas_get_zoom (PwCanvas *self);
 
 void pw_canvas_set_zoom (PwCanvas *self, gdouble zoom);
 
+void pw_canvas_arrange (PwCanvas *self);
+
+gboolean pw_canvas_get_relaxing (PwCanvas *self);
+
+void pw_canvas_set_relaxing (PwCanvas *self, gboolean relaxing);
+
+void pw_canvas_delete_selected_links (PwCanvas *self);
+
 G_END_DECLS
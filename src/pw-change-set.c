@@ -0,0 +1,202 @@
+#include "pw-change-set.h"
+
+// what a batch amounts to for one object, stored + 1 so 0 is "not seen"
+typedef enum
+{
+  STATE_ADDED = PW_CHANGE_ADDED,
+  STATE_REMOVED = PW_CHANGE_REMOVED,
+  STATE_CHANGED = PW_CHANGE_CHANGED,
+  STATE_NONE, // added and removed again
+  STATE_REPLACED, // removed and added again, both as far as the lists go
+} State;
+
+typedef struct
+{
+  PwObjectType type;
+  guint32 id;
+} Entry;
+
+struct _PwChangeSet
+{
+  GHashTable *states[PW_OBJECT_N_TYPES]; // id -> State + 1
+  GArray *order; // Entry, in the order objects were first seen
+  guint n_live; // entries not in STATE_NONE
+  GArray *rekeys[PW_OBJECT_N_TYPES]; // PwRekey, in the order they happened
+
+  // built from the above on demand
+  GArray *ids[PW_OBJECT_N_TYPES][PW_CHANGE_N_KINDS];
+  gboolean built;
+};
+
+PwChangeSet *
+pw_change_set_new (void)
+{
+  PwChangeSet *self = g_new0 (PwChangeSet, 1);
+
+  for (guint t = 0; t < PW_OBJECT_N_TYPES; t++)
+    {
+      self->states[t] = g_hash_table_new (NULL, NULL);
+      for (guint c = 0; c < PW_CHANGE_N_KINDS; c++)
+        self->ids[t][c] = g_array_new (FALSE, FALSE, sizeof (guint32));
+      self->rekeys[t] = g_array_new (FALSE, FALSE, sizeof (PwRekey));
+    }
+  self->order = g_array_new (FALSE, FALSE, sizeof (Entry));
+
+  return self;
+}
+
+void
+pw_change_set_free (PwChangeSet *self)
+{
+  for (guint t = 0; t < PW_OBJECT_N_TYPES; t++)
+    {
+      g_hash_table_unref (self->states[t]);
+      for (guint c = 0; c < PW_CHANGE_N_KINDS; c++)
+        g_array_unref (self->ids[t][c]);
+      g_array_unref (self->rekeys[t]);
+    }
+  g_array_unref (self->order);
+  g_free (self);
+}
+
+static State
+fold (State prev, PwChange change)
+{
+  switch (prev)
+    {
+    case STATE_ADDED:
+      return change == PW_CHANGE_REMOVED ? STATE_NONE : STATE_ADDED;
+    case STATE_CHANGED:
+      return change == PW_CHANGE_REMOVED ? STATE_REMOVED : STATE_CHANGED;
+    case STATE_REMOVED:
+      return change == PW_CHANGE_ADDED ? STATE_REPLACED : STATE_REMOVED;
+    case STATE_REPLACED:
+      return change == PW_CHANGE_REMOVED ? STATE_REMOVED : STATE_REPLACED;
+    case STATE_NONE:
+    default:
+      return (State) change;
+    }
+}
+
+void
+pw_change_set_note (PwChangeSet *self, PwObjectType type, PwChange change, guint32 id)
+{
+  g_return_if_fail (type < PW_OBJECT_N_TYPES && change < PW_CHANGE_N_KINDS);
+  GHashTable *states = self->states[type];
+  guint stored = GPOINTER_TO_UINT (g_hash_table_lookup (states, GUINT_TO_POINTER (id)));
+  State state;
+
+  if (!stored)
+    {
+      Entry entry = { type, id };
+      g_array_append_val (self->order, entry);
+      state = (State) change;
+      self->n_live++;
+    }
+  else
+    {
+      State prev = stored - 1;
+      state = fold (prev, change);
+      if (prev == STATE_NONE && state != STATE_NONE)
+        self->n_live++;
+      else if (prev != STATE_NONE && state == STATE_NONE)
+        self->n_live--;
+    }
+
+  g_hash_table_insert (states, GUINT_TO_POINTER (id), GUINT_TO_POINTER (state + 1));
+  self->built = FALSE;
+}
+
+static void
+change_set_build (PwChangeSet *self)
+{
+  for (guint t = 0; t < PW_OBJECT_N_TYPES; t++)
+    for (guint c = 0; c < PW_CHANGE_N_KINDS; c++)
+      g_array_set_size (self->ids[t][c], 0);
+
+  for (guint i = 0; i < self->order->len; i++)
+    {
+      Entry *entry = &g_array_index (self->order, Entry, i);
+      State state = GPOINTER_TO_UINT (g_hash_table_lookup (self->states[entry->type],
+                                                           GUINT_TO_POINTER (entry->id))) - 1;
+      if (state == STATE_REPLACED)
+        {
+          g_array_append_val (self->ids[entry->type][PW_CHANGE_REMOVED], entry->id);
+          g_array_append_val (self->ids[entry->type][PW_CHANGE_ADDED], entry->id);
+        }
+      else if (state != STATE_NONE)
+        g_array_append_val (self->ids[entry->type][state], entry->id);
+    }
+
+  self->built = TRUE;
+}
+
+/**
+ * pw_change_set_get:
+ * @n_ids: (out): length of the returned array
+ *
+ * Returns: (array length=n_ids): the ids of the objects of @type that had
+ *   @change, in the order they were first noted. Valid until @self changes.
+ */
+const guint32 *
+pw_change_set_get (PwChangeSet *self, PwObjectType type, PwChange change, guint *n_ids)
+{
+  g_return_val_if_fail (type < PW_OBJECT_N_TYPES && change < PW_CHANGE_N_KINDS, NULL);
+
+  if (!self->built)
+    change_set_build (self);
+
+  *n_ids = self->ids[type][change]->len;
+  return (const guint32 *) self->ids[type][change]->data;
+}
+
+/**
+ * pw_change_set_note_rekey:
+ *
+ * Notes that the object with @old_id now has @new_id, on top of the removal
+ * and addition that also have to be noted. Lets views carry over what they
+ * keep about the object instead of starting over.
+ */
+void
+pw_change_set_note_rekey (PwChangeSet *self, PwObjectType type, guint32 old_id, guint32 new_id)
+{
+  g_return_if_fail (type < PW_OBJECT_N_TYPES);
+  PwRekey rekey = { old_id, new_id };
+
+  g_array_append_val (self->rekeys[type], rekey);
+}
+
+/**
+ * pw_change_set_get_rekeys:
+ * @n_rekeys: (out): length of the returned array
+ *
+ * Returns: (array length=n_rekeys): the objects of @type that got another
+ *   id, in the order that happened. Valid until @self changes.
+ */
+const PwRekey *
+pw_change_set_get_rekeys (PwChangeSet *self, PwObjectType type, guint *n_rekeys)
+{
+  g_return_val_if_fail (type < PW_OBJECT_N_TYPES, NULL);
+
+  *n_rekeys = self->rekeys[type]->len;
+  return (const PwRekey *) self->rekeys[type]->data;
+}
+
+gboolean
+pw_change_set_is_empty (PwChangeSet *self)
+{
+  return self->n_live == 0;
+}
+
+void
+pw_change_set_clear (PwChangeSet *self)
+{
+  for (guint t = 0; t < PW_OBJECT_N_TYPES; t++)
+    {
+      g_hash_table_remove_all (self->states[t]);
+      g_array_set_size (self->rekeys[t], 0);
+    }
+  g_array_set_size (self->order, 0);
+  self->n_live = 0;
+  self->built = FALSE;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  PW_OBJECT_NODE,
+  PW_OBJECT_PORT,
+  PW_OBJECT_LINK,
+  PW_OBJECT_N_TYPES
+} PwObjectType;
+
+typedef enum
+{
+  PW_CHANGE_ADDED,
+  PW_CHANGE_REMOVED,
+  PW_CHANGE_CHANGED, // title, type or ports of a node, ends of a link
+  PW_CHANGE_N_KINDS
+} PwChange;
+
+/*
+ * The ids of the graph objects that were added, removed or changed during
+ * a batch, folded so every object shows up once: added and then removed is
+ * nothing. Removed and added again under the same id is a new object that
+ * reuses the id, as PipeWire does, and shows up as both removed and added.
+ * Handling the removals of a batch before its additions does the right thing.
+ */
+typedef struct _PwChangeSet PwChangeSet;
+
+// an object that was given another id, see pw_change_set_note_rekey()
+typedef struct
+{
+  guint32 old_id, new_id;
+} PwRekey;
+
+PwChangeSet *pw_change_set_new (void);
+
+void pw_change_set_free (PwChangeSet *self);
+
+void pw_change_set_note (PwChangeSet *self, PwObjectType type, PwChange change, guint32 id);
+
+const guint32 *pw_change_set_get (PwChangeSet *self, PwObjectType type, PwChange change,
+                                  guint *n_ids);
+
+void pw_change_set_note_rekey (PwChangeSet *self, PwObjectType type, guint32 old_id,
+                               guint32 new_id);
+
+const PwRekey *pw_change_set_get_rekeys (PwChangeSet *self, PwObjectType type, guint *n_rekeys);
+
+gboolean pw_change_set_is_empty (PwChangeSet *self);
+
+void pw_change_set_clear (PwChangeSet *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwChangeSet, pw_change_set_free)
+
+G_END_DECLS
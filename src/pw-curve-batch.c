@@ -0,0 +1,585 @@
+#include "pw-curve-batch.h"
+#include "pw-misc.h"
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#define LINEAR_EPS 1e-3f // a derivative with a smaller t² term is taken as linear
+#define EDGE_SLACK 1.0f // between the float bounds and the double math of pw-misc
+
+static gint simd_level = -1;
+
+// where the segments and rectangles are, relative to a curve's bounds
+enum
+{
+  STATE_APART,
+  STATE_TOUCHING,
+  STATE_INSIDE,
+};
+
+PwSimd
+pw_bezier_get_supported_simd (void)
+{
+#ifdef HAVE_X86
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma"))
+    return PW_SIMD_AVX2;
+  if (__builtin_cpu_supports ("sse2"))
+    return PW_SIMD_SSE;
+#endif
+  return PW_SIMD_NONE;
+}
+
+PwSimd
+pw_bezier_get_simd (void)
+{
+  if (simd_level < 0)
+    simd_level = pw_bezier_get_supported_simd ();
+  return simd_level;
+}
+
+PwSimd
+pw_bezier_set_simd (PwSimd level)
+{
+  simd_level = MIN (level, pw_bezier_get_supported_simd ());
+  return simd_level;
+}
+
+PwCurveBatch *
+pw_curve_batch_new (void)
+{
+  return g_new0 (PwCurveBatch, 1);
+}
+
+void
+pw_curve_batch_free (PwCurveBatch *self)
+{
+  for (int j = 0; j < 4; j++)
+    {
+      g_free (self->x[j]);
+      g_free (self->y[j]);
+    }
+  g_free (self->x0);
+  g_free (self->y0);
+  g_free (self->x1);
+  g_free (self->y1);
+  g_free (self->state);
+  g_free (self);
+}
+
+void
+pw_curve_batch_set_size (PwCurveBatch *self, guint n)
+{
+  self->n = n;
+  if (n <= self->size)
+    return;
+
+  self->size = MAX (n, self->size * 2);
+  for (int j = 0; j < 4; j++)
+    {
+      self->x[j] = g_renew (gfloat, self->x[j], self->size);
+      self->y[j] = g_renew (gfloat, self->y[j], self->size);
+    }
+  self->x0 = g_renew (gfloat, self->x0, self->size);
+  self->y0 = g_renew (gfloat, self->y0, self->size);
+  self->x1 = g_renew (gfloat, self->x1, self->size);
+  self->y1 = g_renew (gfloat, self->y1, self->size);
+  self->state = g_renew (guint8, self->state, self->size);
+}
+
+void
+pw_curve_batch_set (PwCurveBatch *self, guint i, const graphene_point_t *points)
+{
+  g_return_if_fail (i < self->n);
+
+  for (int j = 0; j < 4; j++)
+    {
+      self->x[j][i] = points[j].x;
+      self->y[j][i] = points[j].y;
+    }
+}
+
+void
+pw_curve_batch_get (PwCurveBatch *self, guint i, graphene_point_t *points)
+{
+  for (int j = 0; j < 4; j++)
+    points[j] = GRAPHENE_POINT_INIT (self->x[j][i], self->y[j][i]);
+}
+
+/* scalar */
+
+static inline gfloat
+bernstein (gfloat p0, gfloat p1, gfloat p2, gfloat p3, gfloat t)
+{
+  gfloat omt = 1 - t;
+  return omt * omt * omt * p0 + 3 * omt * omt * t * p1 + 3 * omt * t * t * p2 + t * t * t * p3;
+}
+
+// NaN and infinities of degenerate curves end up at the ends
+static inline gfloat
+clamp_t (gfloat t)
+{
+  t = t > 0 ? t : 0;
+  return t < 1 ? t : 1;
+}
+
+// the range of one coordinate, from the roots of its derivative
+static inline void
+extent (gfloat p0, gfloat p1, gfloat p2, gfloat p3, gfloat *lo, gfloat *hi)
+{
+  gfloat a = 3 * (p3 - p0 + 3 * (p1 - p2));
+  gfloat b = 6 * (p0 - 2 * p1 + p2);
+  gfloat c = 3 * (p1 - p0);
+  gfloat s = sqrtf (MAX (b * b - 4 * a * c, 0));
+  gfloat t1, t2;
+
+  if (fabsf (a) > LINEAR_EPS)
+    {
+      t1 = (-b - s) / (2 * a);
+      t2 = (-b + s) / (2 * a);
+    }
+  else
+    t1 = t2 = -c / b;
+
+  gfloat e1 = bernstein (p0, p1, p2, p3, clamp_t (t1));
+  gfloat e2 = bernstein (p0, p1, p2, p3, clamp_t (t2));
+  *lo = MIN (MIN (p0, p3), MIN (e1, e2));
+  *hi = MAX (MAX (p0, p3), MAX (e1, e2));
+}
+
+static void
+scalar_eval (PwCurveBatch *self, guint i, gfloat t, gfloat *x, gfloat *y)
+{
+  for (; i < self->n; i++)
+    {
+      x[i] = bernstein (self->x[0][i], self->x[1][i], self->x[2][i], self->x[3][i], t);
+      y[i] = bernstein (self->y[0][i], self->y[1][i], self->y[2][i], self->y[3][i], t);
+    }
+}
+
+static void
+scalar_bounds (PwCurveBatch *self, guint i)
+{
+  for (; i < self->n; i++)
+    {
+      extent (self->x[0][i], self->x[1][i], self->x[2][i], self->x[3][i], &self->x0[i], &self->x1[i]);
+      extent (self->y[0][i], self->y[1][i], self->y[2][i], self->y[3][i], &self->y0[i], &self->y1[i]);
+    }
+}
+
+// @r is x0, y0, x1, y1
+static void
+scalar_classify (PwCurveBatch *self, guint i, const gfloat *r, gfloat margin)
+{
+  for (; i < self->n; i++)
+    {
+      gboolean touching = self->x1[i] + margin >= r[0] && self->x0[i] - margin <= r[2]
+                          && self->y1[i] + margin >= r[1] && self->y0[i] - margin <= r[3];
+      gboolean inside = self->x0[i] >= r[0] && self->x1[i] < r[2]
+                        && self->y0[i] >= r[1] && self->y1[i] < r[3];
+      self->state[i] = touching + inside;
+    }
+}
+
+#ifdef HAVE_X86
+
+/* SSE, 4 curves at a time */
+
+#define SSE_LOAD(p, i) \
+  _mm_loadu_ps (p[0] + i), _mm_loadu_ps (p[1] + i), _mm_loadu_ps (p[2] + i), _mm_loadu_ps (p[3] + i)
+
+__attribute__ ((target ("sse2"))) static inline __m128
+sse_select (__m128 mask, __m128 a, __m128 b)
+{
+  return _mm_or_ps (_mm_and_ps (mask, a), _mm_andnot_ps (mask, b));
+}
+
+__attribute__ ((target ("sse2"))) static inline __m128
+sse_bernstein (__m128 p0, __m128 p1, __m128 p2, __m128 p3, __m128 t)
+{
+  __m128 three = _mm_set1_ps (3);
+  __m128 omt = _mm_sub_ps (_mm_set1_ps (1), t);
+  __m128 omt2 = _mm_mul_ps (omt, omt), t2 = _mm_mul_ps (t, t);
+  __m128 r = _mm_mul_ps (_mm_mul_ps (omt2, omt), p0);
+  r = _mm_add_ps (r, _mm_mul_ps (_mm_mul_ps (three, _mm_mul_ps (omt2, t)), p1));
+  r = _mm_add_ps (r, _mm_mul_ps (_mm_mul_ps (three, _mm_mul_ps (omt, t2)), p2));
+  return _mm_add_ps (r, _mm_mul_ps (_mm_mul_ps (t2, t), p3));
+}
+
+// maxps hands back its second operand for NaN, so those become 0 here
+__attribute__ ((target ("sse2"))) static inline __m128
+sse_clamp_t (__m128 t)
+{
+  return _mm_min_ps (_mm_max_ps (t, _mm_setzero_ps ()), _mm_set1_ps (1));
+}
+
+__attribute__ ((target ("sse2"))) static inline __m128
+sse_extent (__m128 p0, __m128 p1, __m128 p2, __m128 p3, __m128 *hi)
+{
+  __m128 zero = _mm_setzero_ps (), three = _mm_set1_ps (3);
+  __m128 a = _mm_mul_ps (three, _mm_add_ps (_mm_sub_ps (p3, p0), _mm_mul_ps (three, _mm_sub_ps (p1, p2))));
+  __m128 b = _mm_mul_ps (_mm_set1_ps (6), _mm_add_ps (_mm_sub_ps (p0, _mm_add_ps (p1, p1)), p2));
+  __m128 c = _mm_mul_ps (three, _mm_sub_ps (p1, p0));
+  __m128 disc = _mm_sub_ps (_mm_mul_ps (b, b), _mm_mul_ps (_mm_set1_ps (4), _mm_mul_ps (a, c)));
+  __m128 s = _mm_sqrt_ps (_mm_max_ps (disc, zero));
+  __m128 nb = _mm_sub_ps (zero, b);
+
+  // both roots are computed and the wrong ones masked away
+  __m128 quad = _mm_cmpgt_ps (_mm_andnot_ps (_mm_set1_ps (-0.0f), a), _mm_set1_ps (LINEAR_EPS));
+  __m128 inv = _mm_div_ps (_mm_set1_ps (0.5f), a);
+  __m128 lin = _mm_div_ps (_mm_sub_ps (zero, c), b);
+  __m128 t1 = sse_select (quad, _mm_mul_ps (_mm_sub_ps (nb, s), inv), lin);
+  __m128 t2 = sse_select (quad, _mm_mul_ps (_mm_add_ps (nb, s), inv), lin);
+
+  __m128 e1 = sse_bernstein (p0, p1, p2, p3, sse_clamp_t (t1));
+  __m128 e2 = sse_bernstein (p0, p1, p2, p3, sse_clamp_t (t2));
+  *hi = _mm_max_ps (_mm_max_ps (p0, p3), _mm_max_ps (e1, e2));
+  return _mm_min_ps (_mm_min_ps (p0, p3), _mm_min_ps (e1, e2));
+}
+
+__attribute__ ((target ("sse2"))) static guint
+sse_eval (PwCurveBatch *self, gfloat t, gfloat *x, gfloat *y)
+{
+  __m128 vt = _mm_set1_ps (t);
+  guint i = 0;
+
+  for (; i + 4 <= self->n; i += 4)
+    {
+      _mm_storeu_ps (x + i, sse_bernstein (SSE_LOAD (self->x, i), vt));
+      _mm_storeu_ps (y + i, sse_bernstein (SSE_LOAD (self->y, i), vt));
+    }
+  return i;
+}
+
+__attribute__ ((target ("sse2"))) static guint
+sse_bounds (PwCurveBatch *self)
+{
+  guint i = 0;
+
+  for (; i + 4 <= self->n; i += 4)
+    {
+      __m128 hi;
+      _mm_storeu_ps (self->x0 + i, sse_extent (SSE_LOAD (self->x, i), &hi));
+      _mm_storeu_ps (self->x1 + i, hi);
+      _mm_storeu_ps (self->y0 + i, sse_extent (SSE_LOAD (self->y, i), &hi));
+      _mm_storeu_ps (self->y1 + i, hi);
+    }
+  return i;
+}
+
+__attribute__ ((target ("sse2"))) static guint
+sse_classify (PwCurveBatch *self, const gfloat *r, gfloat margin)
+{
+  __m128 rx0 = _mm_set1_ps (r[0]), ry0 = _mm_set1_ps (r[1]);
+  __m128 rx1 = _mm_set1_ps (r[2]), ry1 = _mm_set1_ps (r[3]);
+  __m128 m = _mm_set1_ps (margin);
+  guint i = 0;
+
+  for (; i + 4 <= self->n; i += 4)
+    {
+      __m128 x0 = _mm_loadu_ps (self->x0 + i), y0 = _mm_loadu_ps (self->y0 + i);
+      __m128 x1 = _mm_loadu_ps (self->x1 + i), y1 = _mm_loadu_ps (self->y1 + i);
+      __m128 touching = _mm_and_ps (
+          _mm_and_ps (_mm_cmpge_ps (_mm_add_ps (x1, m), rx0), _mm_cmple_ps (_mm_sub_ps (x0, m), rx1)),
+          _mm_and_ps (_mm_cmpge_ps (_mm_add_ps (y1, m), ry0), _mm_cmple_ps (_mm_sub_ps (y0, m), ry1)));
+      __m128 inside = _mm_and_ps (_mm_and_ps (_mm_cmpge_ps (x0, rx0), _mm_cmplt_ps (x1, rx1)),
+                                  _mm_and_ps (_mm_cmpge_ps (y0, ry0), _mm_cmplt_ps (y1, ry1)));
+      int mt = _mm_movemask_ps (touching), mi = _mm_movemask_ps (inside);
+
+      for (int k = 0; k < 4; k++)
+        self->state[i + k] = ((mt >> k) & 1) + ((mi >> k) & 1);
+    }
+  return i;
+}
+
+/* AVX2, 8 curves at a time */
+
+#define AVX_LOAD(p, i)                                                                             \
+  _mm256_loadu_ps (p[0] + i), _mm256_loadu_ps (p[1] + i), _mm256_loadu_ps (p[2] + i),              \
+      _mm256_loadu_ps (p[3] + i)
+
+__attribute__ ((target ("avx2,fma"))) static inline __m256
+avx_bernstein (__m256 p0, __m256 p1, __m256 p2, __m256 p3, __m256 t)
+{
+  __m256 three = _mm256_set1_ps (3);
+  __m256 omt = _mm256_sub_ps (_mm256_set1_ps (1), t);
+  __m256 omt2 = _mm256_mul_ps (omt, omt), t2 = _mm256_mul_ps (t, t);
+  __m256 r = _mm256_mul_ps (_mm256_mul_ps (t2, t), p3);
+  r = _mm256_fmadd_ps (_mm256_mul_ps (three, _mm256_mul_ps (omt, t2)), p2, r);
+  r = _mm256_fmadd_ps (_mm256_mul_ps (three, _mm256_mul_ps (omt2, t)), p1, r);
+  return _mm256_fmadd_ps (_mm256_mul_ps (omt2, omt), p0, r);
+}
+
+__attribute__ ((target ("avx2,fma"))) static inline __m256
+avx_clamp_t (__m256 t)
+{
+  return _mm256_min_ps (_mm256_max_ps (t, _mm256_setzero_ps ()), _mm256_set1_ps (1));
+}
+
+__attribute__ ((target ("avx2,fma"))) static inline __m256
+avx_extent (__m256 p0, __m256 p1, __m256 p2, __m256 p3, __m256 *hi)
+{
+  __m256 zero = _mm256_setzero_ps (), three = _mm256_set1_ps (3);
+  __m256 a = _mm256_mul_ps (three, _mm256_fmadd_ps (three, _mm256_sub_ps (p1, p2), _mm256_sub_ps (p3, p0)));
+  __m256 b = _mm256_mul_ps (_mm256_set1_ps (6), _mm256_add_ps (_mm256_sub_ps (p0, _mm256_add_ps (p1, p1)), p2));
+  __m256 c = _mm256_mul_ps (three, _mm256_sub_ps (p1, p0));
+  __m256 disc = _mm256_fmsub_ps (b, b, _mm256_mul_ps (_mm256_set1_ps (4), _mm256_mul_ps (a, c)));
+  __m256 s = _mm256_sqrt_ps (_mm256_max_ps (disc, zero));
+  __m256 nb = _mm256_sub_ps (zero, b);
+
+  __m256 abs_a = _mm256_andnot_ps (_mm256_set1_ps (-0.0f), a);
+  __m256 quad = _mm256_cmp_ps (abs_a, _mm256_set1_ps (LINEAR_EPS), _CMP_GT_OQ);
+  __m256 inv = _mm256_div_ps (_mm256_set1_ps (0.5f), a);
+  __m256 lin = _mm256_div_ps (_mm256_sub_ps (zero, c), b);
+  __m256 t1 = _mm256_blendv_ps (lin, _mm256_mul_ps (_mm256_sub_ps (nb, s), inv), quad);
+  __m256 t2 = _mm256_blendv_ps (lin, _mm256_mul_ps (_mm256_add_ps (nb, s), inv), quad);
+
+  __m256 e1 = avx_bernstein (p0, p1, p2, p3, avx_clamp_t (t1));
+  __m256 e2 = avx_bernstein (p0, p1, p2, p3, avx_clamp_t (t2));
+  *hi = _mm256_max_ps (_mm256_max_ps (p0, p3), _mm256_max_ps (e1, e2));
+  return _mm256_min_ps (_mm256_min_ps (p0, p3), _mm256_min_ps (e1, e2));
+}
+
+__attribute__ ((target ("avx2,fma"))) static guint
+avx2_eval (PwCurveBatch *self, gfloat t, gfloat *x, gfloat *y)
+{
+  __m256 vt = _mm256_set1_ps (t);
+  guint i = 0;
+
+  for (; i + 8 <= self->n; i += 8)
+    {
+      _mm256_storeu_ps (x + i, avx_bernstein (AVX_LOAD (self->x, i), vt));
+      _mm256_storeu_ps (y + i, avx_bernstein (AVX_LOAD (self->y, i), vt));
+    }
+  return i;
+}
+
+__attribute__ ((target ("avx2,fma"))) static guint
+avx2_bounds (PwCurveBatch *self)
+{
+  guint i = 0;
+
+  for (; i + 8 <= self->n; i += 8)
+    {
+      __m256 hi;
+      _mm256_storeu_ps (self->x0 + i, avx_extent (AVX_LOAD (self->x, i), &hi));
+      _mm256_storeu_ps (self->x1 + i, hi);
+      _mm256_storeu_ps (self->y0 + i, avx_extent (AVX_LOAD (self->y, i), &hi));
+      _mm256_storeu_ps (self->y1 + i, hi);
+    }
+  return i;
+}
+
+__attribute__ ((target ("avx2,fma"))) static guint
+avx2_classify (PwCurveBatch *self, const gfloat *r, gfloat margin)
+{
+  __m256 rx0 = _mm256_set1_ps (r[0]), ry0 = _mm256_set1_ps (r[1]);
+  __m256 rx1 = _mm256_set1_ps (r[2]), ry1 = _mm256_set1_ps (r[3]);
+  __m256 m = _mm256_set1_ps (margin);
+  guint i = 0;
+
+  for (; i + 8 <= self->n; i += 8)
+    {
+      __m256 x0 = _mm256_loadu_ps (self->x0 + i), y0 = _mm256_loadu_ps (self->y0 + i);
+      __m256 x1 = _mm256_loadu_ps (self->x1 + i), y1 = _mm256_loadu_ps (self->y1 + i);
+      __m256 touching = _mm256_and_ps (
+          _mm256_and_ps (_mm256_cmp_ps (_mm256_add_ps (x1, m), rx0, _CMP_GE_OQ),
+                         _mm256_cmp_ps (_mm256_sub_ps (x0, m), rx1, _CMP_LE_OQ)),
+          _mm256_and_ps (_mm256_cmp_ps (_mm256_add_ps (y1, m), ry0, _CMP_GE_OQ),
+                         _mm256_cmp_ps (_mm256_sub_ps (y0, m), ry1, _CMP_LE_OQ)));
+      __m256 inside = _mm256_and_ps (
+          _mm256_and_ps (_mm256_cmp_ps (x0, rx0, _CMP_GE_OQ), _mm256_cmp_ps (x1, rx1, _CMP_LT_OQ)),
+          _mm256_and_ps (_mm256_cmp_ps (y0, ry0, _CMP_GE_OQ), _mm256_cmp_ps (y1, ry1, _CMP_LT_OQ)));
+      int mt = _mm256_movemask_ps (touching), mi = _mm256_movemask_ps (inside);
+
+      for (int k = 0; k < 8; k++)
+        self->state[i + k] = ((mt >> k) & 1) + ((mi >> k) & 1);
+    }
+  return i;
+}
+
+#endif
+
+void
+pw_curve_batch_eval (PwCurveBatch *self, gfloat t, gfloat *x, gfloat *y)
+{
+  guint i = 0;
+
+#ifdef HAVE_X86
+  switch (pw_bezier_get_simd ())
+    {
+    case PW_SIMD_AVX2:
+      i = avx2_eval (self, t, x, y);
+      break;
+    case PW_SIMD_SSE:
+      i = sse_eval (self, t, x, y);
+      break;
+    case PW_SIMD_NONE:
+    default:
+      break;
+    }
+#endif
+  scalar_eval (self, i, t, x, y);
+}
+
+void
+pw_curve_batch_update_bounds (PwCurveBatch *self)
+{
+  guint i = 0;
+
+#ifdef HAVE_X86
+  switch (pw_bezier_get_simd ())
+    {
+    case PW_SIMD_AVX2:
+      i = avx2_bounds (self);
+      break;
+    case PW_SIMD_SSE:
+      i = sse_bounds (self);
+      break;
+    case PW_SIMD_NONE:
+    default:
+      break;
+    }
+#endif
+  scalar_bounds (self, i);
+}
+
+// fills self->state for the rectangle x0, y0, x1, y1
+static void
+batch_classify (PwCurveBatch *self, gfloat x0, gfloat y0, gfloat x1, gfloat y1, gfloat margin)
+{
+  const gfloat r[4] = { x0, y0, x1, y1 };
+  guint i = 0;
+
+#ifdef HAVE_X86
+  switch (pw_bezier_get_simd ())
+    {
+    case PW_SIMD_AVX2:
+      i = avx2_classify (self, r, margin);
+      break;
+    case PW_SIMD_SSE:
+      i = sse_classify (self, r, margin);
+      break;
+    case PW_SIMD_NONE:
+    default:
+      break;
+    }
+#endif
+  scalar_classify (self, i, r, margin);
+}
+
+guint
+pw_curve_batch_cull (PwCurveBatch *self, const graphene_rect_t *rect, gfloat margin,
+                     guint *visible)
+{
+  guint n_visible = 0;
+
+  batch_classify (self, rect->origin.x, rect->origin.y, rect->origin.x + rect->size.width,
+                  rect->origin.y + rect->size.height, margin);
+  // without a branch, about half of them would be mispredicted
+  for (guint i = 0; i < self->n; i++)
+    {
+      visible[n_visible] = i;
+      n_visible += self->state[i] != STATE_APART;
+    }
+
+  return n_visible;
+}
+
+guint
+pw_curve_batch_intersect_line (PwCurveBatch *self, graphene_point_t l1, graphene_point_t l2,
+                               guint8 *hits)
+{
+  graphene_point_t pts[4];
+  guint n_hits = 0;
+
+  // only the curves near the segment need the exact test
+  batch_classify (self, MIN (l1.x, l2.x), MIN (l1.y, l2.y), MAX (l1.x, l2.x), MAX (l1.y, l2.y),
+                  EDGE_SLACK);
+  for (guint i = 0; i < self->n; i++)
+    {
+      hits[i] = FALSE;
+      if (self->state[i] == STATE_APART)
+        continue;
+
+      pw_curve_batch_get (self, i, pts);
+      hits[i] = cbezier_line_intersects (l1, l2, pts[0], pts[1], pts[2], pts[3]);
+      n_hits += hits[i];
+    }
+  return n_hits;
+}
+
+/*
+ * cbezier_line_intersects() for the edges of a rectangle, which need no
+ * rotation: @p are the curve's coordinates across the edge, @q along it.
+ */
+static gboolean
+crosses_edge (const gfloat *p, const gfloat *q, gfloat at, gfloat from, gfloat to)
+{
+  double roots[3];
+
+  get_cubic_roots (p[0] - at, p[1] - at, p[2] - at, p[3] - at, roots);
+  for (int k = 0; k < 3; k++)
+    {
+      double t = roots[k];
+      if (isnan (t) || t < 0 || t > 1)
+        continue;
+
+      double omt = 1 - t;
+      double r = omt * omt * omt * q[0] + 3 * omt * omt * t * q[1] + 3 * omt * t * t * q[2]
+                 + t * t * t * q[3];
+      if (r >= from && r <= to)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+static gboolean
+crosses_rect (PwCurveBatch *self, guint i, gfloat x0, gfloat y0, gfloat x1, gfloat y1)
+{
+  gfloat px[4], py[4];
+
+  for (int j = 0; j < 4; j++)
+    {
+      px[j] = self->x[j][i];
+      py[j] = self->y[j][i];
+    }
+
+  // an edge the bounds don't reach can't be crossed
+  return (self->y0[i] <= y0 + EDGE_SLACK && self->y1[i] >= y0 - EDGE_SLACK && crosses_edge (py, px, y0, x0, x1))
+         || (self->y0[i] <= y1 + EDGE_SLACK && self->y1[i] >= y1 - EDGE_SLACK && crosses_edge (py, px, y1, x0, x1))
+         || (self->x0[i] <= x0 + EDGE_SLACK && self->x1[i] >= x0 - EDGE_SLACK && crosses_edge (px, py, x0, y0, y1))
+         || (self->x0[i] <= x1 + EDGE_SLACK && self->x1[i] >= x1 - EDGE_SLACK && crosses_edge (px, py, x1, y0, y1));
+}
+
+guint
+pw_curve_batch_select (PwCurveBatch *self, const graphene_rect_t *rect, guint8 *selected)
+{
+  gfloat x0 = rect->origin.x, y0 = rect->origin.y;
+  gfloat x1 = x0 + rect->size.width, y1 = y0 + rect->size.height;
+  guint n_selected = 0;
+
+  // what is inside or apart is settled by the bounds, the rest crosses an edge or not
+  batch_classify (self, x0, y0, x1, y1, EDGE_SLACK);
+  for (guint i = 0; i < self->n; i++)
+    {
+      switch (self->state[i])
+        {
+        case STATE_INSIDE:
+          selected[i] = TRUE;
+          break;
+        case STATE_TOUCHING:
+          selected[i] = crosses_rect (self, i, x0, y0, x1, y1);
+          break;
+        case STATE_APART:
+        default:
+          selected[i] = FALSE;
+          break;
+        }
+      n_selected += selected[i];
+    }
+  return n_selected;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glib.h>
+#include <graphene.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Many cubic curves at once, in structure of arrays form: control point j of
+ * curve i is (x[j][i], y[j][i]). The kernels go over the whole batch with
+ * SSE or AVX2 where the CPU has them and plain C elsewhere.
+ *
+ * Not part of the app, the canvas works on the polylines of pw-bezier.h and
+ * the grid of pw-link-shapes.h. Only bench-bezier builds this.
+ */
+typedef struct
+{
+  guint n, size;
+  gfloat *x[4], *y[4];
+  gfloat *x0, *y0, *x1, *y1; // bounds, valid after pw_curve_batch_update_bounds()
+  guint8 *state; // scratch of the kernels
+} PwCurveBatch;
+
+typedef enum
+{
+  PW_SIMD_NONE,
+  PW_SIMD_SSE,
+  PW_SIMD_AVX2,
+} PwSimd;
+
+// the best level the CPU supports
+PwSimd pw_bezier_get_supported_simd (void);
+
+PwSimd pw_bezier_get_simd (void);
+
+// for comparing the code paths, clamped to what is supported, returns the level set
+PwSimd pw_bezier_set_simd (PwSimd level);
+
+PwCurveBatch *pw_curve_batch_new (void);
+
+void pw_curve_batch_free (PwCurveBatch *self);
+
+// keeps the curves below @n, the ones above are garbage until set
+void pw_curve_batch_set_size (PwCurveBatch *self, guint n);
+
+void pw_curve_batch_set (PwCurveBatch *self, guint i, const graphene_point_t *points);
+
+void pw_curve_batch_get (PwCurveBatch *self, guint i, graphene_point_t *points);
+
+// the point at @t of every curve
+void pw_curve_batch_eval (PwCurveBatch *self, gfloat t, gfloat *x, gfloat *y);
+
+// tight boxes, from the ends and the extremes of each coordinate
+void pw_curve_batch_update_bounds (PwCurveBatch *self);
+
+// indices of the curves whose bounds grown by @margin touch @rect, returns how many
+guint pw_curve_batch_cull (PwCurveBatch *self, const graphene_rect_t *rect,
+                           gfloat margin, guint *visible);
+
+// curves crossing the segment, as cbezier_line_intersects() sees it, returns how many
+guint pw_curve_batch_intersect_line (PwCurveBatch *self, graphene_point_t l1,
+                                     graphene_point_t l2, guint8 *hits);
+
+// curves inside of @rect or crossing its edges, returns how many
+guint pw_curve_batch_select (PwCurveBatch *self, const graphene_rect_t *rect,
+                             guint8 *selected);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwCurveBatch, pw_curve_batch_free)
+
+G_END_DECLS
@@ -1,15 +1,36 @@
 #include "pw-dummy.h"
-#include "pw-node.h"
-#include "pw-pad.h"
 #include "pw-view-controller.h"
+#include "pw-types.h"
+#include <math.h>
+
+#define CHURN_INTERVAL 100 // ms
+#define PICK_TRIES 8
+
+// in the order of media_weights
+static const PwPadType media_types[] = { PW_PAD_TYPE_AUDIO, PW_PAD_TYPE_MIDI, PW_PAD_TYPE_VIDEO };
 
 struct _PwDummy
 {
   GObject parent_instance;
 
-  GList *nodes;
-  GList *pads;
-  GList *links;
+  PwGraph *graph;
+  guint32 next_id;
+
+  // what pw_dummy_run generates
+  guint n_nodes;
+  guint min_ports, max_ports; // per direction
+  PwDummyPortDistribution port_distribution;
+  guint media_weights[G_N_ELEMENTS (media_types)];
+  PwDummyTopology topology;
+  gdouble link_density; // links per output port
+  guint layers; // 0 for about the square root of the node count
+  gdouble churn; // nodes replaced per second
+  guint seed;
+
+  GRand *rand;
+  guint churn_id;
+  gint64 churn_last;
+  gdouble churn_debt;
 };
 
 static void pw_view_controller_iface_init (PwViewControllerInterface *iface);
@@ -21,6 +42,18 @@ G_DEFINE_TYPE_WITH_CODE (PwDummy, pw_dummy, G_TYPE_OBJECT,
 enum
 {
   PROP_0,
+  PROP_N_NODES,
+  PROP_MIN_PORTS,
+  PROP_MAX_PORTS,
+  PROP_PORT_DISTRIBUTION,
+  PROP_AUDIO_WEIGHT,
+  PROP_MIDI_WEIGHT,
+  PROP_VIDEO_WEIGHT,
+  PROP_TOPOLOGY,
+  PROP_LINK_DENSITY,
+  PROP_LAYERS,
+  PROP_CHURN,
+  PROP_SEED,
   N_PROPS
 };
 
@@ -34,12 +67,6 @@ static void pw_dummy_get_property (GObject *object, guint prop_id,
 
 static void pw_dummy_set_property (GObject *object, guint prop_id,
                                    const GValue *value, GParamSpec *pspec);
-
-static PwNode*
-pw_dummy_get_node_by_id (GObject* this, gint id);
-
-static void
-_link_added_cb (PwPad* self, guint id1, guint id2, gpointer user_data);
 ///////////////////////////////////////////////////////////
 
 PwDummy *
@@ -48,19 +75,14 @@ pw_dummy_new (void)
   return g_object_new (PW_TYPE_DUMMY, NULL);
 }
 
-static void
-free_nodes (gpointer data)
-{
-  gtk_widget_unparent (GTK_WIDGET (data));
-}
-
 static void
 pw_dummy_dispose (GObject *object)
 {
   PwDummy *dum = PW_DUMMY (object);
 
-  GList *l = dum->nodes;
-  g_list_free_full (g_steal_pointer (&dum->nodes), free_nodes);
+  g_clear_handle_id (&dum->churn_id, g_source_remove);
+  g_clear_pointer (&dum->graph, pw_graph_free);
+  g_clear_pointer (&dum->rand, g_rand_free);
 
   G_OBJECT_CLASS (pw_dummy_parent_class)->dispose (object);
 }
@@ -81,6 +103,38 @@ pw_dummy_get_property (GObject *object, guint prop_id, GValue *value,
 
   switch (prop_id)
     {
+    case PROP_N_NODES:
+      g_value_set_uint (value, self->n_nodes);
+      break;
+    case PROP_MIN_PORTS:
+      g_value_set_uint (value, self->min_ports);
+      break;
+    case PROP_MAX_PORTS:
+      g_value_set_uint (value, self->max_ports);
+      break;
+    case PROP_PORT_DISTRIBUTION:
+      g_value_set_enum (value, self->port_distribution);
+      break;
+    case PROP_AUDIO_WEIGHT:
+    case PROP_MIDI_WEIGHT:
+    case PROP_VIDEO_WEIGHT:
+      g_value_set_uint (value, self->media_weights[prop_id - PROP_AUDIO_WEIGHT]);
+      break;
+    case PROP_TOPOLOGY:
+      g_value_set_enum (value, self->topology);
+      break;
+    case PROP_LINK_DENSITY:
+      g_value_set_double (value, self->link_density);
+      break;
+    case PROP_LAYERS:
+      g_value_set_uint (value, self->layers);
+      break;
+    case PROP_CHURN:
+      g_value_set_double (value, self->churn);
+      break;
+    case PROP_SEED:
+      g_value_set_uint (value, self->seed);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -94,6 +148,38 @@ pw_dummy_set_property (GObject *object, guint prop_id, const GValue *value,
 
   switch (prop_id)
     {
+    case PROP_N_NODES:
+      self->n_nodes = g_value_get_uint (value);
+      break;
+    case PROP_MIN_PORTS:
+      self->min_ports = g_value_get_uint (value);
+      break;
+    case PROP_MAX_PORTS:
+      self->max_ports = g_value_get_uint (value);
+      break;
+    case PROP_PORT_DISTRIBUTION:
+      self->port_distribution = g_value_get_enum (value);
+      break;
+    case PROP_AUDIO_WEIGHT:
+    case PROP_MIDI_WEIGHT:
+    case PROP_VIDEO_WEIGHT:
+      self->media_weights[prop_id - PROP_AUDIO_WEIGHT] = g_value_get_uint (value);
+      break;
+    case PROP_TOPOLOGY:
+      self->topology = g_value_get_enum (value);
+      break;
+    case PROP_LINK_DENSITY:
+      self->link_density = g_value_get_double (value);
+      break;
+    case PROP_LAYERS:
+      self->layers = g_value_get_uint (value);
+      break;
+    case PROP_CHURN:
+      self->churn = g_value_get_double (value);
+      break;
+    case PROP_SEED:
+      self->seed = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -108,157 +194,492 @@ pw_dummy_class_init (PwDummyClass *klass)
   object_class->finalize = pw_dummy_finalize;
   object_class->get_property = pw_dummy_get_property;
   object_class->set_property = pw_dummy_set_property;
-}
 
-static gint cord = 50;
+  properties[PROP_N_NODES] = g_param_spec_uint (
+      "n-nodes", "Nodes", "Number of nodes pw_dummy_run() generates", 0, 1000000, 0,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_MIN_PORTS] = g_param_spec_uint (
+      "min-ports", "Minimum ports", "Fewest ports per direction", 0, 1024, 1,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_MAX_PORTS] = g_param_spec_uint (
+      "max-ports", "Maximum ports", "Most ports per direction", 0, 1024, 2,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_PORT_DISTRIBUTION] = g_param_spec_enum (
+      "port-distribution", "Port distribution", "How port counts are spread",
+      PW_TYPE_DUMMY_PORT_DISTRIBUTION, PW_DUMMY_PORTS_UNIFORM,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_AUDIO_WEIGHT] = g_param_spec_uint (
+      "audio-weight", "Audio weight", "Share of audio nodes", 0, G_MAXUINT16, 8,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_MIDI_WEIGHT] = g_param_spec_uint (
+      "midi-weight", "MIDI weight", "Share of MIDI nodes", 0, G_MAXUINT16, 1,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_VIDEO_WEIGHT] = g_param_spec_uint (
+      "video-weight", "Video weight", "Share of video nodes", 0, G_MAXUINT16, 1,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_TOPOLOGY] = g_param_spec_enum (
+      "topology", "Topology", "How nodes are linked", PW_TYPE_DUMMY_TOPOLOGY,
+      PW_DUMMY_TOPOLOGY_RANDOM, G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_LINK_DENSITY] = g_param_spec_double (
+      "link-density", "Link density", "Links per output port", 0, 64, 1,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_LAYERS] = g_param_spec_uint (
+      "layers", "Layers", "Layers of the layered topology, 0 for automatic", 0,
+      G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_CHURN] = g_param_spec_double (
+      "churn", "Churn", "Nodes replaced per second", 0, 10000, 0,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_SEED] = g_param_spec_uint (
+      "seed", "Seed", "Seed of the generator", 0, G_MAXUINT, 1,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
 
 static void
-pw_dummy_add_node (GObject *this, PwCanvas *canv, PwNodeData nod)
+pw_dummy_add_node (GObject *this, PwNodeData nod)
 {
   g_return_if_fail(PW_IS_DUMMY(this));
   PwDummy *con = PW_DUMMY (this);
 
-  PwNode *nnod = pw_node_new (nod.id);
-  pw_node_set_xpos (nnod, cord);
-  pw_node_set_ypos (nnod, cord);
-  g_object_set (G_OBJECT (nnod), "title", nod.title, NULL);
+  // placed by the canvas like a live node
+  pw_graph_add_node (con->graph, nod.id, nod.title, nod.key, nod.type, nod.category);
+  pw_view_controller_flush_changes (this);
+}
 
-  con->nodes = g_list_prepend (con->nodes, nnod);
-  gtk_widget_set_parent (GTK_WIDGET (nnod), GTK_WIDGET (canv));
+static void
+pw_dummy_add_pad (GObject *this, PwPadData data)
+{
+  g_return_if_fail(PW_IS_DUMMY(this));
+  PwDummy *con = PW_DUMMY (this);
 
-  cord += 50;
+  pw_graph_add_port (con->graph, data.id, data.parent_id, data.name, data.direction);
+  pw_view_controller_flush_changes (this);
 }
 
 static void
-pw_dummy_add_pad (GObject *this, PwPadData data)
+pw_dummy_add_link(GObject* this, PwLinkData data)
 {
   g_return_if_fail(PW_IS_DUMMY(this));
   PwDummy *con = PW_DUMMY (this);
-  PwNode *nod;
-  g_return_if_fail (nod = pw_dummy_get_node_by_id(G_OBJECT(con), data.parent_id));
 
-  PwPad *pad = pw_pad_new_with_name (data.id, data.direction, pw_node_get_media_type(nod), data.name);
+  pw_graph_add_link (con->graph, data.id, data.out, data.in);
+  pw_view_controller_flush_changes (this);
+}
 
-  g_signal_connect(pad , "link-added" , G_CALLBACK(_link_added_cb), con);
+static gboolean
+pw_dummy_remove (GObject *this, gint id)
+{
+  g_return_val_if_fail(PW_IS_DUMMY(this), FALSE);
+  PwDummy *con = PW_DUMMY (this);
 
-  con->pads = g_list_prepend(con->pads , pad);
-  pw_node_append_pad (nod, pad, data.direction);
+  gboolean removed = pw_graph_remove (con->graph, id);
+  pw_view_controller_flush_changes (this);
+  return removed;
 }
 
 static void
-pw_dummy_add_link(GObject* this, PwLinkData data)
+pw_dummy_link_pads (GObject *this, guint32 out, guint32 in)
 {
   g_return_if_fail(PW_IS_DUMMY(this));
   PwDummy *con = PW_DUMMY (this);
 
-  PwLinkData* el = malloc(sizeof(PwLinkData));
-  memcpy(el , &data , sizeof(PwLinkData));
+  PwLinkData dat = {.id=con->next_id++,.in = in, .out=out};
+  pw_dummy_add_link(this, dat);
+}
 
-  con->links = g_list_prepend(con->links, el);
+static void
+pw_dummy_unlink (GObject *this, guint32 link)
+{
+  g_return_if_fail(PW_IS_DUMMY(this));
+
+  pw_dummy_remove(this, link);
 }
 
-static PwNode*
-pw_dummy_get_node_by_id (GObject* this, gint id)
+static PwGraph*
+pw_dummy_get_graph(GObject* this)
 {
-  g_return_val_if_fail(PW_IS_DUMMY(this) , NULL);
+  g_return_val_if_fail(PW_IS_DUMMY(this),NULL);
   PwDummy* dum = PW_DUMMY(this);
-  GList* l=dum->nodes;
+  return dum->graph;
+}
 
-  while(l)
+static void
+pw_view_controller_iface_init (PwViewControllerInterface *iface)
+{
+  iface->add_node = pw_dummy_add_node;
+  iface->add_pad = pw_dummy_add_pad;
+  iface->add_link = pw_dummy_add_link;
+  iface->remove = pw_dummy_remove;
+  iface->link_pads = pw_dummy_link_pads;
+  iface->unlink = pw_dummy_unlink;
+  iface->get_graph = pw_dummy_get_graph;
+}
+
+static void
+pw_dummy_init (PwDummy *self)
+{
+  self->graph = pw_graph_new ();
+  self->next_id = 1;
+  self->rand = NULL;
+  self->churn_id = 0;
+}
+
+/**
+ * pw_dummy_configure:
+ * @spec: comma separated "property=value" pairs, e.g.
+ *   "n-nodes=10000,topology=layered,link-density=2,churn=5"
+ *
+ * Sets the generator properties from a string, enums go by their nick.
+ */
+gboolean
+pw_dummy_configure (PwDummy *self, const char *spec, GError **error)
+{
+  g_return_val_if_fail (PW_IS_DUMMY (self), FALSE);
+  g_auto (GStrv) pairs = g_strsplit (spec, ",", -1);
+
+  for (guint i = 0; pairs[i]; i++)
     {
-      if(pw_node_get_id(PW_NODE(l->data))==id)
-        return l->data;
+      g_auto (GStrv) kv = g_strsplit (g_strstrip (pairs[i]), "=", 2);
+      g_auto (GValue) value = G_VALUE_INIT;
+      GParamSpec *pspec;
+      guint64 u;
+
+      if (!*kv[0])
+        continue;
+
+      pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (self), kv[0]);
+      if (!pspec || !kv[1])
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                       "Expected <property>=<value> instead of “%s”", pairs[i]);
+          return FALSE;
+        }
+
+      g_value_init (&value, pspec->value_type);
+      if (G_IS_PARAM_SPEC_UINT (pspec))
+        {
+          if (!g_ascii_string_to_unsigned (kv[1], 10, 0, G_MAXUINT, &u, error))
+            return FALSE;
+          g_value_set_uint (&value, u);
+        }
+      else if (G_IS_PARAM_SPEC_DOUBLE (pspec))
+        {
+          char *end;
+          g_value_set_double (&value, g_ascii_strtod (kv[1], &end));
+          if (*end || end == kv[1])
+            {
+              g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                           "“%s” is not a number", kv[1]);
+              return FALSE;
+            }
+        }
+      else
+        {
+          g_autoptr (GEnumClass) klass = g_type_class_ref (pspec->value_type);
+          GEnumValue *ev = g_enum_get_value_by_nick (klass, kv[1]);
+          if (!ev)
+            {
+              g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                           "“%s” is not a value of %s", kv[1], kv[0]);
+              return FALSE;
+            }
+          g_value_set_enum (&value, ev->value);
+        }
+
+      if (g_param_value_validate (pspec, &value))
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                       "%s is out of range", kv[0]);
+          return FALSE;
+        }
+      g_object_set_property (G_OBJECT (self), kv[0], &value);
+    }
+
+  return TRUE;
+}
+
+static PwPadType
+dummy_pick_media_type (PwDummy *self)
+{
+  guint total = 0, r;
+
+  for (guint i = 0; i < G_N_ELEMENTS (media_types); i++)
+    total += self->media_weights[i];
+  if (total == 0)
+    return PW_PAD_TYPE_AUDIO;
 
-      l=l->next;
+  r = g_rand_int_range (self->rand, 0, total);
+  for (guint i = 0; i < G_N_ELEMENTS (media_types); i++)
+    {
+      if (r < self->media_weights[i])
+        return media_types[i];
+      r -= self->media_weights[i];
     }
-  return NULL;
+  return PW_PAD_TYPE_AUDIO;
 }
 
-static PwPad*
-pw_dummy_get_pad_by_id (GObject* this, gint id)
+static guint
+dummy_pick_port_count (PwDummy *self)
 {
-  g_return_val_if_fail(PW_IS_DUMMY(this) , NULL);
-  PwDummy* dum = PW_DUMMY(this);
-  GList* l=dum->pads;
+  guint n = self->min_ports;
 
-  while(l)
+  if (self->max_ports <= self->min_ports)
+    return n;
+
+  switch (self->port_distribution)
     {
-      if(pw_pad_get_id(PW_PAD(l->data))==id)
-        return l->data;
+    case PW_DUMMY_PORTS_GEOMETRIC:
+      while (n < self->max_ports && g_rand_boolean (self->rand))
+        n++;
+      return n;
+    case PW_DUMMY_PORTS_UNIFORM:
+    default:
+      return g_rand_int_range (self->rand, self->min_ports, self->max_ports + 1);
+    }
+}
 
-      l=l->next;
+static guint32
+dummy_generate_node (PwDummy *self, gint x, gint y, guint n_ports)
+{
+  guint32 id = self->next_id++;
+  char title[32];
+
+  g_snprintf (title, sizeof (title), "Synthetic %u", id);
+  PwGraphNode *node = pw_graph_add_node (self->graph, id, title, NULL,
+                                         dummy_pick_media_type (self), 0);
+  node->x = x;
+  node->y = y;
+  node->placed = TRUE;
+
+  for (int dir = PW_PAD_DIRECTION_OUT; dir <= PW_PAD_DIRECTION_IN; dir++)
+    {
+      guint n = n_ports ? n_ports : dummy_pick_port_count (self);
+      for (guint i = 0; i < n; i++)
+        {
+          char name[32];
+          g_snprintf (name, sizeof (name), "%s_%u",
+                      dir == PW_PAD_DIRECTION_OUT ? "output" : "input", i + 1);
+          pw_graph_add_port (self->graph, self->next_id++, id, name, dir);
+        }
     }
-  return NULL;
+
+  return id;
 }
 
-static void
-pw_dummy_node_to_front (GObject *this, gint id)
+// a port of @dir on one of the nodes [lo, hi) of the same type as @node, or 0
+static guint32
+dummy_pick_port (PwDummy *self, PwGraphNode *node, gint dir, guint lo, guint hi)
 {
-  g_return_if_fail(PW_IS_DUMMY(this));
-  PwDummy* dum = PW_DUMMY(this);
+  guint n_nodes;
+  PwGraphNode *nodes = pw_graph_get_nodes (self->graph, &n_nodes);
 
-  PwNode* n = pw_dummy_get_node_by_id(G_OBJECT(dum), id);
+  hi = MIN (hi, n_nodes);
+  if (lo >= hi)
+    return 0;
 
-  GList* elem = g_list_find(dum->nodes, n);
-  dum->nodes = g_list_remove_link(dum->nodes, elem);
+  for (guint t = 0; t < PICK_TRIES; t++)
+    {
+      PwGraphNode *other = &nodes[g_rand_int_range (self->rand, lo, hi)];
+      GArray *ports = pw_graph_node_get_ports (other, dir);
 
-  // NULL because of last to snapshot is one in front
-  dum->nodes = g_list_insert_before_link(dum->nodes, NULL, elem);
+      if (other == node || other->type != node->type || ports->len == 0)
+        continue;
+      return g_array_index (ports, guint32, g_rand_int_range (self->rand, 0, ports->len));
+    }
+
+  return 0;
 }
 
-static GList*
-pw_dummy_get_node_list(GObject* this)
+static guint
+dummy_pick_link_count (PwDummy *self)
 {
-  g_return_val_if_fail(PW_IS_DUMMY(this),NULL);
-  PwDummy* dum = PW_DUMMY(this);
-  return dum->nodes;
+  gdouble whole = floor (self->link_density);
+
+  return whole + (g_rand_double (self->rand) < self->link_density - whole);
 }
 
-static GList*
-pw_dummy_get_link_list(GObject* this)
+// links the ports of node @id in @dir to ports on the nodes [lo, hi)
+static void
+dummy_link_node (PwDummy *self, guint32 id, gint dir, guint lo, guint hi)
 {
-  g_return_val_if_fail(PW_IS_DUMMY(this),NULL);
-  PwDummy* dum = PW_DUMMY(this);
-  return dum->links;
+  PwGraphNode *node = pw_graph_lookup_node (self->graph, id);
+  GArray *ports = pw_graph_node_get_ports (node, dir);
+  gint other_dir = dir == PW_PAD_DIRECTION_OUT ? PW_PAD_DIRECTION_IN : PW_PAD_DIRECTION_OUT;
+
+  for (guint i = 0; i < ports->len; i++)
+    {
+      guint n = dummy_pick_link_count (self);
+      for (guint j = 0; j < n; j++)
+        {
+          guint32 port = g_array_index (ports, guint32, i);
+          guint32 other = dummy_pick_port (self, node, other_dir, lo, hi);
+          if (!other)
+            continue;
+          if (dir == PW_PAD_DIRECTION_OUT)
+            pw_graph_add_link (self->graph, self->next_id++, port, other);
+          else
+            pw_graph_add_link (self->graph, self->next_id++, other, port);
+        }
+    }
 }
 
+// every other node feeds the bus port by port and gets fed back by it
 static void
-pw_view_controller_iface_init (PwViewControllerInterface *iface)
+dummy_link_bus (PwDummy *self, guint32 bus_id)
 {
-  iface->add_node = pw_dummy_add_node;
-  iface->add_pad = pw_dummy_add_pad;
-  iface->add_link = pw_dummy_add_link;
-  iface->get_node_by_id = pw_dummy_get_node_by_id;
-  iface->get_pad_by_id = pw_dummy_get_pad_by_id;
-  iface->node_to_front = pw_dummy_node_to_front;
-  iface->get_node_list = pw_dummy_get_node_list;
-  iface->get_link_list = pw_dummy_get_link_list;
+  guint n_nodes;
+  PwGraphNode *nodes = pw_graph_get_nodes (self->graph, &n_nodes);
+  PwGraphNode *bus = pw_graph_lookup_node (self->graph, bus_id);
+  GArray *bus_in = bus->inputs, *bus_out = bus->outputs;
+
+  for (guint i = 0; i < n_nodes; i++)
+    {
+      if (nodes[i].id == bus_id)
+        continue;
+
+      for (guint j = 0; bus_in->len && j < nodes[i].outputs->len; j++)
+        pw_graph_add_link (self->graph, self->next_id++,
+                           g_array_index (nodes[i].outputs, guint32, j),
+                           g_array_index (bus_in, guint32, j % bus_in->len));
+      for (guint j = 0; bus_out->len && j < nodes[i].inputs->len; j++)
+        pw_graph_add_link (self->graph, self->next_id++,
+                           g_array_index (bus_out, guint32, j % bus_out->len),
+                           g_array_index (nodes[i].inputs, guint32, j));
+    }
+}
+
+static guint
+dummy_get_layers (PwDummy *self)
+{
+  if (self->layers)
+    return MIN (self->layers, MAX (self->n_nodes, 1));
+  return MAX (1, (guint) sqrt (self->n_nodes));
 }
 
 static void
-pw_dummy_init (PwDummy *self)
+dummy_generate (PwDummy *self)
 {
-  self->nodes = NULL;
-  self->pads  = NULL;
-  self->links = NULL;
+  guint n = self->n_nodes;
+  guint layers = dummy_get_layers (self);
+  guint per_layer = (n + layers - 1) / layers;
+  guint cols = MAX (1, (guint) ceil (sqrt (n)));
+  guint32 bus = 0;
+
+  // nodes are laid out in a grid, by layer for the layered topology
+  for (guint i = 0; i < n; i++)
+    {
+      gboolean layered = self->topology == PW_DUMMY_TOPOLOGY_LAYERED;
+      guint col = layered ? i / per_layer : i % cols;
+      guint row = layered ? i % per_layer : i / cols;
+      guint n_ports = 0;
+
+      if (i == 0 && self->topology == PW_DUMMY_TOPOLOGY_BUSSED)
+        n_ports = MAX (self->max_ports, 1);
+
+      guint32 id = dummy_generate_node (self, col * 300, row * 150, n_ports);
+      if (i == 0)
+        bus = id;
+    }
+
+  guint n_nodes;
+  PwGraphNode *nodes = pw_graph_get_nodes (self->graph, &n_nodes);
+  switch (self->topology)
+    {
+    case PW_DUMMY_TOPOLOGY_LAYERED:
+      for (guint i = 0; i < n_nodes; i++)
+        {
+          guint next = (i / per_layer + 1) * per_layer;
+          dummy_link_node (self, nodes[i].id, PW_PAD_DIRECTION_OUT, next, next + per_layer);
+        }
+      break;
+    case PW_DUMMY_TOPOLOGY_BUSSED:
+      if (bus)
+        dummy_link_bus (self, bus);
+      break;
+    case PW_DUMMY_TOPOLOGY_RANDOM:
+    default:
+      for (guint i = 0; i < n_nodes; i++)
+        dummy_link_node (self, nodes[i].id, PW_PAD_DIRECTION_OUT, 0, n_nodes);
+      break;
+    }
 }
 
+// a random node goes away with its links and a new one takes its place
 static void
-_link_added_cb (PwPad* self, guint id1, guint id2, gpointer user_data)
+dummy_replace_node (PwDummy *self)
+{
+  guint n_nodes, n_links;
+  PwGraphNode *nodes = pw_graph_get_nodes (self->graph, &n_nodes);
+  PwGraphLink *links = pw_graph_get_links (self->graph, &n_links);
+  g_autoptr (GArray) stale = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  if (n_nodes < 2)
+    return;
+
+  PwGraphNode *node = &nodes[g_rand_int_range (self->rand, 0, n_nodes)];
+  guint32 old_id = node->id;
+  gint x = node->x, y = node->y;
+
+  for (guint i = 0; i < n_links; i++)
+    {
+      PwGraphPort *out = pw_graph_lookup_port (self->graph, links[i].out);
+      PwGraphPort *in = pw_graph_lookup_port (self->graph, links[i].in);
+      if ((out && out->parent_id == old_id) || (in && in->parent_id == old_id))
+        g_array_append_val (stale, links[i].id);
+    }
+  for (guint i = 0; i < stale->len; i++)
+    pw_graph_remove (self->graph, g_array_index (stale, guint32, i));
+  pw_graph_remove (self->graph, old_id);
+
+  guint32 id = dummy_generate_node (self, x, y, 0);
+  pw_graph_get_nodes (self->graph, &n_nodes);
+  dummy_link_node (self, id, PW_PAD_DIRECTION_OUT, 0, n_nodes);
+  dummy_link_node (self, id, PW_PAD_DIRECTION_IN, 0, n_nodes);
+}
+
+static gboolean
+dummy_churn_cb (gpointer data)
+{
+  PwDummy *self = PW_DUMMY (data);
+  gint64 now = g_get_monotonic_time ();
+
+  self->churn_debt += self->churn * (now - self->churn_last) / G_USEC_PER_SEC;
+  self->churn_last = now;
+
+  // all replacements of a tick are one batch
+  for (; self->churn_debt >= 1; self->churn_debt -= 1)
+    dummy_replace_node (self);
+  pw_view_controller_flush_changes (G_OBJECT (self));
+
+  return G_SOURCE_CONTINUE;
+}
+
+/**
+ * pw_dummy_run:
+ *
+ * Generates the graph the properties describe as a single batch and
+ * starts replacing nodes if there is churn.
+ */
+void
+pw_dummy_run (PwDummy *self)
 {
-  PwDummy* dum = PW_DUMMY(user_data);
-  static int id_gen = 28;
-
-  PwPad* pad = pw_dummy_get_pad_by_id(G_OBJECT(dum), id1);
-  guint in,out;
-  if(pw_pad_get_direction(pad)==PW_PAD_DIRECTION_IN){
-    in = id1;
-    out = id2;
-  }else{
-    in=id2;
-    out = id1;
-  }
-
-  PwLinkData dat = {.id=id_gen,.in = in, .out=out};
-  pw_dummy_add_link(G_OBJECT(dum) , dat);
+  g_return_if_fail (PW_IS_DUMMY (self));
+  gint64 start = g_get_monotonic_time ();
+  guint n_links;
+
+  g_clear_pointer (&self->rand, g_rand_free);
+  self->rand = g_rand_new_with_seed (self->seed);
+
+  dummy_generate (self);
+  pw_graph_get_links (self->graph, &n_links);
+  g_debug ("Generated %u nodes and %u links in %.1f ms", self->n_nodes, n_links,
+           (g_get_monotonic_time () - start) / 1000.0);
+  pw_view_controller_flush_changes (G_OBJECT (self));
+
+  if (self->churn > 0 && !self->churn_id)
+    {
+      self->churn_last = g_get_monotonic_time ();
+      self->churn_debt = 0;
+      self->churn_id = g_timeout_add (CHURN_INTERVAL, dummy_churn_cb, self);
+    }
 }
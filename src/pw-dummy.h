@@ -11,4 +11,8 @@ G_DECLARE_FINAL_TYPE (PwDummy, pw_dummy, PW, DUMMY, GObject)
 
 PwDummy *pw_dummy_new (void);
 
+gboolean pw_dummy_configure (PwDummy *self, const char *spec, GError **error);
+
+void pw_dummy_run (PwDummy *self);
+
 G_END_DECLS
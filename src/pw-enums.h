@@ -32,3 +32,19 @@ typedef enum {
   PW_PAD_TYPE_MIDI_PASSTHROUGH,
   PW_PAD_TYPE_OTHER
 }PwPadType;
+
+typedef enum {
+  PW_DUMMY_TOPOLOGY_RANDOM, // outputs link to inputs anywhere
+  PW_DUMMY_TOPOLOGY_LAYERED, // outputs link to inputs of the next layer
+  PW_DUMMY_TOPOLOGY_BUSSED, // every node goes to the first one and back
+}PwDummyTopology;
+
+typedef enum {
+  PW_DUMMY_PORTS_UNIFORM,
+  PW_DUMMY_PORTS_GEOMETRIC, // mostly the minimum, each extra port half as likely
+}PwDummyPortDistribution;
+
+typedef enum {
+  PW_LINK_RENDERING_SHARED, // one cairo node for all links
+  PW_LINK_RENDERING_PER_LINK, // a cairo node per visible link
+}PwLinkRendering;
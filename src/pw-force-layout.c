@@ -0,0 +1,540 @@
+#include "pw-force-layout.h"
+#include <math.h>
+#include <string.h>
+
+/*
+ * Incremental force directed layout. Links act as springs, every pair of
+ * nodes repels and the repulsion is approximated with a Barnes-Hut
+ * quadtree so a step costs O(n log n). The simulation starts from the
+ * current positions and runs on its own thread, the UI picks up the most
+ * recently published step whenever it draws a frame.
+ */
+
+#define THETA 0.9 // cells smaller than THETA * distance count as one body
+#define MIN_CELL 1e-2
+#define MIN_DIST 1.0
+#define NODE_GAP 80 // horizontal space a link wants between its nodes
+#define PADDING 20 // space kept around boxes
+#define COLLIDE 0.7
+#define COLLIDE_PASSES 2
+#define GRAVITY 0.1
+#define VELOCITY_DECAY 0.4
+#define ALPHA_DECAY 0.0228 // about 300 steps from 1 to ALPHA_MIN
+#define ALPHA_MIN 0.001
+#define ALPHA_REHEAT 0.3
+#define PUBLISH_INTERVAL 8000 // usec
+
+typedef struct
+{
+  gfloat cx, cy, half; // square covered by the cell
+  gfloat mass, mx, my; // body count and sum of their positions
+  gint child[4]; // -1 on leaves
+  gint body; // -1 unless a leaf holding one body
+} Cell;
+
+typedef struct
+{
+  guint index;
+  gfloat x, y;
+} PinRequest;
+
+struct _PwForceLayout
+{
+  GThread *thread;
+  GMutex lock;
+  GCond wake;
+
+  // under lock
+  gboolean quit;
+  gboolean settled;
+  guint serial;
+  GArray *front; // PwLayoutNode, the last published step
+  GArray *pins; // PinRequest
+
+  // owned by the simulation thread
+  guint n, n_edges;
+  gfloat *x, *y; // centres
+  gfloat *vx, *vy;
+  gfloat *half_w, *half_h;
+  gfloat max_half_w, max_half_h;
+  gboolean *pinned;
+  guint *degree;
+  guint *edge_src, *edge_dst;
+  gfloat charge, alpha;
+  GArray *cells;
+  GArray *stack;
+};
+
+static gint
+quad_new_cell (PwForceLayout *self, gfloat cx, gfloat cy, gfloat half)
+{
+  Cell cell = { cx, cy, half, 0, 0, 0, { -1, -1, -1, -1 }, -1 };
+  g_array_append_val (self->cells, cell);
+  return self->cells->len - 1;
+}
+
+static inline guint
+quad_quadrant (const Cell *cell, gfloat x, gfloat y)
+{
+  return (x >= cell->cx) | ((y >= cell->cy) << 1);
+}
+
+static void
+quad_split (PwForceLayout *self, gint c)
+{
+  Cell cell = g_array_index (self->cells, Cell, c);
+  gfloat h = cell.half / 2;
+  gint kids[4];
+
+  for (guint q = 0; q < 4; q++)
+    kids[q] = quad_new_cell (self, cell.cx + (q & 1 ? h : -h),
+                             cell.cy + (q & 2 ? h : -h), h);
+
+  // the array may have moved
+  memcpy (g_array_index (self->cells, Cell, c).child, kids, sizeof (kids));
+}
+
+static void
+quad_insert (PwForceLayout *self, guint b)
+{
+  gfloat x = self->x[b], y = self->y[b];
+  gint c = 0;
+
+  for (;;)
+    {
+      Cell *cell = &g_array_index (self->cells, Cell, c);
+
+      if (cell->child[0] < 0)
+        {
+          if (cell->mass == 0 || cell->half < MIN_CELL)
+            {
+              // empty leaf, or bodies on the same spot sharing one
+              cell->body = cell->mass == 0 ? (gint)b : -1;
+              cell->mass += 1;
+              cell->mx += x;
+              cell->my += y;
+              return;
+            }
+
+          gint old = cell->body;
+          quad_split (self, c);
+          cell = &g_array_index (self->cells, Cell, c);
+          cell->body = -1;
+
+          Cell *dst = &g_array_index (self->cells, Cell,
+                                      cell->child[quad_quadrant (cell, self->x[old], self->y[old])]);
+          dst->body = old;
+          dst->mass = 1;
+          dst->mx = self->x[old];
+          dst->my = self->y[old];
+        }
+
+      cell->mass += 1;
+      cell->mx += x;
+      cell->my += y;
+      c = cell->child[quad_quadrant (cell, x, y)];
+    }
+}
+
+static void
+quad_build (PwForceLayout *self)
+{
+  gfloat xmin = G_MAXFLOAT, ymin = G_MAXFLOAT;
+  gfloat xmax = -G_MAXFLOAT, ymax = -G_MAXFLOAT;
+
+  for (guint i = 0; i < self->n; i++)
+    {
+      xmin = MIN (xmin, self->x[i]);
+      xmax = MAX (xmax, self->x[i]);
+      ymin = MIN (ymin, self->y[i]);
+      ymax = MAX (ymax, self->y[i]);
+    }
+
+  g_array_set_size (self->cells, 0);
+  quad_new_cell (self, (xmin + xmax) / 2, (ymin + ymax) / 2,
+                 MAX (xmax - xmin, ymax - ymin) / 2 + 1);
+
+  for (guint i = 0; i < self->n; i++)
+    quad_insert (self, i);
+}
+
+static void
+force_charge (PwForceLayout *self, guint i)
+{
+  gfloat strength = self->charge * self->alpha;
+
+  g_array_set_size (self->stack, 0);
+  g_array_append_val (self->stack, (gint){ 0 });
+
+  while (self->stack->len > 0)
+    {
+      gint c = g_array_index (self->stack, gint, self->stack->len - 1);
+      const Cell *cell = &g_array_index (self->cells, Cell, c);
+      gfloat mass = cell->mass;
+      gfloat dx, dy, d2;
+
+      g_array_set_size (self->stack, self->stack->len - 1);
+      if (mass == 0 || cell->body == (gint)i)
+        continue;
+
+      dx = cell->mx / mass - self->x[i];
+      dy = cell->my / mass - self->y[i];
+      d2 = dx * dx + dy * dy;
+
+      if (cell->child[0] >= 0 && 4 * cell->half * cell->half >= THETA * THETA * d2)
+        {
+          for (guint q = 0; q < 4; q++)
+            g_array_append_val (self->stack, cell->child[q]);
+          continue;
+        }
+
+      if (d2 < MIN_DIST)
+        {
+          // stacked bodies, i may be one of them
+          if (cell->body < 0)
+            mass -= 1;
+          dx = (i & 1) ? 1 : -1;
+          dy = (i & 2) ? 1 : -1;
+          d2 = 2;
+        }
+
+      self->vx[i] += dx * strength * mass / d2;
+      self->vy[i] += dy * strength * mass / d2;
+    }
+}
+
+// pushes apart boxes closer than PADDING, looking them up in the quadtree
+static void
+force_collide (PwForceLayout *self, guint i)
+{
+  gfloat reach_x = self->half_w[i] + self->max_half_w + PADDING;
+  gfloat reach_y = self->half_h[i] + self->max_half_h + PADDING;
+
+  g_array_set_size (self->stack, 0);
+  g_array_append_val (self->stack, (gint){ 0 });
+
+  while (self->stack->len > 0)
+    {
+      gint c = g_array_index (self->stack, gint, self->stack->len - 1);
+      const Cell *cell = &g_array_index (self->cells, Cell, c);
+
+      g_array_set_size (self->stack, self->stack->len - 1);
+      if (cell->mass == 0
+          || fabsf (cell->cx - self->x[i]) > cell->half + reach_x
+          || fabsf (cell->cy - self->y[i]) > cell->half + reach_y)
+        continue;
+
+      if (cell->child[0] >= 0)
+        {
+          for (guint q = 0; q < 4; q++)
+            g_array_append_val (self->stack, cell->child[q]);
+          continue;
+        }
+
+      // every pair once
+      gint j = cell->body;
+      if (j <= (gint)i)
+        continue;
+
+      gfloat dx = self->x[j] + self->vx[j] - self->x[i] - self->vx[i];
+      gfloat dy = self->y[j] + self->vy[j] - self->y[i] - self->vy[i];
+      gfloat ox = self->half_w[i] + self->half_w[j] + PADDING - fabsf (dx);
+      gfloat oy = self->half_h[i] + self->half_h[j] + PADDING - fabsf (dy);
+
+      if (ox <= 0 || oy <= 0)
+        continue;
+
+      // boxes are wide, so push along the axis that separates sooner
+      gfloat wi = self->pinned[i] ? 0 : self->pinned[j] ? 1 : 0.5;
+      gfloat wj = self->pinned[j] ? 0 : 1 - wi;
+      if (ox < oy)
+        {
+          gfloat push = (dx < 0 ? -1 : 1) * ox * COLLIDE;
+          self->vx[i] -= push * wi;
+          self->vx[j] += push * wj;
+        }
+      else
+        {
+          gfloat push = (dy < 0 ? -1 : 1) * oy * COLLIDE;
+          self->vy[i] -= push * wi;
+          self->vy[j] += push * wj;
+        }
+    }
+}
+
+// springs along the links, wanting the sink to the right of the source
+static void
+force_links (PwForceLayout *self)
+{
+  for (guint e = 0; e < self->n_edges; e++)
+    {
+      guint s = self->edge_src[e], t = self->edge_dst[e];
+      gfloat want = self->half_w[s] + self->half_w[t] + NODE_GAP;
+      gfloat dx = self->x[t] + self->vx[t] - self->x[s] - self->vx[s] - want;
+      gfloat dy = self->y[t] + self->vy[t] - self->y[s] - self->vy[s];
+      gfloat strength = self->alpha / MIN (self->degree[s], self->degree[t]);
+      gfloat bias = (gfloat)self->degree[s] / (self->degree[s] + self->degree[t]);
+
+      dx *= strength;
+      dy *= strength;
+      self->vx[t] -= dx * bias;
+      self->vy[t] -= dy * bias;
+      self->vx[s] += dx * (1 - bias);
+      self->vy[s] += dy * (1 - bias);
+    }
+}
+
+static void
+force_step (PwForceLayout *self)
+{
+  gfloat cx = 0, cy = 0;
+
+  quad_build (self);
+
+  for (guint i = 0; i < self->n; i++)
+    {
+      cx += self->x[i];
+      cy += self->y[i];
+    }
+  cx /= self->n;
+  cy /= self->n;
+
+  for (guint i = 0; i < self->n; i++)
+    {
+      force_charge (self, i);
+      self->vx[i] += (cx - self->x[i]) * GRAVITY * self->alpha;
+      self->vy[i] += (cy - self->y[i]) * GRAVITY * self->alpha;
+    }
+
+  force_links (self);
+
+  for (guint pass = 0; pass < COLLIDE_PASSES; pass++)
+    for (guint i = 0; i < self->n; i++)
+      force_collide (self, i);
+
+  for (guint i = 0; i < self->n; i++)
+    {
+      if (self->pinned[i])
+        {
+          self->vx[i] = self->vy[i] = 0;
+          continue;
+        }
+
+      self->vx[i] *= 1 - VELOCITY_DECAY;
+      self->vy[i] *= 1 - VELOCITY_DECAY;
+      self->x[i] += self->vx[i];
+      self->y[i] += self->vy[i];
+    }
+
+  self->alpha -= self->alpha * ALPHA_DECAY;
+}
+
+static void
+force_publish (PwForceLayout *self)
+{
+  for (guint i = 0; i < self->n; i++)
+    {
+      PwLayoutNode *ln = &g_array_index (self->front, PwLayoutNode, i);
+      ln->x = self->x[i] - self->half_w[i];
+      ln->y = self->y[i] - self->half_h[i];
+    }
+  self->serial++;
+}
+
+static gpointer
+force_thread (gpointer data)
+{
+  PwForceLayout *self = data;
+  gint64 published = 0;
+
+  for (;;)
+    {
+      g_mutex_lock (&self->lock);
+      while (!self->quit && self->settled && self->pins->len == 0)
+        g_cond_wait (&self->wake, &self->lock);
+
+      if (self->quit)
+        {
+          g_mutex_unlock (&self->lock);
+          break;
+        }
+
+      for (guint p = 0; p < self->pins->len; p++)
+        {
+          PinRequest *pin = &g_array_index (self->pins, PinRequest, p);
+          self->x[pin->index] = pin->x + self->half_w[pin->index];
+          self->y[pin->index] = pin->y + self->half_h[pin->index];
+          self->pinned[pin->index] = TRUE;
+          self->alpha = MAX (self->alpha, ALPHA_REHEAT);
+          self->settled = FALSE;
+        }
+      g_array_set_size (self->pins, 0);
+      g_mutex_unlock (&self->lock);
+
+      force_step (self);
+      gboolean settled = self->alpha < ALPHA_MIN;
+      gint64 now = g_get_monotonic_time ();
+
+      if (settled || now - published >= PUBLISH_INTERVAL)
+        {
+          g_mutex_lock (&self->lock);
+          force_publish (self);
+          self->settled = settled;
+          g_mutex_unlock (&self->lock);
+          published = now;
+        }
+    }
+
+  return NULL;
+}
+
+/**
+ * pw_force_layout_new:
+ * @nodes: (element-type PwLayoutNode): starting positions and sizes
+ * @edges: (element-type PwLayoutEdge): links between @nodes
+ *
+ * Starts relaxing the graph on a new thread. Nodes marked as pinned keep
+ * their position.
+ */
+PwForceLayout *
+pw_force_layout_new (GArray *nodes, GArray *edges)
+{
+  PwForceLayout *self = g_new0 (PwForceLayout, 1);
+  gfloat size = 0;
+
+  g_mutex_init (&self->lock);
+  g_cond_init (&self->wake);
+
+  self->n = nodes->len;
+  self->front = g_array_copy (nodes);
+  self->pins = g_array_new (FALSE, FALSE, sizeof (PinRequest));
+  self->cells = g_array_sized_new (FALSE, FALSE, sizeof (Cell), 2 * self->n + 1);
+  self->stack = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  self->x = g_new (gfloat, self->n);
+  self->y = g_new (gfloat, self->n);
+  self->vx = g_new0 (gfloat, self->n);
+  self->vy = g_new0 (gfloat, self->n);
+  self->half_w = g_new (gfloat, self->n);
+  self->half_h = g_new (gfloat, self->n);
+  self->pinned = g_new (gboolean, self->n);
+  self->degree = g_new0 (guint, self->n);
+
+  for (guint i = 0; i < self->n; i++)
+    {
+      const PwLayoutNode *ln = &g_array_index (nodes, PwLayoutNode, i);
+      self->half_w[i] = ln->width / 2;
+      self->half_h[i] = ln->height / 2;
+      self->max_half_w = MAX (self->max_half_w, self->half_w[i]);
+      self->max_half_h = MAX (self->max_half_h, self->half_h[i]);
+      self->x[i] = ln->x + self->half_w[i];
+      self->y[i] = ln->y + self->half_h[i];
+      self->pinned[i] = ln->pinned;
+      size += self->half_w[i] + self->half_h[i];
+    }
+
+  self->edge_src = g_new (guint, MAX (edges->len, 1));
+  self->edge_dst = g_new (guint, MAX (edges->len, 1));
+  for (guint e = 0; e < edges->len; e++)
+    {
+      const PwLayoutEdge *le = &g_array_index (edges, PwLayoutEdge, e);
+      if (le->src == le->dst || le->src >= self->n || le->dst >= self->n)
+        continue;
+      self->edge_src[self->n_edges] = le->src;
+      self->edge_dst[self->n_edges] = le->dst;
+      self->degree[le->src]++;
+      self->degree[le->dst]++;
+      self->n_edges++;
+    }
+
+  // the usual -30 for 30 unit links, scaled to the size of the nodes
+  size = (self->n ? size / self->n : 0) + NODE_GAP;
+  self->charge = -size * size / 30;
+  self->alpha = 1;
+  self->settled = self->n == 0;
+
+  self->thread = g_thread_new ("pw-force-layout", force_thread, self);
+  return self;
+}
+
+void
+pw_force_layout_free (PwForceLayout *self)
+{
+  g_mutex_lock (&self->lock);
+  self->quit = TRUE;
+  g_cond_signal (&self->wake);
+  g_mutex_unlock (&self->lock);
+  g_thread_join (self->thread);
+
+  g_mutex_clear (&self->lock);
+  g_cond_clear (&self->wake);
+  g_array_unref (self->front);
+  g_array_unref (self->pins);
+  g_array_unref (self->cells);
+  g_array_unref (self->stack);
+  g_free (self->x);
+  g_free (self->y);
+  g_free (self->vx);
+  g_free (self->vy);
+  g_free (self->half_w);
+  g_free (self->half_h);
+  g_free (self->pinned);
+  g_free (self->degree);
+  g_free (self->edge_src);
+  g_free (self->edge_dst);
+  g_free (self);
+}
+
+/*
+ * Fixes node @index with its top left corner at @x, @y and wakes the
+ * simulation up so the rest of the graph follows.
+ */
+void
+pw_force_layout_pin (PwForceLayout *self, guint index, gfloat x, gfloat y)
+{
+  PinRequest pin = { index, x, y };
+
+  g_return_if_fail (index < self->n);
+
+  g_mutex_lock (&self->lock);
+  g_array_append_val (self->pins, pin);
+  g_cond_signal (&self->wake);
+  g_mutex_unlock (&self->lock);
+}
+
+/**
+ * pw_force_layout_fetch:
+ * @serial: the value returned by the previous call, or 0
+ * @nodes: (element-type PwLayoutNode): receives the positions
+ *
+ * Copies the latest published positions into @nodes, unless they are
+ * still the ones of @serial.
+ *
+ * Returns: the serial of the positions in @nodes
+ */
+guint
+pw_force_layout_fetch (PwForceLayout *self, guint serial, GArray *nodes)
+{
+  g_mutex_lock (&self->lock);
+  if (self->serial != serial)
+    {
+      g_array_set_size (nodes, self->n);
+      memcpy (nodes->data, self->front->data, self->n * sizeof (PwLayoutNode));
+      serial = self->serial;
+    }
+  g_mutex_unlock (&self->lock);
+
+  return serial;
+}
+
+gboolean
+pw_force_layout_is_settled (PwForceLayout *self)
+{
+  gboolean settled;
+
+  g_mutex_lock (&self->lock);
+  settled = self->settled;
+  g_mutex_unlock (&self->lock);
+
+  return settled;
+}
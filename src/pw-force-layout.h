@@ -0,0 +1,21 @@
+#pragma once
+
+#include "pw-layout.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PwForceLayout PwForceLayout;
+
+PwForceLayout *pw_force_layout_new (GArray *nodes, GArray *edges);
+
+void pw_force_layout_free (PwForceLayout *self);
+
+void pw_force_layout_pin (PwForceLayout *self, guint index, gfloat x, gfloat y);
+
+guint pw_force_layout_fetch (PwForceLayout *self, guint serial, GArray *nodes);
+
+gboolean pw_force_layout_is_settled (PwForceLayout *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwForceLayout, pw_force_layout_free)
+
+G_END_DECLS
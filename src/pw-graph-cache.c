@@ -0,0 +1,289 @@
+#include "pw-graph-cache.h"
+#include <gio/gio.h>
+#include <errno.h>
+#include <string.h>
+
+/*
+ * The file is a header followed by three runs of packed records, all
+ * little endian, strings as a u16 length and the bytes:
+ *
+ *   "PWGC" | u32 version | u32 nodes | u32 ports | u32 links
+ *   nodes * ( u32 id | i32 x | i32 y | u8 type | key | title )
+ *   ports * ( u32 id | u32 parent id | u8 direction | name )
+ *   links * ( u32 id | u32 out | u32 in )
+ */
+
+#define MAGIC "PWGC"
+#define VERSION 1
+
+typedef struct
+{
+  const guint8 *data;
+  gsize len, off;
+} Reader;
+
+static gboolean
+read_u32 (Reader *r, guint32 *val)
+{
+  if (r->len - r->off < sizeof (guint32))
+    return FALSE;
+
+  memcpy (val, r->data + r->off, sizeof (guint32));
+  *val = GUINT32_FROM_LE (*val);
+  r->off += sizeof (guint32);
+  return TRUE;
+}
+
+static gboolean
+read_i32 (Reader *r, gint *val)
+{
+  guint32 u;
+
+  if (!read_u32 (r, &u))
+    return FALSE;
+
+  *val = (gint32) u;
+  return TRUE;
+}
+
+static gboolean
+read_u8 (Reader *r, gint *val)
+{
+  if (r->len - r->off < 1)
+    return FALSE;
+
+  *val = r->data[r->off++];
+  return TRUE;
+}
+
+static gboolean
+read_str (Reader *r, char **str)
+{
+  guint16 len;
+
+  if (r->len - r->off < sizeof (len))
+    return FALSE;
+
+  memcpy (&len, r->data + r->off, sizeof (len));
+  len = GUINT16_FROM_LE (len);
+  r->off += sizeof (len);
+  if (r->len - r->off < len)
+    return FALSE;
+
+  *str = g_strndup ((const char *) r->data + r->off, len);
+  r->off += len;
+  return TRUE;
+}
+
+static void
+write_u32 (GByteArray *buf, guint32 val)
+{
+  val = GUINT32_TO_LE (val);
+  g_byte_array_append (buf, (const guint8 *) &val, sizeof (val));
+}
+
+static void
+write_u8 (GByteArray *buf, gint val)
+{
+  guint8 b = val;
+  g_byte_array_append (buf, &b, 1);
+}
+
+static void
+write_str (GByteArray *buf, const char *str)
+{
+  gsize len = str ? MIN (strlen (str), G_MAXUINT16) : 0;
+  guint16 len16 = GUINT16_TO_LE (len);
+
+  g_byte_array_append (buf, (const guint8 *) &len16, sizeof (len16));
+  g_byte_array_append (buf, (const guint8 *) str, len);
+}
+
+static void
+clear_node (gpointer data)
+{
+  PwGraphCacheNode *nod = data;
+
+  g_free (nod->key);
+  g_free (nod->title);
+}
+
+static void
+clear_port (gpointer data)
+{
+  g_free (((PwGraphCachePort *) data)->name);
+}
+
+static gboolean
+cache_parse (PwGraphCache *self, const guint8 *data, gsize len)
+{
+  Reader r = { data, len, 4 };
+  guint32 version, n_nodes, n_ports, n_links;
+
+  if (len < 4 || memcmp (data, MAGIC, 4) != 0)
+    return FALSE;
+
+  if (!read_u32 (&r, &version) || version != VERSION
+      || !read_u32 (&r, &n_nodes) || !read_u32 (&r, &n_ports)
+      || !read_u32 (&r, &n_links))
+    return FALSE;
+
+  for (guint32 i = 0; i < n_nodes; i++)
+    {
+      PwGraphCacheNode nod = { 0 };
+      gboolean ok = read_u32 (&r, &nod.id) && read_i32 (&r, &nod.x)
+                    && read_i32 (&r, &nod.y) && read_u8 (&r, &nod.type)
+                    && read_str (&r, &nod.key) && read_str (&r, &nod.title);
+
+      // appended either way so the clear func takes care of partial reads
+      g_array_append_val (self->nodes, nod);
+      if (!ok)
+        return FALSE;
+    }
+
+  for (guint32 i = 0; i < n_ports; i++)
+    {
+      PwGraphCachePort port = { 0 };
+      gboolean ok = read_u32 (&r, &port.id) && read_u32 (&r, &port.parent_id)
+                    && read_u8 (&r, &port.direction) && read_str (&r, &port.name);
+
+      g_array_append_val (self->ports, port);
+      if (!ok)
+        return FALSE;
+    }
+
+  for (guint32 i = 0; i < n_links; i++)
+    {
+      PwGraphCacheLink link;
+
+      if (!read_u32 (&r, &link.id) || !read_u32 (&r, &link.out)
+          || !read_u32 (&r, &link.in))
+        return FALSE;
+      g_array_append_val (self->links, link);
+    }
+
+  return TRUE;
+}
+
+static GBytes *
+cache_serialize (PwGraphCache *self)
+{
+  GByteArray *buf = g_byte_array_new ();
+
+  g_byte_array_append (buf, (const guint8 *) MAGIC, 4);
+  write_u32 (buf, VERSION);
+  write_u32 (buf, self->nodes->len);
+  write_u32 (buf, self->ports->len);
+  write_u32 (buf, self->links->len);
+
+  for (guint i = 0; i < self->nodes->len; i++)
+    {
+      PwGraphCacheNode *nod = &g_array_index (self->nodes, PwGraphCacheNode, i);
+      write_u32 (buf, nod->id);
+      write_u32 (buf, (guint32) nod->x);
+      write_u32 (buf, (guint32) nod->y);
+      write_u8 (buf, nod->type);
+      write_str (buf, nod->key);
+      write_str (buf, nod->title);
+    }
+
+  for (guint i = 0; i < self->ports->len; i++)
+    {
+      PwGraphCachePort *port = &g_array_index (self->ports, PwGraphCachePort, i);
+      write_u32 (buf, port->id);
+      write_u32 (buf, port->parent_id);
+      write_u8 (buf, port->direction);
+      write_str (buf, port->name);
+    }
+
+  for (guint i = 0; i < self->links->len; i++)
+    {
+      PwGraphCacheLink *link = &g_array_index (self->links, PwGraphCacheLink, i);
+      write_u32 (buf, link->id);
+      write_u32 (buf, link->out);
+      write_u32 (buf, link->in);
+    }
+
+  return g_byte_array_free_to_bytes (buf);
+}
+
+PwGraphCache *
+pw_graph_cache_new (void)
+{
+  PwGraphCache *self = g_new (PwGraphCache, 1);
+
+  self->nodes = g_array_new (FALSE, FALSE, sizeof (PwGraphCacheNode));
+  g_array_set_clear_func (self->nodes, clear_node);
+  self->ports = g_array_new (FALSE, FALSE, sizeof (PwGraphCachePort));
+  g_array_set_clear_func (self->ports, clear_port);
+  self->links = g_array_new (FALSE, FALSE, sizeof (PwGraphCacheLink));
+
+  return self;
+}
+
+void
+pw_graph_cache_free (PwGraphCache *self)
+{
+  g_array_unref (self->nodes);
+  g_array_unref (self->ports);
+  g_array_unref (self->links);
+  g_free (self);
+}
+
+/**
+ * pw_graph_cache_load:
+ * @path: file written by pw_graph_cache_save()
+ *
+ * Returns: the snapshot, or %NULL if there is no usable one
+ */
+PwGraphCache *
+pw_graph_cache_load (const char *path)
+{
+  g_autoptr (PwGraphCache) self = NULL;
+  g_autoptr (GMappedFile) file = NULL;
+  g_autoptr (GError) error = NULL;
+
+  file = g_mapped_file_new (path, FALSE, &error);
+  if (!file)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_warning ("Can't read the graph cache: %s", error->message);
+      return NULL;
+    }
+
+  self = pw_graph_cache_new ();
+  if (!cache_parse (self, (const guint8 *) g_mapped_file_get_contents (file),
+                    g_mapped_file_get_length (file)))
+    {
+      g_warning ("Ignoring the malformed graph cache in %s", path);
+      return NULL;
+    }
+
+  return g_steal_pointer (&self);
+}
+
+// blocking, meant for when the application goes away
+gboolean
+pw_graph_cache_save (PwGraphCache *self, const char *path, GError **error)
+{
+  g_autoptr (GBytes) bytes = cache_serialize (self);
+  g_autofree char *dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, 0700) < 0)
+    {
+      int saved_errno = errno;
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Can't create %s: %s", dir, g_strerror (saved_errno));
+      return FALSE;
+    }
+
+  return g_file_set_contents_full (path, g_bytes_get_data (bytes, NULL),
+                                   g_bytes_get_size (bytes),
+                                   G_FILE_SET_CONTENTS_CONSISTENT, 0600, error);
+}
+
+char *
+pw_graph_cache_get_default_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "patchwork", "graph", NULL);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A snapshot of the graph as it was last seen, so the next start can show
+ * it before the registry has been enumerated. Ids are the ones of the run
+ * that wrote it and only relate the records to each other.
+ */
+typedef struct
+{
+  guint32 id;
+  char *key; // see PwNodeData.key
+  char *title;
+  gint type;
+  gint x, y;
+} PwGraphCacheNode;
+
+typedef struct
+{
+  guint32 id;
+  guint32 parent_id;
+  char *name;
+  gint direction;
+} PwGraphCachePort;
+
+typedef struct
+{
+  guint32 id;
+  guint32 out, in;
+} PwGraphCacheLink;
+
+typedef struct
+{
+  GArray *nodes; // PwGraphCacheNode, back to front
+  GArray *ports; // PwGraphCachePort
+  GArray *links; // PwGraphCacheLink
+} PwGraphCache;
+
+PwGraphCache *pw_graph_cache_new (void);
+
+void pw_graph_cache_free (PwGraphCache *self);
+
+PwGraphCache *pw_graph_cache_load (const char *path);
+
+gboolean pw_graph_cache_save (PwGraphCache *self, const char *path, GError **error);
+
+char *pw_graph_cache_get_default_path (void);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwGraphCache, pw_graph_cache_free)
+
+G_END_DECLS
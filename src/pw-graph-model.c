@@ -0,0 +1,549 @@
+#include "pw-graph-model.h"
+#include "pw-view-controller.h"
+#include "pw-enums.h"
+#include "pw-types.h"
+
+struct _PwGraphItem
+{
+  GObject parent_instance;
+
+  PwObjectType kind;
+  guint32 id;
+  char *name;
+  guint32 parent_id; // ports
+  PwPadDirection direction; // ports
+  PwPadType type; // of the node, for ports the parent's
+  guint32 out, in; // links
+};
+
+G_DEFINE_TYPE (PwGraphItem, pw_graph_item, G_TYPE_OBJECT)
+
+enum
+{
+  ITEM_PROP_0,
+  ITEM_PROP_KIND,
+  ITEM_PROP_ID,
+  ITEM_PROP_NAME,
+  ITEM_PROP_PARENT_ID,
+  ITEM_PROP_DIRECTION,
+  ITEM_PROP_TYPE,
+  ITEM_PROP_OUT,
+  ITEM_PROP_IN,
+  ITEM_N_PROPS
+};
+
+static GParamSpec *item_properties[ITEM_N_PROPS];
+
+struct _PwGraphModel
+{
+  GObject parent_instance;
+
+  GObject *controller;
+  gulong handler;
+  PwObjectType kind;
+  GArray *ids; // guint32, in the order they showed up
+  GHashTable *index; // id -> position + 1
+  GHashTable *items; // id -> PwGraphItem, the ones asked for so far
+};
+
+static void pw_graph_model_list_model_init (GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (PwGraphModel, pw_graph_model, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL,
+                                                pw_graph_model_list_model_init))
+
+///////////////////////////////////////////////////////////
+static void graph_model_change_notify_cb (GObject *controller,
+                                          PwChangeSet *changes,
+                                          gpointer user_data);
+///////////////////////////////////////////////////////////
+
+static void
+pw_graph_item_finalize (GObject *object)
+{
+  PwGraphItem *self = PW_GRAPH_ITEM (object);
+
+  g_free (self->name);
+
+  G_OBJECT_CLASS (pw_graph_item_parent_class)->finalize (object);
+}
+
+static void
+pw_graph_item_get_property (GObject *object, guint prop_id, GValue *value,
+                            GParamSpec *pspec)
+{
+  PwGraphItem *self = PW_GRAPH_ITEM (object);
+
+  switch (prop_id)
+    {
+    case ITEM_PROP_KIND:
+      g_value_set_uint (value, self->kind);
+      break;
+    case ITEM_PROP_ID:
+      g_value_set_uint (value, self->id);
+      break;
+    case ITEM_PROP_NAME:
+      g_value_set_string (value, self->name);
+      break;
+    case ITEM_PROP_PARENT_ID:
+      g_value_set_uint (value, self->parent_id);
+      break;
+    case ITEM_PROP_DIRECTION:
+      g_value_set_enum (value, self->direction);
+      break;
+    case ITEM_PROP_TYPE:
+      g_value_set_enum (value, self->type);
+      break;
+    case ITEM_PROP_OUT:
+      g_value_set_uint (value, self->out);
+      break;
+    case ITEM_PROP_IN:
+      g_value_set_uint (value, self->in);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+pw_graph_item_class_init (PwGraphItemClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = pw_graph_item_finalize;
+  object_class->get_property = pw_graph_item_get_property;
+
+  item_properties[ITEM_PROP_KIND] = g_param_spec_uint (
+      "kind", "Kind", "PwObjectType of the item", 0, PW_OBJECT_N_TYPES - 1, 0,
+      G_PARAM_READABLE);
+  item_properties[ITEM_PROP_ID] = g_param_spec_uint (
+      "id", "Id", "Id of the object", 0, G_MAXUINT, 0, G_PARAM_READABLE);
+  item_properties[ITEM_PROP_NAME] = g_param_spec_string (
+      "name", "Name", "Title of a node, name of a port or both ends of a link",
+      NULL, G_PARAM_READABLE);
+  item_properties[ITEM_PROP_PARENT_ID] = g_param_spec_uint (
+      "parent-id", "Parent id", "Id of the node of a port", 0, G_MAXUINT, 0,
+      G_PARAM_READABLE);
+  item_properties[ITEM_PROP_DIRECTION] = g_param_spec_enum (
+      "direction", "Direction", "Direction of a port", PW_TYPE_PAD_DIRECTION,
+      PW_PAD_DIRECTION_INVALID, G_PARAM_READABLE);
+  item_properties[ITEM_PROP_TYPE] = g_param_spec_enum (
+      "type", "Type", "Media type of a node or port", PW_TYPE_PAD_TYPE,
+      PW_PAD_TYPE_OTHER, G_PARAM_READABLE);
+  item_properties[ITEM_PROP_OUT] = g_param_spec_uint (
+      "out", "Out", "Output port of a link", 0, G_MAXUINT, 0, G_PARAM_READABLE);
+  item_properties[ITEM_PROP_IN] = g_param_spec_uint (
+      "in", "In", "Input port of a link", 0, G_MAXUINT, 0, G_PARAM_READABLE);
+  g_object_class_install_properties (object_class, ITEM_N_PROPS, item_properties);
+}
+
+static void
+pw_graph_item_init (PwGraphItem *self)
+{
+  self->type = PW_PAD_TYPE_OTHER;
+}
+
+guint32
+pw_graph_item_get_id (PwGraphItem *self)
+{
+  g_return_val_if_fail (PW_IS_GRAPH_ITEM (self), 0);
+  return self->id;
+}
+
+const char *
+pw_graph_item_get_name (PwGraphItem *self)
+{
+  g_return_val_if_fail (PW_IS_GRAPH_ITEM (self), NULL);
+  return self->name;
+}
+
+static char *
+describe_port (PwGraph *graph, guint32 id)
+{
+  PwGraphPort *port = pw_graph_lookup_port (graph, id);
+  PwGraphNode *node = port ? pw_graph_lookup_node (graph, port->parent_id) : NULL;
+
+  if (!port)
+    return g_strdup_printf ("%u", id);
+  return g_strdup_printf ("%s:%s", node ? node->title : "", port->name);
+}
+
+static PwGraphItem *
+graph_model_make_item (PwGraphModel *self, guint32 id)
+{
+  PwGraph *graph = pw_view_controller_get_graph (self->controller);
+  PwGraphItem *item = g_object_new (PW_TYPE_GRAPH_ITEM, NULL);
+  PwGraphNode *node;
+  PwGraphPort *port;
+  PwGraphLink *link;
+
+  item->kind = self->kind;
+  item->id = id;
+
+  switch (self->kind)
+    {
+    case PW_OBJECT_NODE:
+      if ((node = pw_graph_lookup_node (graph, id)))
+        {
+          item->name = g_strdup (node->title);
+          item->type = node->type;
+        }
+      break;
+    case PW_OBJECT_PORT:
+      if ((port = pw_graph_lookup_port (graph, id)))
+        {
+          item->name = g_strdup (port->name);
+          item->parent_id = port->parent_id;
+          item->direction = port->direction;
+          if ((node = pw_graph_lookup_node (graph, port->parent_id)))
+            item->type = node->type;
+        }
+      break;
+    case PW_OBJECT_LINK:
+      if ((link = pw_graph_lookup_link (graph, id)))
+        {
+          g_autofree char *out = describe_port (graph, link->out);
+          g_autofree char *in = describe_port (graph, link->in);
+
+          item->name = g_strdup_printf ("%s → %s", out, in);
+          item->out = link->out;
+          item->in = link->in;
+        }
+      break;
+    default:
+      break;
+    }
+
+  return item;
+}
+
+static GType
+pw_graph_model_get_item_type (GListModel *list)
+{
+  return PW_TYPE_GRAPH_ITEM;
+}
+
+static guint
+pw_graph_model_get_n_items (GListModel *list)
+{
+  return PW_GRAPH_MODEL (list)->ids->len;
+}
+
+static gpointer
+pw_graph_model_get_item (GListModel *list, guint position)
+{
+  PwGraphModel *self = PW_GRAPH_MODEL (list);
+  PwGraphItem *item;
+  guint32 id;
+
+  if (position >= self->ids->len)
+    return NULL;
+
+  id = g_array_index (self->ids, guint32, position);
+  item = g_hash_table_lookup (self->items, GUINT_TO_POINTER (id));
+  if (!item)
+    {
+      item = graph_model_make_item (self, id);
+      g_hash_table_insert (self->items, GUINT_TO_POINTER (id), item);
+    }
+  return g_object_ref (item);
+}
+
+static void
+pw_graph_model_list_model_init (GListModelInterface *iface)
+{
+  iface->get_item_type = pw_graph_model_get_item_type;
+  iface->get_n_items = pw_graph_model_get_n_items;
+  iface->get_item = pw_graph_model_get_item;
+}
+
+static void
+pw_graph_model_dispose (GObject *object)
+{
+  PwGraphModel *self = PW_GRAPH_MODEL (object);
+
+  if (self->controller)
+    g_clear_signal_handler (&self->handler, self->controller);
+  g_clear_object (&self->controller);
+
+  G_OBJECT_CLASS (pw_graph_model_parent_class)->dispose (object);
+}
+
+static void
+pw_graph_model_finalize (GObject *object)
+{
+  PwGraphModel *self = PW_GRAPH_MODEL (object);
+
+  g_array_unref (self->ids);
+  g_hash_table_unref (self->index);
+  g_hash_table_unref (self->items);
+
+  G_OBJECT_CLASS (pw_graph_model_parent_class)->finalize (object);
+}
+
+static void
+pw_graph_model_class_init (PwGraphModelClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = pw_graph_model_dispose;
+  object_class->finalize = pw_graph_model_finalize;
+}
+
+static void
+pw_graph_model_init (PwGraphModel *self)
+{
+  self->ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+  self->index = g_hash_table_new (NULL, NULL);
+  self->items = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+}
+
+static inline guint
+graph_model_lookup (PwGraphModel *self, guint32 id)
+{
+  return GPOINTER_TO_UINT (g_hash_table_lookup (self->index, GUINT_TO_POINTER (id)));
+}
+
+static void
+graph_model_append (PwGraphModel *self, guint32 id)
+{
+  g_array_append_val (self->ids, id);
+  g_hash_table_insert (self->index, GUINT_TO_POINTER (id),
+                       GUINT_TO_POINTER (self->ids->len));
+}
+
+PwGraphModel *
+pw_graph_model_new (GObject *controller, PwObjectType kind)
+{
+  g_return_val_if_fail (PW_IS_VIEW_CONTROLLER (controller), NULL);
+  g_return_val_if_fail (kind < PW_OBJECT_N_TYPES, NULL);
+  PwGraphModel *self = g_object_new (PW_TYPE_GRAPH_MODEL, NULL);
+  PwGraph *graph = pw_view_controller_get_graph (controller);
+  guint n;
+
+  self->controller = g_object_ref (controller);
+  self->kind = kind;
+
+  switch (kind)
+    {
+    case PW_OBJECT_NODE:
+      {
+        PwGraphNode *nodes = pw_graph_get_nodes (graph, &n);
+        for (guint i = 0; i < n; i++)
+          graph_model_append (self, nodes[i].id);
+        break;
+      }
+    case PW_OBJECT_PORT:
+      {
+        PwGraphPort *ports = pw_graph_get_ports (graph, &n);
+        for (guint i = 0; i < n; i++)
+          graph_model_append (self, ports[i].id);
+        break;
+      }
+    case PW_OBJECT_LINK:
+      {
+        PwGraphLink *links = pw_graph_get_links (graph, &n);
+        for (guint i = 0; i < n; i++)
+          graph_model_append (self, links[i].id);
+        break;
+      }
+    default:
+      break;
+    }
+
+  self->handler = g_signal_connect (controller, "change-notify",
+                                    G_CALLBACK (graph_model_change_notify_cb), self);
+
+  return self;
+}
+
+PwObjectType
+pw_graph_model_get_kind (PwGraphModel *self)
+{
+  g_return_val_if_fail (PW_IS_GRAPH_MODEL (self), PW_OBJECT_N_TYPES);
+  return self->kind;
+}
+
+static gint
+compare_positions (gconstpointer a, gconstpointer b)
+{
+  guint pa = *(const guint *) a, pb = *(const guint *) b;
+  return pa < pb ? -1 : pa > pb;
+}
+
+// removes the positions in @gone, sorted, one contiguous run at a time
+static void
+graph_model_remove (PwGraphModel *self, GArray *gone)
+{
+  guint i = gone->len;
+
+  while (i > 0)
+    {
+      guint last = g_array_index (gone, guint, --i), first = last;
+
+      while (i > 0 && g_array_index (gone, guint, i - 1) == first - 1)
+        first = g_array_index (gone, guint, --i);
+
+      for (guint p = first; p <= last; p++)
+        {
+          gpointer id = GUINT_TO_POINTER (g_array_index (self->ids, guint32, p));
+          g_hash_table_remove (self->index, id);
+          g_hash_table_remove (self->items, id);
+        }
+      g_array_remove_range (self->ids, first, last - first + 1);
+
+      // what comes after moved down, the index is fixed up below
+      g_list_model_items_changed (G_LIST_MODEL (self), first, last - first + 1, 0);
+    }
+
+  for (guint p = g_array_index (gone, guint, 0); p < self->ids->len; p++)
+    g_hash_table_insert (self->index,
+                         GUINT_TO_POINTER (g_array_index (self->ids, guint32, p)),
+                         GUINT_TO_POINTER (p + 1));
+}
+
+static void
+graph_model_note_position (PwGraphModel *self, GArray *positions, guint32 id)
+{
+  guint pos = graph_model_lookup (self, id);
+
+  if (pos)
+    {
+      pos--;
+      g_array_append_val (positions, pos);
+    }
+}
+
+// objects whose items show something of a changed node, or links of a changed port
+static void
+graph_model_collect_dependents (PwGraphModel *self, PwGraph *graph,
+                                PwChangeSet *changes, GArray *changed)
+{
+  const guint32 *ids;
+  guint n_ids;
+
+  ids = pw_change_set_get (changes, PW_OBJECT_NODE, PW_CHANGE_CHANGED, &n_ids);
+
+  if (self->kind == PW_OBJECT_PORT)
+    {
+      for (guint i = 0; i < n_ids; i++)
+        {
+          PwGraphNode *node = pw_graph_lookup_node (graph, ids[i]);
+          if (!node)
+            continue;
+          for (int dir = PW_PAD_DIRECTION_OUT; dir <= PW_PAD_DIRECTION_IN; dir++)
+            {
+              GArray *ports = pw_graph_node_get_ports (node, dir);
+              for (guint j = 0; j < ports->len; j++)
+                graph_model_note_position (self, changed, g_array_index (ports, guint32, j));
+            }
+        }
+    }
+  else if (self->kind == PW_OBJECT_LINK)
+    {
+      g_autoptr (GHashTable) nodes = g_hash_table_new (NULL, NULL);
+      g_autoptr (GHashTable) ports = g_hash_table_new (NULL, NULL);
+      static const PwChange kinds[] = { PW_CHANGE_ADDED, PW_CHANGE_CHANGED };
+      const PwRekey *rekeys;
+      guint n_rekeys;
+
+      for (guint i = 0; i < n_ids; i++)
+        g_hash_table_add (nodes, GUINT_TO_POINTER (ids[i]));
+
+      // the names of the ends, a link may still refer to a port by its old id
+      for (guint k = 0; k < G_N_ELEMENTS (kinds); k++)
+        {
+          ids = pw_change_set_get (changes, PW_OBJECT_PORT, kinds[k], &n_ids);
+          for (guint i = 0; i < n_ids; i++)
+            g_hash_table_add (ports, GUINT_TO_POINTER (ids[i]));
+        }
+      rekeys = pw_change_set_get_rekeys (changes, PW_OBJECT_PORT, &n_rekeys);
+      for (guint i = 0; i < n_rekeys; i++)
+        {
+          g_hash_table_add (ports, GUINT_TO_POINTER (rekeys[i].old_id));
+          g_hash_table_add (ports, GUINT_TO_POINTER (rekeys[i].new_id));
+        }
+
+      if (g_hash_table_size (nodes) == 0 && g_hash_table_size (ports) == 0)
+        return;
+
+      for (guint p = 0; p < self->ids->len; p++)
+        {
+          PwGraphLink *link = pw_graph_lookup_link (graph, g_array_index (self->ids, guint32, p));
+          PwGraphPort *out = link ? pw_graph_lookup_port (graph, link->out) : NULL;
+          PwGraphPort *in = link ? pw_graph_lookup_port (graph, link->in) : NULL;
+
+          if (link
+              && (g_hash_table_contains (ports, GUINT_TO_POINTER (link->out))
+                  || g_hash_table_contains (ports, GUINT_TO_POINTER (link->in))))
+            g_array_append_val (changed, p);
+          else if ((out && g_hash_table_contains (nodes, GUINT_TO_POINTER (out->parent_id)))
+                   || (in && g_hash_table_contains (nodes, GUINT_TO_POINTER (in->parent_id))))
+            g_array_append_val (changed, p);
+        }
+    }
+}
+
+/*
+ * Removals go first, one items-changed per contiguous run from the back so
+ * the positions of the rest stay put. Additions are appended in a single
+ * run, changes are announced in place.
+ */
+static void
+graph_model_change_notify_cb (GObject *controller, PwChangeSet *changes,
+                              gpointer user_data)
+{
+  PwGraphModel *self = PW_GRAPH_MODEL (user_data);
+  PwGraph *graph = pw_view_controller_get_graph (controller);
+  g_autoptr (GArray) positions = g_array_new (FALSE, FALSE, sizeof (guint));
+  const guint32 *ids;
+  guint n_ids, n_before;
+
+  ids = pw_change_set_get (changes, self->kind, PW_CHANGE_REMOVED, &n_ids);
+  for (guint i = 0; i < n_ids; i++)
+    graph_model_note_position (self, positions, ids[i]);
+  if (positions->len > 0)
+    {
+      g_array_sort (positions, compare_positions);
+      graph_model_remove (self, positions);
+    }
+
+  n_before = self->ids->len;
+  ids = pw_change_set_get (changes, self->kind, PW_CHANGE_ADDED, &n_ids);
+  for (guint i = 0; i < n_ids; i++)
+    if (!graph_model_lookup (self, ids[i]))
+      graph_model_append (self, ids[i]);
+  if (self->ids->len > n_before)
+    g_list_model_items_changed (G_LIST_MODEL (self), n_before, 0,
+                                self->ids->len - n_before);
+
+  g_array_set_size (positions, 0);
+  ids = pw_change_set_get (changes, self->kind, PW_CHANGE_CHANGED, &n_ids);
+  for (guint i = 0; i < n_ids; i++)
+    graph_model_note_position (self, positions, ids[i]);
+  graph_model_collect_dependents (self, graph, changes, positions);
+  g_array_sort (positions, compare_positions);
+
+  // made again when asked for, the new ones may have been asked for already
+  for (guint i = 0; i < positions->len; i++)
+    {
+      guint p = g_array_index (positions, guint, i);
+      if (p < n_before)
+        g_hash_table_remove (self->items,
+                             GUINT_TO_POINTER (g_array_index (self->ids, guint32, p)));
+    }
+
+  // new items were announced already, runs of the rest in one go
+  for (guint i = 0; i < positions->len;)
+    {
+      guint first = g_array_index (positions, guint, i), last = first;
+
+      while (++i < positions->len && g_array_index (positions, guint, i) <= last + 1)
+        last = g_array_index (positions, guint, i);
+      if (first >= n_before)
+        break;
+      last = MIN (last, n_before - 1);
+      g_list_model_items_changed (G_LIST_MODEL (self), first, last - first + 1,
+                                  last - first + 1);
+    }
+}
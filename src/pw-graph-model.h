@@ -0,0 +1,35 @@
+#pragma once
+
+#include "pw-change-set.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/*
+ * One node, port or link as a list item. Items are made the first time the
+ * model is asked for them and kept, so a position gives the same item until
+ * an items-changed over it. They don't change afterwards, a change of the
+ * object replaces its item.
+ */
+#define PW_TYPE_GRAPH_ITEM (pw_graph_item_get_type ())
+
+G_DECLARE_FINAL_TYPE (PwGraphItem, pw_graph_item, PW, GRAPH_ITEM, GObject)
+
+guint32 pw_graph_item_get_id (PwGraphItem *self);
+
+const char *pw_graph_item_get_name (PwGraphItem *self);
+
+/*
+ * The nodes, ports or links of a view controller as a GListModel, in the
+ * order they showed up. Follows change-notify, so a batch only touches the
+ * positions of what it changed.
+ */
+#define PW_TYPE_GRAPH_MODEL (pw_graph_model_get_type ())
+
+G_DECLARE_FINAL_TYPE (PwGraphModel, pw_graph_model, PW, GRAPH_MODEL, GObject)
+
+PwGraphModel *pw_graph_model_new (GObject *controller, PwObjectType kind);
+
+PwObjectType pw_graph_model_get_kind (PwGraphModel *self);
+
+G_END_DECLS
@@ -0,0 +1,483 @@
+#include "pw-graph.h"
+#include "pw-enums.h"
+
+// a stacking slot whose node was raised or removed
+#define STACK_HOLE G_MAXUINT
+
+struct _PwGraph
+{
+  GArray *nodes; // PwGraphNode
+  GArray *ports; // PwGraphPort
+  GArray *links; // PwGraphLink
+  GHashTable *node_index; // id -> index + 1
+  GHashTable *port_index;
+  GHashTable *link_index;
+  PwChangeSet *changes; // since the controller last emitted them
+
+  // z-order, raising a node leaves a hole and appends it
+  GArray *stack; // guint index into nodes, back to front
+  GArray *slots; // guint, position of nodes[i] in stack
+  guint n_holes;
+};
+
+// every record starts with its id
+#define RECORD_ID(array, i) \
+  (*(guint32 *) ((array)->data + (gsize) (i) * g_array_get_element_size (array)))
+
+static void
+clear_node (gpointer data)
+{
+  PwGraphNode *node = data;
+
+  g_free (node->title);
+  g_free (node->key);
+  g_array_unref (node->outputs);
+  g_array_unref (node->inputs);
+}
+
+static void
+clear_port (gpointer data)
+{
+  g_free (((PwGraphPort *) data)->name);
+}
+
+static inline guint
+index_lookup (GHashTable *index, guint32 id)
+{
+  return GPOINTER_TO_UINT (g_hash_table_lookup (index, GUINT_TO_POINTER (id)));
+}
+
+// the last record takes the place of the removed one
+static void
+remove_fast (GArray *array, GHashTable *index, guint i)
+{
+  g_hash_table_remove (index, GUINT_TO_POINTER (RECORD_ID (array, i)));
+  g_array_remove_index_fast (array, i);
+  if (i < array->len)
+    g_hash_table_insert (index, GUINT_TO_POINTER (RECORD_ID (array, i)),
+                         GUINT_TO_POINTER (i + 1));
+}
+
+static void
+stack_compact (PwGraph *self)
+{
+  guint *stack = (guint *) self->stack->data;
+  guint n = 0;
+
+  for (guint i = 0; i < self->stack->len; i++)
+    {
+      if (stack[i] == STACK_HOLE)
+        continue;
+      stack[n] = stack[i];
+      g_array_index (self->slots, guint, stack[n]) = n;
+      n++;
+    }
+
+  g_array_set_size (self->stack, n);
+  self->n_holes = 0;
+}
+
+static void
+stack_vacate (PwGraph *self, guint slot)
+{
+  g_array_index (self->stack, guint, slot) = STACK_HOLE;
+  self->n_holes++;
+}
+
+// once holes are the majority, so every hole is compacted away at most once
+static void
+stack_maybe_compact (PwGraph *self)
+{
+  if (self->n_holes > 16 && self->n_holes * 2 > self->stack->len)
+    stack_compact (self);
+}
+
+static void
+stack_push (PwGraph *self, guint i)
+{
+  guint slot = self->stack->len;
+
+  g_array_append_val (self->stack, i);
+  if (i < self->slots->len)
+    g_array_index (self->slots, guint, i) = slot;
+  else
+    g_array_append_val (self->slots, slot);
+}
+
+PwGraph *
+pw_graph_new (void)
+{
+  PwGraph *self = g_new (PwGraph, 1);
+
+  self->nodes = g_array_new (FALSE, FALSE, sizeof (PwGraphNode));
+  g_array_set_clear_func (self->nodes, clear_node);
+  self->ports = g_array_new (FALSE, FALSE, sizeof (PwGraphPort));
+  g_array_set_clear_func (self->ports, clear_port);
+  self->links = g_array_new (FALSE, FALSE, sizeof (PwGraphLink));
+  self->node_index = g_hash_table_new (NULL, NULL);
+  self->port_index = g_hash_table_new (NULL, NULL);
+  self->link_index = g_hash_table_new (NULL, NULL);
+  self->changes = pw_change_set_new ();
+  self->stack = g_array_new (FALSE, FALSE, sizeof (guint));
+  self->slots = g_array_new (FALSE, FALSE, sizeof (guint));
+  self->n_holes = 0;
+
+  return self;
+}
+
+void
+pw_graph_free (PwGraph *self)
+{
+  g_array_unref (self->nodes);
+  g_array_unref (self->ports);
+  g_array_unref (self->links);
+  g_hash_table_unref (self->node_index);
+  g_hash_table_unref (self->port_index);
+  g_hash_table_unref (self->link_index);
+  pw_change_set_free (self->changes);
+  g_array_unref (self->stack);
+  g_array_unref (self->slots);
+  g_free (self);
+}
+
+/**
+ * pw_graph_add_node:
+ *
+ * Adds a node in front of all others, at 0,0.
+ */
+PwGraphNode *
+pw_graph_add_node (PwGraph *self, guint32 id, const char *title,
+                   const char *key, gint type, gint category)
+{
+  g_return_val_if_fail (!index_lookup (self->node_index, id), NULL);
+  PwGraphNode node = { 0 };
+
+  node.id = id;
+  node.title = g_strdup (title);
+  node.key = g_strdup (key);
+  node.type = type;
+  node.category = category;
+  node.outputs = g_array_new (FALSE, FALSE, sizeof (guint32));
+  node.inputs = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  g_array_append_val (self->nodes, node);
+  g_hash_table_insert (self->node_index, GUINT_TO_POINTER (id),
+                       GUINT_TO_POINTER (self->nodes->len));
+  stack_push (self, self->nodes->len - 1);
+  pw_change_set_note (self->changes, PW_OBJECT_NODE, PW_CHANGE_ADDED, id);
+
+  return &g_array_index (self->nodes, PwGraphNode, self->nodes->len - 1);
+}
+
+// returns NULL if the parent node isn't there
+PwGraphPort *
+pw_graph_add_port (PwGraph *self, guint32 id, guint32 parent_id,
+                   const char *name, gint direction)
+{
+  g_return_val_if_fail (!index_lookup (self->port_index, id), NULL);
+  g_return_val_if_fail (direction == PW_PAD_DIRECTION_OUT
+                        || direction == PW_PAD_DIRECTION_IN, NULL);
+  PwGraphNode *parent = pw_graph_lookup_node (self, parent_id);
+  PwGraphPort port = { id, parent_id, g_strdup (name), direction };
+
+  if (!parent)
+    {
+      g_free (port.name);
+      return NULL;
+    }
+
+  g_array_append_val (pw_graph_node_get_ports (parent, direction), id);
+  g_array_append_val (self->ports, port);
+  g_hash_table_insert (self->port_index, GUINT_TO_POINTER (id),
+                       GUINT_TO_POINTER (self->ports->len));
+  pw_change_set_note (self->changes, PW_OBJECT_PORT, PW_CHANGE_ADDED, id);
+  pw_change_set_note (self->changes, PW_OBJECT_NODE, PW_CHANGE_CHANGED, parent_id);
+
+  return &g_array_index (self->ports, PwGraphPort, self->ports->len - 1);
+}
+
+// the ports don't have to exist (yet)
+PwGraphLink *
+pw_graph_add_link (PwGraph *self, guint32 id, guint32 out, guint32 in)
+{
+  g_return_val_if_fail (!index_lookup (self->link_index, id), NULL);
+  PwGraphLink link = { id, out, in, FALSE };
+
+  g_array_append_val (self->links, link);
+  g_hash_table_insert (self->link_index, GUINT_TO_POINTER (id),
+                       GUINT_TO_POINTER (self->links->len));
+  pw_change_set_note (self->changes, PW_OBJECT_LINK, PW_CHANGE_ADDED, id);
+
+  return &g_array_index (self->links, PwGraphLink, self->links->len - 1);
+}
+
+static void
+graph_remove_port (PwGraph *self, guint i, gboolean unlink)
+{
+  PwGraphPort *port = &g_array_index (self->ports, PwGraphPort, i);
+  PwGraphNode *parent;
+
+  pw_change_set_note (self->changes, PW_OBJECT_PORT, PW_CHANGE_REMOVED, port->id);
+  if (unlink && (parent = pw_graph_lookup_node (self, port->parent_id)))
+    {
+      pw_change_set_note (self->changes, PW_OBJECT_NODE, PW_CHANGE_CHANGED, parent->id);
+      GArray *ids = pw_graph_node_get_ports (parent, port->direction);
+      for (guint j = 0; j < ids->len; j++)
+        if (g_array_index (ids, guint32, j) == port->id)
+          {
+            g_array_remove_index (ids, j);
+            break;
+          }
+    }
+
+  remove_fast (self->ports, self->port_index, i);
+}
+
+/**
+ * pw_graph_remove:
+ *
+ * Removes the node, port or link with @id. A node takes its ports along,
+ * links are left to be removed on their own.
+ *
+ * Returns: whether there was anything with @id
+ */
+gboolean
+pw_graph_remove (PwGraph *self, guint32 id)
+{
+  guint i;
+
+  if ((i = index_lookup (self->link_index, id)))
+    {
+      pw_change_set_note (self->changes, PW_OBJECT_LINK, PW_CHANGE_REMOVED, id);
+      remove_fast (self->links, self->link_index, i - 1);
+      return TRUE;
+    }
+
+  if ((i = index_lookup (self->port_index, id)))
+    {
+      graph_remove_port (self, i - 1, TRUE);
+      return TRUE;
+    }
+
+  if ((i = index_lookup (self->node_index, id)))
+    {
+      PwGraphNode *node = &g_array_index (self->nodes, PwGraphNode, i - 1);
+      GArray *lists[] = { node->outputs, node->inputs };
+
+      for (guint l = 0; l < G_N_ELEMENTS (lists); l++)
+        for (guint j = 0; j < lists[l]->len; j++)
+          {
+            guint k = index_lookup (self->port_index, g_array_index (lists[l], guint32, j));
+            if (k)
+              graph_remove_port (self, k - 1, FALSE);
+          }
+
+      pw_change_set_note (self->changes, PW_OBJECT_NODE, PW_CHANGE_REMOVED, id);
+
+      // the stacking order is kept apart, the last record may move
+      stack_vacate (self, g_array_index (self->slots, guint, i - 1));
+      remove_fast (self->nodes, self->node_index, i - 1);
+      g_array_remove_index_fast (self->slots, i - 1);
+      if (i - 1 < self->nodes->len)
+        g_array_index (self->stack, guint, g_array_index (self->slots, guint, i - 1)) = i - 1;
+      stack_maybe_compact (self);
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+PwGraphNode *
+pw_graph_lookup_node (PwGraph *self, guint32 id)
+{
+  guint i = index_lookup (self->node_index, id);
+  return i ? &g_array_index (self->nodes, PwGraphNode, i - 1) : NULL;
+}
+
+PwGraphPort *
+pw_graph_lookup_port (PwGraph *self, guint32 id)
+{
+  guint i = index_lookup (self->port_index, id);
+  return i ? &g_array_index (self->ports, PwGraphPort, i - 1) : NULL;
+}
+
+PwGraphLink *
+pw_graph_lookup_link (PwGraph *self, guint32 id)
+{
+  guint i = index_lookup (self->link_index, id);
+  return i ? &g_array_index (self->links, PwGraphLink, i - 1) : NULL;
+}
+
+// in no particular order, see PwGraphStackIter for the stacking order
+PwGraphNode *
+pw_graph_get_nodes (PwGraph *self, guint *n_nodes)
+{
+  *n_nodes = self->nodes->len;
+  return (PwGraphNode *) self->nodes->data;
+}
+
+PwGraphPort *
+pw_graph_get_ports (PwGraph *self, guint *n_ports)
+{
+  *n_ports = self->ports->len;
+  return (PwGraphPort *) self->ports->data;
+}
+
+PwGraphLink *
+pw_graph_get_links (PwGraph *self, guint *n_links)
+{
+  *n_links = self->links->len;
+  return (PwGraphLink *) self->links->data;
+}
+
+GArray *
+pw_graph_node_get_ports (PwGraphNode *node, gint direction)
+{
+  return direction == PW_PAD_DIRECTION_OUT ? node->outputs : node->inputs;
+}
+
+// puts the node on top, O(1) amortized
+void
+pw_graph_raise_node (PwGraph *self, guint32 id)
+{
+  guint i = index_lookup (self->node_index, id);
+  guint slot;
+
+  if (!i)
+    return;
+
+  slot = g_array_index (self->slots, guint, i - 1);
+  if (slot == self->stack->len - 1)
+    return;
+
+  stack_vacate (self, slot);
+  stack_push (self, i - 1);
+  stack_maybe_compact (self);
+}
+
+void
+pw_graph_stack_iter_init (PwGraphStackIter *iter, PwGraph *self)
+{
+  iter->graph = self;
+  iter->pos = 0;
+}
+
+/**
+ * pw_graph_stack_iter_next:
+ *
+ * Returns: the next node from the back to the front, %NULL after the
+ *   frontmost one. The graph must not change during the iteration.
+ */
+PwGraphNode *
+pw_graph_stack_iter_next (PwGraphStackIter *iter)
+{
+  PwGraph *self = iter->graph;
+  const guint *stack = (const guint *) self->stack->data;
+
+  while (iter->pos < self->stack->len)
+    {
+      guint i = stack[iter->pos++];
+      if (i != STACK_HOLE)
+        return &g_array_index (self->nodes, PwGraphNode, i);
+    }
+
+  return NULL;
+}
+
+void
+pw_graph_set_node_title (PwGraph *self, PwGraphNode *node, const char *title)
+{
+  if (g_strcmp0 (node->title, title) == 0)
+    return;
+
+  g_free (node->title);
+  node->title = g_strdup (title);
+  pw_change_set_note (self->changes, PW_OBJECT_NODE, PW_CHANGE_CHANGED, node->id);
+}
+
+// for changes made to a record directly
+void
+pw_graph_mark_changed (PwGraph *self, PwObjectType type, guint32 id)
+{
+  pw_change_set_note (self->changes, type, PW_CHANGE_CHANGED, id);
+}
+
+/**
+ * pw_graph_get_changes:
+ *
+ * Returns: (transfer none): what changed since the set was last cleared,
+ *   see pw_view_controller_flush_changes()
+ */
+PwChangeSet *
+pw_graph_get_changes (PwGraph *self)
+{
+  return self->changes;
+}
+
+/**
+ * pw_graph_rekey:
+ *
+ * Gives the node, port or link with @old_id the id @new_id. The ports of a
+ * node follow along, links that refer to a port keep the old id. Noted as
+ * a rekey, and as the removal of @old_id and the addition of @new_id.
+ *
+ * Returns: %FALSE if there is nothing with @old_id or @new_id is taken
+ */
+gboolean
+pw_graph_rekey (PwGraph *self, guint32 old_id, guint32 new_id)
+{
+  // in PwObjectType order
+  GHashTable *indices[] = { self->node_index, self->port_index, self->link_index };
+  GArray *arrays[] = { self->nodes, self->ports, self->links };
+  guint i = 0, kind;
+
+  for (kind = 0; kind < G_N_ELEMENTS (indices); kind++)
+    {
+      if (index_lookup (indices[kind], new_id))
+        return FALSE;
+    }
+
+  for (kind = 0; kind < G_N_ELEMENTS (indices) && !i; kind++)
+    i = index_lookup (indices[kind], old_id);
+  if (!i)
+    return FALSE;
+  kind--;
+
+  RECORD_ID (arrays[kind], i - 1) = new_id;
+  g_hash_table_remove (indices[kind], GUINT_TO_POINTER (old_id));
+  g_hash_table_insert (indices[kind], GUINT_TO_POINTER (new_id), GUINT_TO_POINTER (i));
+  pw_change_set_note (self->changes, kind, PW_CHANGE_REMOVED, old_id);
+  pw_change_set_note (self->changes, kind, PW_CHANGE_ADDED, new_id);
+  pw_change_set_note_rekey (self->changes, kind, old_id, new_id);
+
+  if (arrays[kind] == self->nodes)
+    {
+      PwGraphNode *node = &g_array_index (self->nodes, PwGraphNode, i - 1);
+      GArray *lists[] = { node->outputs, node->inputs };
+
+      for (guint l = 0; l < G_N_ELEMENTS (lists); l++)
+        for (guint j = 0; j < lists[l]->len; j++)
+          {
+            PwGraphPort *port = pw_graph_lookup_port (self, g_array_index (lists[l], guint32, j));
+            if (port)
+              {
+                port->parent_id = new_id;
+                pw_change_set_note (self->changes, PW_OBJECT_PORT, PW_CHANGE_CHANGED, port->id);
+              }
+          }
+    }
+  else if (arrays[kind] == self->ports)
+    {
+      PwGraphPort *port = &g_array_index (self->ports, PwGraphPort, i - 1);
+      PwGraphNode *parent = pw_graph_lookup_node (self, port->parent_id);
+      GArray *ids = parent ? pw_graph_node_get_ports (parent, port->direction) : NULL;
+
+      for (guint j = 0; ids && j < ids->len; j++)
+        if (g_array_index (ids, guint32, j) == old_id)
+          g_array_index (ids, guint32, j) = new_id;
+      if (parent)
+        pw_change_set_note (self->changes, PW_OBJECT_NODE, PW_CHANGE_CHANGED, parent->id);
+    }
+
+  return TRUE;
+}
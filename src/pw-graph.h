@@ -0,0 +1,97 @@
+#pragma once
+
+#include "pw-change-set.h"
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * The graph as plain data: nodes, ports and links in contiguous arrays,
+ * looked up by id in constant time. Owned by the view controller, the
+ * canvas only creates widgets for what it shows.
+ *
+ * Pointers to records stay valid until the graph is changed. Structural
+ * changes are collected in a PwChangeSet, positions and link selection are
+ * the view's and aren't tracked.
+ */
+typedef struct _PwGraph PwGraph;
+
+typedef struct
+{
+  guint32 id;
+  char *title;
+  char *key; // see PwNodeData.key, may be NULL
+  gint type; // PwPadType
+  gint category;
+  gint x, y; // top left, canvas units
+  gboolean placed; // x and y are given, else the canvas places the node once added
+  GArray *outputs, *inputs; // guint32 port ids in the order they came
+} PwGraphNode;
+
+typedef struct
+{
+  guint32 id;
+  guint32 parent_id;
+  char *name;
+  gint direction; // PwPadDirection
+} PwGraphPort;
+
+typedef struct
+{
+  guint32 id;
+  guint32 out, in; // port ids
+  gboolean selected;
+} PwGraphLink;
+
+PwGraph *pw_graph_new (void);
+
+void pw_graph_free (PwGraph *self);
+
+// walks the nodes in stacking order, see pw_graph_stack_iter_next()
+typedef struct
+{
+  PwGraph *graph;
+  guint pos;
+} PwGraphStackIter;
+
+PwGraphNode *pw_graph_add_node (PwGraph *self, guint32 id, const char *title,
+                                const char *key, gint type, gint category);
+
+PwGraphPort *pw_graph_add_port (PwGraph *self, guint32 id, guint32 parent_id,
+                                const char *name, gint direction);
+
+PwGraphLink *pw_graph_add_link (PwGraph *self, guint32 id, guint32 out, guint32 in);
+
+gboolean pw_graph_remove (PwGraph *self, guint32 id);
+
+PwGraphNode *pw_graph_lookup_node (PwGraph *self, guint32 id);
+
+PwGraphPort *pw_graph_lookup_port (PwGraph *self, guint32 id);
+
+PwGraphLink *pw_graph_lookup_link (PwGraph *self, guint32 id);
+
+PwGraphNode *pw_graph_get_nodes (PwGraph *self, guint *n_nodes);
+
+PwGraphPort *pw_graph_get_ports (PwGraph *self, guint *n_ports);
+
+PwGraphLink *pw_graph_get_links (PwGraph *self, guint *n_links);
+
+GArray *pw_graph_node_get_ports (PwGraphNode *node, gint direction);
+
+void pw_graph_raise_node (PwGraph *self, guint32 id);
+
+void pw_graph_stack_iter_init (PwGraphStackIter *iter, PwGraph *self);
+
+PwGraphNode *pw_graph_stack_iter_next (PwGraphStackIter *iter);
+
+void pw_graph_set_node_title (PwGraph *self, PwGraphNode *node, const char *title);
+
+gboolean pw_graph_rekey (PwGraph *self, guint32 old_id, guint32 new_id);
+
+void pw_graph_mark_changed (PwGraph *self, PwObjectType type, guint32 id);
+
+PwChangeSet *pw_graph_get_changes (PwGraph *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwGraph, pw_graph_free)
+
+G_END_DECLS
@@ -0,0 +1,224 @@
+#include "pw-grid.h"
+#include <math.h>
+
+typedef struct
+{
+  gint64 key;
+  GArray *ids; // guint32
+} Cell;
+
+typedef struct
+{
+  graphene_rect_t rect;
+  gint x0, y0, x1, y1; // covered cells, inclusive
+} Item;
+
+struct _PwGrid
+{
+  gfloat cell_size;
+  GHashTable *cells; // &Cell.key -> Cell
+  GHashTable *items; // id -> Item
+};
+
+static inline gint64
+cell_key (gint x, gint y)
+{
+  return (gint64) (((guint64) (guint32) x << 32) | (guint32) y);
+}
+
+static void
+free_cell (gpointer data)
+{
+  Cell *cell = data;
+  g_array_unref (cell->ids);
+  g_free (cell);
+}
+
+static void
+grid_cover (PwGrid *self, const graphene_rect_t *rect, gint *x0, gint *y0,
+            gint *x1, gint *y1)
+{
+  *x0 = floorf (rect->origin.x / self->cell_size);
+  *y0 = floorf (rect->origin.y / self->cell_size);
+  *x1 = floorf ((rect->origin.x + rect->size.width) / self->cell_size);
+  *y1 = floorf ((rect->origin.y + rect->size.height) / self->cell_size);
+}
+
+static void
+grid_unlink (PwGrid *self, guint32 id, const Item *item)
+{
+  for (gint x = item->x0; x <= item->x1; x++)
+    for (gint y = item->y0; y <= item->y1; y++)
+      {
+        gint64 key = cell_key (x, y);
+        Cell *cell = g_hash_table_lookup (self->cells, &key);
+        if (!cell)
+          continue;
+
+        for (guint i = 0; i < cell->ids->len; i++)
+          if (g_array_index (cell->ids, guint32, i) == id)
+            {
+              g_array_remove_index_fast (cell->ids, i);
+              break;
+            }
+
+        if (cell->ids->len == 0)
+          g_hash_table_remove (self->cells, &key);
+      }
+}
+
+PwGrid *
+pw_grid_new (gfloat cell_size)
+{
+  PwGrid *self = g_new0 (PwGrid, 1);
+
+  self->cell_size = cell_size;
+  self->cells = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL, free_cell);
+  self->items = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  return self;
+}
+
+void
+pw_grid_free (PwGrid *self)
+{
+  g_hash_table_unref (self->cells);
+  g_hash_table_unref (self->items);
+  g_free (self);
+}
+
+// inserts @id, or moves it if it is already in the grid
+void
+pw_grid_set (PwGrid *self, guint32 id, const graphene_rect_t *rect)
+{
+  Item *item = g_hash_table_lookup (self->items, GUINT_TO_POINTER (id));
+
+  if (item && graphene_rect_equal (&item->rect, rect))
+    return;
+
+  if (item)
+    grid_unlink (self, id, item);
+  else
+    {
+      item = g_new (Item, 1);
+      g_hash_table_insert (self->items, GUINT_TO_POINTER (id), item);
+    }
+
+  item->rect = *rect;
+  grid_cover (self, rect, &item->x0, &item->y0, &item->x1, &item->y1);
+
+  for (gint x = item->x0; x <= item->x1; x++)
+    for (gint y = item->y0; y <= item->y1; y++)
+      {
+        gint64 key = cell_key (x, y);
+        Cell *cell = g_hash_table_lookup (self->cells, &key);
+
+        if (!cell)
+          {
+            cell = g_new (Cell, 1);
+            cell->key = key;
+            cell->ids = g_array_sized_new (FALSE, FALSE, sizeof (guint32), 4);
+            g_hash_table_insert (self->cells, &cell->key, cell);
+          }
+        g_array_append_val (cell->ids, id);
+      }
+}
+
+void
+pw_grid_remove (PwGrid *self, guint32 id)
+{
+  Item *item = g_hash_table_lookup (self->items, GUINT_TO_POINTER (id));
+
+  if (!item)
+    return;
+
+  grid_unlink (self, id, item);
+  g_hash_table_remove (self->items, GUINT_TO_POINTER (id));
+}
+
+/**
+ * pw_grid_find_overlap:
+ * @ignore: id that doesn't count, usually the one being placed
+ * @hit: (out) (optional): the rectangle that is in the way
+ *
+ * Returns: whether anything but @ignore intersects @rect
+ */
+gboolean
+pw_grid_find_overlap (PwGrid *self, const graphene_rect_t *rect,
+                      guint32 ignore, graphene_rect_t *hit)
+{
+  gint x0, y0, x1, y1;
+
+  grid_cover (self, rect, &x0, &y0, &x1, &y1);
+
+  for (gint x = x0; x <= x1; x++)
+    for (gint y = y0; y <= y1; y++)
+      {
+        gint64 key = cell_key (x, y);
+        Cell *cell = g_hash_table_lookup (self->cells, &key);
+        if (!cell)
+          continue;
+
+        for (guint i = 0; i < cell->ids->len; i++)
+          {
+            guint32 id = g_array_index (cell->ids, guint32, i);
+            Item *item;
+
+            if (id == ignore)
+              continue;
+
+            item = g_hash_table_lookup (self->items, GUINT_TO_POINTER (id));
+            if (graphene_rect_intersection (&item->rect, rect, NULL))
+              {
+                if (hit)
+                  *hit = item->rect;
+                return TRUE;
+              }
+          }
+      }
+
+  return FALSE;
+}
+
+// edges count, so flat rectangles touch too, unlike for graphene
+static inline gboolean
+rects_touch (const graphene_rect_t *a, const graphene_rect_t *b)
+{
+  return a->origin.x <= b->origin.x + b->size.width && b->origin.x <= a->origin.x + a->size.width
+         && a->origin.y <= b->origin.y + b->size.height && b->origin.y <= a->origin.y + a->size.height;
+}
+
+void
+pw_grid_query (PwGrid *self, const graphene_rect_t *rect, GArray *ids)
+{
+  gint x0, y0, x1, y1;
+
+  grid_cover (self, rect, &x0, &y0, &x1, &y1);
+
+  for (gint x = x0; x <= x1; x++)
+    for (gint y = y0; y <= y1; y++)
+      {
+        gint64 key = cell_key (x, y);
+        Cell *cell = g_hash_table_lookup (self->cells, &key);
+        if (!cell)
+          continue;
+
+        for (guint i = 0; i < cell->ids->len; i++)
+          {
+            guint32 id = g_array_index (cell->ids, guint32, i);
+            Item *item = g_hash_table_lookup (self->items, GUINT_TO_POINTER (id));
+
+            // only from the first cell both cover
+            if (x != MAX (x0, item->x0) || y != MAX (y0, item->y0))
+              continue;
+            if (rects_touch (&item->rect, rect))
+              g_array_append_val (ids, id);
+          }
+      }
+}
+
+guint
+pw_grid_get_size (PwGrid *self)
+{
+  return g_hash_table_size (self->items);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glib.h>
+#include <graphene.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Uniform grid over canvas space mapping cells to the ids of the rectangles
+ * touching them, so questions about a region only look at what is nearby.
+ */
+typedef struct _PwGrid PwGrid;
+
+PwGrid *pw_grid_new (gfloat cell_size);
+
+void pw_grid_free (PwGrid *self);
+
+void pw_grid_set (PwGrid *self, guint32 id, const graphene_rect_t *rect);
+
+void pw_grid_remove (PwGrid *self, guint32 id);
+
+gboolean pw_grid_find_overlap (PwGrid *self, const graphene_rect_t *rect,
+                               guint32 ignore, graphene_rect_t *hit);
+
+// appends the ids of the rectangles touching @rect to @ids, each once
+void pw_grid_query (PwGrid *self, const graphene_rect_t *rect, GArray *ids);
+
+guint pw_grid_get_size (PwGrid *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwGrid, pw_grid_free)
+
+G_END_DECLS
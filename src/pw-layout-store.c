@@ -0,0 +1,302 @@
+#include "pw-layout-store.h"
+#include <gio/gio.h>
+#include <errno.h>
+#include <string.h>
+
+/*
+ * The file is a header followed by packed records, all little endian:
+ *
+ *   "PWLS" | u32 version | u32 count
+ *   count * ( i32 x | i32 y | u16 key length | key bytes )
+ *
+ * It is read in one go through a mapping and rewritten as a whole on a
+ * worker thread, a while after the last change.
+ */
+
+#define MAGIC "PWLS"
+#define VERSION 1
+#define HEADER_SIZE 12
+#define RECORD_SIZE 10 // without the key
+#define SAVE_DELAY 2 // seconds
+
+typedef struct
+{
+  gint32 x, y;
+} Position;
+
+typedef struct
+{
+  char *path;
+  GBytes *bytes;
+  guint serial;
+} WriteJob;
+
+struct _PwLayoutStore
+{
+  char *path;
+  GHashTable *positions; // key -> Position
+  guint save_id;
+  gboolean dirty;
+};
+
+// a late write must not replace the contents of a newer one
+static GMutex write_lock;
+static guint write_serial, written_serial;
+
+static gboolean
+store_parse (PwLayoutStore *self, const guint8 *data, gsize len)
+{
+  guint32 version, count;
+  gsize off = HEADER_SIZE;
+
+  if (len < HEADER_SIZE || memcmp (data, MAGIC, 4) != 0)
+    return FALSE;
+
+  memcpy (&version, data + 4, sizeof (version));
+  memcpy (&count, data + 8, sizeof (count));
+  version = GUINT32_FROM_LE (version);
+  count = GUINT32_FROM_LE (count);
+  if (version != VERSION)
+    return FALSE;
+
+  for (guint32 i = 0; i < count; i++)
+    {
+      Position *pos;
+      guint16 key_len;
+
+      if (len - off < RECORD_SIZE)
+        return FALSE;
+
+      pos = g_new (Position, 1);
+      memcpy (pos, data + off, sizeof (Position));
+      pos->x = GINT32_FROM_LE (pos->x);
+      pos->y = GINT32_FROM_LE (pos->y);
+      memcpy (&key_len, data + off + 8, sizeof (key_len));
+      key_len = GUINT16_FROM_LE (key_len);
+      off += RECORD_SIZE;
+
+      if (len - off < key_len)
+        {
+          g_free (pos);
+          return FALSE;
+        }
+
+      g_hash_table_replace (self->positions,
+                            g_strndup ((const char *) data + off, key_len), pos);
+      off += key_len;
+    }
+
+  return TRUE;
+}
+
+static GBytes *
+store_serialize (PwLayoutStore *self)
+{
+  GByteArray *buf = g_byte_array_new ();
+  guint32 header[2] = { GUINT32_TO_LE (VERSION),
+                        GUINT32_TO_LE (g_hash_table_size (self->positions)) };
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_byte_array_append (buf, (const guint8 *) MAGIC, 4);
+  g_byte_array_append (buf, (const guint8 *) header, sizeof (header));
+
+  g_hash_table_iter_init (&iter, self->positions);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      Position *pos = value;
+      gsize key_len = MIN (strlen (key), G_MAXUINT16);
+      gint32 xy[2] = { GINT32_TO_LE (pos->x), GINT32_TO_LE (pos->y) };
+      guint16 len16 = GUINT16_TO_LE (key_len);
+
+      g_byte_array_append (buf, (const guint8 *) xy, sizeof (xy));
+      g_byte_array_append (buf, (const guint8 *) &len16, sizeof (len16));
+      g_byte_array_append (buf, key, key_len);
+    }
+
+  return g_byte_array_free_to_bytes (buf);
+}
+
+static void
+write_job_free (WriteJob *job)
+{
+  g_free (job->path);
+  g_bytes_unref (job->bytes);
+  g_free (job);
+}
+
+static void
+store_write_thread (GTask *task, gpointer source, gpointer task_data,
+                    GCancellable *cancellable)
+{
+  WriteJob *job = task_data;
+  g_autofree char *dir = g_path_get_dirname (job->path);
+  GError *error = NULL;
+
+  g_mutex_lock (&write_lock);
+  if (job->serial < written_serial)
+    {
+      g_mutex_unlock (&write_lock);
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+
+  if (g_mkdir_with_parents (dir, 0700) < 0)
+    error = g_error_new (G_IO_ERROR, g_io_error_from_errno (errno),
+                         "Can't create %s: %s", dir, g_strerror (errno));
+  else
+    g_file_set_contents_full (job->path, g_bytes_get_data (job->bytes, NULL),
+                              g_bytes_get_size (job->bytes),
+                              G_FILE_SET_CONTENTS_CONSISTENT, 0600, &error);
+  written_serial = job->serial;
+  g_mutex_unlock (&write_lock);
+
+  if (error)
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+store_write_done (GObject *source, GAsyncResult *result, gpointer user_data)
+{
+  g_autoptr (GError) error = NULL;
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    g_warning ("Saving the node layout failed: %s", error->message);
+}
+
+// snapshots the positions on the calling thread, only the write is left
+static GTask *
+store_write_task (PwLayoutStore *self, GAsyncReadyCallback callback)
+{
+  GTask *task = g_task_new (NULL, NULL, callback, NULL);
+  WriteJob *job = g_new (WriteJob, 1);
+
+  job->path = g_strdup (self->path);
+  job->bytes = store_serialize (self);
+  g_mutex_lock (&write_lock);
+  job->serial = ++write_serial;
+  g_mutex_unlock (&write_lock);
+
+  g_task_set_task_data (task, job, (GDestroyNotify) write_job_free);
+  self->dirty = FALSE;
+
+  return task;
+}
+
+static gboolean
+store_save_cb (gpointer user_data)
+{
+  PwLayoutStore *self = user_data;
+  g_autoptr (GTask) task = store_write_task (self, store_write_done);
+
+  self->save_id = 0;
+  g_task_run_in_thread (task, store_write_thread);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * pw_layout_store_new:
+ * @path: file to load from and save to
+ *
+ * A missing or unreadable file leaves the store empty.
+ */
+PwLayoutStore *
+pw_layout_store_new (const char *path)
+{
+  PwLayoutStore *self = g_new0 (PwLayoutStore, 1);
+  g_autoptr (GMappedFile) file = NULL;
+  g_autoptr (GError) error = NULL;
+
+  self->path = g_strdup (path);
+  self->positions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  file = g_mapped_file_new (path, FALSE, &error);
+  if (!file)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_warning ("Can't read the node layout: %s", error->message);
+      return self;
+    }
+
+  if (!store_parse (self, (const guint8 *) g_mapped_file_get_contents (file),
+                    g_mapped_file_get_length (file)))
+    {
+      g_warning ("Ignoring the malformed node layout in %s", path);
+      g_hash_table_remove_all (self->positions);
+    }
+
+  return self;
+}
+
+// writes pending changes before going away, the only blocking write
+void
+pw_layout_store_free (PwLayoutStore *self)
+{
+  g_clear_handle_id (&self->save_id, g_source_remove);
+
+  if (self->dirty)
+    {
+      g_autoptr (GTask) task = store_write_task (self, NULL);
+      g_autoptr (GError) error = NULL;
+
+      g_task_run_in_thread_sync (task, store_write_thread);
+      if (!g_task_propagate_boolean (task, &error))
+        g_warning ("Saving the node layout failed: %s", error->message);
+    }
+
+  g_hash_table_unref (self->positions);
+  g_free (self->path);
+  g_free (self);
+}
+
+gboolean
+pw_layout_store_lookup (PwLayoutStore *self, const char *key, gint *x, gint *y)
+{
+  Position *pos;
+
+  if (!key)
+    return FALSE;
+
+  pos = g_hash_table_lookup (self->positions, key);
+  if (!pos)
+    return FALSE;
+
+  *x = pos->x;
+  *y = pos->y;
+  return TRUE;
+}
+
+// schedules a save, further changes within SAVE_DELAY are written with it
+void
+pw_layout_store_remember (PwLayoutStore *self, const char *key, gint x, gint y)
+{
+  Position *pos;
+
+  if (!key)
+    return;
+
+  pos = g_hash_table_lookup (self->positions, key);
+  if (pos && pos->x == x && pos->y == y)
+    return;
+
+  if (!pos)
+    {
+      pos = g_new (Position, 1);
+      g_hash_table_insert (self->positions, g_strdup (key), pos);
+    }
+  pos->x = x;
+  pos->y = y;
+
+  self->dirty = TRUE;
+  g_clear_handle_id (&self->save_id, g_source_remove);
+  self->save_id = g_timeout_add_seconds (SAVE_DELAY, store_save_cb, self);
+}
+
+char *
+pw_layout_store_get_default_path (void)
+{
+  return g_build_filename (g_get_user_data_dir (), "patchwork", "layout", NULL);
+}
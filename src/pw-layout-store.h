@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Remembers where nodes were put, keyed by what identifies a node across
+ * restarts of the graph (see PwNodeData.key).
+ */
+typedef struct _PwLayoutStore PwLayoutStore;
+
+PwLayoutStore *pw_layout_store_new (const char *path);
+
+void pw_layout_store_free (PwLayoutStore *self);
+
+gboolean pw_layout_store_lookup (PwLayoutStore *self, const char *key,
+                                 gint *x, gint *y);
+
+void pw_layout_store_remember (PwLayoutStore *self, const char *key,
+                               gint x, gint y);
+
+char *pw_layout_store_get_default_path (void);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwLayoutStore, pw_layout_store_free)
+
+G_END_DECLS
@@ -0,0 +1,632 @@
+#include "pw-layout.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Layered (Sugiyama style) layout: break cycles, rank vertices by signal
+ * flow, split long edges with dummy vertices, order every layer with
+ * barycenter sweeps and finally assign coordinates. Everything is plain
+ * arrays so it can run on a worker thread off a snapshot of the graph.
+ */
+
+#define LAYER_GAP 120
+#define NODE_GAP 30
+#define DUMMY_SIZE 10
+#define MARGIN 20
+#define SWEEPS 12
+#define BALANCE_PASSES 4
+
+typedef struct
+{
+  guint n, n_real, n_layers;
+  guint *layer;
+  gfloat *height;
+  // adjacency of the proper graph, every edge spans exactly one layer
+  guint *out_start, *out_adj;
+  guint *in_start, *in_adj;
+  // vertices of every layer in their current order
+  guint *layer_start, *order;
+  guint *pos;
+} Graph;
+
+typedef struct
+{
+  guint src, dst;
+} Edge;
+
+typedef struct
+{
+  gfloat key;
+  guint v;
+} SortItem;
+
+///////
+static void graph_build_csr (guint n, const Edge *edges, guint n_edges,
+                             gboolean reverse, guint **start, guint **adj);
+///////
+
+static int
+edge_cmp (const void *a, const void *b)
+{
+  const Edge *ea = a, *eb = b;
+  if (ea->src != eb->src)
+    return ea->src < eb->src ? -1 : 1;
+  if (ea->dst != eb->dst)
+    return ea->dst < eb->dst ? -1 : 1;
+  return 0;
+}
+
+static int
+sort_item_cmp (const void *a, const void *b)
+{
+  const SortItem *ia = a, *ib = b;
+  if (ia->key != ib->key)
+    return ia->key < ib->key ? -1 : 1;
+  return ia->v < ib->v ? -1 : ia->v > ib->v;
+}
+
+// drops self loops and parallel edges, links between ports collapse to one
+static guint
+edges_normalize (Edge *edges, guint n_edges)
+{
+  guint n = 0;
+
+  for (guint i = 0; i < n_edges; i++)
+    if (edges[i].src != edges[i].dst)
+      edges[n++] = edges[i];
+
+  if (n == 0)
+    return 0;
+
+  qsort (edges, n, sizeof (Edge), edge_cmp);
+
+  guint w = 1;
+  for (guint i = 1; i < n; i++)
+    if (edge_cmp (&edges[i], &edges[w - 1]) != 0)
+      edges[w++] = edges[i];
+
+  return w;
+}
+
+// reverses back edges found by an iterative depth first search
+static void
+edges_break_cycles (guint n, Edge *edges, guint n_edges)
+{
+  guint *start, *adj;
+  guint8 *state = g_new0 (guint8, n);
+  guint *stack = g_new (guint, n);
+  guint *next = g_new (guint, n);
+
+  graph_build_csr (n, edges, n_edges, FALSE, &start, &adj);
+
+  for (guint root = 0; root < n; root++)
+    {
+      if (state[root])
+        continue;
+
+      guint depth = 0;
+      stack[depth++] = root;
+      next[root] = start[root];
+      state[root] = 1;
+
+      while (depth > 0)
+        {
+          guint v = stack[depth - 1];
+
+          if (next[v] == start[v + 1])
+            {
+              state[v] = 2;
+              depth--;
+              continue;
+            }
+
+          guint e = next[v]++;
+          guint w = edges[adj[e]].dst;
+
+          if (state[w] == 1)
+            {
+              edges[adj[e]].src = w;
+              edges[adj[e]].dst = v;
+            }
+          else if (state[w] == 0)
+            {
+              state[w] = 1;
+              next[w] = start[w];
+              stack[depth++] = w;
+            }
+        }
+    }
+
+  g_free (state);
+  g_free (stack);
+  g_free (next);
+  g_free (start);
+  g_free (adj);
+}
+
+/*
+ * Compressed adjacency, adj holds edge indices so callers can reach both
+ * ends. With @reverse the edges are grouped by their destination instead.
+ */
+static void
+graph_build_csr (guint n, const Edge *edges, guint n_edges, gboolean reverse,
+                 guint **start, guint **adj)
+{
+  guint *s = g_new0 (guint, n + 1);
+  guint *a = g_new (guint, MAX (n_edges, 1));
+  guint *fill = g_new (guint, n);
+
+  for (guint i = 0; i < n_edges; i++)
+    s[(reverse ? edges[i].dst : edges[i].src) + 1]++;
+  for (guint v = 0; v < n; v++)
+    s[v + 1] += s[v];
+
+  memcpy (fill, s, n * sizeof (guint));
+  for (guint i = 0; i < n_edges; i++)
+    a[fill[reverse ? edges[i].dst : edges[i].src]++] = i;
+
+  g_free (fill);
+  *start = s;
+  *adj = a;
+}
+
+// longest path ranking, sinks are pulled to the last layer
+static guint
+edges_assign_layers (const PwLayoutNode *nodes, guint n, const Edge *edges,
+                     guint n_edges, guint *layer)
+{
+  guint *indeg = g_new0 (guint, n);
+  guint *outdeg = g_new0 (guint, n);
+  guint *queue = g_new (guint, n);
+  guint *start, *adj;
+  guint head = 0, tail = 0, max_layer = 0;
+
+  graph_build_csr (n, edges, n_edges, FALSE, &start, &adj);
+
+  for (guint i = 0; i < n_edges; i++)
+    {
+      indeg[edges[i].dst]++;
+      outdeg[edges[i].src]++;
+    }
+
+  for (guint v = 0; v < n; v++)
+    {
+      layer[v] = 0;
+      if (indeg[v] == 0)
+        queue[tail++] = v;
+    }
+
+  while (head < tail)
+    {
+      guint v = queue[head++];
+      max_layer = MAX (max_layer, layer[v]);
+
+      for (guint e = start[v]; e < start[v + 1]; e++)
+        {
+          guint w = edges[adj[e]].dst;
+          layer[w] = MAX (layer[w], layer[v] + 1);
+          if (--indeg[w] == 0)
+            queue[tail++] = w;
+        }
+    }
+
+  // keep the classic source/duplex/sink columns for unconnected nodes
+  max_layer = MAX (max_layer, 2);
+  for (guint v = 0; v < n; v++)
+    {
+      if (outdeg[v] > 0)
+        continue;
+
+      if (nodes[v].hint == PW_LAYOUT_HINT_SINK)
+        layer[v] = max_layer;
+      else if (layer[v] == 0 && nodes[v].hint == PW_LAYOUT_HINT_NONE)
+        layer[v] = max_layer / 2;
+    }
+
+  g_free (indeg);
+  g_free (outdeg);
+  g_free (queue);
+  g_free (start);
+  g_free (adj);
+  return max_layer + 1;
+}
+
+static void
+graph_init (Graph *g, const PwLayoutNode *nodes, guint n_nodes,
+            const PwLayoutEdge *in_edges, guint n_in_edges)
+{
+  Edge *edges = g_new (Edge, MAX (n_in_edges, 1));
+  guint *rank = g_new (guint, n_nodes);
+  guint n_edges = 0;
+
+  for (guint i = 0; i < n_in_edges; i++)
+    if (in_edges[i].src < n_nodes && in_edges[i].dst < n_nodes)
+      edges[n_edges++] = (Edge){ in_edges[i].src, in_edges[i].dst };
+
+  n_edges = edges_normalize (edges, n_edges);
+  edges_break_cycles (n_nodes, edges, n_edges);
+  // reversing may have produced new duplicates
+  n_edges = edges_normalize (edges, n_edges);
+  g->n_layers = edges_assign_layers (nodes, n_nodes, edges, n_edges, rank);
+
+  guint n_dummies = 0;
+  guint n_proper = 0;
+  for (guint i = 0; i < n_edges; i++)
+    {
+      guint span = rank[edges[i].dst] - rank[edges[i].src];
+      n_dummies += span - 1;
+      n_proper += span;
+    }
+
+  g->n_real = n_nodes;
+  g->n = n_nodes + n_dummies;
+  g->layer = g_new (guint, g->n);
+  g->height = g_new (gfloat, g->n);
+
+  for (guint v = 0; v < n_nodes; v++)
+    {
+      g->layer[v] = rank[v];
+      g->height[v] = nodes[v].height;
+    }
+
+  Edge *proper = g_new (Edge, MAX (n_proper, 1));
+  guint next = n_nodes, k = 0;
+  for (guint i = 0; i < n_edges; i++)
+    {
+      guint prev = edges[i].src;
+      for (guint l = rank[edges[i].src] + 1; l < rank[edges[i].dst]; l++)
+        {
+          g->layer[next] = l;
+          g->height[next] = DUMMY_SIZE;
+          proper[k++] = (Edge){ prev, next };
+          prev = next++;
+        }
+      proper[k++] = (Edge){ prev, edges[i].dst };
+    }
+
+  graph_build_csr (g->n, proper, n_proper, FALSE, &g->out_start, &g->out_adj);
+  graph_build_csr (g->n, proper, n_proper, TRUE, &g->in_start, &g->in_adj);
+  // store vertices instead of edge indices, the edges aren't needed anymore
+  for (guint i = 0; i < n_proper; i++)
+    {
+      g->out_adj[i] = proper[g->out_adj[i]].dst;
+      g->in_adj[i] = proper[g->in_adj[i]].src;
+    }
+
+  g->layer_start = g_new0 (guint, g->n_layers + 1);
+  g->order = g_new (guint, g->n);
+  g->pos = g_new (guint, g->n);
+
+  for (guint v = 0; v < g->n; v++)
+    g->layer_start[g->layer[v] + 1]++;
+  for (guint l = 0; l < g->n_layers; l++)
+    g->layer_start[l + 1] += g->layer_start[l];
+
+  guint *fill = g_new (guint, g->n_layers);
+  memcpy (fill, g->layer_start, g->n_layers * sizeof (guint));
+  for (guint v = 0; v < g->n; v++)
+    {
+      g->pos[v] = fill[g->layer[v]] - g->layer_start[g->layer[v]];
+      g->order[fill[g->layer[v]]++] = v;
+    }
+
+  g_free (fill);
+  g_free (proper);
+  g_free (edges);
+  g_free (rank);
+}
+
+static void
+graph_clear (Graph *g)
+{
+  g_free (g->layer);
+  g_free (g->height);
+  g_free (g->out_start);
+  g_free (g->out_adj);
+  g_free (g->in_start);
+  g_free (g->in_adj);
+  g_free (g->layer_start);
+  g_free (g->order);
+  g_free (g->pos);
+}
+
+// reorders layer @l by the mean position of its neighbours in the fixed layer
+static void
+graph_sort_layer (Graph *g, guint l, gboolean down, SortItem *items)
+{
+  const guint *start = down ? g->in_start : g->out_start;
+  const guint *adj = down ? g->in_adj : g->out_adj;
+  guint first = g->layer_start[l];
+  guint count = g->layer_start[l + 1] - first;
+
+  for (guint i = 0; i < count; i++)
+    {
+      guint v = g->order[first + i];
+      guint deg = start[v + 1] - start[v];
+      gfloat sum = 0;
+
+      for (guint e = start[v]; e < start[v + 1]; e++)
+        sum += g->pos[adj[e]];
+
+      // unconnected vertices stay where they are
+      items[i].key = deg ? sum / deg : (gfloat)g->pos[v];
+      items[i].v = v;
+    }
+
+  qsort (items, count, sizeof (SortItem), sort_item_cmp);
+
+  for (guint i = 0; i < count; i++)
+    {
+      g->order[first + i] = items[i].v;
+      g->pos[items[i].v] = i;
+    }
+}
+
+// inversion count of the edges between layer l and l + 1, via a Fenwick tree
+static guint64
+graph_count_crossings (const Graph *g, guint l, guint *tree, guint *targets)
+{
+  guint width = g->layer_start[l + 2] - g->layer_start[l + 1];
+  guint n_targets = 0;
+  guint64 crossings = 0;
+
+  for (guint i = g->layer_start[l]; i < g->layer_start[l + 1]; i++)
+    {
+      guint v = g->order[i];
+      guint first = n_targets;
+
+      for (guint e = g->out_start[v]; e < g->out_start[v + 1]; e++)
+        targets[n_targets++] = g->pos[g->out_adj[e]];
+
+      // edges of one vertex never cross each other
+      for (guint a = first + 1; a < n_targets; a++)
+        for (guint b = a; b > first && targets[b - 1] > targets[b]; b--)
+          {
+            guint t = targets[b];
+            targets[b] = targets[b - 1];
+            targets[b - 1] = t;
+          }
+    }
+
+  memset (tree, 0, (width + 1) * sizeof (guint));
+  for (guint i = 0; i < n_targets; i++)
+    {
+      guint greater = i;
+      for (guint j = targets[i] + 1; j > 0; j -= j & -j)
+        greater -= tree[j];
+      crossings += greater;
+      for (guint j = targets[i] + 1; j <= width; j += j & -j)
+        tree[j]++;
+    }
+
+  return crossings;
+}
+
+static guint64
+graph_total_crossings (const Graph *g, guint *tree, guint *targets)
+{
+  guint64 total = 0;
+  for (guint l = 0; l + 1 < g->n_layers; l++)
+    total += graph_count_crossings (g, l, tree, targets);
+  return total;
+}
+
+static void
+graph_minimize_crossings (Graph *g)
+{
+  SortItem *items = g_new (SortItem, MAX (g->n, 1));
+  guint *tree = g_new (guint, g->n + 1);
+  guint *targets = g_new (guint, MAX (g->out_start[g->n], 1));
+  guint *best = g_memdup2 (g->order, g->n * sizeof (guint));
+  guint64 best_crossings = graph_total_crossings (g, tree, targets);
+
+  for (guint sweep = 0; sweep < SWEEPS && best_crossings > 0; sweep++)
+    {
+      if (sweep % 2 == 0)
+        for (guint l = 1; l < g->n_layers; l++)
+          graph_sort_layer (g, l, TRUE, items);
+      else
+        for (guint l = g->n_layers - 1; l-- > 0;)
+          graph_sort_layer (g, l, FALSE, items);
+
+      guint64 crossings = graph_total_crossings (g, tree, targets);
+      if (crossings < best_crossings)
+        {
+          best_crossings = crossings;
+          memcpy (best, g->order, g->n * sizeof (guint));
+        }
+    }
+
+  memcpy (g->order, best, g->n * sizeof (guint));
+  for (guint l = 0; l < g->n_layers; l++)
+    for (guint i = g->layer_start[l]; i < g->layer_start[l + 1]; i++)
+      g->pos[g->order[i]] = i - g->layer_start[l];
+
+  g_free (items);
+  g_free (tree);
+  g_free (targets);
+  g_free (best);
+}
+
+/*
+ * Moves every vertex towards the mean centre of its neighbours, then
+ * restores the spacing top-down and shifts the layer back so the
+ * displacement averages out.
+ */
+static void
+graph_balance_layer (const Graph *g, guint l, gboolean down, gfloat *y)
+{
+  const guint *start = down ? g->in_start : g->out_start;
+  const guint *adj = down ? g->in_adj : g->out_adj;
+  guint first = g->layer_start[l];
+  guint last = g->layer_start[l + 1];
+  gfloat prev_end = -G_MAXFLOAT;
+  gfloat shift = 0;
+
+  if (first == last)
+    return;
+
+  for (guint i = first; i < last; i++)
+    {
+      guint v = g->order[i];
+      guint deg = start[v + 1] - start[v];
+      gfloat want = y[v];
+
+      if (deg)
+        {
+          gfloat sum = 0;
+          for (guint e = start[v]; e < start[v + 1]; e++)
+            sum += y[adj[e]] + g->height[adj[e]] / 2;
+          want = sum / deg - g->height[v] / 2;
+        }
+
+      y[v] = MAX (want, prev_end);
+      prev_end = y[v] + g->height[v] + NODE_GAP;
+      shift += y[v] - want;
+    }
+
+  shift /= last - first;
+  for (guint i = first; i < last; i++)
+    y[g->order[i]] -= shift;
+}
+
+static void
+graph_assign_coordinates (const Graph *g, const PwLayoutNode *nodes,
+                          PwLayoutNode *out)
+{
+  gfloat *y = g_new (gfloat, g->n);
+  gfloat *layer_x = g_new (gfloat, g->n_layers);
+  gfloat x = MARGIN;
+
+  for (guint l = 0; l < g->n_layers; l++)
+    {
+      gfloat width = 0;
+      gfloat top = 0;
+
+      for (guint i = g->layer_start[l]; i < g->layer_start[l + 1]; i++)
+        {
+          guint v = g->order[i];
+          if (v < g->n_real)
+            width = MAX (width, nodes[v].width);
+          y[v] = top;
+          top += g->height[v] + NODE_GAP;
+        }
+
+      layer_x[l] = x;
+      if (width > 0)
+        x += width + LAYER_GAP;
+    }
+
+  for (guint pass = 0; pass < BALANCE_PASSES; pass++)
+    {
+      for (guint l = 1; l < g->n_layers; l++)
+        graph_balance_layer (g, l, TRUE, y);
+      for (guint l = g->n_layers - 1; l-- > 0;)
+        graph_balance_layer (g, l, FALSE, y);
+    }
+
+  gfloat min_y = G_MAXFLOAT;
+  for (guint v = 0; v < g->n_real; v++)
+    min_y = MIN (min_y, y[v]);
+
+  for (guint v = 0; v < g->n_real; v++)
+    {
+      out[v].x = layer_x[g->layer[v]];
+      out[v].y = y[v] - min_y + MARGIN;
+    }
+
+  g_free (y);
+  g_free (layer_x);
+}
+
+/**
+ * pw_layout_layered:
+ * @nodes: (array length=n_nodes): nodes to place, x and y are overwritten
+ * @edges: (array length=n_edges): signal flow between @nodes
+ *
+ * Places @nodes in columns following the signal flow, sources on the
+ * left, with as few crossing edges as the heuristics find.
+ */
+void
+pw_layout_layered (PwLayoutNode *nodes, guint n_nodes,
+                   const PwLayoutEdge *edges, guint n_edges)
+{
+  Graph g;
+
+  if (n_nodes == 0)
+    return;
+
+  graph_init (&g, nodes, n_nodes, edges, n_edges);
+  graph_minimize_crossings (&g);
+  graph_assign_coordinates (&g, nodes, nodes);
+  graph_clear (&g);
+}
+
+typedef struct
+{
+  GArray *nodes;
+  GArray *edges;
+} LayoutJob;
+
+static void
+layout_job_free (LayoutJob *job)
+{
+  g_clear_pointer (&job->nodes, g_array_unref);
+  g_clear_pointer (&job->edges, g_array_unref);
+  g_free (job);
+}
+
+static void
+layout_thread (GTask *task, gpointer source, gpointer task_data,
+               GCancellable *cancellable)
+{
+  LayoutJob *job = task_data;
+
+  pw_layout_layered ((PwLayoutNode *)job->nodes->data, job->nodes->len,
+                     (PwLayoutEdge *)job->edges->data, job->edges->len);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_task_return_pointer (task, g_array_ref (job->nodes),
+                         (GDestroyNotify)g_array_unref);
+}
+
+/**
+ * pw_layout_layered_async:
+ * @nodes: (element-type PwLayoutNode): snapshot of the nodes, must not be
+ *   modified until the layout finishes
+ * @edges: (element-type PwLayoutEdge): edges between the nodes
+ *
+ * Runs pw_layout_layered() on a worker thread.
+ */
+void
+pw_layout_layered_async (GArray *nodes, GArray *edges,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback, gpointer user_data)
+{
+  LayoutJob *job = g_new0 (LayoutJob, 1);
+  g_autoptr (GTask) task = NULL;
+
+  job->nodes = g_array_ref (nodes);
+  job->edges = g_array_ref (edges);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, pw_layout_layered_async);
+  g_task_set_task_data (task, job, (GDestroyNotify)layout_job_free);
+  g_task_run_in_thread (task, layout_thread);
+}
+
+/**
+ * pw_layout_layered_finish:
+ *
+ * Returns: (transfer full) (element-type PwLayoutNode): the nodes with
+ *   their new positions
+ */
+GArray *
+pw_layout_layered_finish (GAsyncResult *result, GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
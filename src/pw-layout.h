@@ -0,0 +1,38 @@
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  PW_LAYOUT_HINT_NONE,
+  PW_LAYOUT_HINT_SOURCE,
+  PW_LAYOUT_HINT_SINK,
+} PwLayoutHint;
+
+typedef struct
+{
+  guint32 id;
+  gfloat width, height;
+  PwLayoutHint hint; // where to put nodes the links don't place
+  gboolean pinned; // x and y are fixed, only honoured by the force layout
+  gfloat x, y; // top left, result
+} PwLayoutNode;
+
+typedef struct
+{
+  guint src, dst; // indices into the node array, src feeds dst
+} PwLayoutEdge;
+
+void pw_layout_layered (PwLayoutNode *nodes, guint n_nodes,
+                        const PwLayoutEdge *edges, guint n_edges);
+
+void pw_layout_layered_async (GArray *nodes, GArray *edges,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data);
+
+GArray *pw_layout_layered_finish (GAsyncResult *result, GError **error);
+
+G_END_DECLS
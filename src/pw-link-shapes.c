@@ -0,0 +1,165 @@
+#include "pw-link-shapes.h"
+#include "pw-bezier.h"
+#include "pw-grid.h"
+
+#define CELL_SIZE 512 // links span a few hundred units
+
+struct _PwLinkShapes
+{
+  gfloat tolerance;
+  GHashTable *shapes; // id -> PwLinkShape
+  PwGrid *index; // of the bounds
+  guint generation;
+  guint n_updated; // in this generation
+};
+
+static void
+free_shape (gpointer data)
+{
+  PwLinkShape *shape = data;
+  g_array_unref (shape->points);
+  g_free (shape);
+}
+
+PwLinkShapes *
+pw_link_shapes_new (gfloat tolerance)
+{
+  PwLinkShapes *self = g_new0 (PwLinkShapes, 1);
+
+  self->tolerance = tolerance;
+  self->shapes = g_hash_table_new_full (NULL, NULL, NULL, free_shape);
+  self->index = pw_grid_new (CELL_SIZE);
+  return self;
+}
+
+void
+pw_link_shapes_free (PwLinkShapes *self)
+{
+  g_hash_table_unref (self->shapes);
+  pw_grid_free (self->index);
+  g_free (self);
+}
+
+void
+pw_link_shapes_begin (PwLinkShapes *self)
+{
+  self->generation++;
+  self->n_updated = 0;
+}
+
+// the handles lean out of the ports, further the further apart they are
+static void
+shape_rebuild (PwLinkShapes *self, PwLinkShape *shape, graphene_point_t from, graphene_point_t to)
+{
+  gfloat ydiff = ABS (from.y - to.y), xdiff = ABS (from.x - to.x);
+
+  shape->cpts[0] = from;
+  shape->cpts[1] = GRAPHENE_POINT_INIT (from.x + xdiff / 2 + ydiff / 4, from.y);
+  shape->cpts[2] = GRAPHENE_POINT_INIT (to.x - 10 - xdiff / 2 - ydiff / 4, to.y);
+  shape->cpts[3] = to;
+
+  g_array_set_size (shape->points, 0);
+  pw_bezier_flatten (shape->cpts, self->tolerance, shape->points);
+
+  const graphene_point_t *pts = (const graphene_point_t *) shape->points->data;
+  gfloat x0 = pts[0].x, y0 = pts[0].y, x1 = x0, y1 = y0;
+  for (guint i = 1; i < shape->points->len; i++)
+    {
+      x0 = MIN (x0, pts[i].x), y0 = MIN (y0, pts[i].y);
+      x1 = MAX (x1, pts[i].x), y1 = MAX (y1, pts[i].y);
+    }
+  graphene_rect_init (&shape->bounds, x0, y0, x1 - x0, y1 - y0);
+  pw_grid_set (self->index, shape->id, &shape->bounds);
+}
+
+PwLinkShape *
+pw_link_shapes_update (PwLinkShapes *self, guint32 id, graphene_point_t from, graphene_point_t to)
+{
+  PwLinkShape *shape = g_hash_table_lookup (self->shapes, GUINT_TO_POINTER (id));
+  gboolean moved = !shape || !graphene_point_equal (&shape->cpts[0], &from)
+                   || !graphene_point_equal (&shape->cpts[3], &to);
+
+  if (!shape)
+    {
+      shape = g_new0 (PwLinkShape, 1);
+      shape->id = id;
+      shape->points = g_array_new (FALSE, FALSE, sizeof (graphene_point_t));
+      g_hash_table_insert (self->shapes, GUINT_TO_POINTER (id), shape);
+    }
+  if (moved)
+    shape_rebuild (self, shape, from, to);
+  shape->moved = moved;
+
+  if (shape->generation != self->generation)
+    self->n_updated++;
+  shape->generation = self->generation;
+  return shape;
+}
+
+void
+pw_link_shapes_end (PwLinkShapes *self)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  if (self->n_updated == g_hash_table_size (self->shapes))
+    return;
+
+  g_hash_table_iter_init (&iter, self->shapes);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    if (((PwLinkShape *) value)->generation != self->generation)
+      {
+        pw_grid_remove (self->index, ((PwLinkShape *) value)->id);
+        g_hash_table_iter_remove (&iter);
+      }
+}
+
+PwLinkShape *
+pw_link_shapes_lookup (PwLinkShapes *self, guint32 id)
+{
+  return g_hash_table_lookup (self->shapes, GUINT_TO_POINTER (id));
+}
+
+gboolean
+pw_link_shapes_pick (PwLinkShapes *self, gfloat x, gfloat y, gfloat radius, guint32 *id)
+{
+  graphene_rect_t near = GRAPHENE_RECT_INIT (x - radius, y - radius, 2 * radius, 2 * radius);
+  g_autoptr (GArray) ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+  gfloat best = radius;
+  gboolean found = FALSE;
+
+  pw_grid_query (self->index, &near, ids);
+  for (guint i = 0; i < ids->len; i++)
+    {
+      PwLinkShape *shape = pw_link_shapes_lookup (self, g_array_index (ids, guint32, i));
+      gfloat d = pw_polyline_distance ((const graphene_point_t *) shape->points->data,
+                                       shape->points->len, x, y);
+      if (d <= best)
+        {
+          best = d;
+          *id = shape->id;
+          found = TRUE;
+        }
+    }
+  return found;
+}
+
+void
+pw_link_shapes_query (PwLinkShapes *self, const graphene_rect_t *rect, GArray *ids)
+{
+  pw_grid_query (self->index, rect, ids);
+}
+
+gboolean
+pw_link_shape_intersects_rect (const PwLinkShape *shape, const graphene_rect_t *rect)
+{
+  const graphene_rect_t *b = &shape->bounds;
+
+  // straight links have flat bounds, which graphene sees as empty
+  if (b->origin.x > rect->origin.x + rect->size.width || rect->origin.x > b->origin.x + b->size.width
+      || b->origin.y > rect->origin.y + rect->size.height || rect->origin.y > b->origin.y + b->size.height)
+    return FALSE;
+
+  return pw_polyline_intersects_rect ((const graphene_point_t *) shape->points->data,
+                                      shape->points->len, rect);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glib.h>
+#include <graphene.h>
+
+G_BEGIN_DECLS
+
+/*
+ * The curves of the links in canvas units, flattened once and kept until an
+ * end moves, for drawing and for everything that asks what is where.
+ */
+typedef struct
+{
+  guint32 id;
+  graphene_point_t cpts[4];
+  GArray *points; // graphene_point_t, the curve flattened
+  graphene_rect_t bounds; // of the points
+  gboolean moved; // rebuilt by the last update
+  guint generation;
+} PwLinkShape;
+
+typedef struct _PwLinkShapes PwLinkShapes;
+
+// @tolerance is how far the polylines may stray from the curves
+PwLinkShapes *pw_link_shapes_new (gfloat tolerance);
+
+void pw_link_shapes_free (PwLinkShapes *self);
+
+// starts a pass over all links, the ones not updated in it are dropped by pw_link_shapes_end()
+void pw_link_shapes_begin (PwLinkShapes *self);
+
+// the shape of the link from @from to @to, rebuilt if they moved
+PwLinkShape *pw_link_shapes_update (PwLinkShapes *self, guint32 id, graphene_point_t from,
+                                    graphene_point_t to);
+
+void pw_link_shapes_end (PwLinkShapes *self);
+
+PwLinkShape *pw_link_shapes_lookup (PwLinkShapes *self, guint32 id);
+
+// the link closest to (@x, @y) within @radius
+gboolean pw_link_shapes_pick (PwLinkShapes *self, gfloat x, gfloat y, gfloat radius, guint32 *id);
+
+// appends the ids of the links whose bounds touch @rect to @ids
+void pw_link_shapes_query (PwLinkShapes *self, const graphene_rect_t *rect, GArray *ids);
+
+gboolean pw_link_shape_intersects_rect (const PwLinkShape *shape, const graphene_rect_t *rect);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwLinkShapes, pw_link_shapes_free)
+
+G_END_DECLS
@@ -22,9 +22,9 @@ rcbrt (double num)
 static double
 cbezier_formula (double a, double b, double c, double d, double t)
 {
-  double omt = (1 - t);
-  return pow (omt, 3)*a + 3 * pow (omt, 2) * t * b + 3 * omt * pow (t, 2) * c
-         + pow (t, 3) * d;
+  double omt = 1 - t;
+  return omt * omt * omt * a + 3 * omt * omt * t * b + 3 * omt * t * t * c
+         + t * t * t * d;
 }
 
 graphene_point_t
@@ -56,23 +56,24 @@ get_cubic_roots (double pa, double pb, double pc, double pd, double* roots)
       // this is not a cubic curve.
       if (approx_eq (a, 0, tol))
         {
-          {
-            // in fact, this is not a quadratic curve either.
-            if (approx_eq (b, 0, tol))
-              {
-                // in fact in fact, there are no solutions.
-                return roots;
-              }
-            // linear solution
-            roots[0] = -c / b;
-            return roots;
-          }
-          // quadratic solution
-          double q = sqrt (b * b - 4 * a * c);
-          roots[0] = (q - b) / 2 * a;
-          roots[1] = (-b - q) / 2 * a;
+          // in fact, this is not a quadratic curve either.
+          if (approx_eq (b, 0, tol))
+            {
+              // in fact in fact, there are no solutions.
+              return roots;
+            }
+          // linear solution
+          roots[0] = -c / b;
           return roots;
         }
+      // quadratic solution
+      double disc = b * b - 4 * a * c;
+      if (disc < 0)
+        return roots;
+      double q = sqrt (disc);
+      roots[0] = (q - b) / (2 * a);
+      roots[1] = (-b - q) / (2 * a);
+      return roots;
     }
 
   a /= d;
@@ -152,7 +153,7 @@ cbezier_line_intersects (graphene_point_t l1, graphene_point_t l2,
 
   for (int i = 0; i < 3; i++)
   {
-    if (roots[i] != NAN && (is_valid_bezier_root(roots[i])))
+    if (!isnan (roots[i]) && is_valid_bezier_root (roots[i]))
     {
       graphene_point_t r = curve_get_point (c1, c2, c3, c4, roots[i]);
       if ((r.y >= l1.y) && (l2.y >= r.y) && (r.x >= l1.x) && (l2.x >= r.x))
@@ -192,7 +193,13 @@ get_quadratic_roots(double a, double b, double c, double* roots)
 
   double discriminant = b*b - 4*a*c;
 
-  if(a==0 || discriminant<0){return;}
+  // a linear derivative, the curve is a parabola
+  if(a==0){
+    if(b!=0)
+      roots[0] = -c/b;
+    return;
+  }
+  if(discriminant<0){return;}
 
   double f = -b/(2*a);
   if(discriminant==0)
@@ -220,15 +227,16 @@ get_cbezier_bounding_box(graphene_point_t p0, graphene_point_t p1,
   double y_coefs[3];
   get_cbezier_derivative(p0.x, p1.x, p2.x, p3.x, x_coefs);
   get_cbezier_derivative(p0.y, p1.y, p2.y, p3.y, y_coefs);
-  double t[4];
+  // the extremes and the ends
+  double t[6] = { [4] = 0, [5] = 1 };
   get_quadratic_roots(x_coefs[0], x_coefs[1], x_coefs[2], t);
   get_quadratic_roots(y_coefs[0], y_coefs[1], y_coefs[2], &t[2]);
 
   gdouble x_min = G_MAXDOUBLE, y_min = G_MAXDOUBLE;
-  gdouble x_max = G_MINDOUBLE, y_max = G_MINDOUBLE;
-  for(int i=0;i<4;i++)
+  gdouble x_max = -G_MAXDOUBLE, y_max = -G_MAXDOUBLE;
+  for(int i=0;i<6;i++)
   {
-    if(t[i]!=NAN && is_valid_bezier_root(t[i]))
+    if(!isnan(t[i]) && is_valid_bezier_root(t[i]))
     {
       graphene_point_t p = curve_get_point(p0, p1, p2, p3, t[i]);
       x_min = MIN(x_min, p.x);
@@ -246,4 +254,27 @@ bool rect_contains_rect(graphene_rect_t outter, graphene_rect_t inner)
   return
     (inner.origin.x>=outter.origin.x) && ((inner.origin.x+inner.size.width)<(outter.origin.x+outter.size.width)) &&
     (inner.origin.y>=outter.origin.y) && ((inner.origin.y+inner.size.height)<(outter.origin.y+outter.size.height));
-}
\ No newline at end of file
+}
+guint rect_subtract(const graphene_rect_t *a, const graphene_rect_t *b, graphene_rect_t *out)
+{
+  gfloat ax1 = a->origin.x + a->size.width, ay1 = a->origin.y + a->size.height;
+  gfloat ix0 = MAX(a->origin.x, b->origin.x), ix1 = MIN(ax1, b->origin.x + b->size.width);
+  gfloat iy0 = MAX(a->origin.y, b->origin.y), iy1 = MIN(ay1, b->origin.y + b->size.height);
+  guint n = 0;
+
+  if(ix0 > ix1 || iy0 > iy1){
+    out[0] = *a;
+    return 1;
+  }
+
+  // the strips share their edges with @b
+  if(iy0 > a->origin.y)
+    graphene_rect_init(&out[n++], a->origin.x, a->origin.y, a->size.width, iy0 - a->origin.y);
+  if(ay1 > iy1)
+    graphene_rect_init(&out[n++], a->origin.x, iy1, a->size.width, ay1 - iy1);
+  if(ix0 > a->origin.x)
+    graphene_rect_init(&out[n++], a->origin.x, iy0, ix0 - a->origin.x, iy1 - iy0);
+  if(ax1 > ix1)
+    graphene_rect_init(&out[n++], ix1, iy0, ax1 - ix1, iy1 - iy0);
+  return n;
+}
@@ -1,3 +1,4 @@
+#include <glib.h>
 #include <graphene.h>
 
 graphene_point_t curve_get_point (graphene_point_t c1, graphene_point_t c2,
@@ -21,3 +22,6 @@ get_cbezier_bounding_box (graphene_point_t p0, graphene_point_t p1,
                           graphene_point_t p2, graphene_point_t p3);
 
 bool rect_contains_rect(graphene_rect_t outter, graphene_rect_t inner);
+
+// the parts of @a outside of @b, as up to four rectangles in @out, returns how many
+guint rect_subtract(const graphene_rect_t *a, const graphene_rect_t *b, graphene_rect_t *out);
@@ -1,15 +1,35 @@
 #include "pw-node.h"
+#include "pw-pool.h"
 #include "pw-types.h"
 
+// nodes with more rows than this only have pads for a window of rows
+#define VIRTUAL_THRESHOLD 32
+#define VIRTUAL_ROWS 16
+#define SCROLL_ROWS 3
+#define POOL_CAPACITY 64
+
+// one side of a node: every port as data, pads only for the rows shown
+typedef struct
+{
+  GArray *ids;      // guint32 port ids in the order they came
+  GPtrArray *names; // owned, parallel to ids
+  GPtrArray *pads;  // bound to the ports from the window's first row on, owns a reference to every pad
+  GtkBox *box;
+} NodeColumn;
+
 typedef struct
 {
   gint x, y;
   guint32 id;
-  GList *in, *out;
+  NodeColumn in, out;
+  GHashTable *rows; // port id -> index in its column + 1
   PwPadType media_type;
 
+  gboolean virtual;
+  guint first_row;
+
   GtkBox *hbox, *in_box, *out_box, *main_box;
-  GtkLabel *node_label;
+  GtkLabel *node_label, *more_above, *more_below;
 } PwNodePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (PwNode, pw_node, GTK_TYPE_WIDGET)
@@ -36,11 +56,15 @@ static GParamSpec *properties[N_PROPS];
 
 static gint signals[N_SIG];
 
+static PwPool node_pool = PW_POOL_INIT (POOL_CAPACITY);
+
 ///////////////////////////////////////////////////////////
 static void pw_node_measure (GtkWidget *widget, GtkOrientation orientation,
                              int for_size, int *minimum, int *natural,
                              int *minimum_baseline, int *natural_baseline);
 
+static void node_update_markers (PwNodePrivate *priv);
+
 ///////////////////////////////////////////////////////////
 
 /**
@@ -57,10 +81,76 @@ pw_node_new (guint id)
   return g_object_new (PW_TYPE_NODE, "id", id, NULL);
 }
 
+/**
+ * pw_node_acquire:
+ *
+ * Takes a node from the pool of released nodes, or creates a new one if
+ * there is none, saving the template instantiation of pw_node_new().
+ *
+ * Returns: (transfer full): a #PwNode with no pads, owned by the caller
+ */
+PwNode *
+pw_node_acquire (guint id)
+{
+  PwNode *self = pw_pool_take (&node_pool);
+
+  if (!self)
+    return g_object_ref_sink (pw_node_new (id));
+
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+  priv->id = id;
+  return self;
+}
+
+/**
+ * pw_node_release:
+ *
+ * Detaches @self, hands its pads back to the pad pool, drops every
+ * "link-added" handler and hands it back to the node pool. Consumes the
+ * caller's reference.
+ */
+void
+pw_node_release (PwNode *self)
+{
+  g_return_if_fail (PW_IS_NODE (self));
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+
+  if (gtk_widget_get_parent (GTK_WIDGET (self)))
+    gtk_widget_unparent (GTK_WIDGET (self));
+
+  pw_node_clear_ports (self);
+  g_signal_handlers_disconnect_matched (self, G_SIGNAL_MATCH_ID,
+                                        signals[SIG_LINK_ADDED], 0, NULL,
+                                        NULL, NULL);
+
+  priv->id = 0;
+  priv->x = 0;
+  priv->y = 0;
+  priv->media_type = PW_PAD_TYPE_OTHER;
+  gtk_label_set_label (priv->node_label, "- -");
+
+  pw_pool_give (&node_pool, self);
+}
+
+void
+pw_node_pool_get_stats (PwPoolStats *stats)
+{
+  pw_pool_get_stats (&node_pool, stats);
+}
+
 static void
 pw_node_dispose (GObject *object)
 {
+  PwNodePrivate *priv = pw_node_get_instance_private (PW_NODE (object));
+
   gtk_widget_dispose_template (GTK_WIDGET (object), PW_TYPE_NODE);
+  g_clear_pointer (&priv->in.ids, g_array_unref);
+  g_clear_pointer (&priv->in.names, g_ptr_array_unref);
+  g_clear_pointer (&priv->in.pads, g_ptr_array_unref);
+  g_clear_pointer (&priv->out.ids, g_array_unref);
+  g_clear_pointer (&priv->out.names, g_ptr_array_unref);
+  g_clear_pointer (&priv->out.pads, g_ptr_array_unref);
+  g_clear_pointer (&priv->rows, g_hash_table_unref);
 
   G_OBJECT_CLASS (pw_node_parent_class)->dispose (object);
 }
@@ -211,7 +301,7 @@ pw_node_class_init (PwNodeClass *klass)
   signals[SIG_LINK_ADDED] = g_signal_new (
       "link-added", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL,
       NULL, NULL, G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_UINT);
-  signals[SIG_LINK_ADDED] = g_signal_new (
+  signals[SIG_LINK_REMOVED] = g_signal_new (
       "link-removed", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL,
       NULL, NULL, G_TYPE_NONE, 1, G_TYPE_UINT);
 
@@ -227,27 +317,202 @@ pw_node_class_init (PwNodeClass *klass)
                                                          in_box);
   gtk_widget_class_bind_template_child_internal_private (widget_class, PwNode,
                                                          out_box);
+  gtk_widget_class_bind_template_child_private (widget_class, PwNode,
+                                                more_above);
+  gtk_widget_class_bind_template_child_private (widget_class, PwNode,
+                                                more_below);
 
   gtk_widget_class_set_css_name (widget_class, "node");
 }
 
+static guint
+node_get_row_count (PwNodePrivate *priv)
+{
+  return MAX (priv->in.ids->len, priv->out.ids->len);
+}
+
+static NodeColumn *
+node_get_column (PwNodePrivate *priv, PwPadDirection direction)
+{
+  return direction == PW_PAD_DIRECTION_OUT ? &priv->out : &priv->in;
+}
+
+static void
+node_pad_link_added_cb (PwPad *pad, guint out, guint in, gpointer user_data)
+{
+  g_signal_emit (user_data, signals[SIG_LINK_ADDED], 0, out, in);
+}
+
+// hands the pads past the first @n_pads back to the pool
+static void
+node_trim_column (NodeColumn *col, guint n_pads)
+{
+  while (col->pads->len > n_pads)
+    {
+      PwPad *pad = g_ptr_array_steal_index (col->pads, col->pads->len - 1);
+      gtk_box_remove (col->box, GTK_WIDGET (pad));
+      pw_pad_release (pad);
+    }
+}
+
+/*
+ * Binds the pads of @col to the ports in the window, in place so the box
+ * keeps its order. Rows scrolled into the window reuse the pads of the rows
+ * that left it, a column never holds more pads than it shows.
+ */
+static void
+node_sync_column (PwNode *self, NodeColumn *col, PwPadDirection direction)
+{
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+  guint first = priv->virtual ? priv->first_row : 0;
+  guint window = priv->virtual ? VIRTUAL_ROWS : col->ids->len;
+  guint shown = first < col->ids->len ? MIN (window, col->ids->len - first) : 0;
+
+  node_trim_column (col, shown);
+
+  for (guint i = 0; i < shown; i++)
+    {
+      guint32 id = g_array_index (col->ids, guint32, first + i);
+      const char *name = g_ptr_array_index (col->names, first + i);
+      PwPad *pad;
+
+      if (i < col->pads->len)
+        {
+          pad = g_ptr_array_index (col->pads, i);
+          if (pw_pad_get_id (pad) != id)
+            pw_pad_rebind (pad, id, priv->id, name);
+          continue;
+        }
+
+      pad = pw_pad_acquire (id, priv->id, direction, priv->media_type, name);
+      g_signal_connect (pad, "link-added", G_CALLBACK (node_pad_link_added_cb), self);
+      gtk_box_append (col->box, GTK_WIDGET (pad));
+      g_ptr_array_add (col->pads, pad);
+    }
+}
+
+static void
+node_update_markers (PwNodePrivate *priv)
+{
+  guint rows = node_get_row_count (priv);
+  guint above = priv->virtual ? priv->first_row : 0;
+  guint below = 0;
+  char buf[32];
+
+  if (priv->virtual && rows > priv->first_row + VIRTUAL_ROWS)
+    below = rows - priv->first_row - VIRTUAL_ROWS;
+
+  g_snprintf (buf, sizeof (buf), "▲ %u more", above);
+  gtk_label_set_label (priv->more_above, buf);
+  gtk_widget_set_visible (GTK_WIDGET (priv->more_above), priv->virtual);
+
+  g_snprintf (buf, sizeof (buf), "▼ %u more", below);
+  gtk_label_set_label (priv->more_below, buf);
+  gtk_widget_set_visible (GTK_WIDGET (priv->more_below), priv->virtual);
+}
+
+/*
+ * Switches between showing every pad and showing a window of VIRTUAL_ROWS
+ * rows, then brings the pad boxes in line with the current window.
+ */
+static void
+node_sync_pads (PwNode *self)
+{
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+  guint rows = node_get_row_count (priv);
+
+  priv->virtual = rows > VIRTUAL_THRESHOLD;
+  if (priv->virtual)
+    priv->first_row = MIN (priv->first_row, rows - VIRTUAL_ROWS);
+  else
+    priv->first_row = 0;
+
+  node_sync_column (self, &priv->in, PW_PAD_DIRECTION_IN);
+  node_sync_column (self, &priv->out, PW_PAD_DIRECTION_OUT);
+  node_update_markers (priv);
+}
+
+static gboolean
+node_scroll_cb (GtkEventControllerScroll *controller, gdouble dx, gdouble dy,
+                gpointer user_data)
+{
+  PwNode *self = PW_NODE (user_data);
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+
+  if (!priv->virtual || dy == 0)
+    return FALSE;
+
+  gint first = (gint) priv->first_row + (dy > 0 ? SCROLL_ROWS : -SCROLL_ROWS);
+  gint max_first = node_get_row_count (priv) - VIRTUAL_ROWS;
+  first = CLAMP (first, 0, max_first);
+
+  if ((guint) first != priv->first_row)
+    {
+      priv->first_row = first;
+      node_sync_pads (self);
+    }
+
+  return TRUE;
+}
+
 static void
 pw_node_init (PwNode *self)
 {
   gtk_widget_init_template (GTK_WIDGET (self));
   PwNodePrivate *priv = pw_node_get_instance_private (self);
 
-  priv->in = NULL;
-  priv->out = NULL;
+  NodeColumn *cols[] = { &priv->in, &priv->out };
+  for (guint i = 0; i < G_N_ELEMENTS (cols); i++)
+    {
+      cols[i]->ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+      cols[i]->names = g_ptr_array_new_with_free_func (g_free);
+      cols[i]->pads = g_ptr_array_new_with_free_func (g_object_unref);
+    }
+  priv->in.box = priv->in_box;
+  priv->out.box = priv->out_box;
+  priv->rows = g_hash_table_new (NULL, NULL);
+  priv->virtual = FALSE;
+  priv->first_row = 0;
+
+  GtkEventController *scroll = gtk_event_controller_scroll_new (
+      GTK_EVENT_CONTROLLER_SCROLL_VERTICAL
+      | GTK_EVENT_CONTROLLER_SCROLL_DISCRETE);
+  g_signal_connect (scroll, "scroll", G_CALLBACK (node_scroll_cb), self);
+  gtk_widget_add_controller (GTK_WIDGET (self), scroll);
 }
 
+// unchecked, it runs once per node in every lookup
 guint32
 pw_node_get_id (PwNode *self)
 {
-  guint32 id;
-  g_object_get (self, "id", &id, NULL);
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
 
-  return id;
+  return priv->id;
+}
+
+// how many rows a node with @n_rows rows of ports shows, the markers of a window included
+guint
+pw_node_get_shown_rows (guint n_rows)
+{
+  return n_rows > VIRTUAL_THRESHOLD ? VIRTUAL_ROWS + 2 : n_rows;
+}
+
+// only for matching a node up with another object, the id is otherwise fixed
+void
+pw_node_set_id (PwNode *self, guint32 id)
+{
+  g_return_if_fail (PW_IS_NODE (self));
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+
+  NodeColumn *cols[] = { &priv->in, &priv->out };
+
+  priv->id = id;
+  for (guint c = 0; c < G_N_ELEMENTS (cols); c++)
+    for (guint i = 0; i < cols[c]->pads->len; i++)
+      {
+        PwPad *pad = g_ptr_array_index (cols[c]->pads, i);
+        pw_pad_set_ids (pad, pw_pad_get_id (pad), id);
+      }
 }
 
 void
@@ -283,59 +548,152 @@ pw_node_set_ypos (PwNode *self, gint Y)
 const char*
 pw_node_get_title(PwNode* self)
 {
-  const char* t;
-  g_object_get(self,"title",&t,NULL);
-  return t;
+  g_return_val_if_fail(PW_IS_NODE(self), NULL);
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+
+  return gtk_label_get_label (priv->node_label);
 }
 
 void
 pw_node_set_title(PwNode* self, const char* title)
 {
-  g_object_set (self, "title", title, NULL);
+  g_return_if_fail(PW_IS_NODE(self));
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+
+  if (g_strcmp0 (gtk_label_get_label (priv->node_label), title) == 0)
+    return;
+
+  gtk_label_set_label (priv->node_label, title);
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_TITLE]);
 }
 
+/**
+ * pw_node_append_port:
+ *
+ * Adds a port to the end of the column of @direction. Only the ports in
+ * the window get a #PwPad, see node_sync_column().
+ */
 void
-pw_node_append_pad (PwNode *self, PwPad *pad, int direction)
+pw_node_append_port (PwNode *self, guint32 id, const char *name, PwPadDirection direction)
 {
   g_return_if_fail (PW_IS_NODE (self));
-  g_return_if_fail (PW_IS_PAD (pad));
-
+  g_return_if_fail (direction == PW_PAD_DIRECTION_OUT || direction == PW_PAD_DIRECTION_IN);
   PwNodePrivate *priv = pw_node_get_instance_private (self);
+  NodeColumn *col = node_get_column (priv, direction);
 
-  GList **l;
-  GtkBox *box;
+  g_array_append_val (col->ids, id);
+  g_ptr_array_add (col->names, g_strdup (name));
+  g_hash_table_insert (priv->rows, GUINT_TO_POINTER (id), GUINT_TO_POINTER (col->ids->len));
 
-  switch (direction)
+  // new ports land at the end, only the window's tail can change
+  if (priv->virtual && col->ids->len > priv->first_row + VIRTUAL_ROWS)
+    node_update_markers (priv);
+  else
+    node_sync_pads (self);
+}
+
+// drops all ports and hands the pads back to the pool
+void
+pw_node_clear_ports (PwNode *self)
+{
+  g_return_if_fail (PW_IS_NODE (self));
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+  NodeColumn *cols[] = { &priv->in, &priv->out };
+
+  for (guint i = 0; i < G_N_ELEMENTS (cols); i++)
     {
-    case PW_PAD_DIRECTION_IN:
-      l = &priv->in;
-      box = priv->in_box;
-      break;
-    case PW_PAD_DIRECTION_OUT:
-      l = &priv->out;
-      box = priv->out_box;
-      break;
-    default:
-      g_log ("Patchwork", G_LOG_LEVEL_ERROR, "Invalid pad direction\n");
-      return;
+      node_trim_column (cols[i], 0);
+      g_array_set_size (cols[i]->ids, 0);
+      g_ptr_array_set_size (cols[i]->names, 0);
     }
+  g_hash_table_remove_all (priv->rows);
+  priv->virtual = FALSE;
+  priv->first_row = 0;
+  node_update_markers (priv);
+}
+
+// the port ids of the column of @direction, shown or not
+const GArray *
+pw_node_get_ports (PwNode *self, PwPadDirection direction)
+{
+  g_return_val_if_fail (PW_IS_NODE (self), NULL);
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
 
-  *l = g_list_append (*l, pad);
-  gtk_box_append (box, GTK_WIDGET (pad));
+  return node_get_column (priv, direction)->ids;
+}
+
+// the pads of the rows in the window, only these exist
+const GPtrArray *
+pw_node_get_pads (PwNode *self, PwPadDirection direction)
+{
+  g_return_val_if_fail (PW_IS_NODE (self), NULL);
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+
+  return node_get_column (priv, direction)->pads;
+}
+
+/**
+ * pw_node_compute_port_bounds:
+ *
+ * Computes the bounds of the pad of port @id in @target's coordinate space.
+ * A port that is scrolled out of a virtualized port list resolves to the
+ * marker on the edge it is hidden behind, flattened onto the node's border
+ * on its side.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+pw_node_compute_port_bounds (PwNode *self, guint32 id, GtkWidget *target,
+                             graphene_rect_t *out_bounds)
+{
+  g_return_val_if_fail (PW_IS_NODE (self), FALSE);
+
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+  guint row = GPOINTER_TO_UINT (g_hash_table_lookup (priv->rows, GUINT_TO_POINTER (id)));
+  guint first = priv->virtual ? priv->first_row : 0;
+  graphene_rect_t node_bounds;
+  GtkWidget *marker;
+  gboolean is_out;
+  NodeColumn *col;
+
+  if (!row--)
+    return FALSE;
+
+  is_out = row < priv->out.ids->len && g_array_index (priv->out.ids, guint32, row) == id;
+  col = is_out ? &priv->out : &priv->in;
+  if (row >= first && row - first < col->pads->len)
+    return gtk_widget_compute_bounds (g_ptr_array_index (col->pads, row - first),
+                                      target, out_bounds);
+
+  marker = GTK_WIDGET (row < first ? priv->more_above : priv->more_below);
+  if (!gtk_widget_compute_bounds (marker, target, out_bounds)
+      || !gtk_widget_compute_bounds (GTK_WIDGET (self), target, &node_bounds))
+    return FALSE;
+
+  out_bounds->origin.x = node_bounds.origin.x
+                         + (is_out ? node_bounds.size.width : 0);
+  out_bounds->size.width = 0;
+  return TRUE;
 }
 
 PwPadType
 pw_node_get_media_type(PwNode* self)
 {
   g_return_val_if_fail(PW_IS_NODE(self) , PW_PAD_TYPE_OTHER);
-  PwPadType t;
-  g_object_get(self , "type", &t,NULL);
-  return t;
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+
+  return priv->media_type;
 }
 
 void
-pw_node_set_media_type(PwPad* self, PwPadType type)
+pw_node_set_media_type(PwNode* self, PwPadType type)
 {
   g_return_if_fail(PW_IS_NODE(self));
-  g_object_set(self, "type", &type, NULL);
+  PwNodePrivate *priv = pw_node_get_instance_private (self);
+
+  if (priv->media_type == type)
+    return;
+
+  set_media_type(self, type);
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_TYPE]);
 }
@@ -2,6 +2,7 @@
 
 #include <gtk/gtk.h>
 #include "pw-pad.h"
+#include "pw-pool.h"
 
 G_BEGIN_DECLS
 
@@ -16,8 +17,18 @@ struct _PwNodeClass
 
 PwNode *pw_node_new (guint id);
 
+PwNode *pw_node_acquire (guint id);
+
+void pw_node_release (PwNode *self);
+
+void pw_node_pool_get_stats (PwPoolStats *stats);
+
+guint pw_node_get_shown_rows (guint n_rows);
+
 guint32 pw_node_get_id(PwNode *self);
 
+void pw_node_set_id(PwNode *self, guint32 id);
+
 void pw_node_get_pos(PwNode* self, gint* X, gint* Y);
 
 void pw_node_set_xpos(PwNode* self, gint X);
@@ -28,10 +39,18 @@ const char* pw_node_get_title(PwNode* self);
 
 void pw_node_set_title(PwNode* self, const char* title);
 
-void pw_node_append_pad(PwNode* self, PwPad* pad, int direction);
+void pw_node_append_port(PwNode* self, guint32 id, const char* name, PwPadDirection direction);
+
+void pw_node_clear_ports(PwNode* self);
+
+const GArray* pw_node_get_ports(PwNode* self, PwPadDirection direction);
+
+const GPtrArray* pw_node_get_pads(PwNode* self, PwPadDirection direction);
+
+gboolean pw_node_compute_port_bounds(PwNode* self, guint32 id, GtkWidget* target, graphene_rect_t* out_bounds);
 
 PwPadType pw_node_get_media_type(PwNode* self);
 
-void pw_node_set_media_type(PwPad* self, PwPadType type);
+void pw_node_set_media_type(PwNode* self, PwPadType type);
 
 G_END_DECLS
@@ -0,0 +1,209 @@
+#include "pw-object-filter.h"
+#include <string.h>
+
+typedef struct
+{
+  char *key;
+  gboolean negate;
+  GPatternSpec *glob; // either this
+  GRegex *regex;      // or this
+} Clause;
+
+struct _PwObjectFilter
+{
+  GPtrArray *rules; // GPtrArray of Clause, all of them have to match
+};
+
+static void
+clause_free (gpointer data)
+{
+  Clause *cl = data;
+
+  g_free (cl->key);
+  g_clear_pointer (&cl->glob, g_pattern_spec_free);
+  g_clear_pointer (&cl->regex, g_regex_unref);
+  g_free (cl);
+}
+
+static Clause *
+clause_parse (const char *str)
+{
+  static const char *ops[] = { "==", "!=", "=~", "!~" };
+  const char *op = NULL;
+  int op_idx = -1;
+
+  for (int i = 0; i < (int) G_N_ELEMENTS (ops); i++)
+    {
+      const char *found = strstr (str, ops[i]);
+      if (found && (!op || found < op))
+        {
+          op = found;
+          op_idx = i;
+        }
+    }
+  if (!op)
+    return NULL;
+
+  g_autofree char *key = g_strstrip (g_strndup (str, op - str));
+  g_autofree char *pattern = g_strstrip (g_strdup (op + 2));
+  if (*key == '\0')
+    return NULL;
+
+  Clause *cl = g_new0 (Clause, 1);
+  cl->negate = (op_idx == 1 || op_idx == 3);
+
+  if (op_idx < 2)
+    {
+      cl->glob = g_pattern_spec_new (pattern);
+    }
+  else
+    {
+      g_autoptr (GError) err = NULL;
+      cl->regex = g_regex_new (pattern, G_REGEX_OPTIMIZE, 0, &err);
+      if (!cl->regex)
+        {
+          g_warning ("Invalid regex \"%s\": %s", pattern, err->message);
+          clause_free (cl);
+          return NULL;
+        }
+    }
+
+  cl->key = g_steal_pointer (&key);
+  return cl;
+}
+
+/*
+ * Cuts a rule into clauses at the "&&" between them. A regex pattern may
+ * have its own: inside of a group or a bracket expression, or escaped as
+ * "\&&", they are part of the pattern.
+ */
+static GStrv
+rule_split (const char *str)
+{
+  GPtrArray *parts = g_ptr_array_new ();
+  const char *start = str;
+  gboolean seen_op = FALSE, regex = FALSE, in_class = FALSE;
+  int depth = 0;
+
+  for (const char *p = str; *p; p++)
+    {
+      if (!seen_op && (p[0] == '=' || p[0] == '!') && (p[1] == '=' || p[1] == '~'))
+        {
+          seen_op = TRUE;
+          regex = p[1] == '~';
+          p++;
+        }
+      else if (regex && p[0] == '\\' && p[1])
+        p++;
+      else if (regex && in_class)
+        in_class = p[0] != ']';
+      else if (regex && p[0] == '[')
+        in_class = TRUE;
+      else if (regex && p[0] == '(')
+        depth++;
+      else if (regex && p[0] == ')')
+        depth = MAX (depth - 1, 0);
+      else if (p[0] == '&' && p[1] == '&' && depth == 0)
+        {
+          g_ptr_array_add (parts, g_strndup (start, p - start));
+          start = p + 2;
+          seen_op = regex = in_class = FALSE;
+          p++;
+        }
+    }
+  g_ptr_array_add (parts, g_strdup (start));
+  g_ptr_array_add (parts, NULL);
+
+  return (GStrv) g_ptr_array_free (parts, FALSE);
+}
+
+static GPtrArray *
+rule_parse (const char *str)
+{
+  g_auto (GStrv) parts = rule_split (str);
+  GPtrArray *rule = g_ptr_array_new_with_free_func (clause_free);
+
+  for (int i = 0; parts[i]; i++)
+    {
+      Clause *cl = clause_parse (parts[i]);
+      if (!cl)
+        {
+          g_warning ("Ignoring malformed filter rule \"%s\"", str);
+          g_ptr_array_unref (rule);
+          return NULL;
+        }
+      g_ptr_array_add (rule, cl);
+    }
+
+  return rule;
+}
+
+/**
+ * pw_object_filter_new:
+ *
+ * Compiles @rules, malformed rules are skipped with a warning.
+ *
+ * Returns: (transfer full): a new #PwObjectFilter
+ */
+PwObjectFilter *
+pw_object_filter_new (const char *const *rules)
+{
+  PwObjectFilter *self = g_new (PwObjectFilter, 1);
+  self->rules = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+
+  for (int i = 0; rules && rules[i]; i++)
+    {
+      GPtrArray *rule = rule_parse (rules[i]);
+      if (rule)
+        g_ptr_array_add (self->rules, rule);
+    }
+
+  return self;
+}
+
+void
+pw_object_filter_free (PwObjectFilter *self)
+{
+  if (!self)
+    return;
+
+  g_ptr_array_unref (self->rules);
+  g_free (self);
+}
+
+guint
+pw_object_filter_get_n_rules (PwObjectFilter *self)
+{
+  return self->rules->len;
+}
+
+static gboolean
+clause_match (Clause *cl, const struct spa_dict *props)
+{
+  const char *val = spa_dict_lookup (props, cl->key);
+  gboolean match = FALSE;
+
+  if (val)
+    match = cl->glob ? g_pattern_spec_match_string (cl->glob, val)
+                     : g_regex_match (cl->regex, val, 0, NULL);
+
+  return match != cl->negate;
+}
+
+gboolean
+pw_object_filter_match (PwObjectFilter *self, const struct spa_dict *props)
+{
+  for (guint i = 0; i < self->rules->len; i++)
+    {
+      GPtrArray *rule = g_ptr_array_index (self->rules, i);
+      gboolean match = TRUE;
+
+      for (guint j = 0; match && j < rule->len; j++)
+        match = clause_match (g_ptr_array_index (rule, j), props);
+
+      if (match)
+        return TRUE;
+    }
+
+  return FALSE;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glib.h>
+#include <spa/utils/dict.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A compiled set of rules deciding which registry objects are hidden.
+ *
+ * Every rule is a list of clauses joined with "&&", the object is hidden if
+ * any rule matches. A clause is "<key> <op> <pattern>" where op is one of
+ *   ==  glob match       !=  glob doesn't match
+ *   =~  regex match      !~  regex doesn't match
+ * e.g. "media.class == Audio/Sink && node.name =~ ^alsa_output\\..*hdmi"
+ * A missing property matches nothing, so only negated clauses accept it.
+ * A regex can still have a "&&" of its own inside of a group or a bracket
+ * expression, or escaped as "\\&&". Anywhere else it ends the clause, and
+ * glob patterns can't have one at all.
+ */
+typedef struct _PwObjectFilter PwObjectFilter;
+
+PwObjectFilter *pw_object_filter_new (const char *const *rules);
+
+void pw_object_filter_free (PwObjectFilter *self);
+
+guint pw_object_filter_get_n_rules (PwObjectFilter *self);
+
+gboolean pw_object_filter_match (PwObjectFilter *self,
+                                 const struct spa_dict *props);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwObjectFilter, pw_object_filter_free)
+
+G_END_DECLS
@@ -1,6 +1,9 @@
 #include "pw-pad.h"
+#include "pw-pool.h"
 #include "pw-types.h"
 
+#define POOL_CAPACITY 512
+
 typedef struct
 {
   guint32 id;
@@ -38,6 +41,14 @@ static gint signals[N_SIG] = {
   0,
 };
 
+static PwPool pad_pool = PW_POOL_INIT (POOL_CAPACITY);
+
+///////////////////////////////////////////////////////////
+static void pad_set_direction (PwPad *self, PwPadDirection dir);
+
+static void pad_set_media_type (PwPad *self, PwPadType type);
+///////////////////////////////////////////////////////////
+
 PwPad *
 pw_pad_new (guint32 id, PwPadDirection dir, PwPadType type)
 {
@@ -45,12 +56,71 @@ pw_pad_new (guint32 id, PwPadDirection dir, PwPadType type)
 }
 
 PwPad *
-pw_pad_new_with_name (guint32 id, PwPadDirection dir, PwPadType type, const char *name)
+pw_pad_new_with_name (guint32 id, guint32 parent_id, PwPadDirection dir, PwPadType type, const char *name)
 {
-  return g_object_new (PW_TYPE_PAD, "id", id, "direction", dir, "type", type, "name", name,
+  return g_object_new (PW_TYPE_PAD, "id", id, "parent-id", parent_id, "direction", dir, "type", type, "name", name,
                        NULL);
 }
 
+/**
+ * pw_pad_acquire:
+ *
+ * Takes a pad from the pool of released pads and rebinds it, or creates a
+ * new one if there is none.
+ *
+ * Returns: (transfer full): a #PwPad owned by the caller
+ */
+PwPad *
+pw_pad_acquire (guint32 id, guint32 parent_id, PwPadDirection dir, PwPadType type, const char *name)
+{
+  PwPad *self = pw_pool_take (&pad_pool);
+
+  if (!self)
+    return g_object_ref_sink (pw_pad_new_with_name (id, parent_id, dir, type, name));
+
+  PwPadPrivate *priv = pw_pad_get_instance_private (self);
+  priv->id = id;
+  priv->parent_id = parent_id;
+  pad_set_direction (self, dir);
+  pad_set_media_type (self, type);
+  gtk_label_set_label (priv->name, name);
+  return self;
+}
+
+/**
+ * pw_pad_release:
+ *
+ * Detaches @self, drops every "link-added"/"link-removed" handler and hands
+ * it back to the pad pool. Consumes the caller's reference.
+ */
+void
+pw_pad_release (PwPad *self)
+{
+  g_return_if_fail (PW_IS_PAD (self));
+  PwPadPrivate *priv = pw_pad_get_instance_private (self);
+
+  if (gtk_widget_get_parent (GTK_WIDGET (self)))
+    gtk_widget_unparent (GTK_WIDGET (self));
+
+  g_signal_handlers_disconnect_matched (self, G_SIGNAL_MATCH_ID,
+                                        signals[SIG_LINK_ADDED], 0, NULL,
+                                        NULL, NULL);
+  g_signal_handlers_disconnect_matched (self, G_SIGNAL_MATCH_ID,
+                                        signals[SIG_LINK_REMOVED], 0, NULL,
+                                        NULL, NULL);
+  priv->id = 0;
+  priv->parent_id = 0;
+  gtk_label_set_label (priv->name, "");
+
+  pw_pool_give (&pad_pool, self);
+}
+
+void
+pw_pad_pool_get_stats (PwPoolStats *stats)
+{
+  pw_pool_get_stats (&pad_pool, stats);
+}
+
 static void
 pw_pad_dispose (GObject *object)
 {
@@ -101,13 +171,12 @@ pw_pad_get_property (GObject *object, guint prop_id, GValue *value,
 }
 
 static void
-set_prop_direction (PwPad *self, const GValue *value)
+pad_set_direction (PwPad *self, PwPadDirection dir)
 {
   PwPadPrivate *priv = pw_pad_get_instance_private (self);
   GtkWidget *widget = GTK_WIDGET (self);
   const char *class;
 
-  gint dir = g_value_get_enum (value);
   switch (dir)
     {
     case PW_PAD_DIRECTION_IN:
@@ -116,11 +185,14 @@ set_prop_direction (PwPad *self, const GValue *value)
     case PW_PAD_DIRECTION_OUT:
       class = "out";
       break;
+    case PW_PAD_DIRECTION_INVALID:
     default:
       g_log ("Patchwork", G_LOG_LEVEL_WARNING, "Invalid direction\n");
       return;
     }
   priv->direction = dir;
+  gtk_widget_remove_css_class (widget, "in");
+  gtk_widget_remove_css_class (widget, "out");
   gtk_widget_add_css_class (widget, class);
 }
 
@@ -143,12 +215,12 @@ get_css_class_for_type(PwPadType type)
 }
 
 static void
-set_prop_type(PwPad *self, const GValue *value)
+pad_set_media_type(PwPad *self, PwPadType type)
 {
   PwPadPrivate* priv = pw_pad_get_instance_private(self);
 
   gtk_widget_remove_css_class(GTK_WIDGET(self), get_css_class_for_type(priv->media_type));
-  priv->media_type = g_value_get_enum(value);
+  priv->media_type = type;
   gtk_widget_add_css_class(GTK_WIDGET(self), get_css_class_for_type(priv->media_type));
 }
 
@@ -168,10 +240,10 @@ pw_pad_set_property (GObject *object, guint prop_id, const GValue *value,
       priv->parent_id = g_value_get_uint (value);
       break;
     case PROP_DIRECTION:
-      set_prop_direction (self, value);
+      pad_set_direction (self, g_value_get_enum (value));
       break;
     case PROP_TYPE:
-      set_prop_type (self, value);
+      pad_set_media_type (self, g_value_get_enum (value));
       break;
     case PROP_NAME:
       gtk_label_set_label (priv->name, g_value_get_string (value));
@@ -313,38 +385,74 @@ pw_pad_init (PwPad *self)
                              GTK_EVENT_CONTROLLER (priv->dr_tgt));
 }
 
+// unchecked like pw_node_get_id(), these run for every pad in a lookup
 guint32
 pw_pad_get_id (PwPad *self)
 {
-  guint32 id;
-  g_object_get (self, "id", &id, NULL);
+  PwPadPrivate *priv = pw_pad_get_instance_private (self);
 
-  return id;
+  return priv->id;
 }
 
 guint32
 pw_pad_get_parent_id (PwPad *self)
 {
-  guint32 id;
-  g_object_get (self, "parent-id", &id, NULL);
+  PwPadPrivate *priv = pw_pad_get_instance_private (self);
+
+  return priv->parent_id;
+}
+
+// only for matching a pad up with another object, the ids are otherwise fixed
+void
+pw_pad_set_ids (PwPad *self, guint32 id, guint32 parent_id)
+{
+  g_return_if_fail (PW_IS_PAD (self));
+  PwPadPrivate *priv = pw_pad_get_instance_private (self);
+
+  priv->id = id;
+  priv->parent_id = parent_id;
+}
+
+/**
+ * pw_pad_rebind:
+ *
+ * Makes @self show another port of the same node and direction, for when
+ * a node scrolls its port list. Keeps the widget and its handlers.
+ */
+void
+pw_pad_rebind (PwPad *self, guint32 id, guint32 parent_id, const char *name)
+{
+  g_return_if_fail (PW_IS_PAD (self));
+  PwPadPrivate *priv = pw_pad_get_instance_private (self);
 
-  return id;
+  priv->id = id;
+  priv->parent_id = parent_id;
+  gtk_label_set_label (priv->name, name);
+}
+
+const char *
+pw_pad_get_name (PwPad *self)
+{
+  g_return_val_if_fail (PW_IS_PAD (self), NULL);
+  PwPadPrivate *priv = pw_pad_get_instance_private (self);
+
+  return gtk_label_get_label (priv->name);
 }
 
 PwPadDirection
 pw_pad_get_direction(PwPad* self)
 {
   g_return_val_if_fail(PW_IS_PAD(self) , PW_PAD_DIRECTION_INVALID);
-  PwPadDirection dir;
-  g_object_get(self , "direction", &dir,NULL);
-  return dir;
+  PwPadPrivate *priv = pw_pad_get_instance_private (self);
+
+  return priv->direction;
 }
 
 PwPadType
 pw_pad_get_media_type(PwPad* self)
 {
   g_return_val_if_fail(PW_IS_PAD(self) , PW_PAD_TYPE_OTHER);
-  PwPadType t;
-  g_object_get(self , "type", &t,NULL);
-  return t;
+  PwPadPrivate *priv = pw_pad_get_instance_private (self);
+
+  return priv->media_type;
 }
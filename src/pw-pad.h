@@ -2,6 +2,7 @@
 
 #include <gtk/gtk.h>
 #include "pw-enums.h"
+#include "pw-pool.h"
 
 G_BEGIN_DECLS
 
@@ -16,12 +17,24 @@ struct _PwPadClass
 
 PwPad *pw_pad_new (guint32 id, PwPadDirection dir, PwPadType type);
 
-PwPad *pw_pad_new_with_name (guint32 id, PwPadDirection dir, PwPadType type, const char* name);
+PwPad *pw_pad_new_with_name (guint32 id, guint32 parent_id, PwPadDirection dir, PwPadType type, const char* name);
+
+PwPad *pw_pad_acquire (guint32 id, guint32 parent_id, PwPadDirection dir, PwPadType type, const char* name);
+
+void pw_pad_release (PwPad *self);
+
+void pw_pad_pool_get_stats (PwPoolStats *stats);
 
 guint32 pw_pad_get_id(PwPad* self);
 
 guint32 pw_pad_get_parent_id (PwPad *self);
 
+void pw_pad_set_ids (PwPad *self, guint32 id, guint32 parent_id);
+
+void pw_pad_rebind (PwPad *self, guint32 id, guint32 parent_id, const char *name);
+
+const char *pw_pad_get_name (PwPad *self);
+
 PwPadDirection pw_pad_get_direction(PwPad* self);
 
 PwPadType pw_pad_get_media_type(PwPad* self);
@@ -1,10 +1,20 @@
 #include "pw-pipewire.h"
+#include "pw-enums.h"
+#include "pw-graph-cache.h"
+#include "pw-object-filter.h"
+#include "pw-registry-log.h"
 #include "pw-view-controller.h"
 #include <pipewire/pipewire.h>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wswitch-enum"
 
+#define DEFAULT_HOLD_OFF 300 // ms
+
+// objects shown from the graph cache get ids PipeWire never hands out
+#define SPECULATIVE_ID 0x40000000u
+#define IS_SPECULATIVE(id) ((guint32) (id) >= SPECULATIVE_ID)
+
 struct _PwPipewire
 {
   GObject parent_instance;
@@ -14,12 +24,43 @@ struct _PwPipewire
   struct pw_core *core;
   struct pw_registry *registry;
   struct spa_hook reg_listener;
+  struct spa_hook core_listener;
+  int sync_seq;
+  gboolean synced; // initial enumeration is done
 
   gint idle_id;
   GAsyncQueue *pw_recv;
-
-  GList *nodes, *pads, *links;
-  PwCanvas *canvas;
+  guint64 handled; // messages taken off pw_recv so far
+
+  PwGraph *graph;
+
+  // nodes that haven't survived the hold-off yet, see pipewire_flush_pending
+  guint hold_off;
+  guint suppressed;
+  GHashTable *pending;       // node id -> PendingNode
+  GHashTable *pending_ports; // port id -> node id
+  GList *pending_links;      // PwLinkData* waiting for their pads
+
+  // the graph of the last run, shown until the initial sync, see pipewire_warm_start
+  gboolean speculating;
+  GHashTable *spec_nodes; // key -> id of a node not matched with a live one yet
+  GHashTable *spec_links; // port id -> GArray of unmatched link ids
+
+  // only touched with the thread loop locked
+  char **filter_rules;
+  PwObjectFilter *filter;
+  GHashTable *globals; // id -> CachedGlobal
+  PwRegistryLogWriter *recorder;
+
+  // registry events from a log instead of a daemon, see pipewire_start_replay
+  PwRegistryLogReader *replay;
+  PwRegistryLogEvent replay_event;
+  gboolean replay_pending; // replay_event is read but not fed yet
+  gboolean replay_realtime;
+  struct spa_source *replay_timer;
+  gint64 replay_start;
+  guint replay_count;
+  gboolean replay_synced; // the sync was handled, report once the batch is done
 };
 
 typedef enum
@@ -28,6 +69,8 @@ typedef enum
   MSG_PORT_ADDED,
   MSG_LINK_ADDED,
   MSG_REMOVED,
+  MSG_FILTERED, // hidden by new filter rules, but still there
+  MSG_SYNC_DONE,
   MSG_OTHER
 } MessageType;
 
@@ -37,6 +80,24 @@ typedef struct
   void *data;
 } Message;
 
+typedef struct
+{
+  PwNodeData data;
+  gint64 born;
+  GArray *ports; // PwPadData
+} PendingNode;
+
+// the properties of a node, port or link kept for re-filtering
+typedef struct
+{
+  guint32 id;
+  MessageType type;
+  guint32 deps[2]; // parent node of a port, out/in ports of a link
+  gboolean hidden;
+  struct spa_dict_item *items;
+  guint32 n_items;
+} CachedGlobal;
+
 typedef enum
 {
   CAT_OTHER = 0,
@@ -52,6 +113,9 @@ G_DEFINE_TYPE_WITH_CODE (PwPipewire, pw_pipewire, G_TYPE_OBJECT, G_IMPLEMENT_INT
 enum
 {
   PROP_0,
+  PROP_HOLD_OFF,
+  PROP_SUPPRESSED,
+  PROP_FILTER_RULES,
   N_PROPS
 };
 
@@ -64,34 +128,24 @@ enum
 static GParamSpec *properties[N_PROPS];
 static int signals[N_SIG];
 
-///////////////////////////////////////////////////////////
-static PwNode *pw_pipewire_get_node_by_id (GObject *self, gint id);
-
-static PwPad *pw_pipewire_get_pad_by_id (GObject *this, gint id);
-
-static PwLinkData *pw_pipewire_get_link_by_id (GObject *this, gint id);
-///////////////////////////////////////////////////////////
-
 ///////////////////////////////////////////////////////////
 static MessageType
 reg_get_type (const char *type);
 
 static void
 default_changed_handler (PwPipewire *self, gpointer user_data);
-///////////////////////////////////////////////////////////
 
-PwPipewire *
-pw_pipewire_new (PwCanvas *canvas)
-{
-  PwPipewire *pw = g_object_new (PW_TYPE_PIPEWIRE, NULL);
-  pw->canvas = canvas;
-  return pw;
-}
+static void
+pipewire_set_filter_rules (PwPipewire *self, const char *const *rules);
 
 static void
-free_nodes (gpointer data)
+pipewire_save_graph (PwPipewire *self);
+///////////////////////////////////////////////////////////
+
+PwPipewire *
+pw_pipewire_new (void)
 {
-  gtk_widget_unparent (GTK_WIDGET (data));
+  return g_object_new (PW_TYPE_PIPEWIRE, NULL);
 }
 
 static void
@@ -102,13 +156,31 @@ pw_pipewire_dispose (GObject *object)
   g_source_remove(self->idle_id);
 
   pw_thread_loop_stop(self->loop);
-  pw_proxy_destroy((struct pw_proxy *) self->registry);
-  pw_core_disconnect(self->core);
-  pw_context_destroy(self->context);
+  if (self->replay_timer)
+    pw_loop_destroy_source (pw_thread_loop_get_loop (self->loop), self->replay_timer);
+  if (self->registry)
+    pw_proxy_destroy((struct pw_proxy *) self->registry);
+  if (self->core)
+    pw_core_disconnect(self->core);
+  if (self->context)
+    pw_context_destroy(self->context);
   pw_thread_loop_destroy(self->loop);
-
-  GList *l = self->nodes;
-  g_list_free_full (g_steal_pointer (&self->nodes), free_nodes);
+  g_clear_pointer (&self->recorder, pw_registry_log_writer_free);
+
+  // a replayed graph is not the user's
+  if (!self->replay)
+    pipewire_save_graph (self);
+  g_clear_pointer (&self->replay, pw_registry_log_reader_free);
+
+  g_clear_pointer (&self->graph, pw_graph_free);
+  g_list_free_full (g_steal_pointer (&self->pending_links), g_free);
+  g_clear_pointer (&self->pending, g_hash_table_unref);
+  g_clear_pointer (&self->pending_ports, g_hash_table_unref);
+  g_clear_pointer (&self->spec_nodes, g_hash_table_unref);
+  g_clear_pointer (&self->spec_links, g_hash_table_unref);
+  g_clear_pointer (&self->globals, g_hash_table_unref);
+  g_clear_pointer (&self->filter, pw_object_filter_free);
+  g_clear_pointer (&self->filter_rules, g_strfreev);
 
   G_OBJECT_CLASS (pw_pipewire_parent_class)->dispose (object);
 }
@@ -128,6 +200,15 @@ pw_pipewire_get_property (GObject *object, guint prop_id, GValue *value, GParamS
 
   switch (prop_id)
     {
+    case PROP_HOLD_OFF:
+      g_value_set_uint (value, self->hold_off);
+      break;
+    case PROP_SUPPRESSED:
+      g_value_set_uint (value, self->suppressed);
+      break;
+    case PROP_FILTER_RULES:
+      g_value_set_boxed (value, self->filter_rules);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -140,6 +221,12 @@ pw_pipewire_set_property (GObject *object, guint prop_id, const GValue *value, G
 
   switch (prop_id)
     {
+    case PROP_HOLD_OFF:
+      self->hold_off = g_value_get_uint (value);
+      break;
+    case PROP_FILTER_RULES:
+      pipewire_set_filter_rules (self, g_value_get_boxed (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -155,95 +242,47 @@ pw_pipewire_class_init (PwPipewireClass *klass)
   object_class->get_property = pw_pipewire_get_property;
   object_class->set_property = pw_pipewire_set_property;
 
-  signals[SIG_CHANGED] = g_signal_new_class_handler ("changed", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_FIRST, G_CALLBACK (default_changed_handler), NULL, NULL, NULL, G_TYPE_NONE, 0);
-}
-
-static void
-fill_rect_data(PwNode *nod, graphene_rect_t *rect)
-{
-  gint x,y,w,h;
-  pw_node_get_pos(nod, &x, &y);
-  rect->origin.x = x;
-  rect->origin.y = y;
-  gtk_widget_measure(GTK_WIDGET(nod), GTK_ORIENTATION_HORIZONTAL, -1, NULL, &w, NULL, NULL);
-  gtk_widget_measure(GTK_WIDGET(nod), GTK_ORIENTATION_VERTICAL, -1, NULL, &h, NULL, NULL);
-  rect->size.width = w;
-  rect->size.height = h;
-}
-
-static void
-pipewire_calc_node_pos(PwPipewire *self, PwNodeData *dat, graphene_point_t *pos)
-{
-  static const int segment = 500;
-  static int counter[3] = {0,};
-  graphene_rect_t rect;
-  int i;
-  GList *l = self->nodes;
-
-  int cat = dat->category;
-  switch(cat){
-  case CAT_SOURCE:
-    pos->x = 20;
-    i=0;
-    break;
-  default:
-  case CAT_DUPLEX:
-  case CAT_OTHER:
-    pos->x = segment+20;
-    i=1;
-    break;
-  case CAT_SINK:
-    pos->x = segment*2+20;
-    i=2;
-    break;
-  }
-
-  pos->y = 20;
-  while(l){
-    PwNode *nod = PW_NODE(l->data);
-    fill_rect_data(nod, &rect);
-
-    if(rect.origin.x == pos->x && rect.origin.y == pos->y){
-      pos->y = counter[i] += 100;
-    }
+  properties[PROP_HOLD_OFF] = g_param_spec_uint (
+      "hold-off", "Hold-off", "Milliseconds a new node has to live before it is shown",
+      0, G_MAXUINT, DEFAULT_HOLD_OFF, G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+  properties[PROP_SUPPRESSED] = g_param_spec_uint (
+      "suppressed", "Suppressed", "Objects that were removed before they were shown",
+      0, G_MAXUINT, 0, G_PARAM_READABLE);
+  properties[PROP_FILTER_RULES] = g_param_spec_boxed (
+      "filter-rules", "Filter rules", "Rules for registry objects that are never shown, see PwObjectFilter",
+      G_TYPE_STRV, G_PARAM_READWRITE);
+  g_object_class_install_properties (object_class, N_PROPS, properties);
 
-    l=l->next;
-  }
+  signals[SIG_CHANGED] = g_signal_new_class_handler ("changed", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_FIRST, G_CALLBACK (default_changed_handler), NULL, NULL, NULL, G_TYPE_NONE, 0);
 }
 
 static void
-pw_pipewire_add_node (GObject *self, PwCanvas *canv, PwNodeData nod)
+pw_pipewire_add_node (GObject *self, PwNodeData nod)
 {
   g_return_if_fail (PW_IS_PIPEWIRE (self));
   PwPipewire *con = PW_PIPEWIRE (self);
 
-  PwNode *nnod = pw_node_new (nod.id);
-  graphene_point_t pos;
-  pipewire_calc_node_pos(con, &nod, &pos);
-
-  g_object_set (G_OBJECT (nnod), "title", nod.title, "type", nod.type,
-                "x-pos", (int)pos.x,"y-pos", (int)pos.y, NULL);
-
-  con->nodes = g_list_prepend (con->nodes, nnod);
-  gtk_widget_set_parent (GTK_WIDGET (nnod), GTK_WIDGET (canv));
+  // the canvas places it when it sees it added
+  pw_graph_add_node (con->graph, nod.id, nod.title, nod.key, nod.type, nod.category);
 }
 
 static void
-link_added_cb(PwPad* self, guint out, guint in, gpointer user_data)
+pw_pipewire_link_pads (GObject *self, guint32 out, guint32 in)
 {
-  PwPipewire *con = PW_PIPEWIRE (user_data);
-
-  PwPad* out_pad = pw_pipewire_get_pad_by_id(G_OBJECT(con), out);
-  PwPad* in_pad = pw_pipewire_get_pad_by_id(G_OBJECT(con), in);
+  g_return_if_fail (PW_IS_PIPEWIRE (self));
+  PwPipewire *con = PW_PIPEWIRE (self);
 
-  guint out_node = pw_pad_get_parent_id(out_pad);
-  guint in_node = pw_pad_get_parent_id(in_pad);
+  PwGraphPort *out_port = pw_graph_lookup_port (con->graph, out);
+  PwGraphPort *in_port = pw_graph_lookup_port (con->graph, in);
+  // nobody to ask when replaying
+  if (!out_port || !in_port || !con->core)
+    return;
 
   char ids[4][20];
   g_snprintf(ids[0], 20, "%u", out);
-  g_snprintf(ids[1], 20, "%u", out_node);
+  g_snprintf(ids[1], 20, "%u", out_port->parent_id);
   g_snprintf(ids[2], 20, "%u", in);
-  g_snprintf(ids[3], 20, "%u", in_node);
+  g_snprintf(ids[3], 20, "%u", in_port->parent_id);
 
   struct spa_dict props;
   struct spa_dict_item items[6];
@@ -263,20 +302,27 @@ link_added_cb(PwPad* self, guint out, guint in, gpointer user_data)
 }
 
 static void
-pw_pipewire_add_pad (GObject *self, PwPadData data)
+pw_pipewire_unlink (GObject *self, guint32 link)
 {
   g_return_if_fail (PW_IS_PIPEWIRE (self));
   PwPipewire *con = PW_PIPEWIRE (self);
-  PwNode *nod;
-  g_return_if_fail (
-      nod = pw_pipewire_get_node_by_id (G_OBJECT (con), data.parent_id));
 
-  PwPad *pad = pw_pad_new_with_name (data.id, data.direction, pw_node_get_media_type(nod), data.name);
+  // nobody to ask when replaying
+  if (!pw_graph_lookup_link (con->graph, link) || !con->registry)
+    return;
 
-  g_signal_connect (pad, "link-added", G_CALLBACK (link_added_cb), con);
+  pw_thread_loop_lock (con->loop);
+  pw_registry_destroy (con->registry, link);
+  pw_thread_loop_unlock (con->loop);
+}
 
-  con->pads = g_list_prepend (con->pads, pad);
-  pw_node_append_pad (nod, pad, data.direction);
+static void
+pw_pipewire_add_pad (GObject *self, PwPadData data)
+{
+  g_return_if_fail (PW_IS_PIPEWIRE (self));
+  PwPipewire *con = PW_PIPEWIRE (self);
+
+  pw_graph_add_port (con->graph, data.id, data.parent_id, data.name, data.direction);
 }
 
 static void
@@ -285,173 +331,491 @@ pw_pipewire_add_link (GObject *self, PwLinkData link)
   g_return_if_fail (PW_IS_PIPEWIRE (self));
   PwPipewire *con = PW_PIPEWIRE (self);
 
-  PwLinkData *el = malloc (sizeof (PwLinkData));
-  memcpy (el, &link, sizeof (PwLinkData));
-
-  con->links = g_list_prepend (con->links, el);
+  pw_graph_add_link (con->graph, link.id, link.out, link.in);
 }
 
 static gboolean
 pw_pipewire_remove (GObject *this, gint id)
 {
   g_return_val_if_fail (PW_IS_PIPEWIRE (this), FALSE);
+  PwPipewire *pw = PW_PIPEWIRE (this);
+
+  return pw_graph_remove (pw->graph, id);
+}
 
+static PwGraph *
+pw_pipewire_get_graph (GObject *this)
+{
+  g_return_val_if_fail (PW_IS_PIPEWIRE (this), NULL);
   PwPipewire *pw = PW_PIPEWIRE (this);
-  GList *l;
+  return pw->graph;
+}
+
+static void
+pw_view_controller_iface_init (PwViewControllerInterface *iface)
+{
+  iface->add_node = pw_pipewire_add_node;
+  iface->add_pad = pw_pipewire_add_pad;
+  iface->add_link = pw_pipewire_add_link;
+  iface->remove = pw_pipewire_remove;
+  iface->link_pads = pw_pipewire_link_pads;
+  iface->unlink = pw_pipewire_unlink;
+  iface->get_graph = pw_pipewire_get_graph;
+}
+
+// message data may be stolen by the handler, in which case it is NULL
+static void
+pw_free_recv_queue (void *data)
+{
+  Message *msg = data;
 
-  gpointer ptr = pw_pipewire_get_link_by_id (this, id);
-  if (ptr)
+  if (msg->data)
     {
-      PwLinkData *dat = ptr;
-      pw->links = g_list_remove (pw->links, ptr);
-      return TRUE;
+      switch (msg->type)
+        {
+        case MSG_NODE_ADDED:
+          {
+            PwNodeData *dat = msg->data;
+            free ((void *) dat->title);
+            free ((void *) dat->key);
+          }
+          break;
+        case MSG_PORT_ADDED:
+          {
+            PwPadData *dat = msg->data;
+            free ((void *) dat->name);
+          }
+          break;
+        default:
+          break;
+        }
+      free (msg->data);
     }
+  free (msg);
+}
+
+static void
+free_pending_node (gpointer data)
+{
+  PendingNode *pend = data;
+
+  free ((void *) pend->data.title);
+  free ((void *) pend->data.key);
+  for (guint i = 0; i < pend->ports->len; i++)
+    free ((void *) g_array_index (pend->ports, PwPadData, i).name);
+  g_array_unref (pend->ports);
+  g_free (pend);
+}
 
-  ptr = pw_pipewire_get_pad_by_id (this, id);
-  if (PW_IS_PAD (ptr))
+static void
+free_cached_global (gpointer data)
+{
+  CachedGlobal *g = data;
+
+  for (guint32 i = 0; i < g->n_items; i++)
     {
-      PwPad *pad = PW_PAD (ptr);
-      gtk_widget_unparent (GTK_WIDGET (pad));
-      pw->pads = g_list_delete_link (pw->pads, g_list_find (pw->pads, ptr));
+      g_free ((char *) g->items[i].key);
+      g_free ((char *) g->items[i].value);
+    }
+  g_free (g->items);
+  g_free (g);
+}
+
+static void
+pipewire_hold_node (PwPipewire *self, PwNodeData *dat)
+{
+  PendingNode *pend = g_new (PendingNode, 1);
+
+  pend->data = *dat;
+  pend->born = g_get_monotonic_time ();
+  pend->ports = g_array_new (FALSE, FALSE, sizeof (PwPadData));
+  g_hash_table_insert (self->pending, GUINT_TO_POINTER (dat->id), pend);
+}
+
+static void
+pipewire_add_or_hold_link (PwPipewire *self, PwLinkData *dat)
+{
+  PwGraphPort *out = pw_graph_lookup_port (self->graph, dat->out);
+  PwGraphPort *in = pw_graph_lookup_port (self->graph, dat->in);
+
+  if (out && in)
+    pw_pipewire_add_link (G_OBJECT (self), *dat);
+  else
+    self->pending_links = g_list_prepend (self->pending_links,
+                                          g_memdup2 (dat, sizeof (PwLinkData)));
+}
+
+static void
+pipewire_suppress (PwPipewire *self, guint count)
+{
+  self->suppressed += count;
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SUPPRESSED]);
+}
+
+/*
+ * Returns TRUE if @id belonged to an object that was never shown. Only the
+ * objects that went away count as suppressed, not the ones a filter hides.
+ */
+static gboolean
+pipewire_remove_pending (PwPipewire *self, guint32 id, gboolean gone)
+{
+  gpointer node_id;
+  PendingNode *pend;
+
+  pend = g_hash_table_lookup (self->pending, GUINT_TO_POINTER (id));
+  if (pend)
+    {
+      for (guint i = 0; i < pend->ports->len; i++)
+        g_hash_table_remove (self->pending_ports,
+                             GUINT_TO_POINTER (g_array_index (pend->ports, PwPadData, i).id));
+      if (gone)
+        pipewire_suppress (self, 1 + pend->ports->len);
+      g_hash_table_remove (self->pending, GUINT_TO_POINTER (id));
       return TRUE;
     }
 
-  ptr = pw_pipewire_get_node_by_id (this, id);
-  if (ptr)
+  if (g_hash_table_lookup_extended (self->pending_ports, GUINT_TO_POINTER (id), NULL, &node_id))
     {
-      PwNode *nod = PW_NODE (ptr);
-      gtk_widget_unparent (GTK_WIDGET (nod));
-      pw->nodes = g_list_remove (pw->nodes, ptr);
+      pend = g_hash_table_lookup (self->pending, node_id);
+      for (guint i = 0; pend && i < pend->ports->len; i++)
+        {
+          PwPadData *port = &g_array_index (pend->ports, PwPadData, i);
+          if (port->id == id)
+            {
+              free ((void *) port->name);
+              g_array_remove_index (pend->ports, i);
+              break;
+            }
+        }
+      g_hash_table_remove (self->pending_ports, GUINT_TO_POINTER (id));
+      if (gone)
+        pipewire_suppress (self, 1);
       return TRUE;
     }
 
+  for (GList *l = self->pending_links; l; l = l->next)
+    {
+      if (((PwLinkData *) l->data)->id == id)
+        {
+          g_free (l->data);
+          self->pending_links = g_list_delete_link (self->pending_links, l);
+          if (gone)
+            pipewire_suppress (self, 1);
+          return TRUE;
+        }
+    }
+
   return FALSE;
 }
 
-static PwNode *
-pw_pipewire_get_node_by_id (GObject *this, gint id)
+/*
+ * Materializes held nodes that outlived the hold-off together with their
+ * ports, then adds the links whose pads exist by now. Nodes removed within
+ * the hold-off never reach GTK.
+ */
+static void
+pipewire_flush_pending (PwPipewire *self)
 {
-  g_return_val_if_fail (PW_IS_PIPEWIRE (this), NULL);
-  PwPipewire *pw = PW_PIPEWIRE (this);
-  GList *l = pw->nodes;
+  gint64 now = g_get_monotonic_time ();
+  GHashTableIter iter;
+  gpointer value;
 
-  while (l)
+  g_hash_table_iter_init (&iter, self->pending);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
     {
-      if (pw_node_get_id (PW_NODE (l->data)) == id)
-        return l->data;
+      PendingNode *pend = value;
+
+      if (self->synced && now - pend->born < (gint64) self->hold_off * 1000)
+        continue;
 
-      l = l->next;
+      pw_pipewire_add_node (G_OBJECT (self), pend->data);
+      for (guint i = 0; i < pend->ports->len; i++)
+        {
+          PwPadData *port = &g_array_index (pend->ports, PwPadData, i);
+          g_hash_table_remove (self->pending_ports, GUINT_TO_POINTER (port->id));
+          pw_pipewire_add_pad (G_OBJECT (self), *port);
+        }
+      g_hash_table_iter_remove (&iter);
     }
-  return NULL;
+
+  GList *links = g_steal_pointer (&self->pending_links);
+  for (GList *l = links; l; l = l->next)
+    pipewire_add_or_hold_link (self, l->data);
+  g_list_free_full (links, g_free);
 }
 
-static PwPad *
-pw_pipewire_get_pad_by_id (GObject *this, gint id)
+static void
+pipewire_index_spec_link (PwPipewire *self, guint32 port_id, guint32 link_id)
 {
-  g_return_val_if_fail (PW_IS_PIPEWIRE (this), NULL);
-  PwPipewire *pw = PW_PIPEWIRE (this);
-  GList *l = pw->pads;
+  GArray *links = g_hash_table_lookup (self->spec_links, GUINT_TO_POINTER (port_id));
 
-  while (l)
+  if (!links)
     {
-      if (pw_pad_get_id (PW_PAD (l->data)) == id)
-        return l->data;
-
-      l = l->next;
+      links = g_array_new (FALSE, FALSE, sizeof (guint32));
+      g_hash_table_insert (self->spec_links, GUINT_TO_POINTER (port_id), links);
     }
-  return NULL;
+  g_array_append_val (links, link_id);
 }
 
-static PwLinkData *
-pw_pipewire_get_link_by_id (GObject *this, gint id)
+static void
+pipewire_unindex_spec_link (PwPipewire *self, guint32 port_id, guint32 link_id)
 {
-  g_return_val_if_fail (PW_IS_PIPEWIRE (this), NULL);
-  PwPipewire *pw = PW_PIPEWIRE (this);
-  GList *l = pw->links;
+  GArray *links = g_hash_table_lookup (self->spec_links, GUINT_TO_POINTER (port_id));
+
+  for (guint i = 0; links && i < links->len; i++)
+    if (g_array_index (links, guint32, i) == link_id)
+      {
+        g_array_remove_index_fast (links, i);
+        break;
+      }
+}
 
-  while (l)
+/*
+ * Shows the graph of the last run before the registry has been enumerated.
+ * The cached objects get speculative ids and are matched with live objects
+ * as these arrive: nodes by key, ports by name and direction within their
+ * node and links by their ports. What is left over at the initial sync is
+ * stale and removed, what didn't match is added as usual.
+ */
+static void
+pipewire_warm_start (PwPipewire *self)
+{
+  g_autofree char *path = pw_graph_cache_get_default_path ();
+  g_autoptr (PwGraphCache) cache = pw_graph_cache_load (path);
+  g_autoptr (GHashTable) ids = NULL; // cached id -> speculative id
+  guint32 next_id = SPECULATIVE_ID;
+  gpointer out, in, parent;
+
+  if (!cache)
+    return;
+
+  ids = g_hash_table_new (NULL, NULL);
+
+  for (guint i = 0; i < cache->nodes->len; i++)
+    {
+      PwGraphCacheNode *cn = &g_array_index (cache->nodes, PwGraphCacheNode, i);
+
+      // without a key it could never be matched
+      if (!*cn->key || g_hash_table_contains (self->spec_nodes, cn->key))
+        continue;
+
+      PwGraphNode *node = pw_graph_add_node (self->graph, next_id, cn->title,
+                                             cn->key, cn->type, CAT_OTHER);
+      node->x = cn->x;
+      node->y = cn->y;
+      node->placed = TRUE;
+      g_hash_table_insert (self->spec_nodes, g_strdup (cn->key), GUINT_TO_POINTER (next_id));
+      g_hash_table_insert (ids, GUINT_TO_POINTER (cn->id), GUINT_TO_POINTER (next_id++));
+    }
+
+  for (guint i = 0; i < cache->ports->len; i++)
     {
-      if (((PwPadData *) l->data)->id == id)
-        return l->data;
+      PwGraphCachePort *cp = &g_array_index (cache->ports, PwGraphCachePort, i);
+
+      if (!g_hash_table_lookup_extended (ids, GUINT_TO_POINTER (cp->parent_id), NULL, &parent)
+          || !pw_graph_add_port (self->graph, next_id, GPOINTER_TO_UINT (parent),
+                                 cp->name, cp->direction))
+        continue;
 
-      l = l->next;
+      g_hash_table_insert (ids, GUINT_TO_POINTER (cp->id), GUINT_TO_POINTER (next_id++));
     }
-  return NULL;
+
+  for (guint i = 0; i < cache->links->len; i++)
+    {
+      PwGraphCacheLink *cl = &g_array_index (cache->links, PwGraphCacheLink, i);
+
+      if (!g_hash_table_lookup_extended (ids, GUINT_TO_POINTER (cl->out), NULL, &out)
+          || !g_hash_table_lookup_extended (ids, GUINT_TO_POINTER (cl->in), NULL, &in))
+        continue;
+
+      pw_graph_add_link (self->graph, next_id, GPOINTER_TO_UINT (out), GPOINTER_TO_UINT (in));
+      pipewire_index_spec_link (self, GPOINTER_TO_UINT (out), next_id);
+      pipewire_index_spec_link (self, GPOINTER_TO_UINT (in), next_id);
+      next_id++;
+    }
+
+  self->speculating = g_hash_table_size (self->spec_nodes) > 0;
+  pw_view_controller_flush_changes (G_OBJECT (self));
 }
 
-static void
-pw_pipewire_node_to_front (GObject *this, gint id)
+// takes over the speculative node with the same key, if there is one
+static gboolean
+pipewire_claim_node (PwPipewire *self, PwNodeData *dat)
 {
-  g_return_if_fail (PW_IS_PIPEWIRE (this));
-  PwPipewire *pw = PW_PIPEWIRE (this);
+  gpointer old_id;
 
-  PwNode *n = pw_pipewire_get_node_by_id (G_OBJECT (pw), id);
+  if (!self->speculating || !dat->key
+      || !g_hash_table_lookup_extended (self->spec_nodes, dat->key, NULL, &old_id)
+      || !pw_graph_rekey (self->graph, GPOINTER_TO_UINT (old_id), dat->id))
+    return FALSE;
 
-  GList *elem = g_list_find (pw->nodes, n);
-  pw->nodes = g_list_remove_link (pw->nodes, elem);
+  PwGraphNode *node = pw_graph_lookup_node (self->graph, dat->id);
+  pw_graph_set_node_title (self->graph, node, dat->title);
+  node->type = dat->type;
+  node->category = dat->category;
+  pw_graph_mark_changed (self->graph, PW_OBJECT_NODE, dat->id);
+  g_hash_table_remove (self->spec_nodes, dat->key);
 
-  // NULL because of last to snapshot is one in front
-  pw->nodes = g_list_insert_before_link (pw->nodes, NULL, elem);
+  return TRUE;
 }
 
-static GList *
-pw_pipewire_get_node_list (GObject *this)
+// takes over an unmatched port of a matched node that has the same name
+static gboolean
+pipewire_claim_port (PwPipewire *self, PwPadData *dat)
 {
-  g_return_val_if_fail (PW_IS_PIPEWIRE (this), NULL);
-  PwPipewire *pw = PW_PIPEWIRE (this);
-  return pw->nodes;
+  PwGraphNode *node;
+  GArray *links;
+
+  if (!self->speculating
+      || (dat->direction != PW_PAD_DIRECTION_OUT && dat->direction != PW_PAD_DIRECTION_IN)
+      || !(node = pw_graph_lookup_node (self->graph, dat->parent_id)))
+    return FALSE;
+
+  GArray *ports = pw_graph_node_get_ports (node, dat->direction);
+  for (guint i = 0; i < ports->len; i++)
+    {
+      guint32 old_id = g_array_index (ports, guint32, i);
+      PwGraphPort *port = pw_graph_lookup_port (self->graph, old_id);
+
+      if (!IS_SPECULATIVE (old_id) || !port || g_strcmp0 (port->name, dat->name) != 0
+          || !pw_graph_rekey (self->graph, old_id, dat->id))
+        continue;
+
+      // links keep the ids of their ports, so follow them by hand
+      if (g_hash_table_steal_extended (self->spec_links, GUINT_TO_POINTER (old_id),
+                                       NULL, (gpointer *) &links))
+        {
+          for (guint j = 0; j < links->len; j++)
+            {
+              PwGraphLink *link = pw_graph_lookup_link (self->graph, g_array_index (links, guint32, j));
+              if (!link)
+                continue;
+              if (link->out == old_id)
+                link->out = dat->id;
+              if (link->in == old_id)
+                link->in = dat->id;
+              pw_graph_mark_changed (self->graph, PW_OBJECT_LINK, link->id);
+            }
+          g_hash_table_insert (self->spec_links, GUINT_TO_POINTER (dat->id), links);
+        }
+      return TRUE;
+    }
+
+  return FALSE;
 }
 
-static GList *
-pw_pipewire_get_link_list (GObject *this)
+// takes over the speculative link between the same, already matched ports
+static gboolean
+pipewire_claim_link (PwPipewire *self, PwLinkData *dat)
 {
-  g_return_val_if_fail (PW_IS_PIPEWIRE (this), NULL);
-  PwPipewire *pw = PW_PIPEWIRE (this);
-  return pw->links;
+  GArray *links;
+
+  if (!self->speculating
+      || !(links = g_hash_table_lookup (self->spec_links, GUINT_TO_POINTER (dat->out))))
+    return FALSE;
+
+  for (guint i = 0; i < links->len; i++)
+    {
+      guint32 old_id = g_array_index (links, guint32, i);
+      PwGraphLink *link = pw_graph_lookup_link (self->graph, old_id);
+
+      if (!link || link->out != dat->out || link->in != dat->in
+          || !pw_graph_rekey (self->graph, old_id, dat->id))
+        continue;
+
+      pipewire_unindex_spec_link (self, dat->out, old_id);
+      pipewire_unindex_spec_link (self, dat->in, old_id);
+      return TRUE;
+    }
+
+  return FALSE;
 }
 
+// the registry is enumerated, whatever of the cache wasn't matched is gone
 static void
-pw_view_controller_iface_init (PwViewControllerInterface *iface)
+pipewire_drop_speculative (PwPipewire *self)
 {
-  iface->add_node = pw_pipewire_add_node;
-  iface->add_pad = pw_pipewire_add_pad;
-  iface->add_link = pw_pipewire_add_link;
-  iface->remove = pw_pipewire_remove;
-  iface->get_node_by_id = pw_pipewire_get_node_by_id;
-  iface->get_pad_by_id = pw_pipewire_get_pad_by_id;
-  iface->node_to_front = pw_pipewire_node_to_front;
-  iface->get_node_list = pw_pipewire_get_node_list;
-  iface->get_link_list = pw_pipewire_get_link_list;
+  g_autoptr (GArray) stale = g_array_new (FALSE, FALSE, sizeof (guint32));
+  guint n_nodes, n_ports, n_links;
+
+  if (!self->speculating)
+    return;
+
+  g_hash_table_remove_all (self->spec_links);
+  g_hash_table_remove_all (self->spec_nodes);
+  self->speculating = FALSE;
+
+  PwGraphNode *nodes = pw_graph_get_nodes (self->graph, &n_nodes);
+  PwGraphPort *ports = pw_graph_get_ports (self->graph, &n_ports);
+  PwGraphLink *links = pw_graph_get_links (self->graph, &n_links);
+  for (guint i = 0; i < n_links; i++)
+    if (IS_SPECULATIVE (links[i].id))
+      g_array_append_val (stale, links[i].id);
+  for (guint i = 0; i < n_ports; i++)
+    if (IS_SPECULATIVE (ports[i].id))
+      g_array_append_val (stale, ports[i].id);
+  for (guint i = 0; i < n_nodes; i++)
+    if (IS_SPECULATIVE (nodes[i].id))
+      g_array_append_val (stale, nodes[i].id);
+
+  for (guint i = 0; i < stale->len; i++)
+    pw_graph_remove (self->graph, g_array_index (stale, guint32, i));
 }
 
+// written on the way out, read by pipewire_warm_start on the next run
 static void
-pw_free_recv_queue (void *data)
+pipewire_save_graph (PwPipewire *self)
 {
-  Message *msg = data;
+  g_autoptr (PwGraphCache) cache = NULL;
+  g_autofree char *path = NULL;
+  g_autoptr (GError) error = NULL;
+  guint n_nodes, n_links;
 
-  switch (msg->type)
+  // until then, the graph may still be the one of the last run
+  if (!self->synced)
+    return;
+
+  cache = pw_graph_cache_new ();
+
+  PwGraphStackIter iter;
+  PwGraphNode *node;
+  pw_graph_stack_iter_init (&iter, self->graph);
+  while ((node = pw_graph_stack_iter_next (&iter)))
     {
-    case MSG_NODE_ADDED:
-      {
-        PwNodeData *dat = msg->data;
-        free ((void *) dat->title);
-      }
-      break;
-    case MSG_PORT_ADDED:
-      {
-        PwPadData *dat = msg->data;
-        free ((void *) dat->name);
-      }
-      break;
-    case MSG_LINK_ADDED:
-      g_free(msg->data);
-      break;
-    case MSG_REMOVED:
-      free (msg->data);
-    default:
-      break;
+      if (!node->key)
+        continue;
+
+      PwGraphCacheNode cn = { node->id, g_strdup (node->key), g_strdup (node->title),
+                              node->type, node->x, node->y };
+      g_array_append_val (cache->nodes, cn);
     }
-  free (msg);
+
+  // the order of the ports within their node is kept
+  PwGraphNode *nodes = pw_graph_get_nodes (self->graph, &n_nodes);
+  for (guint i = 0; i < n_nodes; i++)
+    {
+      for (int dir = PW_PAD_DIRECTION_OUT; dir <= PW_PAD_DIRECTION_IN; dir++)
+        {
+          GArray *ids = pw_graph_node_get_ports (&nodes[i], dir);
+          for (guint j = 0; j < ids->len; j++)
+            {
+              PwGraphPort *port = pw_graph_lookup_port (self->graph, g_array_index (ids, guint32, j));
+              PwGraphCachePort cp = { port->id, port->parent_id, g_strdup (port->name), port->direction };
+              g_array_append_val (cache->ports, cp);
+            }
+        }
+    }
+
+  PwGraphLink *links = pw_graph_get_links (self->graph, &n_links);
+  for (guint i = 0; i < n_links; i++)
+    {
+      PwGraphCacheLink cl = { links[i].id, links[i].out, links[i].in };
+      g_array_append_val (cache->links, cl);
+    }
+
+  path = pw_graph_cache_get_default_path ();
+  if (!pw_graph_cache_save (cache, path, &error))
+    g_warning ("Saving the graph cache failed: %s", error->message);
 }
 
 static void
@@ -461,26 +825,72 @@ default_changed_handler (PwPipewire *self, gpointer user_data)
   while (g_async_queue_length (self->pw_recv))
     {
       msg = g_async_queue_pop (self->pw_recv);
+      self->handled++;
 
       switch (msg->type)
         {
         case MSG_NODE_ADDED:
-          pw_pipewire_add_node (G_OBJECT (self), self->canvas,
-                                *(PwNodeData *) msg->data);
+          {
+            // everything that is there before the initial sync is long-lived
+            PwNodeData *dat = msg->data;
+            if (self->synced && self->hold_off > 0)
+              {
+                pipewire_hold_node (self, dat);
+                dat->title = NULL;
+                dat->key = NULL;
+              }
+            else if (!pipewire_claim_node (self, dat))
+              pw_pipewire_add_node (G_OBJECT (self), *dat);
+          }
           break;
         case MSG_PORT_ADDED:
-          pw_pipewire_add_pad (G_OBJECT (self), *(PwPadData *) msg->data);
+          {
+            PwPadData *dat = msg->data;
+            PendingNode *pend = g_hash_table_lookup (self->pending, GUINT_TO_POINTER (dat->parent_id));
+            if (pend)
+              {
+                g_array_append_val (pend->ports, *dat);
+                g_hash_table_insert (self->pending_ports, GUINT_TO_POINTER (dat->id),
+                                     GUINT_TO_POINTER (dat->parent_id));
+                dat->name = NULL;
+              }
+            else if (!pipewire_claim_port (self, dat))
+              pw_pipewire_add_pad (G_OBJECT (self), *dat);
+          }
           break;
         case MSG_LINK_ADDED:
-          pw_pipewire_add_link (G_OBJECT (self), *(PwLinkData *) msg->data);
+          if (!pipewire_claim_link (self, msg->data))
+            pipewire_add_or_hold_link (self, msg->data);
           break;
         case MSG_REMOVED:
-          pw_pipewire_remove (G_OBJECT (self), *(guint32 *) msg->data);
+        case MSG_FILTERED:
+          if (!pipewire_remove_pending (self, *(guint32 *) msg->data, msg->type == MSG_REMOVED))
+            pw_pipewire_remove (G_OBJECT (self), *(guint32 *) msg->data);
+          break;
+        case MSG_SYNC_DONE:
+          self->synced = TRUE;
+          self->replay_synced = self->replay != NULL;
+          pipewire_drop_speculative (self);
           break;
         case MSG_OTHER:
         default:
           break;
         }
+
+      pw_free_recv_queue (msg);
+    }
+
+  pipewire_flush_pending (self);
+  pw_view_controller_flush_changes (G_OBJECT (self));
+
+  if (self->replay_synced)
+    {
+      guint n_nodes;
+      pw_graph_get_nodes (self->graph, &n_nodes);
+      g_message ("Replay: %u events ingested and %u nodes placed in %.1f ms",
+                 self->replay_count, n_nodes,
+                 (g_get_monotonic_time () - self->replay_start) / 1000.0);
+      self->replay_synced = FALSE;
     }
 }
 
@@ -490,10 +900,29 @@ pw_pipewire_init (PwPipewire *self)
   self->idle_id = 0;
   self->pw_recv = g_async_queue_new_full (pw_free_recv_queue);
   spa_zero (self->reg_listener);
-
-  self->nodes = NULL;
-  self->pads = NULL;
-  self->links = NULL;
+  spa_zero (self->core_listener);
+
+  self->graph = pw_graph_new ();
+
+  self->synced = FALSE;
+  self->suppressed = 0;
+  self->pending = g_hash_table_new_full (NULL, NULL, NULL, free_pending_node);
+  self->pending_ports = g_hash_table_new (NULL, NULL);
+  self->pending_links = NULL;
+  self->speculating = FALSE;
+  self->spec_nodes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->spec_links = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+
+  self->filter_rules = NULL;
+  self->filter = NULL;
+  self->globals = g_hash_table_new_full (NULL, NULL, NULL, free_cached_global);
+  self->recorder = NULL;
+
+  self->replay = NULL;
+  self->replay_pending = FALSE;
+  self->replay_timer = NULL;
+  self->replay_count = 0;
+  self->replay_synced = FALSE;
 }
 
 ////////////////////////
@@ -557,6 +986,20 @@ port_get_category(const struct spa_dict *props)
   return res;
 }
 
+// the same node name can show up on several devices, so qualify it
+static char *
+reg_node_key (const struct spa_dict *props)
+{
+  const char *name = spa_dict_lookup (props, PW_KEY_NODE_NAME);
+  const char *path = spa_dict_lookup (props, PW_KEY_OBJECT_PATH);
+  const char *device = spa_dict_lookup (props, PW_KEY_DEVICE_NAME);
+
+  if (!name && !path && !device)
+    return NULL;
+
+  return g_strjoin ("|", name ? name : "", path ? path : "", device ? device : "", NULL);
+}
+
 static void
 reg_fill_node (Message *msg, guint32 id, const struct spa_dict *props)
 {
@@ -576,6 +1019,7 @@ reg_fill_node (Message *msg, guint32 id, const struct spa_dict *props)
 
   dat->id = id;
   dat->title = g_strdup (name);
+  dat->key = reg_node_key (props);
   dat->type = type;
   dat->category = cat;
 
@@ -630,7 +1074,6 @@ reg_fill_link (Message *msg, guint32 id, const struct spa_dict *props)
     g_error ("'out' returned NULL\n");
   dat->out = atoi (str);
   dat->id = id;
-  dat->selected = false;
 
   msg->data = dat;
 }
@@ -646,14 +1089,11 @@ print_obj(guint32 id, const char *type, const struct spa_dict *props)
   printf("--------------------------------------------\n");
 }
 
-static void
-reg_event_global (void *data, guint32 id, guint32 permissions, const char *type, guint32 version, const struct spa_dict *props)
+static Message *
+reg_build_message (PwPipewire *self, MessageType type, guint32 id, const struct spa_dict *props)
 {
-  PwPipewire *self = PW_PIPEWIRE (data);
   Message *msg = malloc (sizeof (Message));
-  msg->type = reg_get_type (type);
-
-  // print_obj(id, type, props);
+  msg->type = type;
 
   switch (msg->type)
     {
@@ -669,19 +1109,18 @@ reg_event_global (void *data, guint32 id, guint32 permissions, const char *type,
     case MSG_OTHER:
     default:
       free (msg);
-      return;
+      return NULL;
     }
 
-  g_async_queue_push (self->pw_recv, msg);
+  return msg;
 }
 
 static void
-remove_event_global (void *data, uint32_t id)
+push_removed (PwPipewire *self, guint32 id, MessageType type)
 {
-  PwPipewire *self = PW_PIPEWIRE (data);
   Message *msg = malloc (sizeof (Message));
 
-  msg->type = MSG_REMOVED;
+  msg->type = type;
 
   msg->data = malloc (sizeof (guint32));
   *(guint32 *) msg->data = id;
@@ -689,32 +1128,338 @@ remove_event_global (void *data, uint32_t id)
   g_async_queue_push (self->pw_recv, msg);
 }
 
+static guint32
+dict_lookup_id (const struct spa_dict *props, const char *key)
+{
+  const char *str = spa_dict_lookup (props, key);
+  return str ? (guint32) atoi (str) : SPA_ID_INVALID;
+}
+
+static CachedGlobal *
+cache_global (PwPipewire *self, guint32 id, MessageType type, const struct spa_dict *props)
+{
+  CachedGlobal *g = g_new0 (CachedGlobal, 1);
+
+  g->id = id;
+  g->type = type;
+  g->n_items = props ? props->n_items : 0;
+  g->items = g_new (struct spa_dict_item, g->n_items);
+  for (guint32 i = 0; i < g->n_items; i++)
+    {
+      g->items[i].key = g_strdup (props->items[i].key);
+      g->items[i].value = g_strdup (props->items[i].value);
+    }
+
+  if (type == MSG_PORT_ADDED)
+    {
+      g->deps[0] = dict_lookup_id (props, PW_KEY_NODE_ID);
+      g->deps[1] = SPA_ID_INVALID;
+    }
+  else if (type == MSG_LINK_ADDED)
+    {
+      g->deps[0] = dict_lookup_id (props, PW_KEY_LINK_OUTPUT_PORT);
+      g->deps[1] = dict_lookup_id (props, PW_KEY_LINK_INPUT_PORT);
+    }
+  else
+    {
+      g->deps[0] = g->deps[1] = SPA_ID_INVALID;
+    }
+
+  g_hash_table_insert (self->globals, GUINT_TO_POINTER (id), g);
+  return g;
+}
+
+// ports of hidden nodes and links of hidden ports are hidden as well
+static gboolean
+global_is_hidden (PwPipewire *self, CachedGlobal *g)
+{
+  struct spa_dict dict = SPA_DICT_INIT (g->items, g->n_items);
+
+  for (int i = 0; i < 2; i++)
+    {
+      CachedGlobal *dep = g_hash_table_lookup (self->globals, GUINT_TO_POINTER (g->deps[i]));
+      if (dep && dep->hidden)
+        return TRUE;
+    }
+
+  return self->filter && pw_object_filter_match (self->filter, &dict);
+}
+
+/*
+ * Re-evaluates the cached objects against a new filter. Only objects whose
+ * visibility changed produce messages: removals go out links first and
+ * additions nodes first, so the handler always sees parents before children.
+ * Called with the thread loop locked.
+ */
+static void
+pipewire_refilter (PwPipewire *self)
+{
+  static const MessageType order[] = { MSG_NODE_ADDED, MSG_PORT_ADDED, MSG_LINK_ADDED };
+  g_autoptr (GPtrArray) changed = g_ptr_array_new ();
+  GHashTableIter iter;
+  gpointer value;
+
+  for (guint i = 0; i < G_N_ELEMENTS (order); i++)
+    {
+      g_hash_table_iter_init (&iter, self->globals);
+      while (g_hash_table_iter_next (&iter, NULL, &value))
+        {
+          CachedGlobal *g = value;
+          if (g->type != order[i])
+            continue;
+
+          gboolean hidden = global_is_hidden (self, g);
+          if (hidden != g->hidden)
+            {
+              g->hidden = hidden;
+              g_ptr_array_add (changed, g);
+            }
+        }
+    }
+
+  for (guint i = changed->len; i > 0; i--)
+    {
+      CachedGlobal *g = g_ptr_array_index (changed, i - 1);
+      if (g->hidden)
+        push_removed (self, g->id, MSG_FILTERED);
+    }
+
+  for (guint i = 0; i < changed->len; i++)
+    {
+      CachedGlobal *g = g_ptr_array_index (changed, i);
+      if (!g->hidden)
+        {
+          struct spa_dict dict = SPA_DICT_INIT (g->items, g->n_items);
+          g_async_queue_push (self->pw_recv, reg_build_message (self, g->type, g->id, &dict));
+        }
+    }
+}
+
+static void
+pipewire_set_filter_rules (PwPipewire *self, const char *const *rules)
+{
+  PwObjectFilter *filter = pw_object_filter_new (rules);
+
+  if (self->loop)
+    pw_thread_loop_lock (self->loop);
+
+  g_clear_pointer (&self->filter, pw_object_filter_free);
+  self->filter = filter;
+  g_strfreev (self->filter_rules);
+  self->filter_rules = g_strdupv ((char **) rules);
+  pipewire_refilter (self);
+
+  if (self->loop)
+    pw_thread_loop_unlock (self->loop);
+}
+
+static void
+reg_event_global (void *data, guint32 id, guint32 permissions, const char *type, guint32 version, const struct spa_dict *props)
+{
+  PwPipewire *self = PW_PIPEWIRE (data);
+  MessageType msg_type = reg_get_type (type);
+
+  // print_obj(id, type, props);
+
+  if (self->recorder)
+    pw_registry_log_writer_global (self->recorder, id, type, version, props);
+
+  if (msg_type == MSG_OTHER)
+    return;
+
+  // filtered objects are only cached, they never reach the main thread
+  CachedGlobal *g = cache_global (self, id, msg_type, props);
+  g->hidden = global_is_hidden (self, g);
+  if (g->hidden)
+    return;
+
+  g_async_queue_push (self->pw_recv, reg_build_message (self, msg_type, id, props));
+}
+
+static void
+remove_event_global (void *data, uint32_t id)
+{
+  PwPipewire *self = PW_PIPEWIRE (data);
+  CachedGlobal *g = g_hash_table_lookup (self->globals, GUINT_TO_POINTER (id));
+
+  if (self->recorder)
+    pw_registry_log_writer_remove (self->recorder, id);
+
+  if (!g)
+    return;
+
+  gboolean hidden = g->hidden;
+  g_hash_table_remove (self->globals, GUINT_TO_POINTER (id));
+  if (!hidden)
+    push_removed (self, id, MSG_REMOVED);
+}
+
 static const struct pw_registry_events
     registry_events = { PW_VERSION_REGISTRY_EVENTS, .global = reg_event_global,
                         .global_remove = remove_event_global };
 
+static void
+push_sync_done (PwPipewire *self)
+{
+  Message *msg = malloc (sizeof (Message));
+  msg->type = MSG_SYNC_DONE;
+  msg->data = NULL;
+  g_async_queue_push (self->pw_recv, msg);
+}
+
+static void
+core_event_done (void *data, uint32_t id, int seq)
+{
+  PwPipewire *self = PW_PIPEWIRE (data);
+
+  if (id != PW_ID_CORE || seq != self->sync_seq)
+    return;
+
+  if (self->recorder)
+    pw_registry_log_writer_sync (self->recorder);
+  push_sync_done (self);
+}
+
+static const struct pw_core_events
+    core_events = { PW_VERSION_CORE_EVENTS, .done = core_event_done };
+
 static gboolean
 idle_check_query (gpointer data)
 {
   PwPipewire *self = PW_PIPEWIRE (data);
-  if (g_async_queue_length (self->pw_recv) != 0)
+  if (g_async_queue_length (self->pw_recv) != 0
+      || g_hash_table_size (self->pending) != 0
+      || self->pending_links)
     g_signal_emit (self, signals[SIG_CHANGED], 0);
   return G_SOURCE_CONTINUE;
 }
 
+/*
+ * Feeds the events of the log through the same handlers the registry
+ * calls, on the thread loop. In real time every event waits for its
+ * timestamp, otherwise they all go in one go.
+ */
+static void
+replay_timer_cb (void *data, uint64_t expirations)
+{
+  PwPipewire *self = PW_PIPEWIRE (data);
+  PwRegistryLogEvent *ev = &self->replay_event;
+  gint64 elapsed = g_get_monotonic_time () - self->replay_start;
+
+  while (self->replay_pending
+         || (self->replay_pending = pw_registry_log_reader_next (self->replay, ev)))
+    {
+      if (self->replay_realtime && ev->time > elapsed)
+        {
+          struct timespec value;
+          gint64 wait = ev->time - elapsed;
+
+          value.tv_sec = wait / G_USEC_PER_SEC;
+          value.tv_nsec = (wait % G_USEC_PER_SEC) * 1000;
+          pw_loop_update_timer (pw_thread_loop_get_loop (self->loop),
+                                self->replay_timer, &value, NULL, false);
+          return;
+        }
+
+      switch (ev->kind)
+        {
+        case PW_REGISTRY_LOG_GLOBAL:
+          reg_event_global (self, ev->id, PW_PERM_ALL, ev->type, ev->version, &ev->props);
+          break;
+        case PW_REGISTRY_LOG_REMOVE:
+          remove_event_global (self, ev->id);
+          break;
+        case PW_REGISTRY_LOG_SYNC:
+          push_sync_done (self);
+          break;
+        default:
+          break;
+        }
+
+      self->replay_count++;
+      self->replay_pending = FALSE;
+    }
+}
+
+static gboolean
+pipewire_start_replay (PwPipewire *self, const char *path)
+{
+  g_autoptr (GError) error = NULL;
+  struct timespec now = { 0, 1 };
+
+  self->replay = pw_registry_log_reader_new (path, &error);
+  if (!self->replay)
+    {
+      g_warning ("Can't replay %s: %s", path, error->message);
+      return FALSE;
+    }
+
+  self->replay_realtime = !g_strcmp0 (g_getenv ("PATCHWORK_REPLAY_REALTIME"), "true");
+  self->loop = pw_thread_loop_new ("pipewire_replay", NULL);
+  self->replay_timer = pw_loop_add_timer (pw_thread_loop_get_loop (self->loop),
+                                          replay_timer_cb, self);
+  self->replay_start = g_get_monotonic_time ();
+
+  pw_thread_loop_lock (self->loop);
+  pw_loop_update_timer (pw_thread_loop_get_loop (self->loop), self->replay_timer,
+                        &now, NULL, false);
+  pw_thread_loop_unlock (self->loop);
+  pw_thread_loop_start (self->loop);
+  self->idle_id = g_timeout_add (150, idle_check_query, self);
+
+  return TRUE;
+}
+
+/*
+ * PATCHWORK_REPLAY=<log> ingests a recording instead of connecting to the
+ * daemon, PATCHWORK_RECORD=<log> records the session.
+ */
 void
 pw_pipewire_run (PwPipewire *self)
 {
+  const char *replay = g_getenv ("PATCHWORK_REPLAY");
+  const char *record = g_getenv ("PATCHWORK_RECORD");
+
+  // without the graph cache, so every replay starts the same
+  if (replay && pipewire_start_replay (self, replay))
+    return;
+
   self->loop = pw_thread_loop_new ("pipewire_thrd", NULL);
   self->context = pw_context_new (pw_thread_loop_get_loop (self->loop), NULL, 0);
   self->core = pw_context_connect (self->context, NULL, 0);
 
+  if (record)
+    {
+      g_autoptr (GError) error = NULL;
+      self->recorder = pw_registry_log_writer_new (record, &error);
+      if (!self->recorder)
+        g_warning ("Not recording: %s", error->message);
+    }
+
+  pipewire_warm_start (self);
+
   self->registry = pw_core_get_registry (self->core, PW_VERSION_CORE, 0);
   pw_registry_add_listener (self->registry, &self->reg_listener,
                             &registry_events, self);
+  pw_core_add_listener (self->core, &self->core_listener, &core_events, self);
+  self->sync_seq = pw_core_sync (self->core, PW_ID_CORE, 0);
 
   pw_thread_loop_start (self->loop);
   self->idle_id = g_timeout_add (150, idle_check_query, self);
 }
 
+guint64
+pw_pipewire_get_handled_messages (PwPipewire *self)
+{
+  g_return_val_if_fail (PW_IS_PIPEWIRE (self), 0);
+  return self->handled;
+}
+
+guint
+pw_pipewire_get_queue_depth (PwPipewire *self)
+{
+  g_return_val_if_fail (PW_IS_PIPEWIRE (self), 0);
+  return g_async_queue_length (self->pw_recv);
+}
+
 #pragma GCC diagnostic pop
@@ -1,6 +1,5 @@
 #pragma once
 
-#include "pw-canvas.h"
 #include <glib-object.h>
 
 G_BEGIN_DECLS
@@ -9,8 +8,14 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE (PwPipewire, pw_pipewire, PW, PIPEWIRE, GObject)
 
-PwPipewire *pw_pipewire_new (PwCanvas *canvas);
+PwPipewire *pw_pipewire_new (void);
 
 void pw_pipewire_run (PwPipewire *self);
 
+// registry messages taken off the queue so far
+guint64 pw_pipewire_get_handled_messages (PwPipewire *self);
+
+// registry messages waiting to be handled
+guint pw_pipewire_get_queue_depth (PwPipewire *self);
+
 G_END_DECLS
@@ -0,0 +1,48 @@
+#include "pw-pool.h"
+
+/*
+ * Returns: (transfer full) (nullable): a pooled object, or %NULL if the
+ * caller has to construct a new one
+ */
+gpointer
+pw_pool_take (PwPool *pool)
+{
+  if (!pool->free || pool->free->len == 0)
+    {
+      pool->misses++;
+      return NULL;
+    }
+
+  pool->hits++;
+  return g_ptr_array_steal_index_fast (pool->free, pool->free->len - 1);
+}
+
+// takes over the caller's reference to @object
+void
+pw_pool_give (PwPool *pool, gpointer object)
+{
+  g_return_if_fail (G_IS_OBJECT (object));
+
+  if (!pool->free)
+    pool->free = g_ptr_array_new_full (pool->capacity, g_object_unref);
+
+  pool->released++;
+  if (pool->free->len >= pool->capacity)
+    {
+      pool->dropped++;
+      g_object_unref (object);
+      return;
+    }
+
+  g_ptr_array_add (pool->free, object);
+}
+
+void
+pw_pool_get_stats (PwPool *pool, PwPoolStats *stats)
+{
+  stats->hits = pool->hits;
+  stats->misses = pool->misses;
+  stats->released = pool->released;
+  stats->dropped = pool->dropped;
+  stats->pooled = pool->free ? pool->free->len : 0;
+}
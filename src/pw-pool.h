@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A bounded free list of objects that are expensive to construct. The pool
+ * owns one reference to every object it holds.
+ */
+typedef struct
+{
+  GPtrArray *free;
+  guint capacity;
+  guint hits, misses, released, dropped;
+} PwPool;
+
+typedef struct
+{
+  guint hits;     // acquisitions served from the pool
+  guint misses;   // acquisitions that had to construct
+  guint released; // objects handed back
+  guint dropped;  // objects destroyed because the pool was full
+  guint pooled;   // objects currently waiting in the pool
+} PwPoolStats;
+
+#define PW_POOL_INIT(cap) { NULL, (cap), 0, 0, 0, 0 }
+
+gpointer pw_pool_take (PwPool *pool);
+
+void pw_pool_give (PwPool *pool, gpointer object);
+
+void pw_pool_get_stats (PwPool *pool, PwPoolStats *stats);
+
+G_END_DECLS
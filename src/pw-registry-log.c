@@ -0,0 +1,266 @@
+#include "pw-registry-log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * A header followed by one record per event, all little endian:
+ *
+ *   "PWRL" | u32 version
+ *   u8 kind | i64 time | u32 id
+ *   globals continue with
+ *     u32 version | type | u32 items * ( key | value )
+ *
+ * Strings are a u32 length, the bytes and a NUL, so events can point into
+ * the mapped file instead of copying every property.
+ */
+
+#define MAGIC "PWRL"
+#define VERSION 1
+
+struct _PwRegistryLogWriter
+{
+  FILE *file;
+  gint64 start;
+  GByteArray *buf; // the record being written
+};
+
+struct _PwRegistryLogReader
+{
+  GMappedFile *file;
+  const guint8 *data;
+  gsize len, off;
+  GArray *items; // struct spa_dict_item of the last global
+};
+
+static void
+write_u32 (GByteArray *buf, guint32 val)
+{
+  val = GUINT32_TO_LE (val);
+  g_byte_array_append (buf, (const guint8 *) &val, sizeof (val));
+}
+
+static void
+write_str (GByteArray *buf, const char *str)
+{
+  guint32 len = str ? strlen (str) : 0;
+
+  write_u32 (buf, len);
+  g_byte_array_append (buf, (const guint8 *) (str ? str : ""), len + 1);
+}
+
+static void
+writer_begin (PwRegistryLogWriter *self, PwRegistryLogKind kind, guint32 id)
+{
+  guint8 k = kind;
+  gint64 time = GINT64_TO_LE (g_get_monotonic_time () - self->start);
+
+  g_byte_array_set_size (self->buf, 0);
+  g_byte_array_append (self->buf, &k, 1);
+  g_byte_array_append (self->buf, (const guint8 *) &time, sizeof (time));
+  write_u32 (self->buf, id);
+}
+
+static void
+writer_commit (PwRegistryLogWriter *self)
+{
+  if (fwrite (self->buf->data, 1, self->buf->len, self->file) != self->buf->len)
+    g_warning ("Can't write the registry log: %s", g_strerror (errno));
+}
+
+/**
+ * pw_registry_log_writer_new:
+ *
+ * Starts a recording in @path, replacing what is there. The clock starts
+ * now.
+ */
+PwRegistryLogWriter *
+pw_registry_log_writer_new (const char *path, GError **error)
+{
+  FILE *file = fopen (path, "wb");
+  PwRegistryLogWriter *self;
+
+  if (!file)
+    {
+      int saved_errno = errno;
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                   "Can't open %s: %s", path, g_strerror (saved_errno));
+      return NULL;
+    }
+
+  self = g_new (PwRegistryLogWriter, 1);
+  self->file = file;
+  self->start = g_get_monotonic_time ();
+  self->buf = g_byte_array_new ();
+
+  g_byte_array_append (self->buf, (const guint8 *) MAGIC, 4);
+  write_u32 (self->buf, VERSION);
+  writer_commit (self);
+
+  return self;
+}
+
+void
+pw_registry_log_writer_free (PwRegistryLogWriter *self)
+{
+  if (fclose (self->file) != 0)
+    g_warning ("Can't write the registry log: %s", g_strerror (errno));
+  g_byte_array_unref (self->buf);
+  g_free (self);
+}
+
+void
+pw_registry_log_writer_global (PwRegistryLogWriter *self, guint32 id,
+                               const char *type, guint32 version,
+                               const struct spa_dict *props)
+{
+  guint32 n_items = props ? props->n_items : 0;
+
+  writer_begin (self, PW_REGISTRY_LOG_GLOBAL, id);
+  write_u32 (self->buf, version);
+  write_str (self->buf, type);
+  write_u32 (self->buf, n_items);
+  for (guint32 i = 0; i < n_items; i++)
+    {
+      write_str (self->buf, props->items[i].key);
+      write_str (self->buf, props->items[i].value);
+    }
+  writer_commit (self);
+}
+
+void
+pw_registry_log_writer_remove (PwRegistryLogWriter *self, guint32 id)
+{
+  writer_begin (self, PW_REGISTRY_LOG_REMOVE, id);
+  writer_commit (self);
+}
+
+void
+pw_registry_log_writer_sync (PwRegistryLogWriter *self)
+{
+  writer_begin (self, PW_REGISTRY_LOG_SYNC, 0);
+  writer_commit (self);
+  fflush (self->file);
+}
+
+static gboolean
+read_u32 (PwRegistryLogReader *r, guint32 *val)
+{
+  if (r->len - r->off < sizeof (guint32))
+    return FALSE;
+
+  memcpy (val, r->data + r->off, sizeof (guint32));
+  *val = GUINT32_FROM_LE (*val);
+  r->off += sizeof (guint32);
+  return TRUE;
+}
+
+static gboolean
+read_str (PwRegistryLogReader *r, const char **str)
+{
+  guint32 len;
+
+  if (!read_u32 (r, &len) || r->len - r->off <= len || r->data[r->off + len] != '\0')
+    return FALSE;
+
+  *str = (const char *) r->data + r->off;
+  r->off += len + 1;
+  return TRUE;
+}
+
+/**
+ * pw_registry_log_reader_new:
+ * @path: file written by a PwRegistryLogWriter
+ *
+ * Returns: a reader at the first event, or %NULL if @path can't be read or
+ *   isn't a registry log
+ */
+PwRegistryLogReader *
+pw_registry_log_reader_new (const char *path, GError **error)
+{
+  GMappedFile *file = g_mapped_file_new (path, FALSE, error);
+  PwRegistryLogReader *self;
+  guint32 version;
+
+  if (!file)
+    return NULL;
+
+  self = g_new (PwRegistryLogReader, 1);
+  self->file = file;
+  self->data = (const guint8 *) g_mapped_file_get_contents (file);
+  self->len = g_mapped_file_get_length (file);
+  self->off = 4;
+  self->items = g_array_new (FALSE, FALSE, sizeof (struct spa_dict_item));
+
+  if (self->len < 4 || memcmp (self->data, MAGIC, 4) != 0
+      || !read_u32 (self, &version) || version != VERSION)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                   "%s is not a registry log", path);
+      pw_registry_log_reader_free (self);
+      return NULL;
+    }
+
+  return self;
+}
+
+void
+pw_registry_log_reader_free (PwRegistryLogReader *self)
+{
+  g_mapped_file_unref (self->file);
+  g_array_unref (self->items);
+  g_free (self);
+}
+
+/**
+ * pw_registry_log_reader_next:
+ *
+ * Reads the next event into @event.
+ *
+ * Returns: %FALSE at the end, a truncated last record counts as the end
+ */
+gboolean
+pw_registry_log_reader_next (PwRegistryLogReader *self, PwRegistryLogEvent *event)
+{
+  gint64 time;
+  guint32 n_items;
+
+  if (self->len - self->off < 1 + sizeof (time))
+    return FALSE;
+
+  event->kind = self->data[self->off++];
+  memcpy (&time, self->data + self->off, sizeof (time));
+  event->time = GINT64_FROM_LE (time);
+  self->off += sizeof (time);
+  event->version = 0;
+  event->type = NULL;
+  event->props = SPA_DICT_INIT (NULL, 0);
+
+  if (!read_u32 (self, &event->id))
+    return FALSE;
+
+  switch (event->kind)
+    {
+    case PW_REGISTRY_LOG_GLOBAL:
+      if (!read_u32 (self, &event->version) || !read_str (self, &event->type)
+          || !read_u32 (self, &n_items))
+        return FALSE;
+
+      g_array_set_size (self->items, 0);
+      for (guint32 i = 0; i < n_items; i++)
+        {
+          struct spa_dict_item item;
+          if (!read_str (self, &item.key) || !read_str (self, &item.value))
+            return FALSE;
+          g_array_append_val (self->items, item);
+        }
+      event->props = SPA_DICT_INIT ((struct spa_dict_item *) self->items->data, self->items->len);
+      return TRUE;
+    case PW_REGISTRY_LOG_REMOVE:
+    case PW_REGISTRY_LOG_SYNC:
+      return TRUE;
+    default:
+      g_warning ("Unknown record in the registry log, stopping there");
+      return FALSE;
+    }
+}
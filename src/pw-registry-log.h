@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glib.h>
+#include <spa/utils/dict.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A recording of the registry events of a session, to feed the same
+ * objects through ingestion again without a daemon. Every event carries
+ * the time it was seen, in microseconds since the recording started.
+ */
+typedef enum
+{
+  PW_REGISTRY_LOG_GLOBAL,
+  PW_REGISTRY_LOG_REMOVE,
+  PW_REGISTRY_LOG_SYNC, // the initial enumeration is done
+} PwRegistryLogKind;
+
+typedef struct
+{
+  PwRegistryLogKind kind;
+  gint64 time;
+  guint32 id;
+  guint32 version;
+  const char *type;
+  struct spa_dict props; // valid until the next event is read
+} PwRegistryLogEvent;
+
+typedef struct _PwRegistryLogWriter PwRegistryLogWriter;
+
+typedef struct _PwRegistryLogReader PwRegistryLogReader;
+
+PwRegistryLogWriter *pw_registry_log_writer_new (const char *path, GError **error);
+
+void pw_registry_log_writer_free (PwRegistryLogWriter *self);
+
+void pw_registry_log_writer_global (PwRegistryLogWriter *self, guint32 id,
+                                    const char *type, guint32 version,
+                                    const struct spa_dict *props);
+
+void pw_registry_log_writer_remove (PwRegistryLogWriter *self, guint32 id);
+
+void pw_registry_log_writer_sync (PwRegistryLogWriter *self);
+
+PwRegistryLogReader *pw_registry_log_reader_new (const char *path, GError **error);
+
+void pw_registry_log_reader_free (PwRegistryLogReader *self);
+
+gboolean pw_registry_log_reader_next (PwRegistryLogReader *self, PwRegistryLogEvent *event);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwRegistryLogWriter, pw_registry_log_writer_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PwRegistryLogReader, pw_registry_log_reader_free)
+
+G_END_DECLS
@@ -0,0 +1,55 @@
+#include "pw-stats.h"
+#include <string.h>
+
+// upper ends in µs, a frame at 60 Hz takes 16.7 ms
+static const gint64 bucket_limits[PW_STATS_N_BUCKETS] = { 8400, 16700, 33400, 50000, 100000, G_MAXINT64 };
+static const char *const bucket_names[PW_STATS_N_BUCKETS] = { "≤8", "≤17", "≤33", "≤50", "≤100", ">100" };
+
+void
+pw_stats_frame (PwStats *self, gint64 time, guint64 messages)
+{
+  if (self->last_frame)
+    {
+      self->head = (self->head + 1) % PW_STATS_HISTORY;
+      self->intervals[self->head] = time - self->last_frame;
+      self->n_intervals = MIN (self->n_intervals + 1, PW_STATS_HISTORY);
+    }
+  self->last_frame = time;
+
+  self->messages_per_frame = messages - self->messages;
+  self->messages = messages;
+}
+
+gdouble
+pw_stats_get_fps (const PwStats *self)
+{
+  gint64 total = 0;
+  guint n = 0;
+
+  while (n < self->n_intervals && total < G_USEC_PER_SEC)
+    total += self->intervals[(self->head + PW_STATS_HISTORY - n++) % PW_STATS_HISTORY];
+
+  return total ? n * (gdouble) G_USEC_PER_SEC / total : 0;
+}
+
+void
+pw_stats_get_histogram (const PwStats *self, guint *counts)
+{
+  memset (counts, 0, PW_STATS_N_BUCKETS * sizeof (guint));
+
+  for (guint i = 0; i < self->n_intervals; i++)
+    {
+      gint64 interval = self->intervals[(self->head + PW_STATS_HISTORY - i) % PW_STATS_HISTORY];
+      guint b = 0;
+      while (interval > bucket_limits[b])
+        b++;
+      counts[b]++;
+    }
+}
+
+const char *
+pw_stats_get_bucket_name (guint bucket)
+{
+  g_return_val_if_fail (bucket < PW_STATS_N_BUCKETS, NULL);
+  return bucket_names[bucket];
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Where the frames of the canvas go, gathered while it draws and shown by
+ * its statistics overlay.
+ */
+typedef enum
+{
+  PW_STATS_BG,
+  PW_STATS_NODES,
+  PW_STATS_LINKS,
+  PW_STATS_RUBBERBAND,
+  PW_STATS_N_PHASES,
+} PwStatsPhase;
+
+#define PW_STATS_HISTORY 240 // frame intervals kept
+#define PW_STATS_N_BUCKETS 6
+
+typedef struct
+{
+  gint64 last_frame; // µs, 0 before the first one
+  gint64 intervals[PW_STATS_HISTORY]; // µs, a ring ending at head
+  guint head, n_intervals;
+
+  gint64 allocate_us; // the last size_allocate
+  gint64 snapshot_us[PW_STATS_N_PHASES]; // the last frame
+  guint links_drawn, links_culled;
+  guint n_nodes, n_pads; // widgets
+
+  guint64 messages; // registry messages handled up to the last frame
+  guint messages_per_frame;
+  guint queue_depth; // registry messages waiting at the last frame
+} PwStats;
+
+// a frame was drawn at @time, by when the controller had handled @messages
+void pw_stats_frame (PwStats *self, gint64 time, guint64 messages);
+
+// over the last second of frames
+gdouble pw_stats_get_fps (const PwStats *self);
+
+// how many of the kept intervals fall in each bucket, see pw_stats_get_bucket_name()
+void pw_stats_get_histogram (const PwStats *self, guint *counts);
+
+const char *pw_stats_get_bucket_name (guint bucket);
+
+G_END_DECLS
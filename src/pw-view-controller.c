@@ -13,19 +13,27 @@ static gint signals[N_SIG];
 static void
 pw_view_controller_default_init (PwViewControllerInterface *iface)
 {
+  /**
+   * PwViewController::change-notify:
+   * @changes: (type PwChangeSet): what changed in the graph, only valid
+   *   during the emission
+   *
+   * Emitted once per batch of changes to the graph.
+   */
   signals[SIG_CHANGE_NOTIFY]
       = g_signal_new ("change-notify", G_TYPE_FROM_INTERFACE (iface),
-                      G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+                      G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1,
+                      G_TYPE_POINTER);
 }
 
 void
-pw_view_controller_add_node (GObject *this, PwCanvas *canv, PwNodeData nod)
+pw_view_controller_add_node (GObject *this, PwNodeData nod)
 {
   PwViewControllerInterface *iface;
   g_return_if_fail (PW_IS_VIEW_CONTROLLER (this));
 
   iface = PW_VIEW_CONTROLLER_GET_IFACE (this);
-  iface->add_node (this, canv, nod);
+  iface->add_node (this, nod);
 }
 void
 pw_view_controller_add_link (GObject *this, PwLinkData link)
@@ -57,52 +65,46 @@ pw_view_controller_remove (GObject *this, gint id)
   return iface->remove(this, id);
 }
 
-PwNode*
-pw_view_controller_get_node_by_id (GObject* this, gint id)
-{
-  PwViewControllerInterface *iface;
-  g_return_val_if_fail (PW_IS_VIEW_CONTROLLER (this),NULL);
-
-  iface = PW_VIEW_CONTROLLER_GET_IFACE (this);
-  return iface->get_node_by_id (this, id);
-}
-
-PwPad*
-pw_view_controller_get_pad_by_id (GObject* this, gint id)
+void
+pw_view_controller_link_pads (GObject *this, guint32 out, guint32 in)
 {
   PwViewControllerInterface *iface;
-  g_return_val_if_fail (PW_IS_VIEW_CONTROLLER (this),NULL);
+  g_return_if_fail (PW_IS_VIEW_CONTROLLER (this));
 
   iface = PW_VIEW_CONTROLLER_GET_IFACE (this);
-  return iface->get_pad_by_id (this, id);
+  iface->link_pads (this, out, in);
 }
 
 void
-pw_view_controller_node_to_front(GObject *this, gint nod)
+pw_view_controller_unlink (GObject *this, guint32 link)
 {
   PwViewControllerInterface *iface;
   g_return_if_fail (PW_IS_VIEW_CONTROLLER (this));
 
   iface = PW_VIEW_CONTROLLER_GET_IFACE (this);
-  iface->node_to_front (this, nod);
+  iface->unlink (this, link);
 }
 
-GList*
-pw_view_controller_get_node_list (GObject *this)
+PwGraph*
+pw_view_controller_get_graph (GObject *this)
 {
   PwViewControllerInterface *iface;
   g_return_val_if_fail (PW_IS_VIEW_CONTROLLER (this), NULL);
 
   iface = PW_VIEW_CONTROLLER_GET_IFACE (this);
-  return iface->get_node_list (this);
+  return iface->get_graph (this);
 }
 
-GList*
-pw_view_controller_get_link_list (GObject *this)
+// emits what the graph collected since the last time, if anything
+void
+pw_view_controller_flush_changes (GObject *this)
 {
-  PwViewControllerInterface *iface;
-  g_return_val_if_fail (PW_IS_VIEW_CONTROLLER (this), NULL);
+  g_return_if_fail (PW_IS_VIEW_CONTROLLER (this));
+  PwChangeSet *changes = pw_graph_get_changes (pw_view_controller_get_graph (this));
 
-  iface = PW_VIEW_CONTROLLER_GET_IFACE (this);
-  return iface->get_link_list (this);
+  if (pw_change_set_is_empty (changes))
+    return;
+
+  g_signal_emit (this, signals[SIG_CHANGE_NOTIFY], 0, changes);
+  pw_change_set_clear (changes);
 }
@@ -1,7 +1,6 @@
 #pragma once
 
-#include "pw-canvas.h"
-#include "pw-node.h"
+#include "pw-graph.h"
 #include <glib-object.h>
 
 G_BEGIN_DECLS
@@ -10,6 +9,7 @@ typedef struct
 {
   guint32 id;
   const char *title;
+  const char *key; // stays the same when the node comes back, may be NULL
   gint type;
   gint category;
 } PwNodeData;
@@ -26,7 +26,6 @@ typedef struct
 {
   guint32 id;
   guint32 in, out; // IDs
-  bool selected;
 } PwLinkData;
 
 #define PW_TYPE_VIEW_CONTROLLER (pw_view_controller_get_type ())
@@ -38,28 +37,27 @@ struct _PwViewControllerInterface
 {
   GTypeInterface parent;
 
-  void (*add_node) (GObject *self, PwCanvas *canv, PwNodeData nod);
+  void (*add_node) (GObject *self, PwNodeData nod);
   void (*add_pad) (GObject *self, PwPadData pad);
   void (*add_link) (GObject *self, PwLinkData link);
   gboolean (*remove) (GObject *self, gint id);
-  PwNode* (*get_node_by_id) (GObject* self, gint id);
-  PwPad* (*get_pad_by_id) (GObject* self, gint id);
-  void (*node_to_front) (GObject *self, gint nod);
-  GList* (*get_node_list) (GObject *self);
-  GList* (*get_link_list) (GObject *self);
+  void (*link_pads) (GObject *self, guint32 out, guint32 in);
+  void (*unlink) (GObject *self, guint32 link);
+  PwGraph* (*get_graph) (GObject *self);
 };
 
-void pw_view_controller_add_node (GObject *self, PwCanvas *canv,
-                                  PwNodeData nod);
+void pw_view_controller_add_node (GObject *self, PwNodeData nod);
 void pw_view_controller_add_link (GObject *self, PwLinkData link);
 void pw_view_controller_add_pad (GObject *self, PwPadData pad);
 gboolean pw_view_controller_remove (GObject *self, gint id);
-PwNode* pw_view_controller_get_node_by_id (GObject* self, gint id);
 
-// 2nd parameter refers to type of pad
-PwPad* pw_view_controller_get_pad_by_id (GObject* self, gint id);
-void pw_view_controller_node_to_front(GObject *self, gint nod);
-GList* pw_view_controller_get_node_list (GObject *self);
-GList* pw_view_controller_get_link_list (GObject *self);
+// asks for a link between two ports, it shows up in the graph once it exists
+void pw_view_controller_link_pads (GObject *self, guint32 out, guint32 in);
+
+// asks for a link to go, it leaves the graph once it is gone
+void pw_view_controller_unlink (GObject *self, guint32 link);
+PwGraph* pw_view_controller_get_graph (GObject *self);
+
+void pw_view_controller_flush_changes (GObject *self);
 
 G_END_DECLS
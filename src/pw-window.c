@@ -23,12 +23,14 @@
 #include "pw-canvas.h"
 #include "pw-window.h"
 #include "pw-zoom-entry.h"
+#include "pw-pipewire.h"
 
 struct _PwWindow
 {
   AdwApplicationWindow parent_instance;
 
   GtkCssProvider *prov;
+  GSettings *settings;
 
   /* Template widgets */
   GtkHeaderBar *header_bar;
@@ -45,6 +47,7 @@ pw_window_dispose(GObject* object)
 
   gtk_widget_dispose_template(GTK_WIDGET(self), PW_TYPE_WINDOW);
   g_clear_object(&self->prov);
+  g_clear_object(&self->settings);
 
   G_OBJECT_CLASS(pw_window_parent_class)->dispose(object);
 }
@@ -64,6 +67,19 @@ pw_window_update_zoom_entry(PwWindow   *self,
   gtk_adjustment_set_value(adj, pw_canvas_get_zoom(canv)*100);
 }
 
+static void
+pw_window_arrange_action(GSimpleAction *action,
+                         GVariant      *parameter,
+                         gpointer       user_data)
+{
+  PwWindow *self = user_data;
+  pw_canvas_arrange(self->main_vp);
+}
+
+static const GActionEntry win_actions[] = {
+  { "arrange", pw_window_arrange_action },
+};
+
 static void
 pw_window_class_init (PwWindowClass *klass)
 {
@@ -95,11 +111,40 @@ theme_notify_cb (AdwStyleManager* man, GParamSpec* pspec, PwWindow* self)
   }
 }
 
+// the schema is missing when running uninstalled, keep the defaults then
+static void
+pw_window_bind_settings(PwWindow *self)
+{
+  GSettingsSchemaSource *source = g_settings_schema_source_get_default();
+  g_autoptr(GSettingsSchema) schema = NULL;
+  g_autoptr(GObject) controller = NULL;
+
+  if(source)
+    schema = g_settings_schema_source_lookup(source, "org.nidi.patchwork", TRUE);
+  if(!schema)
+    return;
+
+  self->settings = g_settings_new_full(schema, NULL, NULL);
+  g_object_get(self->main_vp, "controller", &controller, NULL);
+
+  // a generated graph has nothing to filter or hold off
+  if(!PW_IS_PIPEWIRE(controller))
+    return;
+  g_settings_bind(self->settings, "hidden-objects", controller, "filter-rules", G_SETTINGS_BIND_GET);
+  g_settings_bind(self->settings, "node-hold-off", controller, "hold-off", G_SETTINGS_BIND_GET);
+}
+
 static void
 pw_window_init (PwWindow *self)
 {
   GtkWidget* widget = GTK_WIDGET(self);
   gtk_widget_init_template (GTK_WIDGET (self));
+  g_action_map_add_action_entries (G_ACTION_MAP (self), win_actions,
+                                   G_N_ELEMENTS (win_actions), self);
+  g_autoptr(GPropertyAction) relax = g_property_action_new ("relax", self->main_vp, "relaxing");
+  g_action_map_add_action (G_ACTION_MAP (self), G_ACTION (relax));
+  g_autoptr(GPropertyAction) stats = g_property_action_new ("show-stats", self->main_vp, "show-stats");
+  g_action_map_add_action (G_ACTION_MAP (self), G_ACTION (stats));
 
   GdkDisplay *disp = gtk_widget_get_display (GTK_WIDGET (self));
   self->prov = gtk_css_provider_new();
@@ -116,4 +161,6 @@ pw_window_init (PwWindow *self)
 
   gtk_style_context_add_provider_for_display(disp, GTK_STYLE_PROVIDER(main_css),
                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  pw_window_bind_settings(self);
 }